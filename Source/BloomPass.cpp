@@ -0,0 +1,746 @@
+///////////////////////////////////////////////////////////////////////////////
+// BloomPass.cpp
+// =============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `BloomPass` class, which adds bloom to the HDR
+// scene color of the frame graph, and the naive gaussian bloom it is
+// compared with.
+//
+// FUNCTIONALITY:
+// - Downsample the scene into six half resolution mip levels in a single
+//   dispatch: every work group filters a 64x64 block of the scene into a
+//   32x32 tile in shared memory, stores it as the first level and keeps
+//   halving the tile in shared memory for the levels below.
+// - Upsample from the smallest level with a 3x3 tent filter, one dispatch
+//   per level; each work group loads the lower level texels it needs into
+//   shared memory once and adds the filtered result to its own level.
+// - Add the first level to the scene color in a last dispatch.
+// - As the baseline, blur a bright pass at half resolution with a 49 tap
+//   gaussian in a horizontal and a vertical fragment pass.
+// - Time either method under its own profiler name, optionally switching
+//   between them, and report the averages.
+//
+// NOTES:
+// The single dispatch downsample stops at the sixth level, where a work
+// group's tile has become one texel; smaller levels would need work groups
+// to wait for each other. The first level soft-thresholds the scene and
+// weights its four taps by inverse luma, so that a single very bright
+// pixel does not flicker through the chain. Without compute shaders only
+// the gaussian method is available.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "BloomPass.h"
+#include "GLDebugOutput.h"
+#include "ShaderUtils.h"
+
+#include <iomanip>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* const g_MethodNames[BloomPass::METHOD_COUNT] = { "chain", "gaussian" };
+	// name of the passes of each method in the GPU profiler
+	const char* const g_ProfileNames[BloomPass::METHOD_COUNT] = { "Bloom chain", "Bloom gaussian" };
+
+	// work group edge of the upsample and composite dispatches
+	const int g_WorkGroupSize = 8;
+	// scene pixels covered by one work group of the downsample
+	const int g_DownsampleTile = 64;
+	// half width of the gaussian, in half resolution texels
+	const int g_GaussianRadius = 24;
+
+	// soft threshold shared by both methods; x = threshold, y = knee
+	const char* g_PrefilterFunction =
+		"uniform vec2 threshold;\n"
+		"vec3 Prefilter(vec3 color)\n"
+		"{\n"
+		"	float brightness = max(color.r, max(color.g, color.b));\n"
+		"	float soft = clamp(brightness - threshold.x + threshold.y, 0.0, 2.0 * threshold.y);\n"
+		"	soft = soft * soft / (4.0 * threshold.y + 1e-5);\n"
+		"	return(color * max(soft, brightness - threshold.x) / max(brightness, 1e-5));\n"
+		"}\n"
+		"// four bilinear taps over the 4x4 scene pixels around uv\n"
+		"vec3 DownsampleScene(sampler2D colorTexture, vec2 uv, vec2 texelSize)\n"
+		"{\n"
+		"	vec3 sum = vec3(0.0);\n"
+		"	float weights = 0.0;\n"
+		"	for (int i = 0; i < 4; i++)\n"
+		"	{\n"
+		"		vec2 offset = vec2(i & 1, i >> 1) * 2.0 - 1.0;\n"
+		"		vec3 color = textureLod(colorTexture, uv + offset * texelSize, 0.0).rgb;\n"
+		"		float weight = 1.0 / (1.0 + dot(color, vec3(0.2126, 0.7152, 0.0722)));\n"
+		"		sum += color * weight;\n"
+		"		weights += weight;\n"
+		"	}\n"
+		"	return(Prefilter(sum / weights));\n"
+		"}\n";
+
+	// all levels of the chain from one dispatch of 64x64 blocks
+	const char* g_DownsampleShader =
+		"layout(local_size_x = 16, local_size_y = 16) in;\n"
+		"uniform sampler2D colorTexture;\n"
+		"uniform int levelCount;\n"
+		"layout(rgba16f, binding = 0) writeonly uniform image2D levels[6];\n"
+		"shared vec4 tile[32][32];\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 group = ivec2(gl_WorkGroupID.xy);\n"
+		"	ivec2 local = ivec2(gl_LocalInvocationID.xy);\n"
+		"	vec2 texelSize = 1.0 / vec2(textureSize(colorTexture, 0));\n"
+		"	for (int i = 0; i < 4; i++)\n"
+		"	{\n"
+		"		ivec2 position = local * 2 + ivec2(i & 1, i >> 1);\n"
+		"		ivec2 texel = group * 32 + position;\n"
+		"		vec4 color = vec4(DownsampleScene(colorTexture, (vec2(texel) * 2.0 + 1.0) * texelSize, texelSize), 1.0);\n"
+		"		tile[position.y][position.x] = color;\n"
+		"		if (all(lessThan(texel, imageSize(levels[0]))))\n"
+		"		{\n"
+		"			imageStore(levels[0], texel, color);\n"
+		"		}\n"
+		"	}\n"
+		"	barrier();\n"
+		"	int size = 32;\n"
+		"	for (int level = 1; level < levelCount; level++)\n"
+		"	{\n"
+		"		size /= 2;\n"
+		"		bool bActive = all(lessThan(local, ivec2(size)));\n"
+		"		vec4 color = vec4(0.0);\n"
+		"		if (bActive)\n"
+		"		{\n"
+		"			ivec2 source = local * 2;\n"
+		"			color = 0.25 * (tile[source.y][source.x] + tile[source.y][source.x + 1] +\n"
+		"				tile[source.y + 1][source.x] + tile[source.y + 1][source.x + 1]);\n"
+		"			ivec2 texel = group * size + local;\n"
+		"			if (all(lessThan(texel, imageSize(levels[level]))))\n"
+		"			{\n"
+		"				imageStore(levels[level], texel, color);\n"
+		"			}\n"
+		"		}\n"
+		"		barrier();\n"
+		"		if (bActive)\n"
+		"		{\n"
+		"			tile[local.y][local.x] = color;\n"
+		"		}\n"
+		"		barrier();\n"
+		"	}\n"
+		"}\n";
+
+	// adds the tent filtered lower level to a level of the chain
+	const char* g_UpsampleShader =
+		"layout(local_size_x = 8, local_size_y = 8) in;\n"
+		"layout(rgba16f, binding = 0) uniform image2D targetLevel;\n"
+		"layout(rgba16f, binding = 1) readonly uniform image2D lowerLevel;\n"
+		"shared vec4 tile[8][8];\n"
+		"vec4 Bilinear(vec2 position)\n"
+		"{\n"
+		"	ivec2 base = ivec2(floor(position));\n"
+		"	vec2 fraction = position - vec2(base);\n"
+		"	vec4 bottom = mix(tile[base.y][base.x], tile[base.y][base.x + 1], fraction.x);\n"
+		"	vec4 top = mix(tile[base.y + 1][base.x], tile[base.y + 1][base.x + 1], fraction.x);\n"
+		"	return(mix(bottom, top, fraction.y));\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	// the 8x8 outputs of a group need 4x4 lower texels and a\n"
+		"	// border of two for the tent and the bilinear taps\n"
+		"	ivec2 origin = ivec2(gl_WorkGroupID.xy) * 4 - 2;\n"
+		"	ivec2 local = ivec2(gl_LocalInvocationID.xy);\n"
+		"	tile[local.y][local.x] = imageLoad(lowerLevel, clamp(origin + local, ivec2(0), imageSize(lowerLevel) - 1));\n"
+		"	barrier();\n"
+		"	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+		"	if (any(greaterThanEqual(texel, imageSize(targetLevel))))\n"
+		"	{\n"
+		"		return;\n"
+		"	}\n"
+		"	vec2 center = (vec2(texel) + 0.5) * 0.5 - 0.5 - vec2(origin);\n"
+		"	vec4 sum = vec4(0.0);\n"
+		"	for (int y = -1; y <= 1; y++)\n"
+		"	{\n"
+		"		for (int x = -1; x <= 1; x++)\n"
+		"		{\n"
+		"			sum += Bilinear(center + vec2(x, y)) * float((2 - abs(x)) * (2 - abs(y))) / 16.0;\n"
+		"		}\n"
+		"	}\n"
+		"	imageStore(targetLevel, texel, imageLoad(targetLevel, texel) + sum);\n"
+		"}\n";
+
+	// adds the top of the chain to the scene color
+	const char* g_CompositeShader =
+		"layout(local_size_x = 8, local_size_y = 8) in;\n"
+		"uniform sampler2D colorTexture;\n"
+		"uniform sampler2D bloomTexture;\n"
+		"uniform float intensity;\n"
+		"layout(rgba16f, binding = 0) writeonly uniform image2D targetImage;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+		"	ivec2 size = imageSize(targetImage);\n"
+		"	if (any(greaterThanEqual(texel, size)))\n"
+		"	{\n"
+		"		return;\n"
+		"	}\n"
+		"	vec4 color = texelFetch(colorTexture, texel, 0);\n"
+		"	vec3 bloom = textureLod(bloomTexture, (vec2(texel) + 0.5) / vec2(size), 0.0).rgb;\n"
+		"	imageStore(targetImage, texel, vec4(color.rgb + bloom * intensity, color.a));\n"
+		"}\n";
+
+	// half resolution bright pass of the gaussian method
+	const char* g_BrightShader =
+		"uniform sampler2D colorTexture;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 texelSize = 1.0 / vec2(textureSize(colorTexture, 0));\n"
+		"	vec2 uv = floor(gl_FragCoord.xy) * 2.0 * texelSize + texelSize;\n"
+		"	fragmentColor = vec4(DownsampleScene(colorTexture, uv, texelSize), 1.0);\n"
+		"}\n";
+
+	// one direction of the wide gaussian, one fetch per tap
+	const char* g_BlurShader =
+		"uniform sampler2D sourceTexture;\n"
+		"uniform ivec2 direction;\n"
+		"uniform int radius;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 size = textureSize(sourceTexture, 0);\n"
+		"	ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"	float sigma = float(radius) / 3.0;\n"
+		"	vec3 sum = vec3(0.0);\n"
+		"	float weights = 0.0;\n"
+		"	for (int i = -radius; i <= radius; i++)\n"
+		"	{\n"
+		"		float weight = exp(-float(i * i) / (2.0 * sigma * sigma));\n"
+		"		sum += texelFetch(sourceTexture, clamp(texel + direction * i, ivec2(0), size - 1), 0).rgb * weight;\n"
+		"		weights += weight;\n"
+		"	}\n"
+		"	fragmentColor = vec4(sum / weights, 1.0);\n"
+		"}\n";
+
+	// adds the blurred bright pass to the scene color
+	const char* g_BlendShader =
+		"uniform sampler2D colorTexture;\n"
+		"uniform sampler2D bloomTexture;\n"
+		"uniform float intensity;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"	vec4 color = texelFetch(colorTexture, texel, 0);\n"
+		"	vec3 bloom = texture(bloomTexture, gl_FragCoord.xy / vec2(textureSize(colorTexture, 0))).rgb;\n"
+		"	fragmentColor = vec4(color.rgb + bloom * intensity, color.a);\n"
+		"}\n";
+
+	/***********************************************************
+	 *  LinkComputeProgram()
+	 *
+	 *  Link a compute shader, with the prefilter when asked.
+	 ***********************************************************/
+	GLuint LinkComputeProgram(const char* source, bool bPrefilter, const std::string& name)
+	{
+		std::string text = "#version 430 core\n";
+		text += bPrefilter ? g_PrefilterFunction : "";
+		text += source;
+		std::vector<GLuint> shaders;
+		shaders.push_back(ShaderUtils::CompileShader(GL_COMPUTE_SHADER, text, name + ".comp"));
+		return(ShaderUtils::LinkProgram(shaders, name));
+	}
+
+	/***********************************************************
+	 *  LinkFullscreenProgram()
+	 *
+	 *  Link a fragment shader with the fullscreen triangle.
+	 ***********************************************************/
+	GLuint LinkFullscreenProgram(const char* source, bool bPrefilter, const std::string& name)
+	{
+		std::string text = "#version 410 core\n";
+		text += bPrefilter ? g_PrefilterFunction : "";
+		text += source;
+		std::vector<GLuint> shaders;
+		shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, ShaderUtils::FULLSCREEN_VERTEX_SHADER, name + ".vert"));
+		shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, text, name + ".frag"));
+		return(ShaderUtils::LinkProgram(shaders, name));
+	}
+}
+
+/***********************************************************
+ *  BloomPass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+BloomPass::BloomPass()
+{
+	m_pGpuProfiler = NULL;
+	m_downsampleProgram = 0;
+	m_upsampleProgram = 0;
+	m_compositeProgram = 0;
+	m_brightProgram = 0;
+	m_blurProgram = 0;
+	m_blendProgram = 0;
+	m_vertexArray = 0;
+	m_chainTexture = 0;
+	m_chainWidth = 0;
+	m_chainHeight = 0;
+	m_levelCount = 0;
+	m_bCompute = false;
+	m_method = METHOD_CHAIN;
+	m_lastMethod = -1;
+	m_cycleFrames = 0;
+	m_frameCount = 0;
+	m_threshold = 1.0f;
+	m_knee = 0.5f;
+	m_intensity = 0.5f;
+}
+
+/***********************************************************
+ *  ~BloomPass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+BloomPass::~BloomPass()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the programs of both methods, the
+ *  chain only when the context has compute shaders.
+ ***********************************************************/
+bool BloomPass::Initialize()
+{
+	m_bCompute = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_image_load_store);
+	if (m_bCompute)
+	{
+		m_downsampleProgram = LinkComputeProgram(g_DownsampleShader, true, "bloom.downsample");
+		m_upsampleProgram = LinkComputeProgram(g_UpsampleShader, false, "bloom.upsample");
+		m_compositeProgram = LinkComputeProgram(g_CompositeShader, false, "bloom.composite");
+		m_bCompute = (m_downsampleProgram != 0) && (m_upsampleProgram != 0) && (m_compositeProgram != 0);
+	}
+	if (!m_bCompute)
+	{
+		std::cout << "INFO: Bloom falls back to gaussian passes without compute shaders" << std::endl;
+		m_method = METHOD_GAUSSIAN;
+		m_cycleFrames = 0;
+	}
+
+	m_brightProgram = LinkFullscreenProgram(g_BrightShader, true, "bloom.bright");
+	m_blurProgram = LinkFullscreenProgram(g_BlurShader, false, "bloom.blur");
+	m_blendProgram = LinkFullscreenProgram(g_BlendShader, false, "bloom.blend");
+	glGenVertexArrays(1, &m_vertexArray);
+
+	if ((m_brightProgram == 0) || (m_blurProgram == 0) || (m_blendProgram == 0) || (m_vertexArray == 0))
+	{
+		std::cout << "WARNING: Bloom is disabled, its programs could not be built" << std::endl;
+		Destroy();
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the programs and the mip chain.
+ ***********************************************************/
+void BloomPass::Destroy()
+{
+	GLuint* programs[] = { &m_downsampleProgram, &m_upsampleProgram, &m_compositeProgram,
+		&m_brightProgram, &m_blurProgram, &m_blendProgram };
+	for (int i = 0; i < 6; i++)
+	{
+		if (*programs[i] != 0)
+		{
+			glDeleteProgram(*programs[i]);
+			*programs[i] = 0;
+		}
+	}
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (m_chainTexture != 0)
+	{
+		glDeleteTextures(1, &m_chainTexture);
+		m_chainTexture = 0;
+	}
+	m_chainWidth = 0;
+	m_chainHeight = 0;
+	m_levelCount = 0;
+}
+
+/***********************************************************
+ *  SetMethod()
+ *
+ *  This method selects the method, keeping the gaussian
+ *  one when the chain is not available.
+ ***********************************************************/
+void BloomPass::SetMethod(METHOD method)
+{
+	if ((method < 0) || (method >= METHOD_COUNT) || ((method == METHOD_CHAIN) && !m_bCompute))
+	{
+		return;
+	}
+	m_method = method;
+}
+
+/***********************************************************
+ *  ParseMethod()
+ *
+ *  This method looks up a method by its name.
+ ***********************************************************/
+bool BloomPass::ParseMethod(const std::string& name, METHOD* pMethod)
+{
+	for (int i = 0; i < METHOD_COUNT; i++)
+	{
+		if (name == g_MethodNames[i])
+		{
+			*pMethod = (METHOD)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetMethodName()
+ *
+ *  This method returns the name of a method.
+ ***********************************************************/
+const char* BloomPass::GetMethodName(METHOD method)
+{
+	return(((method >= 0) && (method < METHOD_COUNT)) ? g_MethodNames[method] : "unknown");
+}
+
+/***********************************************************
+ *  AllocateChain()
+ *
+ *  This method creates the mip chain at half the scene size
+ *  with as many levels as fit, up to MAX_LEVELS.
+ ***********************************************************/
+void BloomPass::AllocateChain(int width, int height)
+{
+	int chainWidth = (width / 2 > 1) ? width / 2 : 1;
+	int chainHeight = (height / 2 > 1) ? height / 2 : 1;
+	if ((m_chainTexture != 0) && (chainWidth == m_chainWidth) && (chainHeight == m_chainHeight))
+	{
+		return;
+	}
+
+	if (m_chainTexture != 0)
+	{
+		glDeleteTextures(1, &m_chainTexture);
+	}
+	m_chainWidth = chainWidth;
+	m_chainHeight = chainHeight;
+	m_levelCount = 1;
+	while ((m_levelCount < MAX_LEVELS) && ((chainWidth >> m_levelCount) > 0) && ((chainHeight >> m_levelCount) > 0))
+	{
+		m_levelCount++;
+	}
+
+	glGenTextures(1, &m_chainTexture);
+	glBindTexture(GL_TEXTURE_2D, m_chainTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_levelCount, GL_RGBA16F, m_chainWidth, m_chainHeight);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GLDebugOutput::LabelObject(GL_TEXTURE, m_chainTexture, "texture:bloom.chain");
+}
+
+/***********************************************************
+ *  AddPasses()
+ *
+ *  This method declares the passes of the current method
+ *  and returns the color with bloom.
+ ***********************************************************/
+FrameGraph::RESOURCE BloomPass::AddPasses(FrameGraph& graph, FrameGraph::RESOURCE color)
+{
+	if (m_blendProgram == 0)
+	{
+		return(color);
+	}
+
+	// alternate the methods so the report can compare them
+	if ((m_cycleFrames > 0) && (m_frameCount > 0) && ((m_frameCount % m_cycleFrames) == 0))
+	{
+		SetMethod((METHOD)((m_method + 1) % METHOD_COUNT));
+	}
+	m_frameCount++;
+	if (m_lastMethod != (int)m_method)
+	{
+		std::cout << "INFO: Bloom with the " << g_MethodNames[m_method] << " method" << std::endl;
+		m_lastMethod = (int)m_method;
+	}
+
+	const FrameGraph::TEXTURE_DESC& colorDesc = graph.GetDesc(color);
+	FrameGraph::TEXTURE_DESC outputDesc = { colorDesc.width, colorDesc.height, GL_RGBA16F };
+	FrameGraph::RESOURCE output = graph.CreateTexture("bloom.color", outputDesc);
+	const char* profileName = g_ProfileNames[m_method];
+
+	// the chain texture outlives the frame, so the chain is a
+	// single pass from the scene color to the output
+	if (m_method == METHOD_CHAIN)
+	{
+		int index = graph.AddPass("Bloom", [this, &graph, color, output, outputDesc, profileName]()
+		{
+			if (NULL != m_pGpuProfiler)
+			{
+				m_pGpuProfiler->BeginPass(profileName);
+			}
+			RunChain(graph.GetTexture(color), graph.GetTexture(output), outputDesc.width, outputDesc.height);
+			if (NULL != m_pGpuProfiler)
+			{
+				m_pGpuProfiler->EndPass();
+			}
+		});
+		graph.Read(index, color);
+		graph.Write(index, output);
+		return(output);
+	}
+
+	int width = (colorDesc.width / 2 > 1) ? colorDesc.width / 2 : 1;
+	int height = (colorDesc.height / 2 > 1) ? colorDesc.height / 2 : 1;
+	FrameGraph::TEXTURE_DESC halfDesc = { width, height, GL_RGBA16F };
+	FrameGraph::RESOURCE bright = graph.CreateTexture("bloom.bright", halfDesc);
+	FrameGraph::RESOURCE blurred = graph.CreateTexture("bloom.blurH", halfDesc);
+	FrameGraph::RESOURCE bloom = graph.CreateTexture("bloom.blurV", halfDesc);
+
+	int index = graph.AddPass("Bloom.Bright", [this, &graph, color, profileName]()
+	{
+		if (NULL != m_pGpuProfiler)
+		{
+			m_pGpuProfiler->BeginPass(profileName);
+		}
+		RunBrightPass(graph.GetTexture(color));
+	});
+	graph.Read(index, color);
+	graph.Write(index, bright);
+
+	index = graph.AddPass("Bloom.BlurH", [this, &graph, bright]()
+	{
+		RunBlurPass(graph.GetTexture(bright), 1, 0);
+	});
+	graph.Read(index, bright);
+	graph.Write(index, blurred);
+
+	index = graph.AddPass("Bloom.BlurV", [this, &graph, blurred]()
+	{
+		RunBlurPass(graph.GetTexture(blurred), 0, 1);
+	});
+	graph.Read(index, blurred);
+	graph.Write(index, bloom);
+
+	index = graph.AddPass("Bloom.Blend", [this, &graph, color, bloom]()
+	{
+		RunBlendPass(graph.GetTexture(color), graph.GetTexture(bloom));
+		if (NULL != m_pGpuProfiler)
+		{
+			m_pGpuProfiler->EndPass();
+		}
+	});
+	graph.Read(index, color);
+	graph.Read(index, bloom);
+	graph.Write(index, output);
+	return(output);
+}
+
+/***********************************************************
+ *  RunChain()
+ *
+ *  This method downsamples the scene into the chain in one
+ *  dispatch, walks back up it one level per dispatch and
+ *  adds the result to the scene color.
+ ***********************************************************/
+void BloomPass::RunChain(GLuint color, GLuint output, int width, int height)
+{
+	if ((color == 0) || (output == 0))
+	{
+		return;
+	}
+	AllocateChain(width, height);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+
+	glUseProgram(m_downsampleProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, color);
+	glUniform1i(glGetUniformLocation(m_downsampleProgram, "colorTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_downsampleProgram, "levelCount"), m_levelCount);
+	glUniform2f(glGetUniformLocation(m_downsampleProgram, "threshold"), m_threshold, m_knee);
+	for (int level = 0; level < MAX_LEVELS; level++)
+	{
+		// levels the chain does not have repeat the last one, so
+		// every image of the array is bound
+		int bound = (level < m_levelCount) ? level : m_levelCount - 1;
+		glBindImageTexture(level, m_chainTexture, bound, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	}
+	glDispatchCompute((width + g_DownsampleTile - 1) / g_DownsampleTile, (height + g_DownsampleTile - 1) / g_DownsampleTile, 1);
+	glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+	glUseProgram(m_upsampleProgram);
+	for (int level = m_levelCount - 2; level >= 0; level--)
+	{
+		int levelWidth = (m_chainWidth >> level > 1) ? m_chainWidth >> level : 1;
+		int levelHeight = (m_chainHeight >> level > 1) ? m_chainHeight >> level : 1;
+		glBindImageTexture(0, m_chainTexture, level, GL_FALSE, 0, GL_READ_WRITE, GL_RGBA16F);
+		glBindImageTexture(1, m_chainTexture, level + 1, GL_FALSE, 0, GL_READ_ONLY, GL_RGBA16F);
+		glDispatchCompute((levelWidth + g_WorkGroupSize - 1) / g_WorkGroupSize, (levelHeight + g_WorkGroupSize - 1) / g_WorkGroupSize, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+	}
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	// the top level holds the sum of every level, so the
+	// intensity is spread over them
+	glUseProgram(m_compositeProgram);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, m_chainTexture);
+	glUniform1i(glGetUniformLocation(m_compositeProgram, "colorTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_compositeProgram, "bloomTexture"), 1);
+	glUniform1f(glGetUniformLocation(m_compositeProgram, "intensity"), m_intensity / (float)m_levelCount);
+	glBindImageTexture(0, output, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+	glDispatchCompute((width + g_WorkGroupSize - 1) / g_WorkGroupSize, (height + g_WorkGroupSize - 1) / g_WorkGroupSize, 1);
+	// the next pass samples or blits what was stored
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunBrightPass()
+ *
+ *  This method writes the thresholded scene at half size.
+ ***********************************************************/
+void BloomPass::RunBrightPass(GLuint color)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_brightProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, color);
+	glUniform1i(glGetUniformLocation(m_brightProgram, "colorTexture"), 0);
+	glUniform2f(glGetUniformLocation(m_brightProgram, "threshold"), m_threshold, m_knee);
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunBlurPass()
+ *
+ *  This method blurs the bright pass along one axis.
+ ***********************************************************/
+void BloomPass::RunBlurPass(GLuint source, int directionX, int directionY)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_blurProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source);
+	glUniform1i(glGetUniformLocation(m_blurProgram, "sourceTexture"), 0);
+	glUniform2i(glGetUniformLocation(m_blurProgram, "direction"), directionX, directionY);
+	glUniform1i(glGetUniformLocation(m_blurProgram, "radius"), g_GaussianRadius);
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunBlendPass()
+ *
+ *  This method adds the blurred bright pass to the scene.
+ ***********************************************************/
+void BloomPass::RunBlendPass(GLuint color, GLuint bloom)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_blendProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, color);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, bloom);
+	glUniform1i(glGetUniformLocation(m_blendProgram, "colorTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_blendProgram, "bloomTexture"), 1);
+	glUniform1f(glGetUniformLocation(m_blendProgram, "intensity"), m_intensity);
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  DrawFullscreen()
+ *
+ *  This method draws the fullscreen triangle without depth
+ *  test or blending and restores both afterwards.
+ ***********************************************************/
+void BloomPass::DrawFullscreen()
+{
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean bBlend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	if (bDepthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (bBlend)
+	{
+		glEnable(GL_BLEND);
+	}
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the averaged GPU time of each method
+ *  that has run.
+ ***********************************************************/
+void BloomPass::PrintReport() const
+{
+	if (NULL == m_pGpuProfiler)
+	{
+		return;
+	}
+
+	const std::vector<GpuProfiler::PASS_STATS>& stats = m_pGpuProfiler->GetPassStats();
+	std::cout << "INFO: Bloom GPU time per method" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (int method = 0; method < METHOD_COUNT; method++)
+	{
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			if (stats[i].name != g_ProfileNames[method])
+			{
+				continue;
+			}
+			std::cout << "INFO:   " << std::left << std::setw(9) << g_MethodNames[method] << std::right
+				<< stats[i].average[GpuProfiler::QUERY_TIME_ELAPSED] / 1000000.0 << " ms average over "
+				<< stats[i].resolvedFrames << " frames" << std::endl;
+		}
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
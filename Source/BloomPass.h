@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// bloompass.h
+// ============
+// HDR bloom from one compute mip chain, or separable gaussian passes
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "FrameGraph.h"
+#include "GpuProfiler.h"
+
+#include <string>
+
+/***********************************************************
+ *  BloomPass
+ *
+ *  This class adds the glow of the bright parts of the HDR
+ *  scene color. The default method builds a half resolution
+ *  mip chain of the bright pixels in one compute dispatch,
+ *  each work group reducing a tile through shared memory,
+ *  then walks back up the chain with a tent filter, adding
+ *  each level to the one above. The naive method it is
+ *  measured against blurs a half resolution bright pass
+ *  with a wide gaussian in two fragment passes.
+ ***********************************************************/
+class BloomPass
+{
+public:
+	enum METHOD
+	{
+		METHOD_CHAIN = 0,
+		METHOD_GAUSSIAN,
+		METHOD_COUNT
+	};
+
+	// levels of the mip chain, the first at half resolution
+	static const int MAX_LEVELS = 6;
+
+	// constructor
+	BloomPass();
+	// destructor
+	~BloomPass();
+
+	// compile the programs; the chain needs compute shaders
+	bool Initialize();
+	// free the programs and the mip chain
+	void Destroy();
+
+	void SetMethod(METHOD method);
+	METHOD GetMethod() const { return(m_method); }
+	// switch methods every given number of frames, 0 stops
+	void SetCycleFrames(int frames) { m_cycleFrames = frames; }
+	// brightness where the bloom starts and the width of the
+	// soft transition below it
+	void SetThreshold(float threshold, float knee) { m_threshold = threshold; m_knee = knee; }
+	void SetIntensity(float intensity) { m_intensity = intensity; }
+	// time each method under its own name
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+
+	// method for a name such as "chain"; false when unknown
+	static bool ParseMethod(const std::string& name, METHOD* pMethod);
+	static const char* GetMethodName(METHOD method);
+
+	// declare the bloom passes and return the HDR color with bloom
+	FrameGraph::RESOURCE AddPasses(FrameGraph& graph, FrameGraph::RESOURCE color);
+
+	// print the measured GPU time of every method that has run
+	void PrintReport() const;
+
+private:
+	GpuProfiler* m_pGpuProfiler;
+
+	// compute programs of the chain
+	GLuint m_downsampleProgram;
+	GLuint m_upsampleProgram;
+	GLuint m_compositeProgram;
+	// fragment programs of the gaussian method
+	GLuint m_brightProgram;
+	GLuint m_blurProgram;
+	GLuint m_blendProgram;
+	// empty vertex array for the fullscreen triangle
+	GLuint m_vertexArray;
+
+	// mip chain, kept between frames and resized with the window
+	GLuint m_chainTexture;
+	int m_chainWidth;
+	int m_chainHeight;
+	int m_levelCount;
+
+	bool m_bCompute;
+	METHOD m_method;
+	int m_lastMethod;
+	int m_cycleFrames;
+	long m_frameCount;
+	float m_threshold;
+	float m_knee;
+	float m_intensity;
+
+	// (re)create the mip chain for a scene of this size
+	void AllocateChain(int width, int height);
+
+	// the whole chain as one pass
+	void RunChain(GLuint color, GLuint output, int width, int height);
+	// the passes of the gaussian method
+	void RunBrightPass(GLuint color);
+	void RunBlurPass(GLuint source, int directionX, int directionY);
+	void RunBlendPass(GLuint color, GLuint bloom);
+	// draw the fullscreen triangle with the current program
+	void DrawFullscreen();
+};
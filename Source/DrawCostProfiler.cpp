@@ -0,0 +1,302 @@
+///////////////////////////////////////////////////////////////////////////////
+// DrawCostProfiler.cpp
+// ====================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `DrawCostProfiler` class, an optional profiling
+// mode that measures the GPU time of every draw emitted by the scene draw
+// list and aggregates it per object, per mesh type and per material. The
+// ranked report shows which props are worth simplifying or giving LODs.
+//
+// FUNCTIONALITY:
+// - Place a GL_TIMESTAMP query before and after each draw. Timestamps do
+//   not use glBeginQuery, so they can run inside the per-pass
+//   GL_TIME_ELAPSED queries of the GpuProfiler.
+// - Keep the queries in a ring of frame slots and read a slot back only
+//   once its last query reports GL_QUERY_RESULT_AVAILABLE.
+// - Accumulate the time over many frames and print the entries ranked by
+//   their average cost per frame.
+//
+// NOTES:
+// Timestamps measure when the GPU reaches each point of the command
+// stream, so with deep pipelining the cost of one draw can partly overlap
+// its neighbours. Averaged over many frames the ranking is still reliable.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "DrawCostProfiler.h"
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+	// readable names for the cost categories
+	const char* g_CategoryNames[DrawCostProfiler::COST_CATEGORY_COUNT] =
+	{
+		"object",
+		"mesh type",
+		"material"
+	};
+}
+
+/***********************************************************
+ *  DrawCostProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+DrawCostProfiler::DrawCostProfiler(int frameLatency, int maxDraws)
+{
+	if (frameLatency < 2)
+	{
+		frameLatency = 2;
+	}
+
+	m_frameSlots.resize(frameLatency);
+	m_currentSlot = 0;
+	m_maxDraws = maxDraws;
+	m_bInDraw = false;
+	m_bInitialized = false;
+	m_resolvedFrames = 0;
+	m_droppedFrames = 0;
+}
+
+/***********************************************************
+ *  ~DrawCostProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+DrawCostProfiler::~DrawCostProfiler()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the timestamp queries
+ *  of every frame slot up front.
+ ***********************************************************/
+bool DrawCostProfiler::Initialize()
+{
+	if (m_bInitialized)
+	{
+		return(true);
+	}
+
+	for (size_t i = 0; i < m_frameSlots.size(); i++)
+	{
+		FRAME_SLOT& slot = m_frameSlots[i];
+		slot.queries.resize(m_maxDraws * 2);
+		glGenQueries((GLsizei)slot.queries.size(), &slot.queries[0]);
+		slot.draws.reserve(m_maxDraws);
+		slot.bPending = false;
+	}
+
+	m_bInitialized = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the query objects.
+ ***********************************************************/
+void DrawCostProfiler::Destroy()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_frameSlots.size(); i++)
+	{
+		glDeleteQueries((GLsizei)m_frameSlots[i].queries.size(), &m_frameSlots[i].queries[0]);
+		m_frameSlots[i].queries.clear();
+	}
+	m_bInitialized = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method moves to the next slot of the ring, reading
+ *  it back first if the GPU has finished with it.
+ ***********************************************************/
+void DrawCostProfiler::BeginFrame()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	m_currentSlot = (m_currentSlot + 1) % (int)m_frameSlots.size();
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	if (slot.bPending && !ResolveSlot(slot))
+	{
+		// the slot is still in flight: drop it rather than stall
+		m_droppedFrames++;
+	}
+	slot.draws.clear();
+	slot.bPending = false;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method closes the frame. The oldest pending slot is
+ *  read back as soon as its results are available.
+ ***********************************************************/
+void DrawCostProfiler::EndFrame()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	if (m_bInDraw)
+	{
+		EndDraw();
+	}
+	m_frameSlots[m_currentSlot].bPending = !m_frameSlots[m_currentSlot].draws.empty();
+
+	int oldestSlot = (m_currentSlot + 1) % (int)m_frameSlots.size();
+	if (m_frameSlots[oldestSlot].bPending)
+	{
+		ResolveSlot(m_frameSlots[oldestSlot]);
+	}
+}
+
+/***********************************************************
+ *  BeginDraw()
+ *
+ *  This method records a timestamp before the next draw and
+ *  remembers what is being drawn.
+ ***********************************************************/
+void DrawCostProfiler::BeginDraw(const std::string& objectName, const std::string& meshName, const std::string& materialName)
+{
+	if (!m_bInitialized || m_bInDraw)
+	{
+		return;
+	}
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	if ((int)slot.draws.size() >= m_maxDraws)
+	{
+		return;
+	}
+
+	DRAW_KEY key;
+	key.names[COST_OBJECT] = objectName;
+	key.names[COST_MESH] = meshName;
+	key.names[COST_MATERIAL] = materialName.empty() ? "(none)" : materialName;
+
+	glQueryCounter(slot.queries[slot.draws.size() * 2], GL_TIMESTAMP);
+	slot.draws.push_back(key);
+	m_bInDraw = true;
+}
+
+/***********************************************************
+ *  EndDraw()
+ *
+ *  This method records a timestamp after the draw.
+ ***********************************************************/
+void DrawCostProfiler::EndDraw()
+{
+	if (!m_bInitialized || !m_bInDraw)
+	{
+		return;
+	}
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	glQueryCounter(slot.queries[slot.draws.size() * 2 - 1], GL_TIMESTAMP);
+	m_bInDraw = false;
+}
+
+/***********************************************************
+ *  ResolveSlot()
+ *
+ *  This method reads back the timestamps of a slot without
+ *  blocking and adds each draw's time to its categories.
+ *  It returns false when the GPU has not finished yet.
+ ***********************************************************/
+bool DrawCostProfiler::ResolveSlot(FRAME_SLOT& slot)
+{
+	GLuint available = GL_FALSE;
+	GLsizei queryCount = (GLsizei)slot.draws.size() * 2;
+
+	glGetQueryObjectuiv(slot.queries[queryCount - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE)
+	{
+		return(false);
+	}
+
+	for (size_t draw = 0; draw < slot.draws.size(); draw++)
+	{
+		GLuint64 startTime = 0;
+		GLuint64 endTime = 0;
+		glGetQueryObjectui64v(slot.queries[draw * 2], GL_QUERY_RESULT, &startTime);
+		glGetQueryObjectui64v(slot.queries[draw * 2 + 1], GL_QUERY_RESULT, &endTime);
+
+		double elapsed = (endTime > startTime) ? (double)(endTime - startTime) : 0.0;
+		for (int category = 0; category < COST_CATEGORY_COUNT; category++)
+		{
+			COST_ENTRY& entry = m_costs[category][slot.draws[draw].names[category]];
+			entry.totalNs += elapsed;
+			entry.draws++;
+		}
+	}
+
+	m_resolvedFrames++;
+	slot.bPending = false;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints, for every category, the entries
+ *  ranked by their average GPU time per frame.
+ ***********************************************************/
+void DrawCostProfiler::PrintReport(int topCount) const
+{
+	if (m_resolvedFrames == 0)
+	{
+		std::cout << "INFO: no draw costs resolved yet" << std::endl;
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "DRAW COSTS over " << m_resolvedFrames << " frames ("
+		<< m_droppedFrames << " dropped)" << std::endl;
+
+	for (int category = 0; category < COST_CATEGORY_COUNT; category++)
+	{
+		std::vector<std::pair<double, std::string> > ranked;
+		double categoryTotal = 0.0;
+		std::map<std::string, COST_ENTRY>::const_iterator entry;
+
+		for (entry = m_costs[category].begin(); entry != m_costs[category].end(); ++entry)
+		{
+			ranked.push_back(std::make_pair(entry->second.totalNs, entry->first));
+			categoryTotal += entry->second.totalNs;
+		}
+		std::sort(ranked.rbegin(), ranked.rend());
+
+		std::cout << "  most expensive by " << g_CategoryNames[category] << ":" << std::endl;
+		for (int i = 0; (i < (int)ranked.size()) && (i < topCount); i++)
+		{
+			const COST_ENTRY& cost = m_costs[category].find(ranked[i].second)->second;
+			std::cout << "    " << std::setw(2) << (i + 1) << ". " << std::left << std::setw(18)
+				<< ranked[i].second << std::right
+				<< " " << ranked[i].first / m_resolvedFrames / 1000.0 << " us/frame"
+				<< ", " << ranked[i].first / cost.draws / 1000.0 << " us/draw"
+				<< " (" << 100.0 * ranked[i].first / categoryTotal << "%)" << std::endl;
+		}
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
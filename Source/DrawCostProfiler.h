@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// drawcostprofiler.h
+// ============
+// attribute GPU time to individual draws of the scene
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  DrawCostProfiler
+ *
+ *  This class brackets each draw with GPU timestamp queries
+ *  and adds the measured time to the object, the mesh type
+ *  and the material of the draw. Over many frames this gives
+ *  a ranked list of the most expensive objects in the scene.
+ *  Results are read back several frames late so the CPU
+ *  never waits for the GPU.
+ ***********************************************************/
+class DrawCostProfiler
+{
+public:
+	// constructor
+	DrawCostProfiler(int frameLatency = 4, int maxDraws = 256);
+	// destructor
+	~DrawCostProfiler();
+
+	// ways the measured time is aggregated
+	enum COST_CATEGORY
+	{
+		COST_OBJECT = 0,
+		COST_MESH,
+		COST_MATERIAL,
+		COST_CATEGORY_COUNT
+	};
+
+	struct COST_ENTRY
+	{
+		// total GPU time in nanoseconds over all resolved frames
+		double totalNs;
+		// number of draws measured
+		long draws;
+	};
+
+	// create the query objects in the current context
+	bool Initialize();
+	// free the query objects
+	void Destroy();
+
+	// mark the start and the end of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// bracket a single draw with timestamp queries
+	void BeginDraw(const std::string& objectName, const std::string& meshName, const std::string& materialName);
+	void EndDraw();
+
+	// number of frames whose draws have been resolved
+	long GetResolvedFrames() const { return(m_resolvedFrames); }
+	// print the most expensive entries of every category
+	void PrintReport(int topCount = 10) const;
+
+private:
+	struct DRAW_KEY
+	{
+		std::string names[COST_CATEGORY_COUNT];
+	};
+
+	struct FRAME_SLOT
+	{
+		// two timestamp queries per draw
+		std::vector<GLuint> queries;
+		// what was drawn by each draw of the frame
+		std::vector<DRAW_KEY> draws;
+		bool bPending;
+	};
+
+	// ring of frame slots, one per frame in flight
+	std::vector<FRAME_SLOT> m_frameSlots;
+	int m_currentSlot;
+	int m_maxDraws;
+	// true while a draw is bracketed
+	bool m_bInDraw;
+	// true when the queries have been created
+	bool m_bInitialized;
+	// frames resolved and frames dropped because they were late
+	long m_resolvedFrames;
+	long m_droppedFrames;
+
+	// accumulated cost per name, for each category
+	std::map<std::string, COST_ENTRY> m_costs[COST_CATEGORY_COUNT];
+
+	// read back a slot if the GPU has finished it
+	bool ResolveSlot(FRAME_SLOT& slot);
+};
@@ -0,0 +1,312 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameCapture.cpp
+// ================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `FrameCapture` class, the offline render path that
+// writes every frame to an image sequence. A plain glReadPixels after
+// RenderScene would wait for the GPU to finish the frame; here the
+// readback is only queued, and the pixels are collected frames later.
+//
+// FUNCTIONALITY:
+// - Read each frame into the next pixel buffer object of a ring and place
+//   a fence sync object after it.
+// - When a buffer comes around again, wait on its fence (normally already
+//   signalled), copy the pixels out and unmap it.
+// - Compress and write the copy on a worker pool as PNG, QOI or OpenEXR.
+// - Limit the number of frames waiting for the workers, so memory stays
+//   bounded when the encoder is slower than the renderer.
+//
+// NOTES:
+// The frame size is fixed when the capture starts. Frames are read from
+// the back buffer before the swap, so the file shows exactly what is
+// presented.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+#include "GLDebugOutput.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+
+// declaration of the global variables and defines
+namespace
+{
+	// longest wait for a single fence before warning
+	const GLuint64 g_FenceTimeoutNs = 1000000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture(int ringSize, int workerThreads)
+	: m_workerPool(workerThreads)
+{
+	if (ringSize < 2)
+	{
+		ringSize = 2;
+	}
+
+	m_slots.resize(ringSize);
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		m_slots[i].buffer = 0;
+		m_slots[i].fence = NULL;
+		m_slots[i].frameIndex = 0;
+	}
+	m_nextSlot = 0;
+	m_width = 0;
+	m_height = 0;
+	m_format = ImageWriter::IMAGE_PNG;
+	m_bInitialized = false;
+	m_maxPendingWrites = m_workerPool.GetThreadCount() * 2;
+	m_capturedFrames = 0;
+	m_writtenFrames = 0;
+	m_writtenBytes = 0;
+	m_fenceStalls = 0;
+	m_writerStalls = 0;
+	m_stallMs = 0.0;
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating one pixel buffer per
+ *  slot of the ring, sized for a whole RGBA frame.
+ ***********************************************************/
+bool FrameCapture::Initialize(int width, int height, const std::string& filePrefix, ImageWriter::IMAGE_FORMAT format)
+{
+	if (m_bInitialized || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_filePrefix = filePrefix;
+	m_format = format;
+
+	GLsizeiptr frameBytes = (GLsizeiptr)width * height * 4;
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		glGenBuffers(1, &m_slots[i].buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_slots[i].buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, frameBytes, NULL, GL_STREAM_READ);
+		GLDebugOutput::LabelObject(GL_BUFFER, m_slots[i].buffer, "buffer:frame-capture." + std::to_string(i));
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_startTime = CLOCK::now();
+	m_bInitialized = true;
+
+	std::cout << "INFO: Capturing " << width << "x" << height << " frames to "
+		<< MakeFileName(0) << " ... with " << m_workerPool.GetThreadCount()
+		<< " writer threads" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method writes the frames still in flight and frees
+ *  the pixel buffers.
+ ***********************************************************/
+void FrameCapture::Destroy()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	Flush();
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		glDeleteBuffers(1, &m_slots[i].buffer);
+		m_slots[i].buffer = 0;
+	}
+	m_bInitialized = false;
+}
+
+/***********************************************************
+ *  CaptureFrame()
+ *
+ *  This method collects the readback that was queued in
+ *  the next slot a full ring ago, then queues the readback
+ *  of the current frame into that slot.
+ ***********************************************************/
+void FrameCapture::CaptureFrame()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	READBACK_SLOT& slot = m_slots[m_nextSlot];
+	if (NULL != slot.fence)
+	{
+		ResolveSlot(slot);
+	}
+
+	// with a pack buffer bound the pixels go into the buffer and
+	// glReadPixels returns without waiting for the GPU
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	slot.frameIndex = m_capturedFrames++;
+	m_nextSlot = (m_nextSlot + 1) % (int)m_slots.size();
+}
+
+/***********************************************************
+ *  Flush()
+ *
+ *  This method collects every readback still in flight, in
+ *  frame order, and waits for the workers to write them.
+ ***********************************************************/
+void FrameCapture::Flush()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	// the next slot holds the oldest frame
+	for (size_t i = 0; i < m_slots.size(); i++)
+	{
+		READBACK_SLOT& slot = m_slots[(m_nextSlot + i) % m_slots.size()];
+		if (NULL != slot.fence)
+		{
+			ResolveSlot(slot);
+		}
+	}
+	m_workerPool.WaitIdle();
+}
+
+/***********************************************************
+ *  ResolveSlot()
+ *
+ *  This method waits for the fence of a slot, copies the
+ *  pixels out of its buffer and hands them to a worker.
+ ***********************************************************/
+void FrameCapture::ResolveSlot(READBACK_SLOT& slot)
+{
+	CLOCK::time_point waitStart = CLOCK::now();
+
+	GLenum result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		// the GPU is more than a ring behind: wait for it
+		m_fenceStalls++;
+		result = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_FenceTimeoutNs);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			std::cout << "WARNING: frame " << slot.frameIndex << " readback took over a second" << std::endl;
+			glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		}
+	}
+	glDeleteSync(slot.fence);
+	slot.fence = NULL;
+
+	// bound the memory held by frames waiting to be written
+	if (m_workerPool.GetPendingCount() > m_maxPendingWrites)
+	{
+		m_writerStalls++;
+		m_workerPool.WaitForPending(m_maxPendingWrites);
+	}
+
+	size_t frameBytes = (size_t)m_width * m_height * 4;
+	std::shared_ptr<std::vector<unsigned char> > pixels(new std::vector<unsigned char>(frameBytes));
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)frameBytes, GL_MAP_READ_BIT);
+	if (NULL != mapped)
+	{
+		memcpy(&(*pixels)[0], mapped, frameBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_stallMs += std::chrono::duration<double, std::milli>(CLOCK::now() - waitStart).count();
+
+	if (NULL == mapped)
+	{
+		std::cout << "WARNING: could not map the readback of frame " << slot.frameIndex << std::endl;
+		return;
+	}
+
+	std::string filename = MakeFileName(slot.frameIndex);
+	ImageWriter::IMAGE_FORMAT format = m_format;
+	int width = m_width;
+	int height = m_height;
+	m_workerPool.Submit([this, pixels, filename, format, width, height]()
+	{
+		std::vector<unsigned char> encoded;
+		if (ImageWriter::Encode(format, width, height, &(*pixels)[0], true, encoded))
+		{
+			FILE* file = fopen(filename.c_str(), "wb");
+			if ((NULL != file) && (fwrite(&encoded[0], 1, encoded.size(), file) == encoded.size()))
+			{
+				m_writtenFrames++;
+				m_writtenBytes += (long long)encoded.size();
+			}
+			else
+			{
+				std::cerr << "Could not write captured frame: " << filename << std::endl;
+			}
+			if (NULL != file)
+			{
+				fclose(file);
+			}
+		}
+	});
+}
+
+/***********************************************************
+ *  MakeFileName()
+ *
+ *  This method returns the file name of a captured frame.
+ ***********************************************************/
+std::string FrameCapture::MakeFileName(long frameIndex) const
+{
+	char number[16];
+	snprintf(number, sizeof(number), "_%05ld.", frameIndex);
+	return(m_filePrefix + number + ImageWriter::GetExtension(m_format));
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints how many frames were written, the
+ *  throughput and the time the render loop had to wait.
+ ***********************************************************/
+void FrameCapture::PrintReport() const
+{
+	double seconds = std::chrono::duration<double>(CLOCK::now() - m_startTime).count();
+	double megapixels = (double)m_width * m_height * m_writtenFrames / 1.0e6;
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "FRAME CAPTURE: " << m_writtenFrames << " of " << m_capturedFrames << " frames written, "
+		<< m_writtenBytes / (1024.0 * 1024.0) << " MB in " << seconds << " s\n"
+		<< "  " << m_writtenFrames / seconds << " frames/s, " << megapixels / seconds << " MP/s; "
+		<< "waited " << m_stallMs << " ms (" << m_fenceStalls << " fence, "
+		<< m_writerStalls << " writer stalls)" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,93 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// write rendered frames to an image sequence without stalling the GPU
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "ImageWriter.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class reads every frame back into a ring of pixel
+ *  buffer objects. glReadPixels into a bound PBO returns
+ *  immediately, and each buffer is only mapped when it is
+ *  reused several frames later, after its fence has been
+ *  signalled. The pixels are then compressed and written
+ *  by a worker pool while the next frames render.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture(int ringSize = 3, int workerThreads = 0);
+	// destructor
+	~FrameCapture();
+
+	// create the pixel buffers for frames of the given size;
+	// the files are named <prefix>_00000.<extension>
+	bool Initialize(int width, int height, const std::string& filePrefix, ImageWriter::IMAGE_FORMAT format);
+	// write the frames still in flight and free the buffers
+	void Destroy();
+
+	// queue a readback of the framebuffer bound for reading
+	void CaptureFrame();
+	// wait until every captured frame has been written
+	void Flush();
+
+	// number of frames read back and written so far
+	long GetCapturedFrames() const { return(m_capturedFrames); }
+	long GetWrittenFrames() const { return(m_writtenFrames); }
+	// print the throughput and the time spent waiting
+	void PrintReport() const;
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	struct READBACK_SLOT
+	{
+		GLuint buffer;
+		// fence placed after the readback, or NULL when idle
+		GLsync fence;
+		long frameIndex;
+	};
+
+	std::vector<READBACK_SLOT> m_slots;
+	int m_nextSlot;
+	int m_width;
+	int m_height;
+	std::string m_filePrefix;
+	ImageWriter::IMAGE_FORMAT m_format;
+	bool m_bInitialized;
+
+	// compresses and writes the frames
+	WorkerPool m_workerPool;
+	// frames waiting for a worker before capture blocks
+	int m_maxPendingWrites;
+
+	long m_capturedFrames;
+	std::atomic<long> m_writtenFrames;
+	std::atomic<long long> m_writtenBytes;
+	// readbacks whose fence was not yet signalled when reused
+	long m_fenceStalls;
+	// frames that waited for the workers to catch up
+	long m_writerStalls;
+	double m_stallMs;
+	CLOCK::time_point m_startTime;
+
+	// map a slot once its fence is signalled and queue the write
+	void ResolveSlot(READBACK_SLOT& slot);
+	// file name of a frame
+	std::string MakeFileName(long frameIndex) const;
+};
@@ -0,0 +1,811 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameGraph.cpp
+// ==============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `FrameGraph` class, which runs the render passes
+// of a frame from their declared inputs and outputs instead of from hand
+// managed framebuffers.
+//
+// FUNCTIONALITY:
+// - Keep the passes that write the default framebuffer, an imported
+//   texture or are flagged with a side effect, and every pass they
+//   depend on; drop the rest.
+// - Order the passes so that the writers of a texture run in the order
+//   they were added, and each pass reading it runs between the writer
+//   declared before it and the next one.
+// - Give each transient texture the span of passes between its first and
+//   last use, and reuse a pooled GL texture of the same size and format
+//   once the span of its previous occupant has ended.
+// - Bind a framebuffer with the written textures before each pass.
+// - Report the bytes the transient textures ask for and the bytes the
+//   pool really holds.
+//
+// NOTES:
+// The graph is declared again every frame, which costs little next to
+// the draws; the pool and the framebuffers survive so a steady frame
+// creates no GL objects. A pass that only reads a texture sees what the
+// last pass declared before it wrote there.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "FrameGraph.h"
+#include "GLDebugOutput.h"
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	/***********************************************************
+	 *  IsDepthFormat()
+	 *
+	 *  True for the formats that attach as depth.
+	 ***********************************************************/
+	bool IsDepthFormat(GLenum format)
+	{
+		return((format == GL_DEPTH_COMPONENT16) || (format == GL_DEPTH_COMPONENT24) ||
+			(format == GL_DEPTH_COMPONENT32F) || (format == GL_DEPTH24_STENCIL8) ||
+			(format == GL_DEPTH32F_STENCIL8));
+	}
+
+	/***********************************************************
+	 *  IsIntegerFormat()
+	 *
+	 *  True for the formats that cannot be filtered.
+	 ***********************************************************/
+	bool IsIntegerFormat(GLenum format)
+	{
+		return((format == GL_R32UI) || (format == GL_R32I) || (format == GL_RG32UI) || (format == GL_RGBA8UI));
+	}
+
+	/***********************************************************
+	 *  GetBytesPerPixel()
+	 *
+	 *  Storage size of the internal formats the passes use.
+	 ***********************************************************/
+	size_t GetBytesPerPixel(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_R8:
+			return(1);
+		case GL_R16F:
+		case GL_RG8:
+		case GL_DEPTH_COMPONENT16:
+			return(2);
+		case GL_RGBA8:
+		case GL_SRGB8_ALPHA8:
+		case GL_RG16F:
+		case GL_R32F:
+		case GL_R32UI:
+		case GL_R32I:
+		case GL_RGBA8UI:
+		case GL_R11F_G11F_B10F:
+		case GL_RGB10_A2:
+		case GL_DEPTH_COMPONENT24:
+		case GL_DEPTH_COMPONENT32F:
+		case GL_DEPTH24_STENCIL8:
+			return(4);
+		case GL_RGBA16F:
+		case GL_RG32F:
+		case GL_RG32UI:
+		case GL_DEPTH32F_STENCIL8:
+			return(8);
+		case GL_RGBA32F:
+			return(16);
+		default:
+			return(4);
+		}
+	}
+
+	/***********************************************************
+	 *  GetTextureBytes()
+	 *
+	 *  Storage size of a texture without mipmaps.
+	 ***********************************************************/
+	size_t GetTextureBytes(const FrameGraph::TEXTURE_DESC& desc)
+	{
+		return((size_t)desc.width * desc.height * GetBytesPerPixel(desc.internalFormat));
+	}
+
+	bool IsSameDesc(const FrameGraph::TEXTURE_DESC& a, const FrameGraph::TEXTURE_DESC& b)
+	{
+		return((a.width == b.width) && (a.height == b.height) && (a.internalFormat == b.internalFormat));
+	}
+}
+
+/***********************************************************
+ *  FrameGraph()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameGraph::FrameGraph()
+{
+	m_blitFramebuffer = 0;
+	m_pFrameProfiler = NULL;
+	m_bLayoutChanged = false;
+	m_requestedBytes = 0;
+	m_allocatedBytes = 0;
+}
+
+/***********************************************************
+ *  ~FrameGraph()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameGraph::~FrameGraph()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method clears the declarations of the last frame.
+ ***********************************************************/
+void FrameGraph::Reset()
+{
+	m_passes.clear();
+	m_resources.clear();
+	m_order.clear();
+}
+
+/***********************************************************
+ *  AddPass()
+ *
+ *  This method adds a pass; its reads and writes follow.
+ ***********************************************************/
+int FrameGraph::AddPass(const std::string& name, const EXECUTE& execute)
+{
+	PASS pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.bSideEffect = false;
+	pass.bCulled = false;
+	m_passes.push_back(pass);
+	return((int)m_passes.size() - 1);
+}
+
+/***********************************************************
+ *  CreateTexture()
+ *
+ *  This method declares a texture owned by the graph.
+ ***********************************************************/
+FrameGraph::RESOURCE FrameGraph::CreateTexture(const std::string& name, const TEXTURE_DESC& desc)
+{
+	RESOURCE_NODE resource;
+	resource.name = name;
+	resource.desc = desc;
+	resource.bImported = false;
+	resource.importedTexture = 0;
+	resource.physical = -1;
+	resource.firstUse = -1;
+	resource.lastUse = -1;
+	m_resources.push_back(resource);
+	return((RESOURCE)m_resources.size() - 1);
+}
+
+/***********************************************************
+ *  ImportTexture()
+ *
+ *  This method declares a texture that lives outside the
+ *  graph, such as the default framebuffer.
+ ***********************************************************/
+FrameGraph::RESOURCE FrameGraph::ImportTexture(const std::string& name, GLuint texture, const TEXTURE_DESC& desc)
+{
+	RESOURCE resource = CreateTexture(name, desc);
+	m_resources[resource].bImported = true;
+	m_resources[resource].importedTexture = texture;
+	return(resource);
+}
+
+/***********************************************************
+ *  Read()
+ *
+ *  This method records that a pass samples a texture.
+ ***********************************************************/
+void FrameGraph::Read(int pass, RESOURCE resource)
+{
+	if ((pass >= 0) && (pass < (int)m_passes.size()) && (resource >= 0) && (resource < (int)m_resources.size()))
+	{
+		m_passes[pass].reads.push_back(resource);
+	}
+}
+
+/***********************************************************
+ *  Write()
+ *
+ *  This method records that a pass draws into a texture.
+ ***********************************************************/
+void FrameGraph::Write(int pass, RESOURCE resource)
+{
+	if ((pass >= 0) && (pass < (int)m_passes.size()) && (resource >= 0) && (resource < (int)m_resources.size()))
+	{
+		m_passes[pass].writes.push_back(resource);
+	}
+}
+
+/***********************************************************
+ *  SetSideEffect()
+ *
+ *  This method keeps a pass whose output leaves the graph
+ *  some other way, such as a readback.
+ ***********************************************************/
+void FrameGraph::SetSideEffect(int pass)
+{
+	if ((pass >= 0) && (pass < (int)m_passes.size()))
+	{
+		m_passes[pass].bSideEffect = true;
+	}
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method culls, orders and allocates the frame.
+ ***********************************************************/
+bool FrameGraph::Compile()
+{
+	CullPasses();
+	if (!OrderPasses())
+	{
+		std::cout << "WARNING: The frame graph has a dependency cycle" << std::endl;
+		m_order.clear();
+		return(false);
+	}
+	AllocateTextures();
+
+	// describe the layout so a change can be reported once
+	std::ostringstream layout;
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		layout << m_passes[m_order[i]].name << ";";
+	}
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		layout << m_resources[i].physical << ",";
+	}
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		layout << m_pool[i].desc.width << "x" << m_pool[i].desc.height << ",";
+	}
+	m_bLayoutChanged = (layout.str() != m_layout);
+	m_layout = layout.str();
+	return(true);
+}
+
+/***********************************************************
+ *  CullPasses()
+ *
+ *  This method walks back from the passes with outside
+ *  effects and culls every pass it does not reach.
+ ***********************************************************/
+void FrameGraph::CullPasses()
+{
+	std::vector<int> pending;
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		PASS& pass = m_passes[i];
+		pass.bCulled = !pass.bSideEffect;
+		for (size_t w = 0; w < pass.writes.size(); w++)
+		{
+			if (m_resources[pass.writes[w]].bImported)
+			{
+				pass.bCulled = false;
+			}
+		}
+		if (!pass.bCulled)
+		{
+			pending.push_back((int)i);
+		}
+	}
+
+	// a live pass keeps every writer of what it reads
+	while (!pending.empty())
+	{
+		int current = pending.back();
+		pending.pop_back();
+		const std::vector<RESOURCE>& reads = m_passes[current].reads;
+		for (size_t r = 0; r < reads.size(); r++)
+		{
+			for (size_t i = 0; i < m_passes.size(); i++)
+			{
+				PASS& writer = m_passes[i];
+				if (writer.bCulled && (std::find(writer.writes.begin(), writer.writes.end(), reads[r]) != writer.writes.end()))
+				{
+					writer.bCulled = false;
+					pending.push_back((int)i);
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  OrderPasses()
+ *
+ *  This method sorts the live passes so that the writers of
+ *  a texture run in the order they were added, each reader
+ *  runs after the nearest writer declared before it and
+ *  before the next one; ties keep the order of declaration.
+ ***********************************************************/
+bool FrameGraph::OrderPasses()
+{
+	size_t passCount = m_passes.size();
+	std::vector<std::vector<int> > successors(passCount);
+	std::vector<int> predecessorCounts(passCount, 0);
+
+	for (RESOURCE resource = 0; resource < (RESOURCE)m_resources.size(); resource++)
+	{
+		// each reader sees the nearest writer declared before it,
+		// and the next writer waits for the readers before it
+		int lastWriter = -1;
+		std::vector<int> readers;
+		for (size_t i = 0; i < passCount; i++)
+		{
+			const PASS& pass = m_passes[i];
+			if (pass.bCulled)
+			{
+				continue;
+			}
+			bool bWrites = std::find(pass.writes.begin(), pass.writes.end(), resource) != pass.writes.end();
+			bool bReads = std::find(pass.reads.begin(), pass.reads.end(), resource) != pass.reads.end();
+			if (bWrites)
+			{
+				if (lastWriter >= 0)
+				{
+					successors[lastWriter].push_back((int)i);
+					predecessorCounts[i]++;
+				}
+				for (size_t r = 0; r < readers.size(); r++)
+				{
+					successors[readers[r]].push_back((int)i);
+					predecessorCounts[i]++;
+				}
+				readers.clear();
+				lastWriter = (int)i;
+			}
+			else if (bReads)
+			{
+				if (lastWriter >= 0)
+				{
+					successors[lastWriter].push_back((int)i);
+					predecessorCounts[i]++;
+				}
+				readers.push_back((int)i);
+			}
+		}
+	}
+
+	// Kahn's algorithm, always taking the earliest declared ready pass
+	m_order.clear();
+	std::vector<bool> done(passCount, false);
+	size_t liveCount = 0;
+	for (size_t i = 0; i < passCount; i++)
+	{
+		liveCount += m_passes[i].bCulled ? 0 : 1;
+	}
+	while (m_order.size() < liveCount)
+	{
+		int next = -1;
+		for (size_t i = 0; (i < passCount) && (next < 0); i++)
+		{
+			if (!m_passes[i].bCulled && !done[i] && (predecessorCounts[i] == 0))
+			{
+				next = (int)i;
+			}
+		}
+		if (next < 0)
+		{
+			return(false);
+		}
+
+		done[next] = true;
+		m_order.push_back(next);
+		for (size_t s = 0; s < successors[next].size(); s++)
+		{
+			predecessorCounts[successors[next][s]]--;
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  AllocateTextures()
+ *
+ *  This method finds the lifetime of every transient texture
+ *  and places it in the first pooled texture of its size and
+ *  format that is free by then. Pooled textures no resource
+ *  needs any more are deleted. Creating and deleting pool
+ *  textures is reported to the frame profiler.
+ ***********************************************************/
+void FrameGraph::AllocateTextures()
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].physical = -1;
+		m_resources[i].firstUse = -1;
+		m_resources[i].lastUse = -1;
+	}
+	for (int position = 0; position < (int)m_order.size(); position++)
+	{
+		const PASS& pass = m_passes[m_order[position]];
+		std::vector<RESOURCE> used = pass.reads;
+		used.insert(used.end(), pass.writes.begin(), pass.writes.end());
+		for (size_t u = 0; u < used.size(); u++)
+		{
+			RESOURCE_NODE& resource = m_resources[used[u]];
+			if (resource.firstUse < 0)
+			{
+				resource.firstUse = position;
+			}
+			resource.lastUse = position;
+		}
+	}
+
+	std::vector<RESOURCE> transients;
+	for (RESOURCE i = 0; i < (RESOURCE)m_resources.size(); i++)
+	{
+		if (!m_resources[i].bImported && (m_resources[i].firstUse >= 0))
+		{
+			transients.push_back(i);
+		}
+	}
+	std::stable_sort(transients.begin(), transients.end(), [this](RESOURCE a, RESOURCE b)
+	{
+		return(m_resources[a].firstUse < m_resources[b].firstUse);
+	});
+
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		m_pool[i].busyUntil = -1;
+		m_pool[i].bUsed = false;
+	}
+
+	m_requestedBytes = 0;
+	for (size_t t = 0; t < transients.size(); t++)
+	{
+		RESOURCE_NODE& resource = m_resources[transients[t]];
+		m_requestedBytes += GetTextureBytes(resource.desc);
+
+		for (size_t i = 0; (i < m_pool.size()) && (resource.physical < 0); i++)
+		{
+			if (IsSameDesc(m_pool[i].desc, resource.desc) && (m_pool[i].busyUntil < resource.firstUse))
+			{
+				resource.physical = (int)i;
+			}
+		}
+		if (resource.physical < 0)
+		{
+			CLOCK::time_point start = CLOCK::now();
+			PHYSICAL_TEXTURE physical;
+			physical.desc = resource.desc;
+			physical.texture = 0;
+			bool bNearest = IsDepthFormat(resource.desc.internalFormat) || IsIntegerFormat(resource.desc.internalFormat);
+			glGenTextures(1, &physical.texture);
+			glBindTexture(GL_TEXTURE_2D, physical.texture);
+			glTexStorage2D(GL_TEXTURE_2D, 1, resource.desc.internalFormat, resource.desc.width, resource.desc.height);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, bNearest ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, bNearest ? GL_NEAREST : GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+			std::ostringstream label;
+			label << "texture:framegraph." << m_pool.size();
+			GLDebugOutput::LabelObject(GL_TEXTURE, physical.texture, label.str());
+			if (NULL != m_pFrameProfiler)
+			{
+				std::ostringstream detail;
+				detail << label.str() << " " << resource.desc.width << "x" << resource.desc.height
+					<< " for '" << resource.name << "'";
+				m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_RESOURCE_LOAD, detail.str(),
+					std::chrono::duration<double, std::milli>(CLOCK::now() - start).count());
+			}
+
+			m_pool.push_back(physical);
+			resource.physical = (int)m_pool.size() - 1;
+		}
+		m_pool[resource.physical].busyUntil = resource.lastUse;
+		m_pool[resource.physical].bUsed = true;
+	}
+
+	// free what this frame did not need, and the framebuffers using it
+	std::vector<PHYSICAL_TEXTURE> kept;
+	std::vector<int> remap(m_pool.size(), -1);
+	int freedCount = 0;
+	size_t freedBytes = 0;
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		if (m_pool[i].bUsed)
+		{
+			remap[i] = (int)kept.size();
+			kept.push_back(m_pool[i]);
+			continue;
+		}
+		for (size_t f = m_framebuffers.size(); f-- > 0;)
+		{
+			const std::vector<GLuint>& attachments = m_framebuffers[f].attachments;
+			if (std::find(attachments.begin(), attachments.end(), m_pool[i].texture) != attachments.end())
+			{
+				glDeleteFramebuffers(1, &m_framebuffers[f].framebuffer);
+				m_framebuffers.erase(m_framebuffers.begin() + f);
+			}
+		}
+		glDeleteTextures(1, &m_pool[i].texture);
+		freedCount++;
+		freedBytes += GetTextureBytes(m_pool[i].desc);
+	}
+	m_pool.swap(kept);
+	if ((NULL != m_pFrameProfiler) && (freedCount > 0))
+	{
+		std::ostringstream detail;
+		detail << freedCount << " framegraph textures deleted, " << freedBytes / 1024 << " KB";
+		m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_RESOURCE_DELETE, detail.str());
+	}
+
+	m_allocatedBytes = 0;
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		m_allocatedBytes += GetTextureBytes(m_pool[i].desc);
+	}
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		if (m_resources[i].physical >= 0)
+		{
+			m_resources[i].physical = remap[m_resources[i].physical];
+		}
+	}
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method binds the written textures of each pass and
+ *  runs it, then returns to the default framebuffer.
+ ***********************************************************/
+void FrameGraph::Execute()
+{
+	for (size_t position = 0; position < m_order.size(); position++)
+	{
+		const PASS& pass = m_passes[m_order[position]];
+		std::vector<GLuint> colors;
+		GLuint depth = 0;
+		GLenum depthFormat = GL_NONE;
+		bool bDefaultFramebuffer = false;
+		int width = 0;
+		int height = 0;
+
+		for (size_t w = 0; w < pass.writes.size(); w++)
+		{
+			const RESOURCE_NODE& resource = m_resources[pass.writes[w]];
+			width = resource.desc.width;
+			height = resource.desc.height;
+			if (resource.bImported && (resource.importedTexture == 0))
+			{
+				bDefaultFramebuffer = true;
+			}
+			else if (IsDepthFormat(resource.desc.internalFormat))
+			{
+				depth = GetTexture(pass.writes[w]);
+				depthFormat = resource.desc.internalFormat;
+			}
+			else
+			{
+				colors.push_back(GetTexture(pass.writes[w]));
+			}
+		}
+
+		// the default framebuffer cannot be combined with textures
+		if (bDefaultFramebuffer)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			glViewport(0, 0, width, height);
+		}
+		else if (!colors.empty() || (depth != 0))
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(colors, depth, depthFormat));
+			glViewport(0, 0, width, height);
+		}
+
+		if (pass.execute)
+		{
+			pass.execute();
+		}
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+/***********************************************************
+ *  GetTexture()
+ *
+ *  This method returns the GL texture behind a resource.
+ ***********************************************************/
+GLuint FrameGraph::GetTexture(RESOURCE resource) const
+{
+	if ((resource < 0) || (resource >= (RESOURCE)m_resources.size()))
+	{
+		return(0);
+	}
+
+	const RESOURCE_NODE& node = m_resources[resource];
+	if (node.bImported)
+	{
+		return(node.importedTexture);
+	}
+	return((node.physical >= 0) ? m_pool[node.physical].texture : 0);
+}
+
+/***********************************************************
+ *  GetFramebuffer()
+ *
+ *  This method returns a framebuffer with the attachments,
+ *  creating it the first time the combination is used.
+ ***********************************************************/
+GLuint FrameGraph::GetFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthFormat)
+{
+	std::vector<GLuint> attachments = colors;
+	attachments.push_back(depth);
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		if (m_framebuffers[i].attachments == attachments)
+		{
+			return(m_framebuffers[i].framebuffer);
+		}
+	}
+
+	FRAMEBUFFER framebuffer;
+	framebuffer.attachments = attachments;
+	glGenFramebuffers(1, &framebuffer.framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.framebuffer);
+
+	std::vector<GLenum> drawBuffers;
+	for (size_t i = 0; i < colors.size(); i++)
+	{
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + (GLenum)i, GL_TEXTURE_2D, colors[i], 0);
+		drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + (GLenum)i);
+	}
+	if (depth != 0)
+	{
+		bool bStencil = (depthFormat == GL_DEPTH24_STENCIL8) || (depthFormat == GL_DEPTH32F_STENCIL8);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, bStencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+			GL_TEXTURE_2D, depth, 0);
+	}
+	if (drawBuffers.empty())
+	{
+		glDrawBuffer(GL_NONE);
+	}
+	else
+	{
+		glDrawBuffers((GLsizei)drawBuffers.size(), &drawBuffers[0]);
+	}
+
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Frame graph framebuffer is incomplete: 0x" << std::hex << status << std::dec << std::endl;
+	}
+
+	std::ostringstream label;
+	label << "framebuffer:framegraph." << m_framebuffers.size();
+	GLDebugOutput::LabelObject(GL_FRAMEBUFFER, framebuffer.framebuffer, label.str());
+	m_framebuffers.push_back(framebuffer);
+	return(framebuffer.framebuffer);
+}
+
+/***********************************************************
+ *  BlitTexture()
+ *
+ *  This method copies a color or depth texture into a
+ *  framebuffer and leaves that framebuffer bound.
+ ***********************************************************/
+void FrameGraph::BlitTexture(RESOURCE source, GLuint framebuffer, int width, int height)
+{
+	GLuint texture = GetTexture(source);
+	if (texture == 0)
+	{
+		return;
+	}
+
+	const TEXTURE_DESC& desc = m_resources[source].desc;
+	bool bDepth = IsDepthFormat(desc.internalFormat);
+	if (m_blitFramebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_blitFramebuffer);
+		GLDebugOutput::LabelObject(GL_FRAMEBUFFER, m_blitFramebuffer, "framebuffer:framegraph.blit");
+	}
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_blitFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, bDepth ? GL_DEPTH_ATTACHMENT : GL_COLOR_ATTACHMENT0,
+		GL_TEXTURE_2D, texture, 0);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, bDepth ? GL_COLOR_ATTACHMENT0 : GL_DEPTH_ATTACHMENT,
+		GL_TEXTURE_2D, 0, 0);
+	glReadBuffer(bDepth ? GL_NONE : GL_COLOR_ATTACHMENT0);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+
+	bool bScaled = (desc.width != width) || (desc.height != height);
+	glBlitFramebuffer(0, 0, desc.width, desc.height, 0, 0, width, height,
+		bDepth ? GL_DEPTH_BUFFER_BIT : GL_COLOR_BUFFER_BIT, (bScaled && !bDepth) ? GL_LINEAR : GL_NEAREST);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the passes in order, the culled ones,
+ *  the pool slot of every transient texture and the memory
+ *  that aliasing saved.
+ ***********************************************************/
+void FrameGraph::PrintReport() const
+{
+	std::cout << "INFO: Frame graph passes:";
+	for (size_t i = 0; i < m_order.size(); i++)
+	{
+		std::cout << " " << m_passes[m_order[i]].name;
+	}
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		if (m_passes[i].bCulled)
+		{
+			std::cout << " [" << m_passes[i].name << " culled]";
+		}
+	}
+	std::cout << std::endl;
+
+	int transientCount = 0;
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		const RESOURCE_NODE& resource = m_resources[i];
+		if (resource.bImported || (resource.physical < 0))
+		{
+			continue;
+		}
+		transientCount++;
+		std::cout << "INFO:   " << resource.name << " " << resource.desc.width << "x" << resource.desc.height
+			<< ", passes " << resource.firstUse << "-" << resource.lastUse << ", texture " << resource.physical << std::endl;
+	}
+
+	const double megabyte = 1024.0 * 1024.0;
+	std::cout << std::fixed << std::setprecision(1) << "INFO: Frame graph memory: " << transientCount
+		<< " transient textures in " << m_pool.size() << " allocations, "
+		<< m_requestedBytes / megabyte << " MB requested, " << m_allocatedBytes / megabyte << " MB allocated, "
+		<< (m_requestedBytes - m_allocatedBytes) / megabyte << " MB saved by aliasing" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees every GL object of the graph.
+ ***********************************************************/
+void FrameGraph::Destroy()
+{
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		glDeleteFramebuffers(1, &m_framebuffers[i].framebuffer);
+	}
+	m_framebuffers.clear();
+	for (size_t i = 0; i < m_pool.size(); i++)
+	{
+		glDeleteTextures(1, &m_pool[i].texture);
+	}
+	m_pool.clear();
+	if (m_blitFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_blitFramebuffer);
+		m_blitFramebuffer = 0;
+	}
+	m_layout.clear();
+	m_order.clear();
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].physical = -1;
+	}
+}
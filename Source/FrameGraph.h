@@ -0,0 +1,152 @@
+///////////////////////////////////////////////////////////////////////////////
+// framegraph.h
+// ============
+// render passes declared with their resources, with transient aliasing
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "FrameProfiler.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameGraph
+ *
+ *  This class is rebuilt every frame from the render passes
+ *  and the textures each of them reads and writes. Compile
+ *  drops the passes whose results nobody uses, orders the
+ *  rest by their dependencies, and places the transient
+ *  textures in a pool of GL textures so that two textures
+ *  whose lifetimes do not overlap share the same memory.
+ *  The pool and the framebuffers are kept between frames.
+ ***********************************************************/
+class FrameGraph
+{
+public:
+	// handle of a texture declared in the graph
+	typedef int RESOURCE;
+	static const RESOURCE INVALID_RESOURCE = -1;
+
+	struct TEXTURE_DESC
+	{
+		int width;
+		int height;
+		GLenum internalFormat;
+	};
+
+	// draws a pass into the framebuffer the graph has bound
+	typedef std::function<void()> EXECUTE;
+
+	// constructor
+	FrameGraph();
+	// destructor
+	~FrameGraph();
+
+	// forget the passes and resources of the last frame
+	void Reset();
+	// add a pass and return its index
+	int AddPass(const std::string& name, const EXECUTE& execute);
+	// declare a texture that only lives within the frame
+	RESOURCE CreateTexture(const std::string& name, const TEXTURE_DESC& desc);
+	// declare an outside texture; 0 is the default framebuffer
+	RESOURCE ImportTexture(const std::string& name, GLuint texture, const TEXTURE_DESC& desc);
+	// declare that a pass samples or draws into a texture
+	void Read(int pass, RESOURCE resource);
+	void Write(int pass, RESOURCE resource);
+	// keep a pass even when nothing reads what it writes
+	void SetSideEffect(int pass);
+
+	// cull, order and allocate; false on a dependency cycle
+	bool Compile();
+	// run the passes in order with their framebuffers bound
+	void Execute();
+
+	// GL texture behind a resource, valid after Compile
+	GLuint GetTexture(RESOURCE resource) const;
+	const TEXTURE_DESC& GetDesc(RESOURCE resource) const { return(m_resources[resource].desc); }
+	// copy a texture into a framebuffer, scaling to its size
+	void BlitTexture(RESOURCE source, GLuint framebuffer, int width, int height);
+
+	// true when the last Compile changed the passes or the pool
+	bool IsLayoutChanged() const { return(m_bLayoutChanged); }
+	// print the pass order and the memory saved by aliasing
+	void PrintReport() const;
+	// bytes of all transient textures, and of the pool behind them
+	size_t GetRequestedBytes() const { return(m_requestedBytes); }
+	size_t GetAllocatedBytes() const { return(m_allocatedBytes); }
+
+	// free the pool and the framebuffers
+	void Destroy();
+
+	// receives the pooled textures created and freed mid frame
+	void SetFrameProfiler(FrameProfiler* pFrameProfiler) { m_pFrameProfiler = pFrameProfiler; }
+
+private:
+	struct PASS
+	{
+		std::string name;
+		EXECUTE execute;
+		std::vector<RESOURCE> reads;
+		std::vector<RESOURCE> writes;
+		bool bSideEffect;
+		bool bCulled;
+	};
+
+	struct RESOURCE_NODE
+	{
+		std::string name;
+		TEXTURE_DESC desc;
+		bool bImported;
+		GLuint importedTexture;
+		// index into the pool, for transient textures
+		int physical;
+		// first and last position in the pass order
+		int firstUse;
+		int lastUse;
+	};
+
+	struct PHYSICAL_TEXTURE
+	{
+		TEXTURE_DESC desc;
+		GLuint texture;
+		// last pass position of the resource placed in it, -1 when free
+		int busyUntil;
+		bool bUsed;
+	};
+
+	struct FRAMEBUFFER
+	{
+		// the color textures, then the depth texture or 0
+		std::vector<GLuint> attachments;
+		GLuint framebuffer;
+	};
+
+	std::vector<PASS> m_passes;
+	std::vector<RESOURCE_NODE> m_resources;
+	std::vector<int> m_order;
+	std::vector<PHYSICAL_TEXTURE> m_pool;
+	std::vector<FRAMEBUFFER> m_framebuffers;
+	// read framebuffer for BlitTexture
+	GLuint m_blitFramebuffer;
+	FrameProfiler* m_pFrameProfiler;
+
+	bool m_bLayoutChanged;
+	std::string m_layout;
+	size_t m_requestedBytes;
+	size_t m_allocatedBytes;
+
+	// mark the passes whose writes are never consumed
+	void CullPasses();
+	// topological order of the remaining passes
+	bool OrderPasses();
+	// place the transient textures in the pool
+	void AllocateTextures();
+	// framebuffer with the given attachments, created on demand
+	GLuint GetFramebuffer(const std::vector<GLuint>& colors, GLuint depth, GLenum depthFormat);
+};
@@ -0,0 +1,375 @@
+///////////////////////////////////////////////////////////////////////////////
+// FrameProfiler.cpp
+// =================
+// VERSION: 1.1
+//
+// DESCRIPTION:
+// This file defines the `FrameProfiler` class, which measures how long each
+// frame of the main rendering loop takes and detects hitches: frames whose
+// duration exceeds a configurable threshold, by default 2x the rolling
+// median.
+//
+// FUNCTIONALITY:
+// - Record frame durations into a fixed size ring buffer and keep rolling
+//   median, mean and maximum statistics.
+// - Capture nested, named timing zones (view setup, scene render, swap).
+// - Capture events such as texture loads, shader compiles, resource
+//   deletions and the first use of a shader/vertex format combination.
+// - When a frame hitches, write a snapshot of its zones and events to a
+//   log file so occasional stalls can be diagnosed without a profiler.
+//
+// NOTES:
+// The first few frames are never flagged because the median is not yet
+// meaningful until the ring buffer holds a minimum number of samples.
+// Events recorded outside of a frame (during scene preparation) are
+// discarded when the next frame begins.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+	// minimum number of samples needed before hitches are flagged
+	const int g_MinimumSamples = 10;
+	// default log file for the hitch snapshots
+	const char* g_DefaultLogName = "frame_hitches.log";
+
+	// readable names for the captured event types
+	const char* g_EventNames[FrameProfiler::EVENT_TYPE_COUNT] =
+	{
+		"resource load",
+		"shader compile",
+		"resource delete",
+		"first use",
+		"other"
+	};
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler(int windowSize, float hitchFactor)
+{
+	if (windowSize < g_MinimumSamples)
+	{
+		windowSize = g_MinimumSamples;
+	}
+
+	m_frameTimes.assign(windowSize, 0.0);
+	m_nextSample = 0;
+	m_sampleCount = 0;
+	m_hitchFactor = hitchFactor;
+	m_hitchAbsoluteMs = 0.0;
+	m_frameNumber = 0;
+	m_hitchCount = 0;
+	m_frameStart = CLOCK::now();
+	m_bInFrame = false;
+	m_logFilename = g_DefaultLogName;
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	m_frameTimes.clear();
+	m_frameZones.clear();
+	m_openZones.clear();
+	m_frameEvents.clear();
+}
+
+/***********************************************************
+ *  SetHitchThreshold()
+ *
+ *  This method is used for configuring when a frame counts
+ *  as a hitch: when it takes longer than hitchFactor times
+ *  the rolling median, or longer than absoluteMs when that
+ *  value is greater than zero.
+ ***********************************************************/
+void FrameProfiler::SetHitchThreshold(float hitchFactor, double absoluteMs)
+{
+	m_hitchFactor = hitchFactor;
+	m_hitchAbsoluteMs = absoluteMs;
+}
+
+/***********************************************************
+ *  SetLogFile()
+ *
+ *  This method is used for setting the file that receives
+ *  the snapshots of hitched frames.
+ ***********************************************************/
+void FrameProfiler::SetLogFile(const std::string& filename)
+{
+	m_logFilename = filename;
+}
+
+/***********************************************************
+ *  ElapsedMs()
+ *
+ *  This method returns the time since the frame started.
+ ***********************************************************/
+double FrameProfiler::ElapsedMs() const
+{
+	return(std::chrono::duration<double, std::milli>(CLOCK::now() - m_frameStart).count());
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is called at the top of the rendering loop
+ *  to mark the start of a new frame.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	m_frameStart = CLOCK::now();
+	m_frameZones.clear();
+	m_openZones.clear();
+	m_frameEvents.clear();
+	m_bInFrame = true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is called after the buffers are swapped. It
+ *  records the frame time and logs a snapshot of the frame
+ *  if it is a hitch.
+ *
+ *  Time Complexity: O(n) for the median, where n is the
+ *  size of the rolling window.
+ ***********************************************************/
+void FrameProfiler::EndFrame()
+{
+	double frameTime = ElapsedMs();
+
+	// close any zone that was left open
+	while (!m_openZones.empty())
+	{
+		EndZone();
+	}
+
+	// compare against the median of the previous frames so the
+	// hitch itself does not skew its own threshold
+	if (m_sampleCount >= g_MinimumSamples)
+	{
+		double median = GetMedianFrameTime();
+		bool bHitch = (median > 0.0) && (frameTime > median * m_hitchFactor);
+		if ((m_hitchAbsoluteMs > 0.0) && (frameTime > m_hitchAbsoluteMs))
+		{
+			bHitch = true;
+		}
+
+		if (bHitch)
+		{
+			m_hitchCount++;
+			WriteHitchSnapshot(frameTime, median);
+		}
+	}
+
+	m_frameTimes[m_nextSample] = frameTime;
+	m_nextSample = (m_nextSample + 1) % (int)m_frameTimes.size();
+	if (m_sampleCount < (int)m_frameTimes.size())
+	{
+		m_sampleCount++;
+	}
+	m_frameNumber++;
+	m_bInFrame = false;
+}
+
+/***********************************************************
+ *  BeginZone()
+ *
+ *  This method opens a named timing zone. Zones can nest.
+ ***********************************************************/
+void FrameProfiler::BeginZone(const char* name)
+{
+	ZONE_INFO zone;
+
+	zone.name = name;
+	zone.depth = (int)m_openZones.size();
+	zone.startMs = ElapsedMs();
+	zone.durationMs = 0.0;
+
+	m_openZones.push_back((int)m_frameZones.size());
+	m_frameZones.push_back(zone);
+}
+
+/***********************************************************
+ *  EndZone()
+ *
+ *  This method closes the most recently opened zone.
+ ***********************************************************/
+void FrameProfiler::EndZone()
+{
+	if (m_openZones.empty())
+	{
+		return;
+	}
+
+	ZONE_INFO& zone = m_frameZones[m_openZones.back()];
+	zone.durationMs = ElapsedMs() - zone.startMs;
+	m_openZones.pop_back();
+}
+
+/***********************************************************
+ *  RecordEvent()
+ *
+ *  This method captures an event against the current frame.
+ ***********************************************************/
+void FrameProfiler::RecordEvent(EVENT_TYPE type, const std::string& detail, double durationMs)
+{
+	EVENT_INFO event;
+
+	event.type = type;
+	event.detail = detail;
+	event.timeMs = m_bInFrame ? ElapsedMs() : 0.0;
+	event.durationMs = durationMs;
+
+	m_frameEvents.push_back(event);
+}
+
+/***********************************************************
+ *  NoteCause()
+ *
+ *  This method attaches a likely hitch cause to the frame
+ *  that is currently being recorded.
+ ***********************************************************/
+void FrameProfiler::NoteCause(const std::string& cause)
+{
+	RecordEvent(EVENT_FIRST_USE, cause);
+}
+
+/***********************************************************
+ *  WriteHitchSnapshot()
+ *
+ *  This method reports a hitch on the console and appends
+ *  the zones and events of the frame to the log file.
+ ***********************************************************/
+void FrameProfiler::WriteHitchSnapshot(double frameTime, double median)
+{
+	int eventCounts[EVENT_TYPE_COUNT] = { 0 };
+
+	for (size_t i = 0; i < m_frameEvents.size(); i++)
+	{
+		eventCounts[m_frameEvents[i].type]++;
+	}
+
+	std::cout << std::fixed << std::setprecision(2)
+		<< "WARNING: frame " << m_frameNumber << " hitched: "
+		<< frameTime << " ms (" << (frameTime / median)
+		<< "x median " << median << " ms), "
+		<< m_frameEvents.size() << " events captured in " << m_logFilename << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+
+	std::ofstream log(m_logFilename.c_str(), std::ios::app);
+	if (!log.is_open())
+	{
+		std::cerr << "Could not open hitch log: " << m_logFilename << std::endl;
+		return;
+	}
+
+	log << std::fixed << std::setprecision(3);
+	log << "=== hitch in frame " << m_frameNumber << ": " << frameTime << " ms"
+		<< " (median " << median << " ms, mean " << GetMeanFrameTime()
+		<< " ms, max " << GetMaxFrameTime() << " ms)\n";
+
+	log << "zones:\n";
+	for (size_t i = 0; i < m_frameZones.size(); i++)
+	{
+		const ZONE_INFO& zone = m_frameZones[i];
+		log << "  " << std::string(zone.depth * 2, ' ') << zone.name
+			<< " @" << zone.startMs << " ms: " << zone.durationMs << " ms\n";
+	}
+
+	log << "events:";
+	for (int type = 0; type < EVENT_TYPE_COUNT; type++)
+	{
+		log << " " << g_EventNames[type] << "=" << eventCounts[type];
+	}
+	log << "\n";
+	for (size_t i = 0; i < m_frameEvents.size(); i++)
+	{
+		const EVENT_INFO& event = m_frameEvents[i];
+		log << "  [" << g_EventNames[event.type] << "] @" << event.timeMs << " ms";
+		if (event.durationMs > 0.0)
+		{
+			log << " took " << event.durationMs << " ms";
+		}
+		log << ": " << event.detail << "\n";
+	}
+	if (m_frameEvents.empty())
+	{
+		log << "  no scene event recorded, probably a driver or presentation stall\n";
+	}
+	log << std::endl;
+}
+
+/***********************************************************
+ *  GetMedianFrameTime()
+ *
+ *  This method returns the median of the frame times held
+ *  in the rolling window, in milliseconds.
+ ***********************************************************/
+double FrameProfiler::GetMedianFrameTime() const
+{
+	if (m_sampleCount == 0)
+	{
+		return(0.0);
+	}
+
+	std::vector<double> samples(m_frameTimes.begin(), m_frameTimes.begin() + m_sampleCount);
+	std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+
+	return(samples[samples.size() / 2]);
+}
+
+/***********************************************************
+ *  GetMeanFrameTime()
+ *
+ *  This method returns the mean of the frame times held in
+ *  the rolling window, in milliseconds.
+ ***********************************************************/
+double FrameProfiler::GetMeanFrameTime() const
+{
+	double total = 0.0;
+
+	if (m_sampleCount == 0)
+	{
+		return(0.0);
+	}
+	for (int i = 0; i < m_sampleCount; i++)
+	{
+		total += m_frameTimes[i];
+	}
+
+	return(total / m_sampleCount);
+}
+
+/***********************************************************
+ *  GetMaxFrameTime()
+ *
+ *  This method returns the longest frame time held in the
+ *  rolling window, in milliseconds.
+ ***********************************************************/
+double FrameProfiler::GetMaxFrameTime() const
+{
+	double longest = 0.0;
+
+	for (int i = 0; i < m_sampleCount; i++)
+	{
+		longest = std::max(longest, m_frameTimes[i]);
+	}
+
+	return(longest);
+}
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// track per-frame timing and flag frames that hitch
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <chrono>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class keeps rolling statistics of the frame times
+ *  and flags any frame that takes longer than a configurable
+ *  threshold. During each frame it captures the timed zones
+ *  and the events (resource loads, shader compiles, resource
+ *  deletions, first use of a draw state) so a hitch can be
+ *  written to a log together with everything that happened
+ *  in that frame.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler(int windowSize = 120, float hitchFactor = 2.0f);
+	// destructor
+	~FrameProfiler();
+
+	// kinds of events that can be captured within a frame
+	enum EVENT_TYPE
+	{
+		EVENT_RESOURCE_LOAD = 0,
+		EVENT_SHADER_COMPILE,
+		EVENT_RESOURCE_DELETE,
+		EVENT_FIRST_USE,
+		EVENT_OTHER,
+		EVENT_TYPE_COUNT
+	};
+
+	struct ZONE_INFO
+	{
+		std::string name;
+		int depth;
+		double startMs;
+		double durationMs;
+	};
+
+	struct EVENT_INFO
+	{
+		EVENT_TYPE type;
+		std::string detail;
+		double timeMs;
+		double durationMs;
+	};
+
+	// set the hitch threshold: a frame hitches when it exceeds
+	// factor times the median, or absoluteMs when that is > 0
+	void SetHitchThreshold(float hitchFactor, double absoluteMs = 0.0);
+	// set the log file that receives the hitch snapshots
+	void SetLogFile(const std::string& filename);
+
+	// mark the start and the end of a rendered frame
+	void BeginFrame();
+	void EndFrame();
+
+	// mark the start and the end of a named zone in the frame
+	void BeginZone(const char* name);
+	void EndZone();
+
+	// capture an event that happened during the current frame
+	void RecordEvent(EVENT_TYPE type, const std::string& detail, double durationMs = 0.0);
+	// attach a likely hitch cause to the current frame
+	void NoteCause(const std::string& cause);
+
+	// rolling statistics of the recorded frame times in milliseconds
+	double GetMedianFrameTime() const;
+	double GetMeanFrameTime() const;
+	double GetMaxFrameTime() const;
+	// number of frames flagged as hitches so far
+	int GetHitchCount() const { return(m_hitchCount); }
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+
+	// ring buffer of the most recent frame times in milliseconds
+	std::vector<double> m_frameTimes;
+	int m_nextSample;
+	int m_sampleCount;
+	// a frame is a hitch when it exceeds this multiple of the median
+	float m_hitchFactor;
+	// or when it exceeds this absolute time, if greater than zero
+	double m_hitchAbsoluteMs;
+	// total frames and hitches recorded
+	long m_frameNumber;
+	int m_hitchCount;
+	// start time of the current frame
+	CLOCK::time_point m_frameStart;
+	// true between BeginFrame() and EndFrame()
+	bool m_bInFrame;
+
+	// zones and events captured during the current frame
+	std::vector<ZONE_INFO> m_frameZones;
+	std::vector<int> m_openZones;
+	std::vector<EVENT_INFO> m_frameEvents;
+
+	// file that receives the hitch snapshots
+	std::string m_logFilename;
+
+	// milliseconds elapsed since the start of the frame
+	double ElapsedMs() const;
+	// write the captured context of a hitched frame to the log
+	void WriteHitchSnapshot(double frameTime, double median);
+};
+
+/***********************************************************
+ *  ScopedProfileZone
+ *
+ *  This helper opens a profiler zone when it is created and
+ *  closes it when it goes out of scope. A NULL profiler is
+ *  allowed so callers do not need to check for one.
+ ***********************************************************/
+class ScopedProfileZone
+{
+public:
+	ScopedProfileZone(FrameProfiler* pProfiler, const char* name)
+		: m_pProfiler(pProfiler)
+	{
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->BeginZone(name);
+		}
+	}
+	~ScopedProfileZone()
+	{
+		if (NULL != m_pProfiler)
+		{
+			m_pProfiler->EndZone();
+		}
+	}
+
+private:
+	FrameProfiler* m_pProfiler;
+};
@@ -0,0 +1,352 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLDebugOutput.cpp
+// =================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `GLDebugOutput` class, which gives the application
+// feedback from the OpenGL driver through the KHR_debug extension (core in
+// OpenGL 4.3). Messages are classified by type, with performance warnings
+// (GL_DEBUG_TYPE_PERFORMANCE) called out, and are deduplicated so that a
+// warning raised every frame is only printed the first time.
+//
+// FUNCTIONALITY:
+// - Install `glDebugMessageCallback` in debug and profiling builds.
+// - Count the messages per type for each frame and in total.
+// - Forward new performance warnings to the frame profiler so they show up
+//   in the hitch log of the frame they occurred in.
+// - Attach labels with `glObjectLabel` to textures, buffers, vertex arrays,
+//   framebuffers and programs so the driver messages name our resources.
+//
+// NOTES:
+// In builds without GL_DEBUG_OUTPUT_ENABLED every method is a cheap no-op.
+// Output is always synchronous, in profiling builds too, so the callback
+// never runs on a driver thread while the render thread ends a frame.
+// Buffers created inside ShapeMeshes (outside of this project) are labelled
+// by marking the next free names before the mesh is loaded and labelling
+// the names that exist afterwards.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "GLDebugOutput.h"
+
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// readable names of the message types, in counting order
+	const GLenum g_MessageTypes[] =
+	{
+		GL_DEBUG_TYPE_ERROR,
+		GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR,
+		GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR,
+		GL_DEBUG_TYPE_PORTABILITY,
+		GL_DEBUG_TYPE_PERFORMANCE,
+		GL_DEBUG_TYPE_MARKER,
+		GL_DEBUG_TYPE_PUSH_GROUP,
+		GL_DEBUG_TYPE_POP_GROUP,
+		GL_DEBUG_TYPE_OTHER
+	};
+	const char* g_MessageTypeNames[] =
+	{
+		"error",
+		"deprecated",
+		"undefined",
+		"portability",
+		"performance",
+		"marker",
+		"push group",
+		"pop group",
+		"other"
+	};
+
+	// index of the performance type in the tables above
+	const int g_PerformanceIndex = 4;
+
+	// map a message type onto its counting slot
+	int TypeIndex(GLenum type)
+	{
+		for (int i = 0; i < (int)(sizeof(g_MessageTypes) / sizeof(g_MessageTypes[0])); i++)
+		{
+			if (g_MessageTypes[i] == type)
+			{
+				return(i);
+			}
+		}
+		return(8);
+	}
+
+	// readable name of a message severity
+	const char* SeverityName(GLenum severity)
+	{
+		switch (severity)
+		{
+		case GL_DEBUG_SEVERITY_HIGH:
+			return("high");
+		case GL_DEBUG_SEVERITY_MEDIUM:
+			return("medium");
+		case GL_DEBUG_SEVERITY_LOW:
+			return("low");
+		default:
+			return("notification");
+		}
+	}
+}
+
+// the callback is installed at most once per process
+bool GLDebugOutput::m_bEnabled = false;
+
+/***********************************************************
+ *  GLDebugOutput()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLDebugOutput::GLDebugOutput()
+{
+	for (int i = 0; i < TYPE_COUNT; i++)
+	{
+		m_frameCounts[i] = 0;
+		m_totalCounts[i] = 0;
+	}
+}
+
+/***********************************************************
+ *  ~GLDebugOutput()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GLDebugOutput::~GLDebugOutput()
+{
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	if (m_bEnabled)
+	{
+		glDebugMessageCallback(NULL, NULL);
+		m_bEnabled = false;
+	}
+#endif
+	m_seenMessages.clear();
+}
+
+/***********************************************************
+ *  Install()
+ *
+ *  This method is used for installing the debug message
+ *  callback into the current OpenGL context. It returns
+ *  false when debug output is compiled out or unsupported.
+ ***********************************************************/
+bool GLDebugOutput::Install()
+{
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	if (!GLEW_KHR_debug && !GLEW_VERSION_4_3)
+	{
+		std::cout << "INFO: KHR_debug is not supported, driver messages are disabled" << std::endl;
+		return(false);
+	}
+
+	glEnable(GL_DEBUG_OUTPUT);
+	// synchronous output makes the callback run inside the
+	// offending GL call, on the render thread, which keeps the
+	// call stack useful and lets the callback update the counters
+	// that EndFrame() reads and resets without a lock
+	glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+	glDebugMessageCallback(&GLDebugOutput::MessageCallback, this);
+	glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, NULL, GL_TRUE);
+	m_bEnabled = true;
+
+	std::cout << "INFO: OpenGL debug output installed" << std::endl;
+	return(true);
+#else
+	return(false);
+#endif
+}
+
+/***********************************************************
+ *  MessageCallback()
+ *
+ *  This method is called by the driver for every message.
+ ***********************************************************/
+void APIENTRY GLDebugOutput::MessageCallback(GLenum source, GLenum type, GLuint id,
+	GLenum severity, GLsizei length, const GLchar* message, const void* userParam)
+{
+	GLDebugOutput* pDebugOutput = (GLDebugOutput*)userParam;
+
+	if (NULL != pDebugOutput)
+	{
+		pDebugOutput->OnMessage(source, type, id, severity, message);
+	}
+}
+
+/***********************************************************
+ *  OnMessage()
+ *
+ *  This method counts a message and prints it the first
+ *  time it is seen.
+ ***********************************************************/
+void GLDebugOutput::OnMessage(GLenum source, GLenum type, GLuint id, GLenum severity, const GLchar* message)
+{
+	int typeIndex = TypeIndex(type);
+	std::string key = std::to_string(source) + ":" + std::to_string(type) + ":" +
+		std::to_string(id) + ":" + message;
+
+	m_frameCounts[typeIndex]++;
+	m_totalCounts[typeIndex]++;
+
+	long& seenCount = m_seenMessages[key];
+	seenCount++;
+	if (seenCount > 1)
+	{
+		return;
+	}
+
+	std::cout << "GL " << g_MessageTypeNames[typeIndex] << " (" << SeverityName(severity)
+		<< ", id " << id << "): " << message << std::endl;
+
+	if ((typeIndex == g_PerformanceIndex) && m_framePerformanceMessage.empty())
+	{
+		m_framePerformanceMessage = message;
+	}
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method reports the message counts of the frame that
+ *  has just been rendered and resets them.
+ ***********************************************************/
+void GLDebugOutput::EndFrame(FrameProfiler* pFrameProfiler)
+{
+	int frameTotal = 0;
+
+	for (int i = 0; i < TYPE_COUNT; i++)
+	{
+		frameTotal += m_frameCounts[i];
+	}
+	if (frameTotal == 0)
+	{
+		return;
+	}
+
+	if (NULL != pFrameProfiler)
+	{
+		std::string counts;
+		for (int i = 0; i < TYPE_COUNT; i++)
+		{
+			if (m_frameCounts[i] > 0)
+			{
+				counts += std::string(counts.empty() ? "" : ", ") +
+					g_MessageTypeNames[i] + "=" + std::to_string(m_frameCounts[i]);
+			}
+		}
+		pFrameProfiler->RecordEvent(FrameProfiler::EVENT_OTHER, "GL debug messages: " + counts);
+
+		if (!m_framePerformanceMessage.empty())
+		{
+			pFrameProfiler->NoteCause("driver performance warning: " + m_framePerformanceMessage);
+		}
+	}
+
+	for (int i = 0; i < TYPE_COUNT; i++)
+	{
+		m_frameCounts[i] = 0;
+	}
+	m_framePerformanceMessage.clear();
+}
+
+/***********************************************************
+ *  PrintSummary()
+ *
+ *  This method prints the message totals per type and the
+ *  number of distinct messages.
+ ***********************************************************/
+void GLDebugOutput::PrintSummary() const
+{
+	if (!m_bEnabled)
+	{
+		return;
+	}
+
+	std::cout << "INFO: GL debug messages (" << m_seenMessages.size() << " distinct):";
+	for (int i = 0; i < TYPE_COUNT; i++)
+	{
+		if (m_totalCounts[i] > 0)
+		{
+			std::cout << " " << g_MessageTypeNames[i] << "=" << m_totalCounts[i];
+		}
+	}
+	std::cout << std::endl;
+}
+
+/***********************************************************
+ *  LabelObject()
+ *
+ *  This method attaches a readable label to an OpenGL
+ *  object so the driver messages can refer to it by name.
+ ***********************************************************/
+void GLDebugOutput::LabelObject(GLenum identifier, GLuint name, const std::string& label)
+{
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	if (m_bEnabled && (name != 0))
+	{
+		glObjectLabel(identifier, name, (GLsizei)label.size(), label.c_str());
+	}
+#endif
+}
+
+/***********************************************************
+ *  MarkNames()
+ *
+ *  This method returns the buffer and vertex array names
+ *  the driver will hand out next, by generating and freeing
+ *  a probe name of each kind.
+ ***********************************************************/
+GLDebugOutput::NAME_MARK GLDebugOutput::MarkNames()
+{
+	NAME_MARK mark = { 0, 0 };
+
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	if (m_bEnabled)
+	{
+		glGenBuffers(1, &mark.buffer);
+		glDeleteBuffers(1, &mark.buffer);
+		glGenVertexArrays(1, &mark.vertexArray);
+		glDeleteVertexArrays(1, &mark.vertexArray);
+	}
+#endif
+
+	return(mark);
+}
+
+/***********************************************************
+ *  LabelNamesSince()
+ *
+ *  This method labels every buffer and vertex array that
+ *  was created after the passed in mark was taken.
+ ***********************************************************/
+void GLDebugOutput::LabelNamesSince(const NAME_MARK& mark, const std::string& label)
+{
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	if (!m_bEnabled || (mark.buffer == 0))
+	{
+		return;
+	}
+
+	NAME_MARK next = MarkNames();
+	int index = 0;
+
+	for (GLuint name = mark.buffer; name < next.buffer; name++)
+	{
+		if (glIsBuffer(name))
+		{
+			LabelObject(GL_BUFFER, name, label + ".buffer" + std::to_string(index++));
+		}
+	}
+	for (GLuint name = mark.vertexArray; name < next.vertexArray; name++)
+	{
+		if (glIsVertexArray(name))
+		{
+			LabelObject(GL_VERTEX_ARRAY, name, label + ".vao");
+		}
+	}
+#endif
+}
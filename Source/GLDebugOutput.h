@@ -0,0 +1,82 @@
+///////////////////////////////////////////////////////////////////////////////
+// gldebugoutput.h
+// ============
+// collect, classify and count OpenGL driver debug messages
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "FrameProfiler.h"
+
+#include <map>
+#include <string>
+
+// debug output is compiled into debug builds and into release
+// builds that define ENABLE_GL_PROFILING
+#if defined(_DEBUG) || defined(ENABLE_GL_PROFILING)
+#define GL_DEBUG_OUTPUT_ENABLED 1
+#endif
+
+/***********************************************************
+ *  GLDebugOutput
+ *
+ *  This class installs a KHR_debug message callback, sorts
+ *  the driver messages by type, prints each distinct message
+ *  only once and reports the message counts per frame. It
+ *  also attaches readable labels to the OpenGL objects that
+ *  the application creates so driver warnings can name them.
+ ***********************************************************/
+class GLDebugOutput
+{
+public:
+	// constructor
+	GLDebugOutput();
+	// destructor
+	~GLDebugOutput();
+
+	// names that will be handed out next, used for labelling
+	// objects created by code outside of this project
+	struct NAME_MARK
+	{
+		GLuint buffer;
+		GLuint vertexArray;
+	};
+
+	// install the message callback into the current context
+	bool Install();
+	// report and reset the message counts of the frame
+	void EndFrame(FrameProfiler* pFrameProfiler);
+	// print the totals collected since installation
+	void PrintSummary() const;
+
+	// attach a label to an OpenGL object (no-op when disabled)
+	static void LabelObject(GLenum identifier, GLuint name, const std::string& label);
+	// remember the next buffer and vertex array names
+	static NAME_MARK MarkNames();
+	// label every buffer and vertex array created since a mark
+	static void LabelNamesSince(const NAME_MARK& mark, const std::string& label);
+
+private:
+	// message callback registered with the driver
+	static void APIENTRY MessageCallback(GLenum source, GLenum type, GLuint id,
+		GLenum severity, GLsizei length, const GLchar* message, const void* userParam);
+	// handle one message
+	void OnMessage(GLenum source, GLenum type, GLuint id, GLenum severity, const GLchar* message);
+
+	// true once the callback has been installed
+	static bool m_bEnabled;
+
+	// number of message types that are counted separately
+	static const int TYPE_COUNT = 9;
+
+	// message counts for the current frame and in total, per type
+	int m_frameCounts[TYPE_COUNT];
+	long m_totalCounts[TYPE_COUNT];
+	// how often each distinct message has been seen
+	std::map<std::string, long> m_seenMessages;
+	// first new performance message of the frame, for the profiler
+	std::string m_framePerformanceMessage;
+};
@@ -0,0 +1,726 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLReplay.cpp
+// ============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `GLReplay` class, the standalone replay benchmark
+// for traces recorded by `GLTrace`. It is started with `--replay <file>`
+// and runs headless in a hidden window, so the same captured frames can be
+// timed on different drivers (for example with LIBGL_ALWAYS_SOFTWARE=1 to
+// force llvmpipe) without any of the application's scene logic.
+//
+// FUNCTIONALITY:
+// - Load the trace into memory so no file I/O happens while timing.
+// - Replay the setup segment once and the frames once to warm up.
+// - Replay the recorded frames repeatedly as fast as possible, measuring
+//   the CPU submission time and the time until the GPU has finished.
+// - Map recorded object names and uniform locations onto the ones handed
+//   out by the replay context.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "GLReplay.h"
+#include "GLTrace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+	/***********************************************************
+	 *  TraceReader
+	 *
+	 *  Reads the fields of one record from the loaded trace.
+	 ***********************************************************/
+	class TraceReader
+	{
+	public:
+		TraceReader(const unsigned char* data)
+			: m_data(data), m_offset(0) {}
+
+		GLuint UInt() { GLuint value; Read(&value, sizeof(value)); return(value); }
+		GLint Int() { GLint value; Read(&value, sizeof(value)); return(value); }
+		GLfloat Float() { GLfloat value; Read(&value, sizeof(value)); return(value); }
+		GLint64 Size() { GLint64 value; Read(&value, sizeof(value)); return(value); }
+		// returns the blob in place, or NULL when it is empty
+		const void* Blob(unsigned int* pLength = NULL)
+		{
+			unsigned int length = UInt();
+			const void* data = (length > 0) ? (m_data + m_offset) : NULL;
+			m_offset += length;
+			if (NULL != pLength)
+			{
+				*pLength = length;
+			}
+			return(data);
+		}
+		// returns the array of recorded object names in place
+		const GLuint* Names(GLsizei* pCount)
+		{
+			*pCount = Int();
+			const GLuint* names = (const GLuint*)(m_data + m_offset);
+			m_offset += sizeof(GLuint) * (*pCount);
+			return(names);
+		}
+
+	private:
+		const unsigned char* m_data;
+		size_t m_offset;
+
+		void Read(void* value, size_t size)
+		{
+			memcpy(value, m_data + m_offset, size);
+			m_offset += size;
+		}
+	};
+}
+
+/***********************************************************
+ *  GLReplay()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GLReplay::GLReplay()
+{
+	m_currentProgram = 0;
+}
+
+/***********************************************************
+ *  ~GLReplay()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GLReplay::~GLReplay()
+{
+	m_trace.clear();
+	m_frameOffsets.clear();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method reads the trace file into memory and finds
+ *  the offsets of the frame markers.
+ ***********************************************************/
+bool GLReplay::Load(const std::string& filename)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	size_t magicLength = strlen(GLTrace::FILE_MAGIC);
+	char magic[16] = { 0 };
+
+	if (NULL == file)
+	{
+		std::cerr << "Could not open GL trace: " << filename << std::endl;
+		return(false);
+	}
+	if ((fread(magic, 1, magicLength, file) != magicLength) ||
+		(memcmp(magic, GLTrace::FILE_MAGIC, magicLength) != 0))
+	{
+		std::cerr << "Not a GL trace file: " << filename << std::endl;
+		fclose(file);
+		return(false);
+	}
+
+	fseek(file, 0, SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file, (long)magicLength, SEEK_SET);
+	m_trace.resize(fileSize - magicLength);
+	if (!m_trace.empty() && (fread(&m_trace[0], 1, m_trace.size(), file) != m_trace.size()))
+	{
+		std::cerr << "Could not read GL trace: " << filename << std::endl;
+		fclose(file);
+		return(false);
+	}
+	fclose(file);
+
+	// walk the records once to find where each frame ends, and
+	// count the calls the capture could only note by name
+	std::map<std::string, long> untracedCounts;
+	size_t offset = 0;
+	while (offset + 6 <= m_trace.size())
+	{
+		unsigned short opcode = 0;
+		unsigned int size = 0;
+		memcpy(&opcode, &m_trace[offset], sizeof(opcode));
+		memcpy(&size, &m_trace[offset + 2], sizeof(size));
+		if ((opcode == GLTrace::OP_UNTRACED) && (offset + 6 + size <= m_trace.size()))
+		{
+			TraceReader in(&m_trace[offset + 6]);
+			unsigned int length = 0;
+			const char* name = (const char*)in.Blob(&length);
+			untracedCounts[std::string(name, (NULL != name) ? length : 0)]++;
+		}
+		offset += 6 + size;
+		if (opcode == GLTrace::OP_END_FRAME)
+		{
+			m_frameOffsets.push_back(offset);
+		}
+	}
+
+	std::cout << "INFO: Loaded GL trace " << filename << ": " << m_trace.size() / 1024
+		<< " KB, " << (m_frameOffsets.empty() ? 0 : m_frameOffsets.size() - 1)
+		<< " frames after the setup segment" << std::endl;
+	if (!untracedCounts.empty())
+	{
+		std::cout << "WARNING: the GL trace holds calls that were not recorded, the frames will not "
+			"replay as captured:";
+		for (std::map<std::string, long>::const_iterator it = untracedCounts.begin(); it != untracedCounts.end(); ++it)
+		{
+			std::cout << " " << it->first << " (" << it->second << ")";
+		}
+		std::cout << std::endl;
+	}
+	return(m_frameOffsets.size() >= 2);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method replays the setup segment and every frame
+ *  once, then times the frames for the given number of
+ *  loops and prints the throughput.
+ ***********************************************************/
+bool GLReplay::Run(int loops)
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	if (m_frameOffsets.size() < 2)
+	{
+		std::cerr << "The GL trace holds no complete frame to replay" << std::endl;
+		return(false);
+	}
+	if (loops < 1)
+	{
+		loops = 1;
+	}
+
+	size_t framesBegin = m_frameOffsets[0];
+	size_t framesEnd = m_frameOffsets.back();
+	size_t frameCount = m_frameOffsets.size() - 1;
+
+	// setup and a first pass over the frames, untimed, so shader
+	// compiles and first-use costs are not part of the results
+	Execute(0, framesBegin);
+	Execute(framesBegin, framesEnd);
+	glFinish();
+
+	CLOCK::time_point start = CLOCK::now();
+	double submitMs = 0.0;
+	for (int loop = 0; loop < loops; loop++)
+	{
+		CLOCK::time_point loopStart = CLOCK::now();
+		Execute(framesBegin, framesEnd);
+		submitMs += std::chrono::duration<double, std::milli>(CLOCK::now() - loopStart).count();
+	}
+	glFinish();
+	double totalMs = std::chrono::duration<double, std::milli>(CLOCK::now() - start).count();
+
+	double replayedFrames = (double)frameCount * loops;
+	std::cout << std::fixed << std::setprecision(3)
+		<< "REPLAY: " << glGetString(GL_RENDERER) << " (" << glGetString(GL_VERSION) << ")\n"
+		<< "  " << (long)replayedFrames << " frames in " << totalMs << " ms: "
+		<< totalMs / replayedFrames << " ms/frame, "
+		<< 1000.0 * replayedFrames / totalMs << " frames/s\n"
+		<< "  cpu submission " << submitMs / replayedFrames << " ms/frame, "
+		<< "gpu drain after submission " << (totalMs - submitMs) << " ms" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+
+	return(true);
+}
+
+/***********************************************************
+ *  MapName()
+ *
+ *  This method maps an object name from the trace onto the
+ *  name created for it in the replay context.
+ ***********************************************************/
+GLuint GLReplay::MapName(NAME_KIND kind, GLuint name) const
+{
+	if (name == 0)
+	{
+		return(0);
+	}
+
+	std::map<GLuint, GLuint>::const_iterator found = m_names[kind].find(name);
+	return((found != m_names[kind].end()) ? found->second : name);
+}
+
+/***********************************************************
+ *  MapLocation()
+ *
+ *  This method maps a uniform location from the trace onto
+ *  the location of the same uniform in the current program.
+ ***********************************************************/
+GLint GLReplay::MapLocation(GLint location) const
+{
+	if (location < 0)
+	{
+		return(location);
+	}
+
+	unsigned long long key = ((unsigned long long)m_currentProgram << 32) | (GLuint)location;
+	std::map<unsigned long long, GLint>::const_iterator found = m_locations.find(key);
+	return((found != m_locations.end()) ? found->second : location);
+}
+
+/***********************************************************
+ *  Execute()
+ *
+ *  This method issues every recorded call in a range of
+ *  the trace against the current context.
+ ***********************************************************/
+void GLReplay::Execute(size_t begin, size_t end)
+{
+	size_t offset = begin;
+
+	while (offset + 6 <= end)
+	{
+		unsigned short opcode = 0;
+		unsigned int size = 0;
+		memcpy(&opcode, &m_trace[offset], sizeof(opcode));
+		memcpy(&size, &m_trace[offset + 2], sizeof(size));
+
+		TraceReader in(&m_trace[offset + 6]);
+		offset += 6 + size;
+
+		switch (opcode)
+		{
+		case GLTrace::OP_END_FRAME:
+			break;
+
+		// object creation: create new names and remember the mapping
+		case GLTrace::OP_GEN_BUFFERS:
+		case GLTrace::OP_GEN_VERTEX_ARRAYS:
+		case GLTrace::OP_GEN_FRAMEBUFFERS:
+		case GLTrace::OP_GEN_RENDERBUFFERS:
+		case GLTrace::OP_GEN_TEXTURES:
+		{
+			GLsizei count = 0;
+			const GLuint* recorded = in.Names(&count);
+			std::vector<GLuint> created(count);
+			NAME_KIND kind = NAME_BUFFER;
+			switch (opcode)
+			{
+			case GLTrace::OP_GEN_BUFFERS:
+				glGenBuffers(count, &created[0]);
+				break;
+			case GLTrace::OP_GEN_VERTEX_ARRAYS:
+				glGenVertexArrays(count, &created[0]);
+				kind = NAME_VERTEX_ARRAY;
+				break;
+			case GLTrace::OP_GEN_FRAMEBUFFERS:
+				glGenFramebuffers(count, &created[0]);
+				kind = NAME_FRAMEBUFFER;
+				break;
+			case GLTrace::OP_GEN_RENDERBUFFERS:
+				glGenRenderbuffers(count, &created[0]);
+				kind = NAME_RENDERBUFFER;
+				break;
+			default:
+				glGenTextures(count, &created[0]);
+				kind = NAME_TEXTURE;
+				break;
+			}
+			for (GLsizei i = 0; i < count; i++)
+			{
+				m_names[kind][recorded[i]] = created[i];
+			}
+			break;
+		}
+		case GLTrace::OP_DELETE_BUFFERS:
+		case GLTrace::OP_DELETE_VERTEX_ARRAYS:
+		case GLTrace::OP_DELETE_FRAMEBUFFERS:
+		case GLTrace::OP_DELETE_RENDERBUFFERS:
+		case GLTrace::OP_DELETE_TEXTURES:
+		{
+			GLsizei count = 0;
+			const GLuint* recorded = in.Names(&count);
+			NAME_KIND kind = NAME_BUFFER;
+			switch (opcode)
+			{
+			case GLTrace::OP_DELETE_VERTEX_ARRAYS:
+				kind = NAME_VERTEX_ARRAY;
+				break;
+			case GLTrace::OP_DELETE_FRAMEBUFFERS:
+				kind = NAME_FRAMEBUFFER;
+				break;
+			case GLTrace::OP_DELETE_RENDERBUFFERS:
+				kind = NAME_RENDERBUFFER;
+				break;
+			case GLTrace::OP_DELETE_TEXTURES:
+				kind = NAME_TEXTURE;
+				break;
+			default:
+				break;
+			}
+			std::vector<GLuint> names(count);
+			for (GLsizei i = 0; i < count; i++)
+			{
+				names[i] = MapName(kind, recorded[i]);
+				m_names[kind].erase(recorded[i]);
+			}
+			if (opcode == GLTrace::OP_DELETE_BUFFERS)
+				glDeleteBuffers(count, &names[0]);
+			else if (opcode == GLTrace::OP_DELETE_VERTEX_ARRAYS)
+				glDeleteVertexArrays(count, &names[0]);
+			else if (opcode == GLTrace::OP_DELETE_FRAMEBUFFERS)
+				glDeleteFramebuffers(count, &names[0]);
+			else if (opcode == GLTrace::OP_DELETE_RENDERBUFFERS)
+				glDeleteRenderbuffers(count, &names[0]);
+			else
+				glDeleteTextures(count, &names[0]);
+			break;
+		}
+
+		// buffers and vertex arrays
+		case GLTrace::OP_BIND_BUFFER:
+		{
+			GLenum target = in.UInt();
+			glBindBuffer(target, MapName(NAME_BUFFER, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_BUFFER_DATA:
+		{
+			GLenum target = in.UInt();
+			GLint64 dataSize = in.Size();
+			GLenum usage = in.UInt();
+			glBufferData(target, (GLsizeiptr)dataSize, in.Blob(), usage);
+			break;
+		}
+		case GLTrace::OP_BUFFER_SUB_DATA:
+		{
+			GLenum target = in.UInt();
+			GLint64 dataOffset = in.Size();
+			unsigned int length = 0;
+			const void* data = in.Blob(&length);
+			glBufferSubData(target, (GLintptr)dataOffset, length, data);
+			break;
+		}
+		case GLTrace::OP_BIND_VERTEX_ARRAY:
+			glBindVertexArray(MapName(NAME_VERTEX_ARRAY, in.UInt()));
+			break;
+		case GLTrace::OP_VERTEX_ATTRIB_POINTER:
+		{
+			GLuint index = in.UInt();
+			GLint components = in.Int();
+			GLenum type = in.UInt();
+			GLboolean normalized = (GLboolean)in.UInt();
+			GLsizei stride = in.Int();
+			GLint64 pointer = in.Size();
+			glVertexAttribPointer(index, components, type, normalized, stride, (const void*)(size_t)pointer);
+			break;
+		}
+		case GLTrace::OP_ENABLE_VERTEX_ATTRIB_ARRAY:
+			glEnableVertexAttribArray(in.UInt());
+			break;
+		case GLTrace::OP_DISABLE_VERTEX_ATTRIB_ARRAY:
+			glDisableVertexAttribArray(in.UInt());
+			break;
+
+		// shaders and programs
+		case GLTrace::OP_CREATE_SHADER:
+		{
+			GLenum type = in.UInt();
+			GLuint recorded = in.UInt();
+			m_names[NAME_SHADER][recorded] = glCreateShader(type);
+			break;
+		}
+		case GLTrace::OP_SHADER_SOURCE:
+		{
+			GLuint shader = MapName(NAME_SHADER, in.UInt());
+			unsigned int length = 0;
+			const GLchar* source = (const GLchar*)in.Blob(&length);
+			GLint sourceLength = (GLint)length;
+			glShaderSource(shader, 1, &source, &sourceLength);
+			break;
+		}
+		case GLTrace::OP_COMPILE_SHADER:
+			glCompileShader(MapName(NAME_SHADER, in.UInt()));
+			break;
+		case GLTrace::OP_DELETE_SHADER:
+			glDeleteShader(MapName(NAME_SHADER, in.UInt()));
+			break;
+		case GLTrace::OP_CREATE_PROGRAM:
+			m_names[NAME_PROGRAM][in.UInt()] = glCreateProgram();
+			break;
+		case GLTrace::OP_ATTACH_SHADER:
+		{
+			GLuint program = MapName(NAME_PROGRAM, in.UInt());
+			glAttachShader(program, MapName(NAME_SHADER, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_LINK_PROGRAM:
+			glLinkProgram(MapName(NAME_PROGRAM, in.UInt()));
+			break;
+		case GLTrace::OP_DELETE_PROGRAM:
+			glDeleteProgram(MapName(NAME_PROGRAM, in.UInt()));
+			break;
+		case GLTrace::OP_USE_PROGRAM:
+			m_currentProgram = MapName(NAME_PROGRAM, in.UInt());
+			glUseProgram(m_currentProgram);
+			break;
+		case GLTrace::OP_GET_UNIFORM_LOCATION:
+		{
+			GLuint program = MapName(NAME_PROGRAM, in.UInt());
+			const GLchar* name = (const GLchar*)in.Blob();
+			GLint recorded = in.Int();
+			if ((NULL != name) && (recorded >= 0))
+			{
+				unsigned long long key = ((unsigned long long)program << 32) | (GLuint)recorded;
+				m_locations[key] = glGetUniformLocation(program, name);
+			}
+			break;
+		}
+		case GLTrace::OP_UNIFORM_1I:
+		{
+			GLint location = MapLocation(in.Int());
+			glUniform1i(location, in.Int());
+			break;
+		}
+		case GLTrace::OP_UNIFORM_1F:
+		{
+			GLint location = MapLocation(in.Int());
+			glUniform1f(location, in.Float());
+			break;
+		}
+		case GLTrace::OP_UNIFORM_2F:
+		{
+			GLint location = MapLocation(in.Int());
+			GLfloat x = in.Float();
+			GLfloat y = in.Float();
+			glUniform2f(location, x, y);
+			break;
+		}
+		case GLTrace::OP_UNIFORM_3F:
+		{
+			GLint location = MapLocation(in.Int());
+			GLfloat x = in.Float();
+			GLfloat y = in.Float();
+			GLfloat z = in.Float();
+			glUniform3f(location, x, y, z);
+			break;
+		}
+		case GLTrace::OP_UNIFORM_4F:
+		{
+			GLint location = MapLocation(in.Int());
+			GLfloat x = in.Float();
+			GLfloat y = in.Float();
+			GLfloat z = in.Float();
+			GLfloat w = in.Float();
+			glUniform4f(location, x, y, z, w);
+			break;
+		}
+		case GLTrace::OP_UNIFORM_2FV:
+		case GLTrace::OP_UNIFORM_3FV:
+		case GLTrace::OP_UNIFORM_4FV:
+		{
+			GLint location = MapLocation(in.Int());
+			GLsizei count = in.Int();
+			const GLfloat* values = (const GLfloat*)in.Blob();
+			if (opcode == GLTrace::OP_UNIFORM_2FV)
+				glUniform2fv(location, count, values);
+			else if (opcode == GLTrace::OP_UNIFORM_3FV)
+				glUniform3fv(location, count, values);
+			else
+				glUniform4fv(location, count, values);
+			break;
+		}
+		case GLTrace::OP_UNIFORM_MATRIX_4FV:
+		{
+			GLint location = MapLocation(in.Int());
+			GLsizei count = in.Int();
+			GLboolean transpose = (GLboolean)in.UInt();
+			glUniformMatrix4fv(location, count, transpose, (const GLfloat*)in.Blob());
+			break;
+		}
+
+		// textures
+		case GLTrace::OP_ACTIVE_TEXTURE:
+			glActiveTexture(in.UInt());
+			break;
+		case GLTrace::OP_BIND_TEXTURE:
+		{
+			GLenum target = in.UInt();
+			glBindTexture(target, MapName(NAME_TEXTURE, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_TEX_IMAGE_2D:
+		{
+			GLenum target = in.UInt();
+			GLint level = in.Int();
+			GLint internalFormat = in.Int();
+			GLsizei width = in.Int();
+			GLsizei height = in.Int();
+			GLint border = in.Int();
+			GLenum format = in.UInt();
+			GLenum type = in.UInt();
+			glTexImage2D(target, level, internalFormat, width, height, border, format, type, in.Blob());
+			break;
+		}
+		case GLTrace::OP_TEX_PARAMETER_I:
+		{
+			GLenum target = in.UInt();
+			GLenum name = in.UInt();
+			glTexParameteri(target, name, in.Int());
+			break;
+		}
+		case GLTrace::OP_PIXEL_STORE_I:
+		{
+			GLenum name = in.UInt();
+			glPixelStorei(name, in.Int());
+			break;
+		}
+		case GLTrace::OP_GENERATE_MIPMAP:
+			glGenerateMipmap(in.UInt());
+			break;
+
+		// framebuffers
+		case GLTrace::OP_BIND_FRAMEBUFFER:
+		{
+			GLenum target = in.UInt();
+			glBindFramebuffer(target, MapName(NAME_FRAMEBUFFER, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_FRAMEBUFFER_TEXTURE_2D:
+		{
+			GLenum target = in.UInt();
+			GLenum attachment = in.UInt();
+			GLenum textureTarget = in.UInt();
+			GLuint texture = MapName(NAME_TEXTURE, in.UInt());
+			glFramebufferTexture2D(target, attachment, textureTarget, texture, in.Int());
+			break;
+		}
+		case GLTrace::OP_FRAMEBUFFER_RENDERBUFFER:
+		{
+			GLenum target = in.UInt();
+			GLenum attachment = in.UInt();
+			GLenum renderbufferTarget = in.UInt();
+			glFramebufferRenderbuffer(target, attachment, renderbufferTarget,
+				MapName(NAME_RENDERBUFFER, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_BIND_RENDERBUFFER:
+		{
+			GLenum target = in.UInt();
+			glBindRenderbuffer(target, MapName(NAME_RENDERBUFFER, in.UInt()));
+			break;
+		}
+		case GLTrace::OP_RENDERBUFFER_STORAGE:
+		{
+			GLenum target = in.UInt();
+			GLenum internalFormat = in.UInt();
+			GLsizei width = in.Int();
+			glRenderbufferStorage(target, internalFormat, width, in.Int());
+			break;
+		}
+
+		// draws
+		case GLTrace::OP_DRAW_ELEMENTS:
+		{
+			GLenum mode = in.UInt();
+			GLsizei count = in.Int();
+			GLenum type = in.UInt();
+			glDrawElements(mode, count, type, (const void*)(size_t)in.Size());
+			break;
+		}
+		case GLTrace::OP_DRAW_ARRAYS:
+		{
+			GLenum mode = in.UInt();
+			GLint first = in.Int();
+			glDrawArrays(mode, first, in.Int());
+			break;
+		}
+		case GLTrace::OP_DRAW_ELEMENTS_INSTANCED:
+		{
+			GLenum mode = in.UInt();
+			GLsizei count = in.Int();
+			GLenum type = in.UInt();
+			const void* indices = (const void*)(size_t)in.Size();
+			glDrawElementsInstanced(mode, count, type, indices, in.Int());
+			break;
+		}
+		case GLTrace::OP_DRAW_ARRAYS_INSTANCED:
+		{
+			GLenum mode = in.UInt();
+			GLint first = in.Int();
+			GLsizei count = in.Int();
+			glDrawArraysInstanced(mode, first, count, in.Int());
+			break;
+		}
+
+		// fixed function state
+		case GLTrace::OP_CLEAR:
+			glClear(in.UInt());
+			break;
+		case GLTrace::OP_CLEAR_COLOR:
+		{
+			GLfloat red = in.Float();
+			GLfloat green = in.Float();
+			GLfloat blue = in.Float();
+			glClearColor(red, green, blue, in.Float());
+			break;
+		}
+		case GLTrace::OP_ENABLE:
+			glEnable(in.UInt());
+			break;
+		case GLTrace::OP_DISABLE:
+			glDisable(in.UInt());
+			break;
+		case GLTrace::OP_BLEND_FUNC:
+		{
+			GLenum source = in.UInt();
+			glBlendFunc(source, in.UInt());
+			break;
+		}
+		case GLTrace::OP_BLEND_FUNC_SEPARATE:
+		{
+			GLenum sourceRGB = in.UInt();
+			GLenum destinationRGB = in.UInt();
+			GLenum sourceAlpha = in.UInt();
+			glBlendFuncSeparate(sourceRGB, destinationRGB, sourceAlpha, in.UInt());
+			break;
+		}
+		case GLTrace::OP_BLEND_EQUATION_SEPARATE:
+		{
+			GLenum modeRGB = in.UInt();
+			glBlendEquationSeparate(modeRGB, in.UInt());
+			break;
+		}
+		case GLTrace::OP_DEPTH_FUNC:
+			glDepthFunc(in.UInt());
+			break;
+		case GLTrace::OP_DEPTH_MASK:
+			glDepthMask((GLboolean)in.UInt());
+			break;
+		case GLTrace::OP_CULL_FACE:
+			glCullFace(in.UInt());
+			break;
+		case GLTrace::OP_VIEWPORT:
+		case GLTrace::OP_SCISSOR:
+		{
+			GLint x = in.Int();
+			GLint y = in.Int();
+			GLsizei width = in.Int();
+			GLsizei height = in.Int();
+			if (opcode == GLTrace::OP_VIEWPORT)
+				glViewport(x, y, width, height);
+			else
+				glScissor(x, y, width, height);
+			break;
+		}
+
+		case GLTrace::OP_UNTRACED:
+			// reported when the trace was loaded
+			break;
+
+		default:
+			// unknown records are skipped using their payload size
+			break;
+		}
+	}
+}
@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// glreplay.h
+// ============
+// play back a recorded GL call trace as fast as possible
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GLReplay
+ *
+ *  This class loads a trace written by GLTrace and replays
+ *  it into the current context: the setup segment once,
+ *  then the recorded frames as many times as requested,
+ *  timing the CPU submission and the GPU completion. No
+ *  scene logic runs, so the result is the driver and GPU
+ *  cost of exactly the frames that were captured.
+ ***********************************************************/
+class GLReplay
+{
+public:
+	// constructor
+	GLReplay();
+	// destructor
+	~GLReplay();
+
+	// read a trace file into memory
+	bool Load(const std::string& filename);
+	// replay the setup, then the frames the given number of times
+	bool Run(int loops);
+
+private:
+	// kinds of object names that are remapped during replay
+	enum NAME_KIND
+	{
+		NAME_BUFFER = 0,
+		NAME_VERTEX_ARRAY,
+		NAME_SHADER,
+		NAME_PROGRAM,
+		NAME_TEXTURE,
+		NAME_FRAMEBUFFER,
+		NAME_RENDERBUFFER,
+		NAME_KIND_COUNT
+	};
+
+	// the whole trace file, without the magic string
+	std::vector<unsigned char> m_trace;
+	// offset of the first record after every frame marker
+	std::vector<size_t> m_frameOffsets;
+
+	// recorded object names mapped onto the names of this context
+	std::map<GLuint, GLuint> m_names[NAME_KIND_COUNT];
+	// recorded uniform locations per program mapped onto this context
+	std::map<unsigned long long, GLint> m_locations;
+	// program currently in use, as named in this context
+	GLuint m_currentProgram;
+
+	// replay the records in [begin, end)
+	void Execute(size_t begin, size_t end);
+	// map a recorded name; unknown names are used unchanged
+	GLuint MapName(NAME_KIND kind, GLuint name) const;
+	// map a recorded uniform location of the current program
+	GLint MapLocation(GLint location) const;
+};
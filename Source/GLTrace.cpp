@@ -0,0 +1,1074 @@
+///////////////////////////////////////////////////////////////////////////////
+// GLTrace.cpp
+// ===========
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `GLTrace` class, which records the OpenGL call
+// stream of the application into a compact binary trace. Together with the
+// replay mode in GLReplay.cpp this isolates the driver and GPU cost of our
+// exact frames from the CPU-side scene logic, and makes it possible to
+// benchmark the same frames on different drivers (for example llvmpipe
+// against a hardware driver).
+//
+// FUNCTIONALITY:
+// - When a capture starts, the GLEW function pointers of every entry point
+//   the application uses are swapped for recording wrappers; the pointers
+//   are restored when the capture ends.
+// - The OpenGL 1.1 entry points are recorded by the GLTrace_* wrappers that
+//   GLTraceHooks.h routes every call through.
+// - Uploaded data is stored in the trace: buffer contents, texture pixels
+//   and shader sources, so the trace replays without any asset files.
+// - The fixed function state set before the capture starts (blending,
+//   depth, culling, clear color, viewport) is queried and written first,
+//   so the replay window starts from the same state.
+//
+// FILE FORMAT:
+// The file starts with FILE_MAGIC. Each call is stored as a 16 bit opcode,
+// a 32 bit payload size and the payload. Integers, enums and floats take
+// 4 bytes, sizes and offsets 8 bytes, and blobs a 32 bit length followed
+// by their bytes. Object names are stored as the application saw them;
+// the replay maps them onto the names its own context hands out.
+//
+// NOTES:
+// Vertex attribute and index pointers are recorded as offsets, which is
+// always the case in a core profile context since client-side arrays are
+// not allowed. Query objects are not recorded; they only feed profilers.
+// The other calls that change GL state but have no replay yet, like the
+// compute dispatches, texture arrays and multi-draws of the extra render
+// passes, write an OP_UNTRACED record with their name, and the replay
+// warns about them. Calls that only read back, such as glReadPixels,
+// buffer maps, fences and queries, are not recorded at all.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "GLTrace.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <vector>
+
+// every GLEW entry point recorded by the trace
+#define GL_TRACE_GLEW_FUNCTIONS(X) \
+	X(GenBuffers, GENBUFFERS) \
+	X(DeleteBuffers, DELETEBUFFERS) \
+	X(BindBuffer, BINDBUFFER) \
+	X(BufferData, BUFFERDATA) \
+	X(BufferSubData, BUFFERSUBDATA) \
+	X(GenVertexArrays, GENVERTEXARRAYS) \
+	X(DeleteVertexArrays, DELETEVERTEXARRAYS) \
+	X(BindVertexArray, BINDVERTEXARRAY) \
+	X(VertexAttribPointer, VERTEXATTRIBPOINTER) \
+	X(EnableVertexAttribArray, ENABLEVERTEXATTRIBARRAY) \
+	X(DisableVertexAttribArray, DISABLEVERTEXATTRIBARRAY) \
+	X(CreateShader, CREATESHADER) \
+	X(ShaderSource, SHADERSOURCE) \
+	X(CompileShader, COMPILESHADER) \
+	X(DeleteShader, DELETESHADER) \
+	X(CreateProgram, CREATEPROGRAM) \
+	X(AttachShader, ATTACHSHADER) \
+	X(LinkProgram, LINKPROGRAM) \
+	X(DeleteProgram, DELETEPROGRAM) \
+	X(UseProgram, USEPROGRAM) \
+	X(GetUniformLocation, GETUNIFORMLOCATION) \
+	X(Uniform1i, UNIFORM1I) \
+	X(Uniform1f, UNIFORM1F) \
+	X(Uniform2f, UNIFORM2F) \
+	X(Uniform2fv, UNIFORM2FV) \
+	X(Uniform3f, UNIFORM3F) \
+	X(Uniform3fv, UNIFORM3FV) \
+	X(Uniform4f, UNIFORM4F) \
+	X(Uniform4fv, UNIFORM4FV) \
+	X(UniformMatrix4fv, UNIFORMMATRIX4FV) \
+	X(ActiveTexture, ACTIVETEXTURE) \
+	X(GenerateMipmap, GENERATEMIPMAP) \
+	X(GenFramebuffers, GENFRAMEBUFFERS) \
+	X(DeleteFramebuffers, DELETEFRAMEBUFFERS) \
+	X(BindFramebuffer, BINDFRAMEBUFFER) \
+	X(FramebufferTexture2D, FRAMEBUFFERTEXTURE2D) \
+	X(FramebufferRenderbuffer, FRAMEBUFFERRENDERBUFFER) \
+	X(GenRenderbuffers, GENRENDERBUFFERS) \
+	X(DeleteRenderbuffers, DELETERENDERBUFFERS) \
+	X(BindRenderbuffer, BINDRENDERBUFFER) \
+	X(RenderbufferStorage, RENDERBUFFERSTORAGE) \
+	X(DrawElementsInstanced, DRAWELEMENTSINSTANCED) \
+	X(DrawArraysInstanced, DRAWARRAYSINSTANCED) \
+	X(BlendFuncSeparate, BLENDFUNCSEPARATE)
+
+// GLEW entry points the application uses that change GL state but are
+// only noted by name, with their parameter and argument lists
+#define GL_TRACE_UNTRACED_FUNCTIONS(X) \
+	X(BindBufferBase, BINDBUFFERBASE, (GLenum target, GLuint index, GLuint buffer), (target, index, buffer)) \
+	X(BindImageTexture, BINDIMAGETEXTURE, (GLuint unit, GLuint texture, GLint level, GLboolean layered, \
+		GLint layer, GLenum access, GLenum format), (unit, texture, level, layered, layer, access, format)) \
+	X(BlitFramebuffer, BLITFRAMEBUFFER, (GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, \
+		GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter), \
+		(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter)) \
+	X(ClearBufferData, CLEARBUFFERDATA, (GLenum target, GLenum internalformat, GLenum format, GLenum type, \
+		const void* data), (target, internalformat, format, type, data)) \
+	X(ClearBufferuiv, CLEARBUFFERUIV, (GLenum buffer, GLint drawbuffer, const GLuint* value), \
+		(buffer, drawbuffer, value)) \
+	X(DetachShader, DETACHSHADER, (GLuint program, GLuint shader), (program, shader)) \
+	X(DispatchCompute, DISPATCHCOMPUTE, (GLuint x, GLuint y, GLuint z), (x, y, z)) \
+	X(DrawBuffers, DRAWBUFFERS, (GLsizei n, const GLenum* bufs), (n, bufs)) \
+	X(FramebufferTextureLayer, FRAMEBUFFERTEXTURELAYER, (GLenum target, GLenum attachment, GLuint texture, \
+		GLint level, GLint layer), (target, attachment, texture, level, layer)) \
+	X(MemoryBarrier, MEMORYBARRIER, (GLbitfield barriers), (barriers)) \
+	X(MultiDrawElements, MULTIDRAWELEMENTS, (GLenum mode, const GLsizei* count, GLenum type, \
+		const void* const* indices, GLsizei drawcount), (mode, count, type, indices, drawcount)) \
+	X(MultiDrawElementsIndirectCount, MULTIDRAWELEMENTSINDIRECTCOUNT, (GLenum mode, GLenum type, \
+		const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride), \
+		(mode, type, indirect, drawcount, maxdrawcount, stride)) \
+	X(MultiDrawElementsIndirectCountARB, MULTIDRAWELEMENTSINDIRECTCOUNTARB, (GLenum mode, GLenum type, \
+		const void* indirect, GLintptr drawcount, GLsizei maxdrawcount, GLsizei stride), \
+		(mode, type, indirect, drawcount, maxdrawcount, stride)) \
+	X(TexImage3D, TEXIMAGE3D, (GLenum target, GLint level, GLint internalformat, GLsizei width, \
+		GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void* pixels), \
+		(target, level, internalformat, width, height, depth, border, format, type, pixels)) \
+	X(TexStorage2D, TEXSTORAGE2D, (GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, \
+		GLsizei height), (target, levels, internalformat, width, height)) \
+	X(Uniform1ui, UNIFORM1UI, (GLint location, GLuint v0), (location, v0)) \
+	X(Uniform2i, UNIFORM2I, (GLint location, GLint v0, GLint v1), (location, v0, v1)) \
+	X(UniformMatrix3fv, UNIFORMMATRIX3FV, (GLint location, GLsizei count, GLboolean transpose, \
+		const GLfloat* value), (location, count, transpose, value)) \
+	X(VertexAttribDivisor, VERTEXATTRIBDIVISOR, (GLuint index, GLuint divisor), (index, divisor)) \
+	X(ViewportArrayv, VIEWPORTARRAYV, (GLuint first, GLsizei count, const GLfloat* v), (first, count, v))
+
+const char* GLTrace::FILE_MAGIC = "GLTRACE1";
+
+// declaration of the global variables and defines
+namespace
+{
+	// the buffered records are written out above this size
+	const size_t g_FlushThreshold = 4 * 1024 * 1024;
+
+	// open trace file and the records not yet written to it
+	FILE* g_TraceFile = NULL;
+	std::vector<unsigned char> g_TraceBuffer;
+	bool g_bCapturing = false;
+	long g_CapturedFrames = 0;
+	// current GL_UNPACK_ALIGNMENT, needed to size texture uploads
+	GLint g_UnpackAlignment = 4;
+
+	// the real GLEW entry points, saved while the capture runs
+#define GL_TRACE_DECLARE_REAL(name, NAME) PFNGL##NAME##PROC g_Real##name = NULL;
+	GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_DECLARE_REAL)
+#undef GL_TRACE_DECLARE_REAL
+#define GL_TRACE_DECLARE_REAL(name, NAME, params, args) PFNGL##NAME##PROC g_Real##name = NULL;
+	GL_TRACE_UNTRACED_FUNCTIONS(GL_TRACE_DECLARE_REAL)
+#undef GL_TRACE_DECLARE_REAL
+	// calls noted by name during the capture, for the summary
+	std::map<std::string, long> g_UntracedCounts;
+
+	// write the buffered records to the trace file
+	void FlushTrace()
+	{
+		if ((NULL != g_TraceFile) && !g_TraceBuffer.empty())
+		{
+			fwrite(&g_TraceBuffer[0], 1, g_TraceBuffer.size(), g_TraceFile);
+		}
+		g_TraceBuffer.clear();
+	}
+
+	/***********************************************************
+	 *  TraceRecord
+	 *
+	 *  Appends one call to the trace buffer. The payload size
+	 *  is patched in when the record goes out of scope.
+	 ***********************************************************/
+	class TraceRecord
+	{
+	public:
+		TraceRecord(GLTrace::OPCODE opcode)
+		{
+			m_start = g_TraceBuffer.size();
+			unsigned short code = (unsigned short)opcode;
+			unsigned int size = 0;
+			Append(&code, sizeof(code));
+			Append(&size, sizeof(size));
+		}
+		~TraceRecord()
+		{
+			unsigned int size = (unsigned int)(g_TraceBuffer.size() - m_start - 6);
+			memcpy(&g_TraceBuffer[m_start + 2], &size, sizeof(size));
+			if (g_TraceBuffer.size() > g_FlushThreshold)
+			{
+				FlushTrace();
+			}
+		}
+
+		void PutUInt(GLuint value) { Append(&value, sizeof(value)); }
+		void PutInt(GLint value) { Append(&value, sizeof(value)); }
+		void PutFloat(GLfloat value) { Append(&value, sizeof(value)); }
+		void PutSize(GLint64 value) { Append(&value, sizeof(value)); }
+		void PutBlob(const void* data, size_t size)
+		{
+			unsigned int length = (NULL != data) ? (unsigned int)size : 0;
+			Append(&length, sizeof(length));
+			if (length > 0)
+			{
+				Append(data, length);
+			}
+		}
+		void PutNames(GLsizei count, const GLuint* names)
+		{
+			PutInt(count);
+			Append(names, sizeof(GLuint) * count);
+		}
+
+	private:
+		size_t m_start;
+
+		void Append(const void* data, size_t size)
+		{
+			const unsigned char* bytes = (const unsigned char*)data;
+			g_TraceBuffer.insert(g_TraceBuffer.end(), bytes, bytes + size);
+		}
+	};
+
+	// bytes of client memory read by glTexImage2D
+	size_t TextureUploadSize(GLsizei width, GLsizei height, GLenum format, GLenum type)
+	{
+		size_t components = 4;
+		size_t componentSize = 1;
+
+		switch (format)
+		{
+		case GL_RED:
+		case GL_DEPTH_COMPONENT:
+			components = 1;
+			break;
+		case GL_RG:
+			components = 2;
+			break;
+		case GL_RGB:
+		case GL_BGR:
+			components = 3;
+			break;
+		default:
+			components = 4;
+			break;
+		}
+		switch (type)
+		{
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			componentSize = 2;
+			break;
+		case GL_FLOAT:
+		case GL_UNSIGNED_INT:
+			componentSize = 4;
+			break;
+		case GL_UNSIGNED_INT_24_8:
+			components = 1;
+			componentSize = 4;
+			break;
+		default:
+			componentSize = 1;
+			break;
+		}
+
+		size_t alignment = (g_UnpackAlignment > 0) ? (size_t)g_UnpackAlignment : 1;
+		size_t rowSize = ((size_t)width * components * componentSize + alignment - 1) / alignment * alignment;
+		return(rowSize * height);
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// recording wrappers for the GLEW entry points
+	///////////////////////////////////////////////////////////////////////////
+
+	void APIENTRY Trace_GenBuffers(GLsizei n, GLuint* buffers)
+	{
+		g_RealGenBuffers(n, buffers);
+		TraceRecord record(GLTrace::OP_GEN_BUFFERS);
+		record.PutNames(n, buffers);
+	}
+	void APIENTRY Trace_DeleteBuffers(GLsizei n, const GLuint* buffers)
+	{
+		g_RealDeleteBuffers(n, buffers);
+		TraceRecord record(GLTrace::OP_DELETE_BUFFERS);
+		record.PutNames(n, buffers);
+	}
+	void APIENTRY Trace_BindBuffer(GLenum target, GLuint buffer)
+	{
+		g_RealBindBuffer(target, buffer);
+		TraceRecord record(GLTrace::OP_BIND_BUFFER);
+		record.PutUInt(target);
+		record.PutUInt(buffer);
+	}
+	void APIENTRY Trace_BufferData(GLenum target, GLsizeiptr size, const void* data, GLenum usage)
+	{
+		g_RealBufferData(target, size, data, usage);
+		TraceRecord record(GLTrace::OP_BUFFER_DATA);
+		record.PutUInt(target);
+		record.PutSize(size);
+		record.PutUInt(usage);
+		record.PutBlob(data, size);
+	}
+	void APIENTRY Trace_BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void* data)
+	{
+		g_RealBufferSubData(target, offset, size, data);
+		TraceRecord record(GLTrace::OP_BUFFER_SUB_DATA);
+		record.PutUInt(target);
+		record.PutSize(offset);
+		record.PutBlob(data, size);
+	}
+	void APIENTRY Trace_GenVertexArrays(GLsizei n, GLuint* arrays)
+	{
+		g_RealGenVertexArrays(n, arrays);
+		TraceRecord record(GLTrace::OP_GEN_VERTEX_ARRAYS);
+		record.PutNames(n, arrays);
+	}
+	void APIENTRY Trace_DeleteVertexArrays(GLsizei n, const GLuint* arrays)
+	{
+		g_RealDeleteVertexArrays(n, arrays);
+		TraceRecord record(GLTrace::OP_DELETE_VERTEX_ARRAYS);
+		record.PutNames(n, arrays);
+	}
+	void APIENTRY Trace_BindVertexArray(GLuint array)
+	{
+		g_RealBindVertexArray(array);
+		TraceRecord record(GLTrace::OP_BIND_VERTEX_ARRAY);
+		record.PutUInt(array);
+	}
+	void APIENTRY Trace_VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized,
+		GLsizei stride, const void* pointer)
+	{
+		g_RealVertexAttribPointer(index, size, type, normalized, stride, pointer);
+		TraceRecord record(GLTrace::OP_VERTEX_ATTRIB_POINTER);
+		record.PutUInt(index);
+		record.PutInt(size);
+		record.PutUInt(type);
+		record.PutUInt(normalized);
+		record.PutInt(stride);
+		record.PutSize((GLint64)(size_t)pointer);
+	}
+	void APIENTRY Trace_EnableVertexAttribArray(GLuint index)
+	{
+		g_RealEnableVertexAttribArray(index);
+		TraceRecord record(GLTrace::OP_ENABLE_VERTEX_ATTRIB_ARRAY);
+		record.PutUInt(index);
+	}
+	void APIENTRY Trace_DisableVertexAttribArray(GLuint index)
+	{
+		g_RealDisableVertexAttribArray(index);
+		TraceRecord record(GLTrace::OP_DISABLE_VERTEX_ATTRIB_ARRAY);
+		record.PutUInt(index);
+	}
+	GLuint APIENTRY Trace_CreateShader(GLenum type)
+	{
+		GLuint shader = g_RealCreateShader(type);
+		TraceRecord record(GLTrace::OP_CREATE_SHADER);
+		record.PutUInt(type);
+		record.PutUInt(shader);
+		return(shader);
+	}
+	void APIENTRY Trace_ShaderSource(GLuint shader, GLsizei count, const GLchar* const* strings, const GLint* lengths)
+	{
+		std::string source;
+
+		g_RealShaderSource(shader, count, strings, lengths);
+		for (GLsizei i = 0; i < count; i++)
+		{
+			if ((NULL != lengths) && (lengths[i] >= 0))
+			{
+				source.append(strings[i], lengths[i]);
+			}
+			else
+			{
+				source.append(strings[i]);
+			}
+		}
+
+		TraceRecord record(GLTrace::OP_SHADER_SOURCE);
+		record.PutUInt(shader);
+		record.PutBlob(source.c_str(), source.size());
+	}
+	void APIENTRY Trace_CompileShader(GLuint shader)
+	{
+		g_RealCompileShader(shader);
+		TraceRecord record(GLTrace::OP_COMPILE_SHADER);
+		record.PutUInt(shader);
+	}
+	void APIENTRY Trace_DeleteShader(GLuint shader)
+	{
+		g_RealDeleteShader(shader);
+		TraceRecord record(GLTrace::OP_DELETE_SHADER);
+		record.PutUInt(shader);
+	}
+	GLuint APIENTRY Trace_CreateProgram()
+	{
+		GLuint program = g_RealCreateProgram();
+		TraceRecord record(GLTrace::OP_CREATE_PROGRAM);
+		record.PutUInt(program);
+		return(program);
+	}
+	void APIENTRY Trace_AttachShader(GLuint program, GLuint shader)
+	{
+		g_RealAttachShader(program, shader);
+		TraceRecord record(GLTrace::OP_ATTACH_SHADER);
+		record.PutUInt(program);
+		record.PutUInt(shader);
+	}
+	void APIENTRY Trace_LinkProgram(GLuint program)
+	{
+		g_RealLinkProgram(program);
+		TraceRecord record(GLTrace::OP_LINK_PROGRAM);
+		record.PutUInt(program);
+	}
+	void APIENTRY Trace_DeleteProgram(GLuint program)
+	{
+		g_RealDeleteProgram(program);
+		TraceRecord record(GLTrace::OP_DELETE_PROGRAM);
+		record.PutUInt(program);
+	}
+	void APIENTRY Trace_UseProgram(GLuint program)
+	{
+		g_RealUseProgram(program);
+		TraceRecord record(GLTrace::OP_USE_PROGRAM);
+		record.PutUInt(program);
+	}
+	GLint APIENTRY Trace_GetUniformLocation(GLuint program, const GLchar* name)
+	{
+		GLint location = g_RealGetUniformLocation(program, name);
+		TraceRecord record(GLTrace::OP_GET_UNIFORM_LOCATION);
+		record.PutUInt(program);
+		record.PutBlob(name, strlen(name) + 1);
+		record.PutInt(location);
+		return(location);
+	}
+	void APIENTRY Trace_Uniform1i(GLint location, GLint v0)
+	{
+		g_RealUniform1i(location, v0);
+		TraceRecord record(GLTrace::OP_UNIFORM_1I);
+		record.PutInt(location);
+		record.PutInt(v0);
+	}
+	void APIENTRY Trace_Uniform1f(GLint location, GLfloat v0)
+	{
+		g_RealUniform1f(location, v0);
+		TraceRecord record(GLTrace::OP_UNIFORM_1F);
+		record.PutInt(location);
+		record.PutFloat(v0);
+	}
+	void APIENTRY Trace_Uniform2f(GLint location, GLfloat v0, GLfloat v1)
+	{
+		g_RealUniform2f(location, v0, v1);
+		TraceRecord record(GLTrace::OP_UNIFORM_2F);
+		record.PutInt(location);
+		record.PutFloat(v0);
+		record.PutFloat(v1);
+	}
+	void APIENTRY Trace_Uniform2fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_RealUniform2fv(location, count, value);
+		TraceRecord record(GLTrace::OP_UNIFORM_2FV);
+		record.PutInt(location);
+		record.PutInt(count);
+		record.PutBlob(value, sizeof(GLfloat) * 2 * count);
+	}
+	void APIENTRY Trace_Uniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2)
+	{
+		g_RealUniform3f(location, v0, v1, v2);
+		TraceRecord record(GLTrace::OP_UNIFORM_3F);
+		record.PutInt(location);
+		record.PutFloat(v0);
+		record.PutFloat(v1);
+		record.PutFloat(v2);
+	}
+	void APIENTRY Trace_Uniform3fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_RealUniform3fv(location, count, value);
+		TraceRecord record(GLTrace::OP_UNIFORM_3FV);
+		record.PutInt(location);
+		record.PutInt(count);
+		record.PutBlob(value, sizeof(GLfloat) * 3 * count);
+	}
+	void APIENTRY Trace_Uniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3)
+	{
+		g_RealUniform4f(location, v0, v1, v2, v3);
+		TraceRecord record(GLTrace::OP_UNIFORM_4F);
+		record.PutInt(location);
+		record.PutFloat(v0);
+		record.PutFloat(v1);
+		record.PutFloat(v2);
+		record.PutFloat(v3);
+	}
+	void APIENTRY Trace_Uniform4fv(GLint location, GLsizei count, const GLfloat* value)
+	{
+		g_RealUniform4fv(location, count, value);
+		TraceRecord record(GLTrace::OP_UNIFORM_4FV);
+		record.PutInt(location);
+		record.PutInt(count);
+		record.PutBlob(value, sizeof(GLfloat) * 4 * count);
+	}
+	void APIENTRY Trace_UniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value)
+	{
+		g_RealUniformMatrix4fv(location, count, transpose, value);
+		TraceRecord record(GLTrace::OP_UNIFORM_MATRIX_4FV);
+		record.PutInt(location);
+		record.PutInt(count);
+		record.PutUInt(transpose);
+		record.PutBlob(value, sizeof(GLfloat) * 16 * count);
+	}
+	void APIENTRY Trace_ActiveTexture(GLenum texture)
+	{
+		g_RealActiveTexture(texture);
+		TraceRecord record(GLTrace::OP_ACTIVE_TEXTURE);
+		record.PutUInt(texture);
+	}
+	void APIENTRY Trace_GenerateMipmap(GLenum target)
+	{
+		g_RealGenerateMipmap(target);
+		TraceRecord record(GLTrace::OP_GENERATE_MIPMAP);
+		record.PutUInt(target);
+	}
+	void APIENTRY Trace_GenFramebuffers(GLsizei n, GLuint* framebuffers)
+	{
+		g_RealGenFramebuffers(n, framebuffers);
+		TraceRecord record(GLTrace::OP_GEN_FRAMEBUFFERS);
+		record.PutNames(n, framebuffers);
+	}
+	void APIENTRY Trace_DeleteFramebuffers(GLsizei n, const GLuint* framebuffers)
+	{
+		g_RealDeleteFramebuffers(n, framebuffers);
+		TraceRecord record(GLTrace::OP_DELETE_FRAMEBUFFERS);
+		record.PutNames(n, framebuffers);
+	}
+	void APIENTRY Trace_BindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		g_RealBindFramebuffer(target, framebuffer);
+		TraceRecord record(GLTrace::OP_BIND_FRAMEBUFFER);
+		record.PutUInt(target);
+		record.PutUInt(framebuffer);
+	}
+	void APIENTRY Trace_FramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget,
+		GLuint texture, GLint level)
+	{
+		g_RealFramebufferTexture2D(target, attachment, textarget, texture, level);
+		TraceRecord record(GLTrace::OP_FRAMEBUFFER_TEXTURE_2D);
+		record.PutUInt(target);
+		record.PutUInt(attachment);
+		record.PutUInt(textarget);
+		record.PutUInt(texture);
+		record.PutInt(level);
+	}
+	void APIENTRY Trace_FramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget,
+		GLuint renderbuffer)
+	{
+		g_RealFramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+		TraceRecord record(GLTrace::OP_FRAMEBUFFER_RENDERBUFFER);
+		record.PutUInt(target);
+		record.PutUInt(attachment);
+		record.PutUInt(renderbuffertarget);
+		record.PutUInt(renderbuffer);
+	}
+	void APIENTRY Trace_GenRenderbuffers(GLsizei n, GLuint* renderbuffers)
+	{
+		g_RealGenRenderbuffers(n, renderbuffers);
+		TraceRecord record(GLTrace::OP_GEN_RENDERBUFFERS);
+		record.PutNames(n, renderbuffers);
+	}
+	void APIENTRY Trace_DeleteRenderbuffers(GLsizei n, const GLuint* renderbuffers)
+	{
+		g_RealDeleteRenderbuffers(n, renderbuffers);
+		TraceRecord record(GLTrace::OP_DELETE_RENDERBUFFERS);
+		record.PutNames(n, renderbuffers);
+	}
+	void APIENTRY Trace_BindRenderbuffer(GLenum target, GLuint renderbuffer)
+	{
+		g_RealBindRenderbuffer(target, renderbuffer);
+		TraceRecord record(GLTrace::OP_BIND_RENDERBUFFER);
+		record.PutUInt(target);
+		record.PutUInt(renderbuffer);
+	}
+	void APIENTRY Trace_RenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
+	{
+		g_RealRenderbufferStorage(target, internalformat, width, height);
+		TraceRecord record(GLTrace::OP_RENDERBUFFER_STORAGE);
+		record.PutUInt(target);
+		record.PutUInt(internalformat);
+		record.PutInt(width);
+		record.PutInt(height);
+	}
+	void APIENTRY Trace_DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices,
+		GLsizei instancecount)
+	{
+		g_RealDrawElementsInstanced(mode, count, type, indices, instancecount);
+		TraceRecord record(GLTrace::OP_DRAW_ELEMENTS_INSTANCED);
+		record.PutUInt(mode);
+		record.PutInt(count);
+		record.PutUInt(type);
+		record.PutSize((GLint64)(size_t)indices);
+		record.PutInt(instancecount);
+	}
+	void APIENTRY Trace_DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instancecount)
+	{
+		g_RealDrawArraysInstanced(mode, first, count, instancecount);
+		TraceRecord record(GLTrace::OP_DRAW_ARRAYS_INSTANCED);
+		record.PutUInt(mode);
+		record.PutInt(first);
+		record.PutInt(count);
+		record.PutInt(instancecount);
+	}
+	void APIENTRY Trace_BlendFuncSeparate(GLenum sfactorRGB, GLenum dfactorRGB, GLenum sfactorAlpha, GLenum dfactorAlpha)
+	{
+		g_RealBlendFuncSeparate(sfactorRGB, dfactorRGB, sfactorAlpha, dfactorAlpha);
+		TraceRecord record(GLTrace::OP_BLEND_FUNC_SEPARATE);
+		record.PutUInt(sfactorRGB);
+		record.PutUInt(dfactorRGB);
+		record.PutUInt(sfactorAlpha);
+		record.PutUInt(dfactorAlpha);
+	}
+
+	/***********************************************************
+	 *  RecordInitialState()
+	 *
+	 *  Writes the fixed function state the context already has
+	 *  when the capture starts, such as the blending set up
+	 *  with the window, so the setup segment of the replay
+	 *  starts from the same state.
+	 ***********************************************************/
+	void RecordInitialState()
+	{
+		const GLenum capabilities[] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST };
+		for (size_t i = 0; i < sizeof(capabilities) / sizeof(capabilities[0]); i++)
+		{
+			TraceRecord record(glIsEnabled(capabilities[i]) ? GLTrace::OP_ENABLE : GLTrace::OP_DISABLE);
+			record.PutUInt(capabilities[i]);
+		}
+
+		GLint blend[4] = { 0 };
+		glGetIntegerv(GL_BLEND_SRC_RGB, &blend[0]);
+		glGetIntegerv(GL_BLEND_DST_RGB, &blend[1]);
+		glGetIntegerv(GL_BLEND_SRC_ALPHA, &blend[2]);
+		glGetIntegerv(GL_BLEND_DST_ALPHA, &blend[3]);
+		{
+			TraceRecord record(GLTrace::OP_BLEND_FUNC_SEPARATE);
+			for (int i = 0; i < 4; i++)
+			{
+				record.PutUInt((GLuint)blend[i]);
+			}
+		}
+		GLint equation[2] = { 0 };
+		glGetIntegerv(GL_BLEND_EQUATION_RGB, &equation[0]);
+		glGetIntegerv(GL_BLEND_EQUATION_ALPHA, &equation[1]);
+		{
+			TraceRecord record(GLTrace::OP_BLEND_EQUATION_SEPARATE);
+			record.PutUInt((GLuint)equation[0]);
+			record.PutUInt((GLuint)equation[1]);
+		}
+
+		GLint depthFunc = 0;
+		GLboolean depthMask = GL_TRUE;
+		GLint cullFace = 0;
+		glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+		glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+		glGetIntegerv(GL_CULL_FACE_MODE, &cullFace);
+		{
+			TraceRecord record(GLTrace::OP_DEPTH_FUNC);
+			record.PutUInt((GLuint)depthFunc);
+		}
+		{
+			TraceRecord record(GLTrace::OP_DEPTH_MASK);
+			record.PutUInt(depthMask);
+		}
+		{
+			TraceRecord record(GLTrace::OP_CULL_FACE);
+			record.PutUInt((GLuint)cullFace);
+		}
+
+		GLfloat clearColor[4] = { 0.0f };
+		glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+		{
+			TraceRecord record(GLTrace::OP_CLEAR_COLOR);
+			for (int i = 0; i < 4; i++)
+			{
+				record.PutFloat(clearColor[i]);
+			}
+		}
+
+		GLint viewport[4] = { 0 };
+		GLint scissor[4] = { 0 };
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glGetIntegerv(GL_SCISSOR_BOX, scissor);
+		{
+			TraceRecord record(GLTrace::OP_VIEWPORT);
+			for (int i = 0; i < 4; i++)
+			{
+				record.PutInt(viewport[i]);
+			}
+		}
+		{
+			TraceRecord record(GLTrace::OP_SCISSOR);
+			for (int i = 0; i < 4; i++)
+			{
+				record.PutInt(scissor[i]);
+			}
+		}
+		{
+			TraceRecord record(GLTrace::OP_PIXEL_STORE_I);
+			record.PutUInt(GL_UNPACK_ALIGNMENT);
+			record.PutInt(g_UnpackAlignment);
+		}
+	}
+
+	///////////////////////////////////////////////////////////////////////////
+	// wrappers that only note the calls the replay cannot issue yet
+	///////////////////////////////////////////////////////////////////////////
+
+	void NoteUntraced(const char* name)
+	{
+		TraceRecord record(GLTrace::OP_UNTRACED);
+		record.PutBlob(name, strlen(name));
+		g_UntracedCounts[name]++;
+	}
+
+#define GL_TRACE_DEFINE_UNTRACED(name, NAME, params, args) \
+	void APIENTRY Untraced_##name params \
+	{ \
+		g_Real##name args; \
+		NoteUntraced("gl" #name); \
+	}
+	GL_TRACE_UNTRACED_FUNCTIONS(GL_TRACE_DEFINE_UNTRACED)
+#undef GL_TRACE_DEFINE_UNTRACED
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// recording wrappers for the OpenGL 1.1 entry points (see GLTraceHooks.h)
+///////////////////////////////////////////////////////////////////////////////
+
+void APIENTRY GLTrace_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+{
+	glDrawElements(mode, count, type, indices);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DRAW_ELEMENTS);
+		record.PutUInt(mode);
+		record.PutInt(count);
+		record.PutUInt(type);
+		record.PutSize((GLint64)(size_t)indices);
+	}
+}
+void APIENTRY GLTrace_DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+	glDrawArrays(mode, first, count);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DRAW_ARRAYS);
+		record.PutUInt(mode);
+		record.PutInt(first);
+		record.PutInt(count);
+	}
+}
+void APIENTRY GLTrace_Clear(GLbitfield mask)
+{
+	glClear(mask);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_CLEAR);
+		record.PutUInt(mask);
+	}
+}
+void APIENTRY GLTrace_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha)
+{
+	glClearColor(red, green, blue, alpha);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_CLEAR_COLOR);
+		record.PutFloat(red);
+		record.PutFloat(green);
+		record.PutFloat(blue);
+		record.PutFloat(alpha);
+	}
+}
+void APIENTRY GLTrace_Enable(GLenum cap)
+{
+	glEnable(cap);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_ENABLE);
+		record.PutUInt(cap);
+	}
+}
+void APIENTRY GLTrace_Disable(GLenum cap)
+{
+	glDisable(cap);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DISABLE);
+		record.PutUInt(cap);
+	}
+}
+void APIENTRY GLTrace_BlendFunc(GLenum sfactor, GLenum dfactor)
+{
+	glBlendFunc(sfactor, dfactor);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_BLEND_FUNC);
+		record.PutUInt(sfactor);
+		record.PutUInt(dfactor);
+	}
+}
+void APIENTRY GLTrace_DepthFunc(GLenum func)
+{
+	glDepthFunc(func);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DEPTH_FUNC);
+		record.PutUInt(func);
+	}
+}
+void APIENTRY GLTrace_DepthMask(GLboolean flag)
+{
+	glDepthMask(flag);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DEPTH_MASK);
+		record.PutUInt(flag);
+	}
+}
+void APIENTRY GLTrace_CullFace(GLenum mode)
+{
+	glCullFace(mode);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_CULL_FACE);
+		record.PutUInt(mode);
+	}
+}
+void APIENTRY GLTrace_Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glViewport(x, y, width, height);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_VIEWPORT);
+		record.PutInt(x);
+		record.PutInt(y);
+		record.PutInt(width);
+		record.PutInt(height);
+	}
+}
+void APIENTRY GLTrace_Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	glScissor(x, y, width, height);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_SCISSOR);
+		record.PutInt(x);
+		record.PutInt(y);
+		record.PutInt(width);
+		record.PutInt(height);
+	}
+}
+void APIENTRY GLTrace_BindTexture(GLenum target, GLuint texture)
+{
+	glBindTexture(target, texture);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_BIND_TEXTURE);
+		record.PutUInt(target);
+		record.PutUInt(texture);
+	}
+}
+void APIENTRY GLTrace_GenTextures(GLsizei n, GLuint* textures)
+{
+	glGenTextures(n, textures);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_GEN_TEXTURES);
+		record.PutNames(n, textures);
+	}
+}
+void APIENTRY GLTrace_DeleteTextures(GLsizei n, const GLuint* textures)
+{
+	glDeleteTextures(n, textures);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_DELETE_TEXTURES);
+		record.PutNames(n, textures);
+	}
+}
+void APIENTRY GLTrace_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width,
+	GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels)
+{
+	glTexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_TEX_IMAGE_2D);
+		record.PutUInt(target);
+		record.PutInt(level);
+		record.PutInt(internalformat);
+		record.PutInt(width);
+		record.PutInt(height);
+		record.PutInt(border);
+		record.PutUInt(format);
+		record.PutUInt(type);
+		record.PutBlob(pixels, TextureUploadSize(width, height, format, type));
+	}
+}
+void APIENTRY GLTrace_TexParameteri(GLenum target, GLenum pname, GLint param)
+{
+	glTexParameteri(target, pname, param);
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_TEX_PARAMETER_I);
+		record.PutUInt(target);
+		record.PutUInt(pname);
+		record.PutInt(param);
+	}
+}
+void APIENTRY GLTrace_PixelStorei(GLenum pname, GLint param)
+{
+	glPixelStorei(pname, param);
+	if (pname == GL_UNPACK_ALIGNMENT)
+	{
+		g_UnpackAlignment = param;
+	}
+	if (g_bCapturing)
+	{
+		TraceRecord record(GLTrace::OP_PIXEL_STORE_I);
+		record.PutUInt(pname);
+		record.PutInt(param);
+	}
+}
+void APIENTRY GLTrace_DrawBuffer(GLenum buf)
+{
+	glDrawBuffer(buf);
+	if (g_bCapturing)
+	{
+		NoteUntraced("glDrawBuffer");
+	}
+}
+void APIENTRY GLTrace_ReadBuffer(GLenum src)
+{
+	glReadBuffer(src);
+	if (g_bCapturing)
+	{
+		NoteUntraced("glReadBuffer");
+	}
+}
+
+/***********************************************************
+ *  BeginCapture()
+ *
+ *  This method opens the trace file, records the fixed
+ *  function state the context already has and swaps the
+ *  GLEW function pointers for the recording wrappers. It must
+ *  be called after glewInit() and before the resources of
+ *  the scene are created, so the trace is self-contained.
+ ***********************************************************/
+bool GLTrace::BeginCapture(const std::string& filename)
+{
+	if (g_bCapturing)
+	{
+		return(false);
+	}
+
+	g_TraceFile = fopen(filename.c_str(), "wb");
+	if (NULL == g_TraceFile)
+	{
+		std::cerr << "Could not open GL trace file: " << filename << std::endl;
+		return(false);
+	}
+	fwrite(FILE_MAGIC, 1, strlen(FILE_MAGIC), g_TraceFile);
+
+	glGetIntegerv(GL_UNPACK_ALIGNMENT, &g_UnpackAlignment);
+	g_TraceBuffer.reserve(g_FlushThreshold * 2);
+	g_CapturedFrames = 0;
+	g_UntracedCounts.clear();
+	RecordInitialState();
+
+#define GL_TRACE_HOOK(name, NAME) g_Real##name = __glew##name; __glew##name = Trace_##name;
+	GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_HOOK)
+#undef GL_TRACE_HOOK
+	// entry points the driver does not offer stay NULL
+#define GL_TRACE_HOOK(name, NAME, params, args) \
+	g_Real##name = __glew##name; \
+	if (NULL != g_Real##name) { __glew##name = Untraced_##name; }
+	GL_TRACE_UNTRACED_FUNCTIONS(GL_TRACE_HOOK)
+#undef GL_TRACE_HOOK
+
+	g_bCapturing = true;
+	std::cout << "INFO: Capturing GL calls into " << filename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  MarkFrame()
+ *
+ *  This method records the end of a frame, called just
+ *  before the buffers are swapped.
+ ***********************************************************/
+void GLTrace::MarkFrame()
+{
+	if (!g_bCapturing)
+	{
+		return;
+	}
+
+	TraceRecord record(OP_END_FRAME);
+	record.PutInt((GLint)g_CapturedFrames);
+	g_CapturedFrames++;
+}
+
+/***********************************************************
+ *  EndCapture()
+ *
+ *  This method restores the GLEW function pointers and
+ *  writes the remaining records to the trace file.
+ ***********************************************************/
+void GLTrace::EndCapture()
+{
+	if (!g_bCapturing)
+	{
+		return;
+	}
+
+#define GL_TRACE_UNHOOK(name, NAME) __glew##name = g_Real##name;
+	GL_TRACE_GLEW_FUNCTIONS(GL_TRACE_UNHOOK)
+#undef GL_TRACE_UNHOOK
+#define GL_TRACE_UNHOOK(name, NAME, params, args) __glew##name = g_Real##name;
+	GL_TRACE_UNTRACED_FUNCTIONS(GL_TRACE_UNHOOK)
+#undef GL_TRACE_UNHOOK
+
+	g_bCapturing = false;
+	FlushTrace();
+	long fileSize = ftell(g_TraceFile);
+	fclose(g_TraceFile);
+	g_TraceFile = NULL;
+
+	std::cout << "INFO: GL trace finished: " << g_CapturedFrames << " frames, "
+		<< fileSize / 1024 << " KB" << std::endl;
+	if (!g_UntracedCounts.empty())
+	{
+		std::cout << "WARNING: the GL trace could not record these calls and will not replay them:";
+		for (std::map<std::string, long>::const_iterator it = g_UntracedCounts.begin(); it != g_UntracedCounts.end(); ++it)
+		{
+			std::cout << " " << it->first << " (" << it->second << ")";
+		}
+		std::cout << std::endl;
+	}
+}
+
+/***********************************************************
+ *  IsCapturing()
+ *
+ *  This method returns true while a capture is running.
+ ***********************************************************/
+bool GLTrace::IsCapturing()
+{
+	return(g_bCapturing);
+}
+
+/***********************************************************
+ *  GetCapturedFrames()
+ *
+ *  This method returns the number of recorded frames.
+ ***********************************************************/
+long GLTrace::GetCapturedFrames()
+{
+	return(g_CapturedFrames);
+}
@@ -0,0 +1,121 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltrace.h
+// ============
+// record the OpenGL call stream of the application to a binary trace
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  GLTrace
+ *
+ *  This class records every OpenGL call the application
+ *  issues into a compact binary trace, including the
+ *  contents of uploaded buffers, textures and shader
+ *  sources, so the frames can be replayed without any of
+ *  the scene logic. Calls loaded through GLEW are captured
+ *  by swapping the GLEW function pointers; the OpenGL 1.1
+ *  calls are captured by the wrappers in GLTraceHooks.h.
+ *  Calls the replay cannot issue yet are still noted by
+ *  name, so a trace that misses state is reported.
+ ***********************************************************/
+class GLTrace
+{
+public:
+	// identifies each recorded call in the trace file
+	enum OPCODE
+	{
+		OP_END_FRAME = 1,
+		OP_GEN_BUFFERS,
+		OP_DELETE_BUFFERS,
+		OP_BIND_BUFFER,
+		OP_BUFFER_DATA,
+		OP_BUFFER_SUB_DATA,
+		OP_GEN_VERTEX_ARRAYS,
+		OP_DELETE_VERTEX_ARRAYS,
+		OP_BIND_VERTEX_ARRAY,
+		OP_VERTEX_ATTRIB_POINTER,
+		OP_ENABLE_VERTEX_ATTRIB_ARRAY,
+		OP_DISABLE_VERTEX_ATTRIB_ARRAY,
+		OP_CREATE_SHADER,
+		OP_SHADER_SOURCE,
+		OP_COMPILE_SHADER,
+		OP_DELETE_SHADER,
+		OP_CREATE_PROGRAM,
+		OP_ATTACH_SHADER,
+		OP_LINK_PROGRAM,
+		OP_DELETE_PROGRAM,
+		OP_USE_PROGRAM,
+		OP_GET_UNIFORM_LOCATION,
+		OP_UNIFORM_1I,
+		OP_UNIFORM_1F,
+		OP_UNIFORM_2F,
+		OP_UNIFORM_2FV,
+		OP_UNIFORM_3F,
+		OP_UNIFORM_3FV,
+		OP_UNIFORM_4F,
+		OP_UNIFORM_4FV,
+		OP_UNIFORM_MATRIX_4FV,
+		OP_ACTIVE_TEXTURE,
+		OP_GENERATE_MIPMAP,
+		OP_GEN_FRAMEBUFFERS,
+		OP_DELETE_FRAMEBUFFERS,
+		OP_BIND_FRAMEBUFFER,
+		OP_FRAMEBUFFER_TEXTURE_2D,
+		OP_FRAMEBUFFER_RENDERBUFFER,
+		OP_GEN_RENDERBUFFERS,
+		OP_DELETE_RENDERBUFFERS,
+		OP_BIND_RENDERBUFFER,
+		OP_RENDERBUFFER_STORAGE,
+		OP_DRAW_ELEMENTS_INSTANCED,
+		OP_DRAW_ARRAYS_INSTANCED,
+		OP_BLEND_FUNC_SEPARATE,
+		OP_DRAW_ELEMENTS,
+		OP_DRAW_ARRAYS,
+		OP_CLEAR,
+		OP_CLEAR_COLOR,
+		OP_ENABLE,
+		OP_DISABLE,
+		OP_BLEND_FUNC,
+		OP_DEPTH_FUNC,
+		OP_DEPTH_MASK,
+		OP_CULL_FACE,
+		OP_VIEWPORT,
+		OP_SCISSOR,
+		OP_BIND_TEXTURE,
+		OP_GEN_TEXTURES,
+		OP_DELETE_TEXTURES,
+		OP_TEX_IMAGE_2D,
+		OP_TEX_PARAMETER_I,
+		OP_PIXEL_STORE_I,
+		// a call that changes GL state but is not recorded; holds
+		// the name of the entry point so the replay can report it
+		OP_UNTRACED,
+		// only written for the state found when the capture starts
+		OP_BLEND_EQUATION_SEPARATE,
+		OP_COUNT
+	};
+
+	// start recording into a trace file, beginning with the fixed
+	// function state already set; call after glewInit()
+	static bool BeginCapture(const std::string& filename);
+	// mark the end of a frame in the trace; the first marked
+	// segment holds the scene setup and is replayed only once
+	static void MarkFrame();
+	// stop recording, restore the GLEW pointers and close the file
+	static void EndCapture();
+
+	// true while a capture is running
+	static bool IsCapturing();
+	// number of frames recorded so far
+	static long GetCapturedFrames();
+
+	// magic string at the start of every trace file
+	static const char* FILE_MAGIC;
+};
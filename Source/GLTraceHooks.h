@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// gltracehooks.h
+// ============
+// route the OpenGL 1.1 entry points through the GL call trace
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+// This header is force-included into every translation unit of the
+// project (see ForcedIncludeFiles in the project file), including
+// ShapeMeshes.cpp and ShaderManager.cpp. The OpenGL 1.1 functions are
+// exported directly by the OpenGL library instead of being loaded through
+// GLEW function pointers, so they are redirected with macros here. The
+// wrappers pass straight through when no capture is running.
+// GLTrace.cpp and GLReplay.cpp define GL_TRACE_NO_HOOKS to call the real
+// functions.
+
+#pragma once
+
+#ifdef __cplusplus
+
+#include <GL/glew.h>
+
+#ifndef GL_TRACE_NO_HOOKS
+
+void APIENTRY GLTrace_DrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices);
+void APIENTRY GLTrace_DrawArrays(GLenum mode, GLint first, GLsizei count);
+void APIENTRY GLTrace_Clear(GLbitfield mask);
+void APIENTRY GLTrace_ClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha);
+void APIENTRY GLTrace_Enable(GLenum cap);
+void APIENTRY GLTrace_Disable(GLenum cap);
+void APIENTRY GLTrace_BlendFunc(GLenum sfactor, GLenum dfactor);
+void APIENTRY GLTrace_DepthFunc(GLenum func);
+void APIENTRY GLTrace_DepthMask(GLboolean flag);
+void APIENTRY GLTrace_CullFace(GLenum mode);
+void APIENTRY GLTrace_Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+void APIENTRY GLTrace_Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+void APIENTRY GLTrace_BindTexture(GLenum target, GLuint texture);
+void APIENTRY GLTrace_GenTextures(GLsizei n, GLuint* textures);
+void APIENTRY GLTrace_DeleteTextures(GLsizei n, const GLuint* textures);
+void APIENTRY GLTrace_TexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width,
+	GLsizei height, GLint border, GLenum format, GLenum type, const void* pixels);
+void APIENTRY GLTrace_TexParameteri(GLenum target, GLenum pname, GLint param);
+void APIENTRY GLTrace_PixelStorei(GLenum pname, GLint param);
+// noted in the trace by name only
+void APIENTRY GLTrace_DrawBuffer(GLenum buf);
+void APIENTRY GLTrace_ReadBuffer(GLenum src);
+
+#define glDrawElements GLTrace_DrawElements
+#define glDrawArrays GLTrace_DrawArrays
+#define glClear GLTrace_Clear
+#define glClearColor GLTrace_ClearColor
+#define glEnable GLTrace_Enable
+#define glDisable GLTrace_Disable
+#define glBlendFunc GLTrace_BlendFunc
+#define glDepthFunc GLTrace_DepthFunc
+#define glDepthMask GLTrace_DepthMask
+#define glCullFace GLTrace_CullFace
+#define glViewport GLTrace_Viewport
+#define glScissor GLTrace_Scissor
+#define glBindTexture GLTrace_BindTexture
+#define glGenTextures GLTrace_GenTextures
+#define glDeleteTextures GLTrace_DeleteTextures
+#define glTexImage2D GLTrace_TexImage2D
+#define glTexParameteri GLTrace_TexParameteri
+#define glPixelStorei GLTrace_PixelStorei
+#define glDrawBuffer GLTrace_DrawBuffer
+#define glReadBuffer GLTrace_ReadBuffer
+
+#endif // GL_TRACE_NO_HOOKS
+
+#endif // __cplusplus
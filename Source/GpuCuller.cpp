@@ -0,0 +1,768 @@
+///////////////////////////////////////////////////////////////////////////////
+// GpuCuller.cpp
+// =============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `GpuCuller` class, which moves the visibility
+// test and the draw list of the scene to the GPU.
+//
+// FUNCTIONALITY:
+// - Merge the basic meshes into one vertex and one index buffer, so one
+//   vertex array serves every draw command.
+// - Store the model matrix, the world bounding sphere, the mesh and the
+//   draw state bin of every object in a shader storage buffer. The draw
+//   list can be repeated in a grid to reach large object counts.
+// - Test every sphere against the six frustum planes, and against a max
+//   depth pyramid of the previous frame when occlusion culling is on, in
+//   a compute shader with one invocation per object.
+// - Append a DrawElementsIndirectCommand for each visible object to the
+//   command range of its bin, counting with an atomic per bin.
+// - Draw each bin with glMultiDrawElementsIndirectCount; the vertex
+//   shader reads its model matrix from the object buffer through
+//   gl_BaseInstance, which holds the object index.
+//
+// NOTES:
+// The scene vertex shader is patched in the source text: its model
+// uniform becomes a define that reads the object buffer. Objects that
+// differ only in their transform share a bin, so the CPU work is one
+// state change and one draw per bin. The bins keep the order of their
+// first object, but objects inside a bin are drawn in the order the
+// culling wrote them, which only matters for transparent objects. The
+// pyramid is one frame old, so an object that comes into view behind
+// moving geometry can appear a frame late.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "GpuCuller.h"
+#include "GLDebugOutput.h"
+#include "SceneGeometry.h"
+#include "ShaderUtils.h"
+#include "VisibilityCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+// GLFW library, used for timing the CPU side of a frame
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// one object in the storage buffer, std430 layout
+	struct GPU_OBJECT
+	{
+		glm::mat4 model;
+		// world space center and radius
+		glm::vec4 sphere;
+		// mesh, bin and padding
+		GLuint info[4];
+	};
+
+	// invocations per work group of the culling shader
+	const int g_CullGroupSize = 64;
+	// work group edge of the pyramid shader
+	const int g_PyramidGroupSize = 8;
+
+	// declarations added to the scene vertex shader
+	const char* g_VertexDeclarations =
+		"#extension GL_ARB_shader_draw_parameters : require\n"
+		"#extension GL_ARB_shader_storage_buffer_object : enable\n"
+		"struct CULL_OBJECT\n"
+		"{\n"
+		"	mat4 model;\n"
+		"	vec4 sphere;\n"
+		"	uvec4 info;\n"
+		"};\n"
+		"layout(std430, binding = 0) readonly buffer CullObjects\n"
+		"{\n"
+		"	CULL_OBJECT cullObjects[];\n"
+		"};\n"
+		"#define model (cullObjects[gl_BaseInstanceARB].model)\n";
+
+	// one invocation per object, appending the visible ones
+	const char* g_CullShader =
+		"#version 430 core\n"
+		"layout(local_size_x = 64) in;\n"
+		"struct CULL_OBJECT\n"
+		"{\n"
+		"	mat4 model;\n"
+		"	vec4 sphere;\n"
+		"	uvec4 info;\n"
+		"};\n"
+		"struct DRAW_COMMAND\n"
+		"{\n"
+		"	uint count;\n"
+		"	uint instanceCount;\n"
+		"	uint firstIndex;\n"
+		"	int baseVertex;\n"
+		"	uint baseInstance;\n"
+		"};\n"
+		"layout(std430, binding = 0) readonly buffer CullObjects { CULL_OBJECT cullObjects[]; };\n"
+		"layout(std430, binding = 1) readonly buffer CullMeshes { ivec4 meshes[]; };\n"
+		"layout(std430, binding = 2) readonly buffer CullBins { uint binOffsets[]; };\n"
+		"layout(std430, binding = 3) writeonly buffer CullCommands { DRAW_COMMAND commands[]; };\n"
+		"layout(std430, binding = 4) buffer CullCounts { uint counts[]; };\n"
+		"uniform uint objectCount;\n"
+		"uniform vec4 planes[6];\n"
+		"uniform bool bOcclusion;\n"
+		"uniform mat4 pyramidViewProjection;\n"
+		"uniform int pyramidLevels;\n"
+		"uniform sampler2D pyramidTexture;\n"
+		"// true when the box around the sphere lies behind the\n"
+		"// farthest depth of the pyramid texels it covers\n"
+		"bool IsOccluded(vec4 sphere)\n"
+		"{\n"
+		"	vec2 low = vec2(1.0);\n"
+		"	vec2 high = vec2(0.0);\n"
+		"	float nearest = 1.0;\n"
+		"	for (int i = 0; i < 8; i++)\n"
+		"	{\n"
+		"		vec3 corner = sphere.xyz + sphere.w * (vec3(i & 1, (i >> 1) & 1, i >> 2) * 2.0 - 1.0);\n"
+		"		vec4 clip = pyramidViewProjection * vec4(corner, 1.0);\n"
+		"		if (clip.w <= 0.0)\n"
+		"		{\n"
+		"			return(false);\n"
+		"		}\n"
+		"		vec3 ndc = clip.xyz / clip.w;\n"
+		"		low = min(low, ndc.xy * 0.5 + 0.5);\n"
+		"		high = max(high, ndc.xy * 0.5 + 0.5);\n"
+		"		nearest = min(nearest, ndc.z * 0.5 + 0.5);\n"
+		"	}\n"
+		"	low = clamp(low, 0.0, 1.0);\n"
+		"	high = clamp(high, 0.0, 1.0);\n"
+		"	// the level where the box spans at most two texels\n"
+		"	vec2 extent = (high - low) * vec2(textureSize(pyramidTexture, 0));\n"
+		"	int level = clamp(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))), 0, pyramidLevels - 1);\n"
+		"	ivec2 size = textureSize(pyramidTexture, level);\n"
+		"	ivec2 first = clamp(ivec2(low * vec2(size)), ivec2(0), size - 1);\n"
+		"	ivec2 last = clamp(ivec2(high * vec2(size)), ivec2(0), min(size - 1, first + 1));\n"
+		"	float farthest = 0.0;\n"
+		"	for (int y = first.y; y <= last.y; y++)\n"
+		"	{\n"
+		"		for (int x = first.x; x <= last.x; x++)\n"
+		"		{\n"
+		"			farthest = max(farthest, texelFetch(pyramidTexture, ivec2(x, y), level).r);\n"
+		"		}\n"
+		"	}\n"
+		"	return(nearest > farthest);\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	uint index = gl_GlobalInvocationID.x;\n"
+		"	if (index >= objectCount)\n"
+		"	{\n"
+		"		return;\n"
+		"	}\n"
+		"	vec4 sphere = cullObjects[index].sphere;\n"
+		"	for (int i = 0; i < 6; i++)\n"
+		"	{\n"
+		"		if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w)\n"
+		"		{\n"
+		"			return;\n"
+		"		}\n"
+		"	}\n"
+		"	if (bOcclusion && IsOccluded(sphere))\n"
+		"	{\n"
+		"		return;\n"
+		"	}\n"
+		"	uvec4 info = cullObjects[index].info;\n"
+		"	ivec4 mesh = meshes[info.x];\n"
+		"	uint slot = binOffsets[info.y] + atomicAdd(counts[info.y], 1u);\n"
+		"	commands[slot] = DRAW_COMMAND(uint(mesh.x), 1u, uint(mesh.y), mesh.z, index);\n"
+		"}\n";
+
+	// copies the depth buffer into level 0, or halves a level
+	// keeping the farthest depth
+	const char* g_PyramidShader =
+		"#version 430 core\n"
+		"layout(local_size_x = 8, local_size_y = 8) in;\n"
+		"uniform sampler2D sourceTexture;\n"
+		"uniform int sourceLevel;\n"
+		"layout(r32f, binding = 0) writeonly uniform image2D targetImage;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 texel = ivec2(gl_GlobalInvocationID.xy);\n"
+		"	ivec2 size = imageSize(targetImage);\n"
+		"	if (any(greaterThanEqual(texel, size)))\n"
+		"	{\n"
+		"		return;\n"
+		"	}\n"
+		"	if (sourceLevel < 0)\n"
+		"	{\n"
+		"		imageStore(targetImage, texel, vec4(texelFetch(sourceTexture, texel, 0).r));\n"
+		"		return;\n"
+		"	}\n"
+		"	// the last texel of a level also covers the odd row or\n"
+		"	// column of the level above, to stay conservative\n"
+		"	ivec2 sourceSize = textureSize(sourceTexture, sourceLevel);\n"
+		"	ivec2 odd = ivec2(equal(sourceSize & 1, ivec2(1))) * ivec2(equal(texel, size - 1));\n"
+		"	ivec2 last = min(texel * 2 + 1 + odd, sourceSize - 1);\n"
+		"	float depth = 0.0;\n"
+		"	for (int y = texel.y * 2; y <= last.y; y++)\n"
+		"	{\n"
+		"		for (int x = texel.x * 2; x <= last.x; x++)\n"
+		"		{\n"
+		"			depth = max(depth, texelFetch(sourceTexture, ivec2(x, y), sourceLevel).r);\n"
+		"		}\n"
+		"	}\n"
+		"	imageStore(targetImage, texel, vec4(depth));\n"
+		"}\n";
+
+	/***********************************************************
+	 *  GetStateKey()
+	 *
+	 *  Objects with the same key can share one draw call.
+	 ***********************************************************/
+	std::string GetStateKey(const SceneManager::SCENE_OBJECT& object)
+	{
+		std::ostringstream key;
+		if (object.bTextured)
+		{
+			key << "texture " << object.textureTag << " " << object.uvScale.x << " " << object.uvScale.y;
+		}
+		else
+		{
+			key << "color " << object.color.r << " " << object.color.g << " " << object.color.b << " " << object.color.a;
+		}
+		key << " material " << object.materialTag;
+		return(key.str());
+	}
+
+	/***********************************************************
+	 *  CreateBuffer()
+	 *
+	 *  Create a labelled buffer with the given contents.
+	 ***********************************************************/
+	GLuint CreateBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage, const char* label)
+	{
+		GLuint buffer = 0;
+		glGenBuffers(1, &buffer);
+		glBindBuffer(target, buffer);
+		glBufferData(target, (size > 0) ? size : 4, data, usage);
+		glBindBuffer(target, 0);
+		GLDebugOutput::LabelObject(GL_BUFFER, buffer, label);
+		return(buffer);
+	}
+}
+
+/***********************************************************
+ *  GpuCuller()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuCuller::GpuCuller(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_pGpuProfiler = NULL;
+	m_drawProgram = 0;
+	m_cullProgram = 0;
+	m_pyramidProgram = 0;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_objectBuffer = 0;
+	m_meshBuffer = 0;
+	m_binBuffer = 0;
+	m_commandBuffer = 0;
+	m_countBuffer = 0;
+	m_pyramidTexture = 0;
+	m_pyramidWidth = 0;
+	m_pyramidHeight = 0;
+	m_pyramidLevels = 0;
+	m_bPyramidValid = false;
+	m_pyramidViewProjection = glm::mat4(1.0f);
+	m_viewProjection = glm::mat4(1.0f);
+	m_objectCount = 0;
+	m_bOcclusion = false;
+	m_cpuSeconds = 0.0;
+	m_frames = 0;
+}
+
+/***********************************************************
+ *  ~GpuCuller()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuCuller::~GpuCuller()
+{
+	Destroy();
+	m_pShaderManager = NULL;
+	m_pSceneManager = NULL;
+	m_pViewManager = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the draw program from the scene
+ *  shaders, the culling and pyramid programs, and the
+ *  merged mesh buffers.
+ ***********************************************************/
+bool GpuCuller::Initialize(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	bool bCompute = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+	bool bIndirectCount = GLEW_VERSION_4_6 || (GLEW_ARB_indirect_parameters && GLEW_ARB_shader_draw_parameters);
+	if (!bCompute || !bIndirectCount)
+	{
+		std::cout << "WARNING: GPU culling needs compute shaders and indirect count draws" << std::endl;
+		return(false);
+	}
+
+	std::string vertexSource;
+	std::string fragmentSource;
+	if (!ShaderUtils::ReadFile(vertexShader, vertexSource) || !ShaderUtils::ReadFile(fragmentShader, fragmentSource))
+	{
+		return(false);
+	}
+
+	// the model matrix comes from the object of the draw command
+	if (vertexSource.find("uniform mat4 model;") == std::string::npos)
+	{
+		std::cout << "WARNING: GPU culling could not find the model uniform in " << vertexShader << std::endl;
+		return(false);
+	}
+	ShaderUtils::ReplaceAll(vertexSource, "uniform mat4 model;", "");
+	ShaderUtils::InsertAfterVersion(vertexSource, g_VertexDeclarations);
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, vertexSource, "gpu-cull.vert"));
+	shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, fragmentSource, "gpu-cull.frag"));
+	m_drawProgram = ShaderUtils::LinkProgram(shaders, "gpu-cull.draw");
+
+	shaders.clear();
+	shaders.push_back(ShaderUtils::CompileShader(GL_COMPUTE_SHADER, g_CullShader, "gpu-cull.comp"));
+	m_cullProgram = ShaderUtils::LinkProgram(shaders, "gpu-cull");
+
+	shaders.clear();
+	shaders.push_back(ShaderUtils::CompileShader(GL_COMPUTE_SHADER, g_PyramidShader, "depth-pyramid.comp"));
+	m_pyramidProgram = ShaderUtils::LinkProgram(shaders, "depth-pyramid");
+
+	if ((m_drawProgram == 0) || (m_cullProgram == 0) || (m_pyramidProgram == 0))
+	{
+		Destroy();
+		return(false);
+	}
+
+	// the lights are set once, like in the scene program
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_drawProgram);
+	m_pSceneManager->SetupSceneLights();
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+
+	CreateMeshBuffers();
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees every GL object of the culler.
+ ***********************************************************/
+void GpuCuller::Destroy()
+{
+	GLuint* programs[] = { &m_drawProgram, &m_cullProgram, &m_pyramidProgram };
+	for (int i = 0; i < 3; i++)
+	{
+		if (*programs[i] != 0)
+		{
+			glDeleteProgram(*programs[i]);
+			*programs[i] = 0;
+		}
+	}
+
+	GLuint* buffers[] = { &m_vertexBuffer, &m_indexBuffer, &m_objectBuffer, &m_meshBuffer,
+		&m_binBuffer, &m_commandBuffer, &m_countBuffer };
+	for (int i = 0; i < 7; i++)
+	{
+		if (*buffers[i] != 0)
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (m_pyramidTexture != 0)
+	{
+		glDeleteTextures(1, &m_pyramidTexture);
+		m_pyramidTexture = 0;
+	}
+	m_bPyramidValid = false;
+	m_bins.clear();
+	m_objectCount = 0;
+}
+
+/***********************************************************
+ *  CreateMeshBuffers()
+ *
+ *  This method appends the basic meshes to one vertex and
+ *  one index buffer, with position, normal and texture
+ *  coordinate at the attribute locations of ShapeMeshes,
+ *  and records the range and bounding sphere of each.
+ ***********************************************************/
+void GpuCuller::CreateMeshBuffers()
+{
+	std::vector<SceneGeometry::VERTEX> vertices;
+	std::vector<GLuint> indices;
+	std::vector<glm::ivec4> meshInfo;
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		SceneGeometry::MESH mesh;
+		SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, mesh);
+
+		MESH_RANGE& range = m_meshes[type];
+		range.indexCount = (GLuint)mesh.indices.size();
+		range.firstIndex = (GLuint)indices.size();
+		range.baseVertex = (GLint)vertices.size();
+		range.sphere = SceneGeometry::ComputeBoundingSphere(mesh);
+		meshInfo.push_back(glm::ivec4((int)range.indexCount, (int)range.firstIndex, range.baseVertex, 0));
+
+		vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+		indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+	}
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glBindVertexArray(m_vertexArray);
+	m_vertexBuffer = CreateBuffer(GL_ARRAY_BUFFER, vertices.size() * sizeof(SceneGeometry::VERTEX),
+		&vertices[0], GL_STATIC_DRAW, "buffer:gpu-cull.vertices");
+	m_indexBuffer = CreateBuffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+		&indices[0], GL_STATIC_DRAW, "buffer:gpu-cull.indices");
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	GLsizei stride = sizeof(SceneGeometry::VERTEX);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, uv));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	m_meshBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, meshInfo.size() * sizeof(glm::ivec4),
+		&meshInfo[0], GL_STATIC_DRAW, "buffer:gpu-cull.meshes");
+}
+
+/***********************************************************
+ *  UploadObjects()
+ *
+ *  This method sorts the draw list into bins of equal draw
+ *  state and uploads the objects, repeating the list in a
+ *  square grid when more than one copy is asked for.
+ ***********************************************************/
+void GpuCuller::UploadObjects(int copies)
+{
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = m_pSceneManager->GetSceneObjects();
+	copies = std::max(copies, 1);
+	if (objects.empty() || (m_cullProgram == 0))
+	{
+		return;
+	}
+
+	// the copies are spaced by the extent of the scene
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	std::vector<glm::mat4> models(objects.size());
+	std::vector<glm::vec4> spheres(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const SceneManager::SCENE_OBJECT& object = objects[i];
+		models[i] = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+		spheres[i] = SceneGeometry::TransformSphere(models[i], m_meshes[object.mesh].sphere);
+		minimum = glm::min(minimum, glm::vec3(spheres[i]) - spheres[i].w);
+		maximum = glm::max(maximum, glm::vec3(spheres[i]) + spheres[i].w);
+	}
+	float spacing = std::max(maximum.x - minimum.x, maximum.z - minimum.z) * 1.2f;
+	int columns = (int)ceil(sqrt((double)copies));
+
+	// bins in the order of their first object
+	std::map<std::string, int> binIndices;
+	std::vector<GLuint> objectBins(objects.size());
+	m_bins.clear();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		std::string key = GetStateKey(objects[i]);
+		std::map<std::string, int>::iterator it = binIndices.find(key);
+		if (it == binIndices.end())
+		{
+			BIN bin;
+			bin.state = objects[i];
+			bin.firstCommand = 0;
+			bin.objectCount = 0;
+			it = binIndices.insert(std::make_pair(key, (int)m_bins.size())).first;
+			m_bins.push_back(bin);
+		}
+		objectBins[i] = (GLuint)it->second;
+		m_bins[it->second].objectCount += (GLuint)copies;
+	}
+	std::vector<GLuint> binOffsets(m_bins.size());
+	GLuint firstCommand = 0;
+	for (size_t bin = 0; bin < m_bins.size(); bin++)
+	{
+		m_bins[bin].firstCommand = firstCommand;
+		binOffsets[bin] = firstCommand;
+		firstCommand += m_bins[bin].objectCount;
+	}
+
+	m_objectCount = (int)(objects.size() * copies);
+	std::vector<GPU_OBJECT> gpuObjects(m_objectCount);
+	for (int copy = 0; copy < copies; copy++)
+	{
+		glm::vec3 offset((float)(copy % columns) * spacing, 0.0f, -(float)(copy / columns) * spacing);
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			GPU_OBJECT& gpuObject = gpuObjects[copy * objects.size() + i];
+			gpuObject.model = models[i];
+			gpuObject.model[3] += glm::vec4(offset, 0.0f);
+			gpuObject.sphere = spheres[i] + glm::vec4(offset, 0.0f);
+			gpuObject.info[0] = (GLuint)objects[i].mesh;
+			gpuObject.info[1] = objectBins[i];
+			gpuObject.info[2] = 0;
+			gpuObject.info[3] = 0;
+		}
+	}
+
+	GLuint* buffers[] = { &m_objectBuffer, &m_binBuffer, &m_commandBuffer, &m_countBuffer };
+	for (int i = 0; i < 4; i++)
+	{
+		if (*buffers[i] != 0)
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+	m_objectBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, gpuObjects.size() * sizeof(GPU_OBJECT),
+		&gpuObjects[0], GL_STATIC_DRAW, "buffer:gpu-cull.objects");
+	m_binBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, binOffsets.size() * sizeof(GLuint),
+		&binOffsets[0], GL_STATIC_DRAW, "buffer:gpu-cull.bins");
+	m_commandBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, m_objectCount * sizeof(DRAW_COMMAND),
+		NULL, GL_DYNAMIC_COPY, "buffer:gpu-cull.commands");
+	m_countBuffer = CreateBuffer(GL_SHADER_STORAGE_BUFFER, m_bins.size() * sizeof(GLuint),
+		NULL, GL_DYNAMIC_COPY, "buffer:gpu-cull.counts");
+
+	std::cout << "INFO: GPU culling " << m_objectCount << " objects (" << copies << " copies of "
+		<< objects.size() << ") in " << m_bins.size() << " draw state bins" << std::endl;
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method runs the culling dispatch and then one
+ *  indirect count draw per bin.
+ ***********************************************************/
+void GpuCuller::Render()
+{
+	if ((m_objectCount == 0) || (m_drawProgram == 0))
+	{
+		return;
+	}
+	double startTime = glfwGetTime();
+
+	m_viewProjection = m_pViewManager->GetProjectionMatrix() * m_pViewManager->GetViewMatrix();
+	glm::vec4 planes[6];
+	VisibilityCache::ExtractFrustumPlanes(m_viewProjection, planes);
+
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->BeginPass("gpu cull");
+	}
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	bool bOcclusion = m_bOcclusion && m_bPyramidValid;
+	glUseProgram(m_cullProgram);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, m_meshBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, m_binBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, m_countBuffer);
+	glUniform1ui(glGetUniformLocation(m_cullProgram, "objectCount"), (GLuint)m_objectCount);
+	glUniform4fv(glGetUniformLocation(m_cullProgram, "planes"), 6, glm::value_ptr(planes[0]));
+	glUniform1i(glGetUniformLocation(m_cullProgram, "bOcclusion"), bOcclusion ? 1 : 0);
+	if (bOcclusion)
+	{
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+		glUniform1i(glGetUniformLocation(m_cullProgram, "pyramidTexture"), 0);
+		glUniform1i(glGetUniformLocation(m_cullProgram, "pyramidLevels"), m_pyramidLevels);
+		glUniformMatrix4fv(glGetUniformLocation(m_cullProgram, "pyramidViewProjection"), 1, GL_FALSE,
+			glm::value_ptr(m_pyramidViewProjection));
+	}
+	glDispatchCompute((m_objectCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+	// the draws read the commands and the counts as parameters
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+	if (bOcclusion)
+	{
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->EndPass();
+		m_pGpuProfiler->BeginPass("gpu draws");
+	}
+
+	// the scene texture units stay bound by the scene manager
+	glm::vec3 cameraPosition;
+	glm::vec3 cameraFront;
+	float zoom = 0.0f;
+	m_pViewManager->GetCameraPose(cameraPosition, cameraFront, zoom);
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_drawProgram);
+	m_pShaderManager->setMat4Value("view", m_pViewManager->GetViewMatrix());
+	m_pShaderManager->setMat4Value("projection", m_pViewManager->GetProjectionMatrix());
+	m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, m_countBuffer);
+	for (size_t bin = 0; bin < m_bins.size(); bin++)
+	{
+		m_pSceneManager->ApplyObjectState(m_bins[bin].state);
+		const void* commands = (const void*)(m_bins[bin].firstCommand * sizeof(DRAW_COMMAND));
+		GLintptr count = (GLintptr)(bin * sizeof(GLuint));
+		if (GLEW_VERSION_4_6)
+		{
+			glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, commands, count, (GLsizei)m_bins[bin].objectCount, 0);
+		}
+		else
+		{
+			glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, commands, count, (GLsizei)m_bins[bin].objectCount, 0);
+		}
+	}
+	glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->EndPass();
+	}
+
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+	m_cpuSeconds += glfwGetTime() - startTime;
+	m_frames++;
+}
+
+/***********************************************************
+ *  AllocatePyramid()
+ *
+ *  This method creates the pyramid with a full mip chain
+ *  for a depth buffer of the given size.
+ ***********************************************************/
+void GpuCuller::AllocatePyramid(int width, int height)
+{
+	if ((m_pyramidTexture != 0) && (width == m_pyramidWidth) && (height == m_pyramidHeight))
+	{
+		return;
+	}
+	if (m_pyramidTexture != 0)
+	{
+		glDeleteTextures(1, &m_pyramidTexture);
+	}
+
+	m_pyramidWidth = width;
+	m_pyramidHeight = height;
+	m_pyramidLevels = 1;
+	while (((width >> m_pyramidLevels) > 0) || ((height >> m_pyramidLevels) > 0))
+	{
+		m_pyramidLevels++;
+	}
+
+	glGenTextures(1, &m_pyramidTexture);
+	glBindTexture(GL_TEXTURE_2D, m_pyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_pyramidLevels, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	GLDebugOutput::LabelObject(GL_TEXTURE, m_pyramidTexture, "texture:gpu-cull.depth-pyramid");
+	m_bPyramidValid = false;
+}
+
+/***********************************************************
+ *  BuildDepthPyramid()
+ *
+ *  This method copies the depth of the frame into the first
+ *  level and reduces it level by level to the farthest
+ *  depth, for the occlusion test of the next frame.
+ ***********************************************************/
+void GpuCuller::BuildDepthPyramid(GLuint depthTexture, int width, int height)
+{
+	if (!m_bOcclusion || (m_pyramidProgram == 0) || (depthTexture == 0) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+	AllocatePyramid(width, height);
+
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_pyramidProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glUniform1i(glGetUniformLocation(m_pyramidProgram, "sourceTexture"), 0);
+	GLint sourceLevelLocation = glGetUniformLocation(m_pyramidProgram, "sourceLevel");
+
+	for (int level = 0; level < m_pyramidLevels; level++)
+	{
+		int levelWidth = std::max(width >> level, 1);
+		int levelHeight = std::max(height >> level, 1);
+		glBindTexture(GL_TEXTURE_2D, (level == 0) ? depthTexture : m_pyramidTexture);
+		glUniform1i(sourceLevelLocation, level - 1);
+		glBindImageTexture(0, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute((levelWidth + g_PyramidGroupSize - 1) / g_PyramidGroupSize,
+			(levelHeight + g_PyramidGroupSize - 1) / g_PyramidGroupSize, 1);
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+	m_pyramidViewProjection = m_viewProjection;
+	m_bPyramidValid = true;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the average CPU time of Render() and
+ *  reads back the visible counts of the last frame.
+ ***********************************************************/
+void GpuCuller::PrintReport()
+{
+	if ((m_frames == 0) || (m_countBuffer == 0))
+	{
+		return;
+	}
+
+	// waits for the GPU, which is fine once at the end
+	std::vector<GLuint> counts(m_bins.size());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_countBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, counts.size() * sizeof(GLuint), &counts[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	GLuint visible = 0;
+	for (size_t i = 0; i < counts.size(); i++)
+	{
+		visible += counts[i];
+	}
+
+	std::cout << std::fixed << std::setprecision(3) << "INFO: GPU culling: " << m_objectCount << " objects, "
+		<< m_bins.size() << " indirect draws per frame, " << visible << " visible in the last frame"
+		<< (m_bOcclusion ? " (frustum and occlusion)" : " (frustum)") << std::endl;
+	std::cout << "INFO: GPU culling CPU time: " << m_cpuSeconds * 1000.0 / (double)m_frames
+		<< " ms per frame over " << m_frames << " frames" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
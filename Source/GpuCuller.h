@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuculler.h
+// ============
+// cull the draw list in a compute shader and draw it indirectly
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+#include "ViewManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GpuCuller
+ *
+ *  This class keeps the transforms and bounding spheres of
+ *  every scene object in shader storage buffers. Each frame
+ *  a compute shader tests the spheres against the frustum,
+ *  and optionally against a depth pyramid of the previous
+ *  frame, and appends a draw command for every visible
+ *  object to the range of its draw state. One indirect
+ *  multi-draw per draw state then draws what survived, with
+ *  the count read from the GPU, so the CPU work per frame
+ *  depends on the number of draw states only, not on the
+ *  number of objects or how many of them are visible.
+ ***********************************************************/
+class GpuCuller
+{
+public:
+	// layout of the indirect draw commands of glMultiDrawElementsIndirect
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// constructor
+	GpuCuller(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager);
+	// destructor
+	~GpuCuller();
+
+	// build the programs from the scene shader files and the
+	// merged mesh buffers; false without indirect count draws
+	bool Initialize(const std::string& vertexShader, const std::string& fragmentShader);
+	// free the programs, buffers and the depth pyramid
+	void Destroy();
+
+	// upload the draw list, repeated in a grid of copies to
+	// measure large object counts
+	void UploadObjects(int copies);
+	// test against the depth pyramid of the previous frame
+	void SetOcclusionCulling(bool bEnabled) { m_bOcclusion = bEnabled; }
+	bool IsOcclusionCulling() const { return(m_bOcclusion); }
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+
+	// cull and draw with the matrices of the view manager
+	void Render();
+	// rebuild the depth pyramid from the depth of this frame
+	void BuildDepthPyramid(GLuint depthTexture, int width, int height);
+
+	int GetObjectCount() const { return(m_objectCount); }
+	int GetBinCount() const { return((int)m_bins.size()); }
+	// print the object and draw state counts, the CPU time per
+	// frame and the visible objects of the last frame
+	void PrintReport();
+
+private:
+	// objects drawn with the same shader state
+	struct BIN
+	{
+		SceneManager::SCENE_OBJECT state;
+		// first command of the bin and its number of objects
+		GLuint firstCommand;
+		GLuint objectCount;
+	};
+
+	// range of a mesh in the merged buffers and its bounds
+	struct MESH_RANGE
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		glm::vec4 sphere;
+	};
+
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+	GpuProfiler* m_pGpuProfiler;
+
+	GLuint m_drawProgram;
+	GLuint m_cullProgram;
+	GLuint m_pyramidProgram;
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	GLuint m_objectBuffer;
+	GLuint m_meshBuffer;
+	GLuint m_binBuffer;
+	GLuint m_commandBuffer;
+	GLuint m_countBuffer;
+
+	// max depth pyramid of the previous frame
+	GLuint m_pyramidTexture;
+	int m_pyramidWidth;
+	int m_pyramidHeight;
+	int m_pyramidLevels;
+	bool m_bPyramidValid;
+	// view projection the pyramid was rendered with
+	glm::mat4 m_pyramidViewProjection;
+	glm::mat4 m_viewProjection;
+
+	MESH_RANGE m_meshes[SceneManager::MESH_COUNT];
+	std::vector<BIN> m_bins;
+	int m_objectCount;
+	bool m_bOcclusion;
+
+	// CPU time spent in Render()
+	double m_cpuSeconds;
+	long m_frames;
+
+	// build the merged vertex and index buffers of the meshes
+	void CreateMeshBuffers();
+	// (re)create the pyramid texture for a depth buffer size
+	void AllocatePyramid(int width, int height);
+};
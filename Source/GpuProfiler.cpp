@@ -0,0 +1,381 @@
+///////////////////////////////////////////////////////////////////////////////
+// GpuProfiler.cpp
+// ===============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `GpuProfiler` class, which measures what the GPU
+// does in each render pass. It shows whether a frame is limited by vertex
+// work or by fragment work, and how much of the fragment work comes from a
+// single pass such as the large 20x10 floor plane.
+//
+// FUNCTIONALITY:
+// - GPU time per pass (GL_TIME_ELAPSED) and samples passed (occlusion).
+// - GL_ARB_pipeline_statistics_query counters per pass: vertices and
+//   primitives submitted, vertex shader invocations, primitives entering and
+//   leaving the clipper and fragment shader invocations.
+// - A ring of query sets several frames deep; a slot is only read back
+//   when GL_QUERY_RESULT_AVAILABLE reports that it is ready.
+// - A report that prints the GPU pass statistics next to the CPU frame
+//   statistics of the FrameProfiler.
+//
+// NOTES:
+// Each query kind uses a different target, so all of them can be active
+// at the same time, but passes cannot nest.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "GpuProfiler.h"
+
+#include <iostream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+	// query target used for each query kind
+	const GLenum g_QueryTargets[GpuProfiler::QUERY_KIND_COUNT] =
+	{
+		GL_TIME_ELAPSED,
+		GL_SAMPLES_PASSED,
+		GL_VERTICES_SUBMITTED_ARB,
+		GL_PRIMITIVES_SUBMITTED_ARB,
+		GL_VERTEX_SHADER_INVOCATIONS_ARB,
+		GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+		GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+		GL_FRAGMENT_SHADER_INVOCATIONS_ARB
+	};
+
+	// number of query kinds that do not need the extension
+	const int g_BasicQueryKinds = 2;
+
+	// weight of the newest frame in the moving averages
+	const double g_AverageWeight = 0.1;
+
+	// above this many fragments per vertex the frame is treated
+	// as fragment bound in the report
+	const double g_FragmentBoundRatio = 16.0;
+}
+
+/***********************************************************
+ *  GpuProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuProfiler::GpuProfiler(int frameLatency)
+{
+	if (frameLatency < 2)
+	{
+		frameLatency = 2;
+	}
+
+	m_frameSlots.resize(frameLatency);
+	m_currentSlot = 0;
+	m_openPass = -1;
+	m_bInitialized = false;
+	m_bPipelineStatistics = false;
+	m_droppedFrames = 0;
+}
+
+/***********************************************************
+ *  ~GpuProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuProfiler::~GpuProfiler()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating every query object of
+ *  the ring up front, so no names are generated per frame.
+ ***********************************************************/
+bool GpuProfiler::Initialize()
+{
+	if (m_bInitialized)
+	{
+		return(true);
+	}
+
+	m_bPipelineStatistics = (GLEW_ARB_pipeline_statistics_query || GLEW_VERSION_4_6);
+	if (!m_bPipelineStatistics)
+	{
+		std::cout << "INFO: GL_ARB_pipeline_statistics_query is not supported, "
+			<< "only GPU time and samples passed are collected" << std::endl;
+	}
+
+	for (size_t i = 0; i < m_frameSlots.size(); i++)
+	{
+		FRAME_SLOT& slot = m_frameSlots[i];
+		glGenQueries(MAX_PASSES * QUERY_KIND_COUNT, &slot.queries[0][0]);
+		slot.passCount = 0;
+		slot.bPending = false;
+	}
+
+	m_bInitialized = true;
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the query objects.
+ ***********************************************************/
+void GpuProfiler::Destroy()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < m_frameSlots.size(); i++)
+	{
+		glDeleteQueries(MAX_PASSES * QUERY_KIND_COUNT, &m_frameSlots[i].queries[0][0]);
+	}
+	m_bInitialized = false;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method moves to the next slot of the ring. The slot
+ *  was last used frameLatency frames ago; its results are
+ *  read if they are ready, otherwise the frame is dropped.
+ ***********************************************************/
+void GpuProfiler::BeginFrame()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	m_currentSlot = (m_currentSlot + 1) % (int)m_frameSlots.size();
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	if (slot.bPending)
+	{
+		ResolveSlot(slot);
+	}
+	slot.passCount = 0;
+	slot.bPending = false;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method closes the frame. Its queries are resolved
+ *  when the slot comes around again. Slots older than the
+ *  current one are checked too, so results show up as soon
+ *  as the GPU produces them.
+ ***********************************************************/
+void GpuProfiler::EndFrame()
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	if (m_openPass >= 0)
+	{
+		EndPass();
+	}
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	slot.bPending = (slot.passCount > 0);
+
+	int oldestSlot = (m_currentSlot + 1) % (int)m_frameSlots.size();
+	if (m_frameSlots[oldestSlot].bPending)
+	{
+		ResolveSlot(m_frameSlots[oldestSlot]);
+	}
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method starts every query of a named render pass.
+ ***********************************************************/
+void GpuProfiler::BeginPass(const char* name)
+{
+	if (!m_bInitialized)
+	{
+		return;
+	}
+
+	FRAME_SLOT& slot = m_frameSlots[m_currentSlot];
+	if ((m_openPass >= 0) || (slot.passCount >= MAX_PASSES))
+	{
+		return;
+	}
+
+	m_openPass = slot.passCount++;
+	slot.passNames[m_openPass] = name;
+
+	int queryKinds = m_bPipelineStatistics ? QUERY_KIND_COUNT : g_BasicQueryKinds;
+	for (int kind = 0; kind < queryKinds; kind++)
+	{
+		glBeginQuery(g_QueryTargets[kind], slot.queries[m_openPass][kind]);
+	}
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method ends every query of the open render pass.
+ ***********************************************************/
+void GpuProfiler::EndPass()
+{
+	if (!m_bInitialized || (m_openPass < 0))
+	{
+		return;
+	}
+
+	int queryKinds = m_bPipelineStatistics ? QUERY_KIND_COUNT : g_BasicQueryKinds;
+	for (int kind = 0; kind < queryKinds; kind++)
+	{
+		glEndQuery(g_QueryTargets[kind]);
+	}
+	m_openPass = -1;
+}
+
+/***********************************************************
+ *  ResolveSlot()
+ *
+ *  This method reads back the queries of a slot without
+ *  blocking. The last query of the last pass is checked
+ *  first since queries complete in submission order.
+ ***********************************************************/
+void GpuProfiler::ResolveSlot(FRAME_SLOT& slot)
+{
+	int queryKinds = m_bPipelineStatistics ? QUERY_KIND_COUNT : g_BasicQueryKinds;
+	GLuint available = GL_FALSE;
+
+	glGetQueryObjectuiv(slot.queries[slot.passCount - 1][queryKinds - 1],
+		GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available == GL_FALSE)
+	{
+		// still in flight: drop the frame rather than stall
+		if (m_currentSlot == (int)(&slot - &m_frameSlots[0]))
+		{
+			m_droppedFrames++;
+			slot.bPending = false;
+		}
+		return;
+	}
+
+	for (int pass = 0; pass < slot.passCount; pass++)
+	{
+		PASS_STATS& stats = FindPassStats(slot.passNames[pass]);
+		for (int kind = 0; kind < queryKinds; kind++)
+		{
+			GLuint64 value = 0;
+			glGetQueryObjectui64v(slot.queries[pass][kind], GL_QUERY_RESULT, &value);
+			stats.values[kind] = value;
+			if (stats.resolvedFrames == 0)
+			{
+				stats.average[kind] = (double)value;
+			}
+			else
+			{
+				stats.average[kind] += ((double)value - stats.average[kind]) * g_AverageWeight;
+			}
+		}
+		stats.resolvedFrames++;
+	}
+
+	slot.bPending = false;
+}
+
+/***********************************************************
+ *  FindPassStats()
+ *
+ *  This method returns the statistics of a named pass,
+ *  adding an empty entry the first time a name is seen.
+ ***********************************************************/
+GpuProfiler::PASS_STATS& GpuProfiler::FindPassStats(const std::string& name)
+{
+	for (size_t i = 0; i < m_passStats.size(); i++)
+	{
+		if (m_passStats[i].name == name)
+		{
+			return(m_passStats[i]);
+		}
+	}
+
+	PASS_STATS stats;
+	stats.name = name;
+	for (int kind = 0; kind < QUERY_KIND_COUNT; kind++)
+	{
+		stats.values[kind] = 0;
+		stats.average[kind] = 0.0;
+	}
+	stats.resolvedFrames = 0;
+	m_passStats.push_back(stats);
+
+	return(m_passStats.back());
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the averaged GPU statistics of each
+ *  pass next to the CPU frame statistics, along with the
+ *  share of the fragment work done by each pass.
+ ***********************************************************/
+void GpuProfiler::PrintReport(const FrameProfiler* pFrameProfiler) const
+{
+	double totalFragments = 0.0;
+	double totalVertices = 0.0;
+
+	for (size_t i = 0; i < m_passStats.size(); i++)
+	{
+		totalFragments += m_passStats[i].average[QUERY_FRAGMENT_SHADER_INVOCATIONS];
+		totalVertices += m_passStats[i].average[QUERY_VERTEX_SHADER_INVOCATIONS];
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	if (NULL != pFrameProfiler)
+	{
+		std::cout << "STATS: cpu frame median " << pFrameProfiler->GetMedianFrameTime()
+			<< " ms, mean " << pFrameProfiler->GetMeanFrameTime()
+			<< " ms, max " << pFrameProfiler->GetMaxFrameTime() << " ms";
+	}
+	else
+	{
+		std::cout << "STATS:";
+	}
+	std::cout << " | gpu frames dropped " << m_droppedFrames << std::endl;
+
+	for (size_t i = 0; i < m_passStats.size(); i++)
+	{
+		const PASS_STATS& stats = m_passStats[i];
+		std::cout << "  pass " << std::left << std::setw(10) << stats.name << std::right
+			<< " gpu " << stats.average[QUERY_TIME_ELAPSED] / 1000000.0 << " ms"
+			<< ", samples " << (GLuint64)stats.average[QUERY_SAMPLES_PASSED];
+
+		if (m_bPipelineStatistics)
+		{
+			std::cout << ", vs " << (GLuint64)stats.average[QUERY_VERTEX_SHADER_INVOCATIONS]
+				<< ", clip in/out " << (GLuint64)stats.average[QUERY_CLIPPING_INPUT_PRIMITIVES]
+				<< "/" << (GLuint64)stats.average[QUERY_CLIPPING_OUTPUT_PRIMITIVES]
+				<< ", fs " << (GLuint64)stats.average[QUERY_FRAGMENT_SHADER_INVOCATIONS];
+			if (totalFragments > 0.0)
+			{
+				std::cout << " (" << 100.0 * stats.average[QUERY_FRAGMENT_SHADER_INVOCATIONS] / totalFragments
+					<< "% of fragments)";
+			}
+		}
+		std::cout << std::endl;
+	}
+
+	if (m_bPipelineStatistics && (totalVertices > 0.0))
+	{
+		std::cout << "  fragments per vertex " << totalFragments / totalVertices
+			<< (totalFragments / totalVertices > g_FragmentBoundRatio ? " (fragment bound)" : " (vertex bound)")
+			<< std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
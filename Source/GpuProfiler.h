@@ -0,0 +1,114 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpuprofiler.h
+// ============
+// measure the GPU work of each render pass with query objects
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "FrameProfiler.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GpuProfiler
+ *
+ *  This class wraps each render pass in a set of query
+ *  objects: GPU time, samples passed (occlusion) and, when
+ *  GL_ARB_pipeline_statistics_query is available, vertex,
+ *  clipping and fragment shader counters. The queries live
+ *  in a ring buffer that is several frames deep, so results
+ *  are only read once the GPU has produced them and the CPU
+ *  never waits on the GPU.
+ ***********************************************************/
+class GpuProfiler
+{
+public:
+	// constructor
+	GpuProfiler(int frameLatency = 4);
+	// destructor
+	~GpuProfiler();
+
+	// query kinds recorded for each pass
+	enum QUERY_KIND
+	{
+		QUERY_TIME_ELAPSED = 0,
+		QUERY_SAMPLES_PASSED,
+		QUERY_VERTICES_SUBMITTED,
+		QUERY_PRIMITIVES_SUBMITTED,
+		QUERY_VERTEX_SHADER_INVOCATIONS,
+		QUERY_CLIPPING_INPUT_PRIMITIVES,
+		QUERY_CLIPPING_OUTPUT_PRIMITIVES,
+		QUERY_FRAGMENT_SHADER_INVOCATIONS,
+		QUERY_KIND_COUNT
+	};
+
+	struct PASS_STATS
+	{
+		std::string name;
+		// most recent resolved values, indexed by QUERY_KIND
+		GLuint64 values[QUERY_KIND_COUNT];
+		// exponential moving average of the values
+		double average[QUERY_KIND_COUNT];
+		// number of frames resolved for this pass
+		long resolvedFrames;
+	};
+
+	// create the query objects in the current context
+	bool Initialize();
+	// free the query objects
+	void Destroy();
+
+	// mark the start and the end of a frame
+	void BeginFrame();
+	void EndFrame();
+
+	// mark the start and the end of a render pass
+	void BeginPass(const char* name);
+	void EndPass();
+
+	// statistics of every pass that has been resolved so far
+	const std::vector<PASS_STATS>& GetPassStats() const { return(m_passStats); }
+	// true when the pipeline statistics counters are available
+	bool HasPipelineStatistics() const { return(m_bPipelineStatistics); }
+	// print the GPU pass statistics next to the CPU frame stats
+	void PrintReport(const FrameProfiler* pFrameProfiler) const;
+
+private:
+	// maximum number of passes recorded in a single frame
+	static const int MAX_PASSES = 16;
+
+	struct FRAME_SLOT
+	{
+		// query names for every pass and kind
+		GLuint queries[MAX_PASSES][QUERY_KIND_COUNT];
+		// names of the passes recorded in this slot
+		std::string passNames[MAX_PASSES];
+		int passCount;
+		bool bPending;
+	};
+
+	// ring of frame slots, one per frame in flight
+	std::vector<FRAME_SLOT> m_frameSlots;
+	int m_currentSlot;
+	// pass that is currently open, or -1
+	int m_openPass;
+	// true when the queries have been created
+	bool m_bInitialized;
+	// true when GL_ARB_pipeline_statistics_query is supported
+	bool m_bPipelineStatistics;
+	// number of frames whose results were not ready in time
+	long m_droppedFrames;
+
+	// resolved statistics per pass name
+	std::vector<PASS_STATS> m_passStats;
+
+	// read back a slot if the GPU has finished it
+	void ResolveSlot(FRAME_SLOT& slot);
+	// find or add the statistics of a named pass
+	PASS_STATS& FindPassStats(const std::string& name);
+};
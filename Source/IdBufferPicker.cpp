@@ -0,0 +1,417 @@
+///////////////////////////////////////////////////////////////////////////////
+// IdBufferPicker.cpp
+// ==================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `IdBufferPicker` class, which picks the object
+// under the cursor from an object id target of the scene pass.
+//
+// FUNCTIONALITY:
+// - Build a copy of the scene program whose fragment stage also writes
+//   the pickId uniform, the draw list index + 1 that RenderScene() sets
+//   before every object, into a second, R32UI, color target.
+// - Clear the id target to 0 after the clear of the scene pass, since an
+//   integer target cannot be cleared with the float clear color.
+// - Copy the pixel under the cursor into one of a ring of pixel buffers
+//   with glReadPixels, which returns at once, and put a fence behind it.
+// - Read a buffer only when it is at least the latency old and its fence
+//   has passed, so reading it never waits for the GPU.
+// - Switch the id target on and off every few frames when cycling, so
+//   the GPU profiler times the scene passes with ("props+ids",
+//   "floor+ids") and without it, next to the "pick readback" copy.
+//
+// NOTES:
+// The original main() of the fragment shader is renamed and called from
+// a new main() that adds the id output; a color output declared at the
+// start of a line is pinned to location 0. Only the draws of
+// RenderScene() set the ids, so the GPU culler and the multi-view
+// renderer draw the background id.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "IdBufferPicker.h"
+#include "GLDebugOutput.h"
+#include "ShaderUtils.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// appended to the scene fragment shader after its main()
+	// has been renamed to pickSceneMain()
+	const char* g_IdOutput =
+		"\n"
+		"// draw list index + 1 of the object, 0 is the background\n"
+		"layout(location = 1) out uint pickObjectId;\n"
+		"uniform int pickId;\n"
+		"\n"
+		"void main()\n"
+		"{\n"
+		"	pickSceneMain();\n"
+		"	pickObjectId = uint(pickId);\n"
+		"}\n";
+}
+
+/***********************************************************
+ *  IdBufferPicker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+IdBufferPicker::IdBufferPicker(ShaderManager* pShaderManager, SceneManager* pSceneManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_pGpuProfiler = NULL;
+
+	m_program = 0;
+	m_sceneProgram = 0;
+	m_readFramebuffer = 0;
+	m_latency = 2;
+
+	m_bEnabled = true;
+	m_bActive = false;
+	m_bInScene = false;
+	m_cycleFrames = 0;
+	m_frame = 0;
+	m_cursorX = 0.5f;
+	m_cursorY = 0.5f;
+	m_bSelectionPending = false;
+	m_hoveredObject = -1;
+	m_hoveredFrame = -1;
+
+	m_issued = 0;
+	m_resolved = 0;
+	m_dropped = 0;
+	m_latencyFrames = 0;
+}
+
+/***********************************************************
+ *  ~IdBufferPicker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+IdBufferPicker::~IdBufferPicker()
+{
+	Destroy();
+	m_pShaderManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  SetLatency()
+ *
+ *  This method sets how many frames a copy waits before it
+ *  is read; it takes effect at Initialize(), which makes
+ *  one more buffer than frames of latency.
+ ***********************************************************/
+void IdBufferPicker::SetLatency(int frames)
+{
+	m_latency = std::max(frames, 1);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the id program, lets it receive the
+ *  lights of the scene, and creates the pixel buffers.
+ ***********************************************************/
+bool IdBufferPicker::Initialize(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	if (!GLEW_VERSION_3_2 && !GLEW_ARB_sync)
+	{
+		std::cout << "WARNING: ID buffer picking needs fence sync objects" << std::endl;
+		return(false);
+	}
+
+	std::string vertexSource;
+	std::string fragmentSource;
+	if (!ShaderUtils::ReadFile(vertexShader, vertexSource) || !ShaderUtils::ReadFile(fragmentShader, fragmentSource))
+	{
+		return(false);
+	}
+	if (fragmentSource.find("void main()") == std::string::npos)
+	{
+		std::cout << "WARNING: ID buffer picking could not find main() in " << fragmentShader << std::endl;
+		return(false);
+	}
+	ShaderUtils::ReplaceAll(fragmentSource, "void main()", "void pickSceneMain()");
+	ShaderUtils::ReplaceAll(fragmentSource, "\nout vec4 ", "\nlayout(location = 0) out vec4 ");
+	fragmentSource += g_IdOutput;
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, vertexSource, "id-pick.vert"));
+	shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, fragmentSource, "id-pick.frag"));
+	m_program = ShaderUtils::LinkProgram(shaders, "id-pick.scene");
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	// the lights are set once, like in the scene program
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+	m_pSceneManager->SetupSceneLights();
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+
+	glGenFramebuffers(1, &m_readFramebuffer);
+	m_readbacks.resize(m_latency + 1);
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		READBACK& readback = m_readbacks[i];
+		glGenBuffers(1, &readback.buffer);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(GLuint), NULL, GL_STREAM_READ);
+		GLDebugOutput::LabelObject(GL_BUFFER, readback.buffer, "buffer:id-pick.readback");
+		readback.fence = 0;
+		readback.frame = 0;
+		readback.bSelection = false;
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees every GL object of the picker.
+ ***********************************************************/
+void IdBufferPicker::Destroy()
+{
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		if (0 != m_readbacks[i].fence)
+		{
+			glDeleteSync(m_readbacks[i].fence);
+		}
+		glDeleteBuffers(1, &m_readbacks[i].buffer);
+	}
+	m_readbacks.clear();
+
+	if (m_readFramebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_readFramebuffer);
+		m_readFramebuffer = 0;
+	}
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  SetCursor()
+ *
+ *  This method stores the cursor relative to the window,
+ *  so it maps onto a framebuffer of any size.
+ ***********************************************************/
+void IdBufferPicker::SetCursor(double xCursor, double yCursor, int windowWidth, int windowHeight)
+{
+	m_cursorX = (float)(xCursor / (double)std::max(windowWidth, 1));
+	m_cursorY = 1.0f - (float)(yCursor / (double)std::max(windowHeight, 1));
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method counts the frame, switches the id target
+ *  when cycling, and reads the copies that have arrived.
+ ***********************************************************/
+bool IdBufferPicker::BeginFrame()
+{
+	m_frame++;
+	if ((m_cycleFrames > 0) && ((m_frame % m_cycleFrames) == 0))
+	{
+		m_bEnabled = !m_bEnabled;
+	}
+	m_bActive = m_bEnabled && (m_program != 0);
+
+	ResolveReadbacks();
+	return(m_bActive);
+}
+
+/***********************************************************
+ *  ResolveReadbacks()
+ *
+ *  This method reads the pixel buffers that are old enough
+ *  and whose fence has passed; the fence status is polled,
+ *  never waited on.
+ ***********************************************************/
+void IdBufferPicker::ResolveReadbacks()
+{
+	for (size_t i = 0; i < m_readbacks.size(); i++)
+	{
+		READBACK& readback = m_readbacks[i];
+		if ((0 == readback.fence) || (m_frame - readback.frame < m_latency))
+		{
+			continue;
+		}
+		GLint status = GL_UNSIGNALED;
+		glGetSynciv(readback.fence, GL_SYNC_STATUS, 1, NULL, &status);
+		if (status != GL_SIGNALED)
+		{
+			continue;
+		}
+
+		GLuint id = 0;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(GLuint), &id);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+		m_resolved++;
+		m_latencyFrames += m_frame - readback.frame;
+
+		int object = (int)id - 1;
+		if ((object >= (int)m_pSceneManager->GetSceneObjects().size()) || (object < -1))
+		{
+			object = -1;
+		}
+		if (readback.frame > m_hoveredFrame)
+		{
+			m_hoveredObject = object;
+			m_hoveredFrame = readback.frame;
+		}
+		if (readback.bSelection)
+		{
+			if (object >= 0)
+			{
+				const SceneManager::SCENE_OBJECT& picked = m_pSceneManager->GetSceneObjects()[object];
+				std::cout << "INFO: ID buffer picked " << picked.name << " (" << picked.group << ", "
+					<< SceneManager::GetMeshName(picked.mesh) << ") " << m_frame - readback.frame
+					<< " frames after the click" << std::endl;
+			}
+			else
+			{
+				std::cout << "INFO: ID buffer picked nothing" << std::endl;
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  BeginScene()
+ *
+ *  This method makes the id program current for the scene
+ *  pass and lets the scene manager set the object ids.
+ ***********************************************************/
+void IdBufferPicker::BeginScene()
+{
+	if (!m_bActive)
+	{
+		return;
+	}
+	m_sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+	m_pSceneManager->SetObjectIds(true);
+	m_bInScene = true;
+}
+
+/***********************************************************
+ *  ClearIds()
+ *
+ *  This method clears the id target, the second color
+ *  target of the scene pass, to the background id.
+ ***********************************************************/
+void IdBufferPicker::ClearIds()
+{
+	if (!m_bInScene)
+	{
+		return;
+	}
+	GLuint background[4] = { 0, 0, 0, 0 };
+	glClearBufferuiv(GL_COLOR, 1, background);
+}
+
+/***********************************************************
+ *  EndScene()
+ *
+ *  This method restores the scene program.
+ ***********************************************************/
+void IdBufferPicker::EndScene()
+{
+	if (!m_bInScene)
+	{
+		return;
+	}
+	m_pSceneManager->SetObjectIds(false);
+	ShaderUtils::SwapProgram(m_pShaderManager, m_sceneProgram);
+	m_bInScene = false;
+}
+
+/***********************************************************
+ *  ReadBack()
+ *
+ *  This method starts the copy of the pixel under the
+ *  cursor into a free pixel buffer; the copy is dropped
+ *  when every buffer is still in flight.
+ ***********************************************************/
+void IdBufferPicker::ReadBack(GLuint idTexture, int width, int height)
+{
+	if (!m_bActive || (idTexture == 0))
+	{
+		return;
+	}
+
+	READBACK* pReadback = NULL;
+	for (size_t i = 0; (i < m_readbacks.size()) && (NULL == pReadback); i++)
+	{
+		if (0 == m_readbacks[i].fence)
+		{
+			pReadback = &m_readbacks[i];
+		}
+	}
+	if (NULL == pReadback)
+	{
+		m_dropped++;
+		return;
+	}
+
+	int x = std::min(std::max((int)(m_cursorX * (float)width), 0), width - 1);
+	int y = std::min(std::max((int)(m_cursorY * (float)height), 0), height - 1);
+
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->BeginPass("pick readback");
+	}
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, m_readFramebuffer);
+	glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, idTexture, 0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, pReadback->buffer);
+	// with a pack buffer bound the pointer is an offset, and the
+	// call returns without waiting for the pixel
+	glReadPixels(x, y, 1, 1, GL_RED_INTEGER, GL_UNSIGNED_INT, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	pReadback->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->EndPass();
+	}
+
+	pReadback->frame = m_frame;
+	pReadback->bSelection = m_bSelectionPending;
+	m_bSelectionPending = false;
+	m_issued++;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints how many pixels were copied and read
+ *  back, their average age and the dropped copies.
+ ***********************************************************/
+void IdBufferPicker::PrintReport() const
+{
+	if (m_issued == 0)
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(2) << "INFO: ID buffer picking: " << m_issued << " pixels copied, "
+		<< m_resolved << " read on average " << (double)m_latencyFrames / (double)std::max(m_resolved, 1L)
+		<< " frames later, " << m_dropped << " dropped with every buffer in flight" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,117 @@
+///////////////////////////////////////////////////////////////////////////////
+// idbufferpicker.h
+// ============
+// pick objects from an id target of the scene pass, read back later
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  IdBufferPicker
+ *
+ *  This class draws the scene with a copy of the scene
+ *  program that also writes the draw list index of every
+ *  object into an integer target. Each frame the pixel
+ *  under the cursor is copied into a pixel buffer with a
+ *  fence behind it, and the buffer is read a few frames
+ *  later, once the fence has passed, so the CPU never waits
+ *  for the GPU. The id target can be switched on and off,
+ *  and the scene passes that write it are profiled under
+ *  their own names.
+ ***********************************************************/
+class IdBufferPicker
+{
+public:
+	// constructor
+	IdBufferPicker(ShaderManager* pShaderManager, SceneManager* pSceneManager);
+	// destructor
+	~IdBufferPicker();
+
+	// build the id program from the scene shader files; false
+	// without fences
+	bool Initialize(const std::string& vertexShader, const std::string& fragmentShader);
+	// free the program, the pixel buffers and the fences
+	void Destroy();
+
+	void SetEnabled(bool bEnabled) { m_bEnabled = bEnabled; }
+	// switch the id target on and off every given number of
+	// frames to measure what it costs, 0 stops
+	void SetCycleFrames(int frames) { m_cycleFrames = frames; }
+	// frames between the copy of a pixel and its read
+	void SetLatency(int frames);
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+
+	// advance the frame and the on and off cycle; true when this
+	// frame writes the id target
+	bool BeginFrame();
+	bool IsActive() const { return(m_bActive); }
+	// cursor in window coordinates from the top left
+	void SetCursor(double xCursor, double yCursor, int windowWidth, int windowHeight);
+	// report the object under the cursor once its pixel arrives
+	void RequestSelection() { m_bSelectionPending = true; }
+
+	// draw with the id program around the scene pass; ClearIds()
+	// goes after the clear of the color and depth buffers
+	void BeginScene();
+	void ClearIds();
+	void EndScene();
+	// read the finished pixels and copy the pixel under the
+	// cursor from the id texture of this frame
+	void ReadBack(GLuint idTexture, int width, int height);
+
+	// draw list index under the cursor, -1 for the background
+	int GetHoveredObject() const { return(m_hoveredObject); }
+	// print the copies, the frames they took and how many were
+	// dropped because every buffer was in flight
+	void PrintReport() const;
+
+private:
+	// a pixel copy in flight
+	struct READBACK
+	{
+		GLuint buffer;
+		GLsync fence;
+		long frame;
+		bool bSelection;
+	};
+
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+	GpuProfiler* m_pGpuProfiler;
+
+	GLuint m_program;
+	GLuint m_sceneProgram;
+	GLuint m_readFramebuffer;
+	std::vector<READBACK> m_readbacks;
+	int m_latency;
+
+	bool m_bEnabled;
+	bool m_bActive;
+	bool m_bInScene;
+	int m_cycleFrames;
+	long m_frame;
+	float m_cursorX;
+	float m_cursorY;
+	bool m_bSelectionPending;
+	int m_hoveredObject;
+	// frame of the copy the hovered object came from
+	long m_hoveredFrame;
+
+	long m_issued;
+	long m_resolved;
+	long m_dropped;
+	long long m_latencyFrames;
+
+	// read the buffers whose fence has passed
+	void ResolveReadbacks();
+};
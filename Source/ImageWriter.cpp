@@ -0,0 +1,957 @@
+///////////////////////////////////////////////////////////////////////////////
+// ImageWriter.cpp
+// ===============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `ImageWriter` class, which turns captured frames
+// into image files without any external image library. It is used by the
+// frame capture path, where the encoders run on worker threads.
+//
+// FUNCTIONALITY:
+// - PNG: per-row adaptive filtering (the filter with the smallest sum of
+//   absolute differences) and a fast deflate coder with fixed Huffman
+//   codes and single-probe LZ77 matching.
+// - QOI: the "Quite OK Image" format, which compresses much faster than
+//   PNG at a somewhat larger size; the best choice for long sequences.
+// - OpenEXR: uncompressed scanlines of half-float RGBA. The 8-bit sRGB
+//   values are converted to linear light, as compositing tools expect.
+//
+// NOTES:
+// The deflate coder trades ratio for speed: it skips dynamic Huffman
+// tables and lazy matching, which keeps a 4K frame well under the frame
+// budget of one worker thread.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "ImageWriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_FormatNames[ImageWriter::IMAGE_FORMAT_COUNT] =
+	{
+		"png",
+		"qoi",
+		"exr"
+	};
+
+	// deflate length codes 257..285: base length and extra bits
+	const unsigned short g_LengthBase[29] =
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+	const unsigned char g_LengthExtra[29] =
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	// deflate distance codes 0..29: base distance and extra bits
+	const unsigned short g_DistanceBase[30] =
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+		8193, 12289, 16385, 24577
+	};
+	const unsigned char g_DistanceExtra[30] =
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	const int g_WindowSize = 32768;
+	const int g_MinMatch = 3;
+	const int g_MaxMatch = 258;
+	const int g_HashBits = 15;
+
+	/***********************************************************
+	 *  Adler32()
+	 *
+	 *  Continues the zlib checksum over a buffer.
+	 ***********************************************************/
+	unsigned int Adler32(unsigned int adler, const unsigned char* data, size_t size)
+	{
+		unsigned int a = adler & 0xFFFF;
+		unsigned int b = adler >> 16;
+		while (size > 0)
+		{
+			// largest block that cannot overflow before the modulo
+			size_t block = (size < 5552) ? size : 5552;
+			size -= block;
+			while (block-- > 0)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return((b << 16) | a);
+	}
+
+	/***********************************************************
+	 *  Crc32()
+	 *
+	 *  Continues the PNG chunk checksum over a buffer.
+	 ***********************************************************/
+	struct CRC_TABLE
+	{
+		unsigned int values[256];
+
+		CRC_TABLE()
+		{
+			for (unsigned int n = 0; n < 256; n++)
+			{
+				unsigned int c = n;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? (0xEDB88320u ^ (c >> 1)) : (c >> 1);
+				}
+				values[n] = c;
+			}
+		}
+	};
+
+	unsigned int Crc32(unsigned int crc, const unsigned char* data, size_t size)
+	{
+		// built once, on first use, even with several workers
+		static const CRC_TABLE table;
+
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table.values[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return(~crc);
+	}
+
+	// write integers in the byte order of each format
+	void PutBigEndian32(std::vector<unsigned char>& output, unsigned int value)
+	{
+		output.push_back((unsigned char)(value >> 24));
+		output.push_back((unsigned char)(value >> 16));
+		output.push_back((unsigned char)(value >> 8));
+		output.push_back((unsigned char)value);
+	}
+	void PutLittleEndian(std::vector<unsigned char>& output, unsigned long long value, int bytes)
+	{
+		for (int i = 0; i < bytes; i++)
+		{
+			output.push_back((unsigned char)(value >> (8 * i)));
+		}
+	}
+
+	/***********************************************************
+	 *  PutExrAttribute()
+	 *
+	 *  Starts an OpenEXR header attribute: name, type and the
+	 *  size of the value that follows.
+	 ***********************************************************/
+	void PutExrAttribute(std::vector<unsigned char>& output, const char* name, const char* type, int size)
+	{
+		output.insert(output.end(), name, name + strlen(name) + 1);
+		output.insert(output.end(), type, type + strlen(type) + 1);
+		PutLittleEndian(output, (unsigned int)size, 4);
+	}
+
+	/***********************************************************
+	 *  PutPngChunk()
+	 *
+	 *  Appends a PNG chunk with its length and checksum.
+	 ***********************************************************/
+	void PutPngChunk(std::vector<unsigned char>& output, const char* type, const std::vector<unsigned char>& data)
+	{
+		PutBigEndian32(output, (unsigned int)data.size());
+		size_t typeOffset = output.size();
+		output.insert(output.end(), type, type + 4);
+		output.insert(output.end(), data.begin(), data.end());
+		PutBigEndian32(output, Crc32(0, &output[typeOffset], data.size() + 4));
+	}
+
+	/***********************************************************
+	 *  Paeth()
+	 *
+	 *  The PNG Paeth predictor.
+	 ***********************************************************/
+	unsigned char Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a);
+		int pb = std::abs(p - b);
+		int pc = std::abs(p - c);
+		if ((pa <= pb) && (pa <= pc))
+			return((unsigned char)a);
+		if (pb <= pc)
+			return((unsigned char)b);
+		return((unsigned char)c);
+	}
+
+	/***********************************************************
+	 *  FilterPngRow()
+	 *
+	 *  Filters one row of RGBA pixels with the PNG filter that
+	 *  gives the smallest sum of absolute differences, and
+	 *  writes the filter type followed by the filtered bytes.
+	 ***********************************************************/
+	void FilterPngRow(const unsigned char* row, const unsigned char* above, size_t rowBytes,
+		unsigned char* destination, std::vector<unsigned char>& candidate)
+	{
+		unsigned long bestSum = 0xFFFFFFFFul;
+
+		candidate.resize(rowBytes);
+		for (int filter = 0; filter < 5; filter++)
+		{
+			unsigned long sum = 0;
+			for (size_t x = 0; x < rowBytes; x++)
+			{
+				int left = (x >= 4) ? row[x - 4] : 0;
+				int up = above[x];
+				int upLeft = (x >= 4) ? above[x - 4] : 0;
+				int predicted = 0;
+				switch (filter)
+				{
+				case 1: predicted = left; break;
+				case 2: predicted = up; break;
+				case 3: predicted = (left + up) / 2; break;
+				case 4: predicted = Paeth(left, up, upLeft); break;
+				default: break;
+				}
+				candidate[x] = (unsigned char)(row[x] - predicted);
+				sum += (candidate[x] < 128) ? candidate[x] : (256 - candidate[x]);
+			}
+			if (sum < bestSum)
+			{
+				bestSum = sum;
+				destination[0] = (unsigned char)filter;
+				memcpy(destination + 1, &candidate[0], rowBytes);
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  PutPngHeader()
+	 *
+	 *  Appends the PNG signature and the IHDR chunk of an 8-bit
+	 *  RGBA image.
+	 ***********************************************************/
+	void PutPngHeader(std::vector<unsigned char>& output, int width, int height)
+	{
+		const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		std::vector<unsigned char> header;
+
+		PutBigEndian32(header, (unsigned int)width);
+		PutBigEndian32(header, (unsigned int)height);
+		header.push_back(8);	// bit depth
+		header.push_back(6);	// RGBA
+		header.push_back(0);	// deflate
+		header.push_back(0);	// adaptive filtering
+		header.push_back(0);	// no interlace
+
+		output.insert(output.end(), signature, signature + 8);
+		PutPngChunk(output, "IHDR", header);
+	}
+
+	/***********************************************************
+	 *  FloatToHalf()
+	 *
+	 *  Converts a float to a 16-bit half float, rounding to
+	 *  the nearest value.
+	 ***********************************************************/
+	unsigned short FloatToHalf(float value)
+	{
+		unsigned int bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+
+		unsigned int sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		unsigned int mantissa = bits & 0x7FFFFF;
+
+		if (exponent <= 0)
+		{
+			// denormal or too small for a half
+			if (exponent < -10)
+			{
+				return((unsigned short)sign);
+			}
+			mantissa |= 0x800000;
+			int shift = 14 - exponent;
+			unsigned int half = mantissa >> shift;
+			if ((mantissa >> (shift - 1)) & 1)
+			{
+				half++;
+			}
+			return((unsigned short)(sign | half));
+		}
+		if (exponent >= 31)
+		{
+			return((unsigned short)(sign | 0x7C00));
+		}
+
+		unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+		if (mantissa & 0x1000)
+		{
+			half++;
+		}
+		return((unsigned short)half);
+	}
+}
+
+/***********************************************************
+ *  ParseFormat()
+ *
+ *  This method reads an image format from its name.
+ ***********************************************************/
+bool ImageWriter::ParseFormat(const std::string& name, IMAGE_FORMAT* pFormat)
+{
+	for (int i = 0; i < IMAGE_FORMAT_COUNT; i++)
+	{
+		if (name == g_FormatNames[i])
+		{
+			*pFormat = (IMAGE_FORMAT)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetExtension()
+ *
+ *  This method returns the file extension of a format.
+ ***********************************************************/
+const char* ImageWriter::GetExtension(IMAGE_FORMAT format)
+{
+	return(g_FormatNames[format]);
+}
+
+/***********************************************************
+ *  Encode()
+ *
+ *  This method encodes RGBA pixels in the given format.
+ ***********************************************************/
+bool ImageWriter::Encode(IMAGE_FORMAT format, int width, int height,
+	const unsigned char* pixels, bool bBottomUp, std::vector<unsigned char>& output)
+{
+	output.clear();
+	if ((width <= 0) || (height <= 0) || (NULL == pixels))
+	{
+		return(false);
+	}
+
+	switch (format)
+	{
+	case IMAGE_PNG:
+		EncodePNG(width, height, pixels, bBottomUp, output);
+		break;
+	case IMAGE_QOI:
+		EncodeQOI(width, height, pixels, bBottomUp, output);
+		break;
+	case IMAGE_EXR:
+		EncodeEXR(width, height, pixels, bBottomUp, output);
+		break;
+	default:
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  WriteFile()
+ *
+ *  This method encodes RGBA pixels and writes the result
+ *  to a file.
+ ***********************************************************/
+bool ImageWriter::WriteFile(const std::string& filename, IMAGE_FORMAT format, int width,
+	int height, const unsigned char* pixels, bool bBottomUp)
+{
+	std::vector<unsigned char> encoded;
+	if (!Encode(format, width, height, pixels, bBottomUp, encoded))
+	{
+		return(false);
+	}
+
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (NULL == file)
+	{
+		std::cerr << "Could not open image file for writing: " << filename << std::endl;
+		return(false);
+	}
+	bool bWritten = (fwrite(&encoded[0], 1, encoded.size(), file) == encoded.size());
+	fclose(file);
+
+	if (!bWritten)
+	{
+		std::cerr << "Could not write image file: " << filename << std::endl;
+	}
+	return(bWritten);
+}
+
+/***********************************************************
+ *  EncodePNG()
+ *
+ *  This method encodes the pixels as an 8-bit RGBA PNG.
+ ***********************************************************/
+void ImageWriter::EncodePNG(int width, int height, const unsigned char* pixels,
+	bool bBottomUp, std::vector<unsigned char>& output)
+{
+	const size_t rowBytes = (size_t)width * 4;
+	std::vector<unsigned char> filtered((rowBytes + 1) * height);
+	std::vector<unsigned char> candidate;
+	std::vector<unsigned char> zeroRow(rowBytes, 0);
+
+	for (int y = 0; y < height; y++)
+	{
+		int sourceRow = bBottomUp ? (height - 1 - y) : y;
+		int previousRow = bBottomUp ? (sourceRow + 1) : (sourceRow - 1);
+		const unsigned char* above = (y > 0) ? (pixels + rowBytes * previousRow) : &zeroRow[0];
+		FilterPngRow(pixels + rowBytes * sourceRow, above, rowBytes, &filtered[(rowBytes + 1) * y], candidate);
+	}
+
+	ZlibStream stream;
+	std::vector<unsigned char> compressed;
+	compressed.reserve(filtered.size() / 2);
+	stream.Begin(compressed);
+	stream.Compress(&filtered[0], filtered.size(), compressed);
+	stream.Finish(compressed);
+
+	PutPngHeader(output, width, height);
+	PutPngChunk(output, "IDAT", compressed);
+	PutPngChunk(output, "IEND", std::vector<unsigned char>());
+}
+
+/***********************************************************
+ *  EncodeQOI()
+ *
+ *  This method encodes the pixels in the QOI format.
+ ***********************************************************/
+void ImageWriter::EncodeQOI(int width, int height, const unsigned char* pixels,
+	bool bBottomUp, std::vector<unsigned char>& output)
+{
+	unsigned char index[64][4];
+	unsigned char previous[4] = { 0, 0, 0, 255 };
+	int run = 0;
+
+	memset(index, 0, sizeof(index));
+	output.reserve((size_t)width * height * 2);
+
+	output.push_back('q');
+	output.push_back('o');
+	output.push_back('i');
+	output.push_back('f');
+	PutBigEndian32(output, (unsigned int)width);
+	PutBigEndian32(output, (unsigned int)height);
+	output.push_back(4);	// RGBA
+	output.push_back(0);	// sRGB with linear alpha
+
+	for (int y = 0; y < height; y++)
+	{
+		int sourceRow = bBottomUp ? (height - 1 - y) : y;
+		const unsigned char* row = pixels + (size_t)width * 4 * sourceRow;
+
+		for (int x = 0; x < width; x++)
+		{
+			const unsigned char* pixel = row + x * 4;
+
+			if (memcmp(pixel, previous, 4) == 0)
+			{
+				run++;
+				if (run == 62)
+				{
+					output.push_back((unsigned char)(0xC0 | (run - 1)));
+					run = 0;
+				}
+				continue;
+			}
+			if (run > 0)
+			{
+				output.push_back((unsigned char)(0xC0 | (run - 1)));
+				run = 0;
+			}
+
+			int hash = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+			if (memcmp(index[hash], pixel, 4) == 0)
+			{
+				output.push_back((unsigned char)hash);
+			}
+			else
+			{
+				memcpy(index[hash], pixel, 4);
+
+				if (pixel[3] == previous[3])
+				{
+					signed char dr = (signed char)(pixel[0] - previous[0]);
+					signed char dg = (signed char)(pixel[1] - previous[1]);
+					signed char db = (signed char)(pixel[2] - previous[2]);
+					signed char drg = (signed char)(dr - dg);
+					signed char dbg = (signed char)(db - dg);
+
+					if ((dr >= -2) && (dr <= 1) && (dg >= -2) && (dg <= 1) && (db >= -2) && (db <= 1))
+					{
+						output.push_back((unsigned char)(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2)));
+					}
+					else if ((dg >= -32) && (dg <= 31) && (drg >= -8) && (drg <= 7) && (dbg >= -8) && (dbg <= 7))
+					{
+						output.push_back((unsigned char)(0x80 | (dg + 32)));
+						output.push_back((unsigned char)(((drg + 8) << 4) | (dbg + 8)));
+					}
+					else
+					{
+						output.push_back(0xFE);
+						output.insert(output.end(), pixel, pixel + 3);
+					}
+				}
+				else
+				{
+					output.push_back(0xFF);
+					output.insert(output.end(), pixel, pixel + 4);
+				}
+			}
+			memcpy(previous, pixel, 4);
+		}
+	}
+	if (run > 0)
+	{
+		output.push_back((unsigned char)(0xC0 | (run - 1)));
+	}
+
+	// end marker
+	for (int i = 0; i < 7; i++)
+	{
+		output.push_back(0);
+	}
+	output.push_back(1);
+}
+
+/***********************************************************
+ *  EncodeEXR()
+ *
+ *  This method encodes the pixels as an uncompressed
+ *  half-float RGBA OpenEXR image in linear light.
+ ***********************************************************/
+void ImageWriter::EncodeEXR(int width, int height, const unsigned char* pixels,
+	bool bBottomUp, std::vector<unsigned char>& output)
+{
+	// channels are stored in alphabetical order
+	const char* channelNames[4] = { "A", "B", "G", "R" };
+	const int channelSources[4] = { 3, 2, 1, 0 };
+
+	// decode sRGB to linear; alpha stays linear
+	unsigned short linear[256];
+	unsigned short alpha[256];
+	for (int i = 0; i < 256; i++)
+	{
+		float c = i / 255.0f;
+		float value = (c <= 0.04045f) ? (c / 12.92f) : powf((c + 0.055f) / 1.055f, 2.4f);
+		linear[i] = FloatToHalf(value);
+		alpha[i] = FloatToHalf(c);
+	}
+
+	// magic number and version 2, single part scanline file
+	PutLittleEndian(output, 20000630, 4);
+	PutLittleEndian(output, 2, 4);
+
+	PutExrAttribute(output, "channels", "chlist", 4 * 18 + 1);
+	for (int c = 0; c < 4; c++)
+	{
+		output.push_back((unsigned char)channelNames[c][0]);
+		output.push_back(0);
+		PutLittleEndian(output, 1, 4);	// HALF
+		PutLittleEndian(output, 0, 4);	// pLinear and reserved
+		PutLittleEndian(output, 1, 4);	// x sampling
+		PutLittleEndian(output, 1, 4);	// y sampling
+	}
+	output.push_back(0);
+
+	PutExrAttribute(output, "compression", "compression", 1);
+	output.push_back(0);	// NO_COMPRESSION
+
+	const char* windows[2] = { "dataWindow", "displayWindow" };
+	for (int w = 0; w < 2; w++)
+	{
+		PutExrAttribute(output, windows[w], "box2i", 16);
+		PutLittleEndian(output, 0, 4);
+		PutLittleEndian(output, 0, 4);
+		PutLittleEndian(output, (unsigned int)(width - 1), 4);
+		PutLittleEndian(output, (unsigned int)(height - 1), 4);
+	}
+
+	PutExrAttribute(output, "lineOrder", "lineOrder", 1);
+	output.push_back(0);	// INCREASING_Y
+
+	float one = 1.0f;
+	unsigned int oneBits = 0;
+	memcpy(&oneBits, &one, sizeof(oneBits));
+	PutExrAttribute(output, "pixelAspectRatio", "float", 4);
+	PutLittleEndian(output, oneBits, 4);
+	PutExrAttribute(output, "screenWindowCenter", "v2f", 8);
+	PutLittleEndian(output, 0, 8);
+	PutExrAttribute(output, "screenWindowWidth", "float", 4);
+	PutLittleEndian(output, oneBits, 4);
+	output.push_back(0);	// end of header
+
+	// line offset table, followed by one block per scanline
+	const size_t lineBytes = (size_t)width * 4 * sizeof(unsigned short);
+	const size_t blockBytes = 8 + lineBytes;
+	size_t firstBlock = output.size() + (size_t)height * 8;
+	for (int y = 0; y < height; y++)
+	{
+		PutLittleEndian(output, firstBlock + blockBytes * y, 8);
+	}
+
+	output.reserve(firstBlock + blockBytes * height);
+	for (int y = 0; y < height; y++)
+	{
+		int sourceRow = bBottomUp ? (height - 1 - y) : y;
+		const unsigned char* row = pixels + (size_t)width * 4 * sourceRow;
+
+		PutLittleEndian(output, (unsigned int)y, 4);
+		PutLittleEndian(output, (unsigned int)lineBytes, 4);
+		for (int c = 0; c < 4; c++)
+		{
+			const unsigned short* table = (channelSources[c] == 3) ? alpha : linear;
+			for (int x = 0; x < width; x++)
+			{
+				PutLittleEndian(output, table[row[x * 4 + channelSources[c]]], 2);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ZlibStream()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ZlibStream::ZlibStream()
+{
+	m_pOutput = NULL;
+	m_bits = 0;
+	m_bitCount = 0;
+	m_adler = 1;
+	m_head.resize((size_t)1 << g_HashBits);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method appends the zlib header.
+ ***********************************************************/
+void ZlibStream::Begin(std::vector<unsigned char>& output)
+{
+	// deflate, 32K window, fastest compression
+	output.push_back(0x78);
+	output.push_back(0x01);
+	m_bits = 0;
+	m_bitCount = 0;
+	m_adler = 1;
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method compresses a piece of data into one deflate
+ *  block. Matches are only searched within the piece, so
+ *  the pieces should be at least a few rows of an image.
+ *  A partial byte may stay pending until the next call.
+ ***********************************************************/
+void ZlibStream::Compress(const unsigned char* data, size_t size, std::vector<unsigned char>& output)
+{
+	m_pOutput = &output;
+	std::fill(m_head.begin(), m_head.end(), -1);
+
+	// block that is not the last one, fixed Huffman codes
+	PutBits(0, 1);
+	PutBits(1, 2);
+
+	size_t position = 0;
+	while (position < size)
+	{
+		int bestLength = 0;
+		int bestDistance = 0;
+
+		if (position + g_MinMatch <= size)
+		{
+			unsigned int hash = ((data[position] << 16) | (data[position + 1] << 8) | data[position + 2]) * 2654435761u;
+			hash >>= (32 - g_HashBits);
+			int candidate = m_head[hash];
+			m_head[hash] = (int)position;
+
+			if ((candidate >= 0) && ((int)position - candidate <= g_WindowSize))
+			{
+				size_t limit = size - position;
+				if (limit > (size_t)g_MaxMatch)
+				{
+					limit = g_MaxMatch;
+				}
+				int length = 0;
+				while (((size_t)length < limit) && (data[candidate + length] == data[position + length]))
+				{
+					length++;
+				}
+				if (length >= g_MinMatch)
+				{
+					bestLength = length;
+					bestDistance = (int)position - candidate;
+				}
+			}
+		}
+
+		if (bestLength > 0)
+		{
+			PutMatch(bestLength, bestDistance);
+			position += bestLength;
+		}
+		else
+		{
+			PutLiteral(data[position]);
+			position++;
+		}
+	}
+
+	// end of block
+	PutLiteral(256);
+	m_adler = Adler32(m_adler, data, size);
+	m_pOutput = NULL;
+}
+
+/***********************************************************
+ *  Finish()
+ *
+ *  This method closes the stream with an empty final block
+ *  and appends the checksum of all compressed data.
+ ***********************************************************/
+void ZlibStream::Finish(std::vector<unsigned char>& output)
+{
+	m_pOutput = &output;
+	PutBits(1, 1);
+	PutBits(1, 2);
+	PutLiteral(256);
+	if (m_bitCount > 0)
+	{
+		output.push_back((unsigned char)(m_bits & 0xFF));
+	}
+	m_bits = 0;
+	m_bitCount = 0;
+	m_pOutput = NULL;
+
+	PutBigEndian32(output, m_adler);
+}
+
+/***********************************************************
+ *  PutBits()
+ *
+ *  This method appends a bit field, least significant bit
+ *  first, as deflate requires.
+ ***********************************************************/
+void ZlibStream::PutBits(unsigned int value, int count)
+{
+	m_bits |= value << m_bitCount;
+	m_bitCount += count;
+	while (m_bitCount >= 8)
+	{
+		m_pOutput->push_back((unsigned char)(m_bits & 0xFF));
+		m_bits >>= 8;
+		m_bitCount -= 8;
+	}
+}
+
+/***********************************************************
+ *  PutCode()
+ *
+ *  This method appends a Huffman code, which deflate stores
+ *  most significant bit first.
+ ***********************************************************/
+void ZlibStream::PutCode(unsigned int code, int count)
+{
+	unsigned int reversed = 0;
+	for (int i = 0; i < count; i++)
+	{
+		reversed = (reversed << 1) | ((code >> i) & 1);
+	}
+	PutBits(reversed, count);
+}
+
+/***********************************************************
+ *  PutLiteral()
+ *
+ *  This method writes a literal/length symbol with the
+ *  fixed codes.
+ ***********************************************************/
+void ZlibStream::PutLiteral(int symbol)
+{
+	if (symbol < 144)
+		PutCode(0x30 + symbol, 8);
+	else if (symbol < 256)
+		PutCode(0x190 + symbol - 144, 9);
+	else if (symbol < 280)
+		PutCode(symbol - 256, 7);
+	else
+		PutCode(0xC0 + symbol - 280, 8);
+}
+
+/***********************************************************
+ *  PutMatch()
+ *
+ *  This method writes a length/distance pair with the fixed
+ *  codes.
+ ***********************************************************/
+void ZlibStream::PutMatch(int length, int distance)
+{
+	int lengthCode = 28;
+	while (g_LengthBase[lengthCode] > length)
+	{
+		lengthCode--;
+	}
+	PutLiteral(257 + lengthCode);
+	PutBits(length - g_LengthBase[lengthCode], g_LengthExtra[lengthCode]);
+
+	int distanceCode = 29;
+	while (g_DistanceBase[distanceCode] > distance)
+	{
+		distanceCode--;
+	}
+	PutCode(distanceCode, 5);
+	PutBits(distance - g_DistanceBase[distanceCode], g_DistanceExtra[distanceCode]);
+}
+
+/***********************************************************
+ *  PngRowWriter()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PngRowWriter::PngRowWriter()
+{
+	m_pFile = NULL;
+	m_width = 0;
+	m_height = 0;
+	m_rowsWritten = 0;
+	m_bFailed = false;
+}
+
+/***********************************************************
+ *  ~PngRowWriter()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PngRowWriter::~PngRowWriter()
+{
+	if (NULL != m_pFile)
+	{
+		Close();
+	}
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method creates the file and writes the PNG header.
+ ***********************************************************/
+bool PngRowWriter::Open(const std::string& filename, int width, int height)
+{
+	if ((NULL != m_pFile) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	m_pFile = fopen(filename.c_str(), "wb");
+	if (NULL == m_pFile)
+	{
+		std::cerr << "Could not open image file for writing: " << filename << std::endl;
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_rowsWritten = 0;
+	m_bFailed = false;
+	m_previousRow.assign((size_t)width * 4, 0);
+	m_pending.clear();
+
+	std::vector<unsigned char> header;
+	PutPngHeader(header, width, height);
+	m_stream.Begin(m_pending);
+	return(WriteBytes(header));
+}
+
+/***********************************************************
+ *  WriteRows()
+ *
+ *  This method filters and compresses the next rows of the
+ *  image and writes them as one IDAT chunk.
+ ***********************************************************/
+bool PngRowWriter::WriteRows(const unsigned char* pixels, int rowCount, bool bBottomUp)
+{
+	if ((NULL == m_pFile) || m_bFailed || (rowCount <= 0) || (m_rowsWritten + rowCount > m_height))
+	{
+		return(false);
+	}
+
+	const size_t rowBytes = (size_t)m_width * 4;
+	std::vector<unsigned char> filtered((rowBytes + 1) * rowCount);
+	std::vector<unsigned char> candidate;
+
+	for (int y = 0; y < rowCount; y++)
+	{
+		const unsigned char* row = pixels + rowBytes * (bBottomUp ? (rowCount - 1 - y) : y);
+		FilterPngRow(row, &m_previousRow[0], rowBytes, &filtered[(rowBytes + 1) * y], candidate);
+		memcpy(&m_previousRow[0], row, rowBytes);
+	}
+	m_rowsWritten += rowCount;
+
+	// whole bytes go out now; a partial byte waits for the next rows
+	m_stream.Compress(&filtered[0], filtered.size(), m_pending);
+	std::vector<unsigned char> chunk;
+	PutPngChunk(chunk, "IDAT", m_pending);
+	m_pending.clear();
+	return(WriteBytes(chunk));
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method finishes the compressed stream, writes the
+ *  end of the image and closes the file. It fails if fewer
+ *  rows than the image height were written.
+ ***********************************************************/
+bool PngRowWriter::Close()
+{
+	if (NULL == m_pFile)
+	{
+		return(false);
+	}
+
+	std::vector<unsigned char> trailer;
+	m_stream.Finish(m_pending);
+	PutPngChunk(trailer, "IDAT", m_pending);
+	PutPngChunk(trailer, "IEND", std::vector<unsigned char>());
+	m_pending.clear();
+	bool bResult = WriteBytes(trailer) && (m_rowsWritten == m_height);
+
+	fclose(m_pFile);
+	m_pFile = NULL;
+	return(bResult);
+}
+
+/***********************************************************
+ *  WriteBytes()
+ *
+ *  This method writes encoded bytes to the file.
+ ***********************************************************/
+bool PngRowWriter::WriteBytes(const std::vector<unsigned char>& bytes)
+{
+	if (!m_bFailed && !bytes.empty() && (fwrite(&bytes[0], 1, bytes.size(), m_pFile) != bytes.size()))
+	{
+		std::cerr << "Could not write to the image file" << std::endl;
+		m_bFailed = true;
+	}
+	return(!m_bFailed);
+}
@@ -0,0 +1,131 @@
+///////////////////////////////////////////////////////////////////////////////
+// imagewriter.h
+// ============
+// encode captured RGBA frames as PNG, QOI or OpenEXR images
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ImageWriter
+ *
+ *  This class encodes 8-bit RGBA pixels into image files.
+ *  The encoders have no shared state, so they can be called
+ *  from several worker threads at the same time.
+ ***********************************************************/
+class ImageWriter
+{
+public:
+	// supported output formats
+	enum IMAGE_FORMAT
+	{
+		IMAGE_PNG = 0,
+		IMAGE_QOI,
+		IMAGE_EXR,
+		IMAGE_FORMAT_COUNT
+	};
+
+	// read a format from its name ("png", "qoi" or "exr")
+	static bool ParseFormat(const std::string& name, IMAGE_FORMAT* pFormat);
+	// file extension of a format, without the dot
+	static const char* GetExtension(IMAGE_FORMAT format);
+
+	// encode tightly packed RGBA pixels into memory; rows read
+	// back from OpenGL are bottom-up and get flipped
+	static bool Encode(IMAGE_FORMAT format, int width, int height,
+		const unsigned char* pixels, bool bBottomUp, std::vector<unsigned char>& output);
+	// encode the pixels and write them to a file
+	static bool WriteFile(const std::string& filename, IMAGE_FORMAT format, int width,
+		int height, const unsigned char* pixels, bool bBottomUp);
+
+private:
+	static void EncodePNG(int width, int height, const unsigned char* pixels,
+		bool bBottomUp, std::vector<unsigned char>& output);
+	static void EncodeQOI(int width, int height, const unsigned char* pixels,
+		bool bBottomUp, std::vector<unsigned char>& output);
+	static void EncodeEXR(int width, int height, const unsigned char* pixels,
+		bool bBottomUp, std::vector<unsigned char>& output);
+};
+
+/***********************************************************
+ *  ZlibStream
+ *
+ *  This class compresses data into a zlib stream piece by
+ *  piece, one deflate block with the fixed Huffman codes
+ *  per piece, so large images never have to be held in
+ *  memory as a whole.
+ ***********************************************************/
+class ZlibStream
+{
+public:
+	// constructor
+	ZlibStream();
+
+	// append the zlib header and reset the checksum
+	void Begin(std::vector<unsigned char>& output);
+	// compress the next piece of data
+	void Compress(const unsigned char* data, size_t size, std::vector<unsigned char>& output);
+	// append the final block and the checksum
+	void Finish(std::vector<unsigned char>& output);
+
+private:
+	// output of the call in progress
+	std::vector<unsigned char>* m_pOutput;
+	// bits not yet forming a whole byte
+	unsigned int m_bits;
+	int m_bitCount;
+	unsigned int m_adler;
+	// last position of every 3-byte hash in the current piece
+	std::vector<int> m_head;
+
+	void PutBits(unsigned int value, int count);
+	void PutCode(unsigned int code, int count);
+	void PutLiteral(int symbol);
+	void PutMatch(int length, int distance);
+};
+
+/***********************************************************
+ *  PngRowWriter
+ *
+ *  This class writes a PNG file a band of rows at a time,
+ *  from the top of the image down. Only the previous row is
+ *  kept for filtering, so images far larger than memory can
+ *  be written.
+ ***********************************************************/
+class PngRowWriter
+{
+public:
+	// constructor
+	PngRowWriter();
+	// destructor
+	~PngRowWriter();
+
+	// create the file and write the header
+	bool Open(const std::string& filename, int width, int height);
+	// append the next rows of tightly packed RGBA pixels
+	bool WriteRows(const unsigned char* pixels, int rowCount, bool bBottomUp);
+	// finish the file; fails unless every row was written
+	bool Close();
+
+	int GetRowsWritten() const { return(m_rowsWritten); }
+
+private:
+	FILE* m_pFile;
+	int m_width;
+	int m_height;
+	int m_rowsWritten;
+	bool m_bFailed;
+	// last row written, unfiltered, for the Up/Average/Paeth filters
+	std::vector<unsigned char> m_previousRow;
+	ZlibStream m_stream;
+	// compressed bytes waiting to be written in an IDAT chunk
+	std::vector<unsigned char> m_pending;
+
+	bool WriteBytes(const std::vector<unsigned char>& bytes);
+};
@@ -0,0 +1,608 @@
+///////////////////////////////////////////////////////////////////////////////
+// ImpostorRenderer.cpp
+// ====================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `ImpostorRenderer` class, which draws far away
+// composite objects as textured quads captured from the real objects.
+//
+// FUNCTIONALITY:
+// - Group the draw list by the composite object each object belongs to.
+//   Groups of one object, like the floor, are always drawn in full.
+// - At load time, render every group with the scene program from a
+//   grid of directions spread over the whole sphere with an octahedral
+//   mapping, each into its own cell of one layer of a texture array,
+//   with an orthographic camera fitted to the bounding sphere.
+// - Repeat the groups in a square grid of copies, like the GPU culler
+//   does with the whole draw list, to measure large object counts.
+// - Per frame, cull the copies by their sphere, draw the near ones in
+//   full and collect the centers of the far ones, then draw the far
+//   copies of each group with one instanced draw of a quad. The vertex
+//   stage picks the cell captured nearest to the direction of the
+//   camera and turns the quad the way that view was captured.
+//
+// NOTES:
+// The lighting is captured with the objects at their place in the
+// scene, so the impostors keep those highlights wherever they stand.
+// The colors are stored premultiplied by their alpha so the smaller
+// mipmap levels do not darken the outlines, and the quads are drawn
+// opaque with an alpha test, so a translucent part becomes solid at a
+// distance. The captured colors are clamped to the range of the atlas.
+// The quads sit at the center of their group in the depth buffer.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "ImpostorRenderer.h"
+#include "GLDebugOutput.h"
+#include "SceneGeometry.h"
+#include "ShaderUtils.h"
+#include "VisibilityCache.h"
+
+// GLFW library, used for timing the capture
+#include "GLFW/glfw3.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the scene manager binds its textures to the first 16 units
+	const int g_AtlasUnit = 16;
+	// the smallest mipmap keeps a few pixels per view
+	const int g_MaxAtlasLevel = 4;
+
+	// builds each quad from the view captured nearest to the
+	// direction of the camera
+	const char* g_VertexShader =
+		"#version 410 core\n"
+		"layout(location = 0) in vec3 impostorCenter;\n"
+		"uniform mat4 view;\n"
+		"uniform mat4 projection;\n"
+		"uniform vec3 viewPosition;\n"
+		"uniform float impostorRadius;\n"
+		"uniform int impostorFrames;\n"
+		"out vec2 impostorTextureCoordinate;\n"
+		"vec2 SignNotZero(vec2 value)\n"
+		"{\n"
+		"	return vec2(value.x >= 0.0 ? 1.0 : -1.0, value.y >= 0.0 ? 1.0 : -1.0);\n"
+		"}\n"
+		"// the octahedral mapping with y up, from [-1, 1] to a direction\n"
+		"vec3 DecodeDirection(vec2 point)\n"
+		"{\n"
+		"	vec3 direction = vec3(point, 1.0 - abs(point.x) - abs(point.y));\n"
+		"	if (direction.z < 0.0) direction.xy = (1.0 - abs(direction.yx)) * SignNotZero(direction.xy);\n"
+		"	return normalize(direction.xzy);\n"
+		"}\n"
+		"vec2 EncodeDirection(vec3 direction)\n"
+		"{\n"
+		"	direction = direction.xzy / max(abs(direction.x) + abs(direction.y) + abs(direction.z), 1e-6);\n"
+		"	if (direction.z < 0.0) direction.xy = (1.0 - abs(direction.yx)) * SignNotZero(direction.xy);\n"
+		"	return direction.xy;\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	float frames = float(impostorFrames);\n"
+		"	vec2 point = EncodeDirection(viewPosition - impostorCenter);\n"
+		"	vec2 frame = clamp(floor((point * 0.5 + 0.5) * frames), 0.0, frames - 1.0);\n"
+		"	vec3 direction = DecodeDirection((frame + 0.5) / frames * 2.0 - 1.0);\n"
+		"	// the same axes as the capture camera\n"
+		"	vec3 up = (abs(direction.y) > 0.99) ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);\n"
+		"	vec3 right = normalize(cross(-direction, up));\n"
+		"	vec3 upward = cross(right, -direction);\n"
+		"	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - 1.0;\n"
+		"	vec3 position = impostorCenter + (right * corner.x + upward * corner.y) * impostorRadius;\n"
+		"	gl_Position = projection * view * vec4(position, 1.0);\n"
+		"	impostorTextureCoordinate = (frame + corner * 0.5 + 0.5) / frames;\n"
+		"}\n";
+
+	const char* g_FragmentShader =
+		"#version 410 core\n"
+		"in vec2 impostorTextureCoordinate;\n"
+		"uniform sampler2DArray impostorAtlas;\n"
+		"uniform int impostorLayer;\n"
+		"out vec4 outFragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	vec4 color = texture(impostorAtlas, vec3(impostorTextureCoordinate, float(impostorLayer)));\n"
+		"	if (color.a < 0.25) discard;\n"
+		"	outFragmentColor = vec4(color.rgb / color.a, 1.0);\n"
+		"}\n";
+
+	/***********************************************************
+	 *  DecodeDirection()
+	 *
+	 *  Returns the direction of a point of the octahedral map,
+	 *  given in [-1, 1], with y up like the vertex stage.
+	 ***********************************************************/
+	glm::vec3 DecodeDirection(const glm::vec2& point)
+	{
+		glm::vec3 direction(point.x, point.y, 1.0f - fabsf(point.x) - fabsf(point.y));
+		if (direction.z < 0.0f)
+		{
+			float x = (1.0f - fabsf(direction.y)) * ((direction.x >= 0.0f) ? 1.0f : -1.0f);
+			float y = (1.0f - fabsf(direction.x)) * ((direction.y >= 0.0f) ? 1.0f : -1.0f);
+			direction.x = x;
+			direction.y = y;
+		}
+		return(glm::normalize(glm::vec3(direction.x, direction.z, direction.y)));
+	}
+}
+
+/***********************************************************
+ *  ImpostorRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ImpostorRenderer::ImpostorRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_pGpuProfiler = NULL;
+	m_program = 0;
+	m_atlas = 0;
+	m_vertexArray = 0;
+	m_centerBuffer = 0;
+	m_frames = 0;
+	m_copies = 1;
+	m_distance = 30.0f;
+	m_otherTriangles = 0;
+	m_captureSeconds = 0.0;
+	m_renderedFrames = 0;
+	m_draws = 0;
+	m_triangles = 0;
+	m_fullDraws = 0;
+	m_fullTriangles = 0;
+	m_impostors = 0;
+	m_nearCopies = 0;
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		SceneGeometry::MESH mesh;
+		SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, mesh);
+		m_meshTriangles[type] = (long long)(mesh.indices.size() / 3);
+	}
+}
+
+/***********************************************************
+ *  ~ImpostorRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ImpostorRenderer::~ImpostorRenderer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method groups the draw list, places the copies,
+ *  builds the impostor program and captures the atlas.
+ ***********************************************************/
+bool ImpostorRenderer::Initialize(int frames, int frameSize)
+{
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = m_pSceneManager->GetSceneObjects();
+	m_frames = std::max(frames, 1);
+	frameSize = std::max(frameSize, 4);
+	m_copies = std::max(m_copies, 1);
+
+	// groups in the order of their first object
+	std::map<std::string, int> groupIndices;
+	m_groups.clear();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		std::map<std::string, int>::iterator it = groupIndices.find(objects[i].group);
+		if (it == groupIndices.end())
+		{
+			GROUP group;
+			group.name = objects[i].group;
+			group.sphere = glm::vec4(0.0f);
+			group.triangleCount = 0;
+			it = groupIndices.insert(std::make_pair(objects[i].group, (int)m_groups.size())).first;
+			m_groups.push_back(group);
+		}
+		m_groups[it->second].objects.push_back((int)i);
+		m_groups[it->second].triangleCount += m_meshTriangles[objects[i].mesh];
+	}
+
+	// a group of one object gains nothing from an impostor
+	m_others.clear();
+	m_otherTriangles = 0;
+	for (size_t g = 0; g < m_groups.size(); )
+	{
+		if (m_groups[g].name.empty() || (m_groups[g].objects.size() < 2))
+		{
+			m_others.insert(m_others.end(), m_groups[g].objects.begin(), m_groups[g].objects.end());
+			m_otherTriangles += m_groups[g].triangleCount;
+			m_groups.erase(m_groups.begin() + g);
+		}
+		else
+		{
+			g++;
+		}
+	}
+	if (m_groups.empty())
+	{
+		std::cout << "WARNING: Impostors found no composite objects in the scene" << std::endl;
+		return(false);
+	}
+
+	// one sphere around the spheres of the objects of each group,
+	// and the copies spaced by the extent of all groups
+	std::vector<glm::vec4> spheres;
+	SceneGeometry::ComputeObjectSpheres(objects, spheres);
+	glm::vec3 extentMin(1e30f);
+	glm::vec3 extentMax(-1e30f);
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		GROUP& group = m_groups[g];
+		glm::vec3 minimum(1e30f);
+		glm::vec3 maximum(-1e30f);
+		for (size_t i = 0; i < group.objects.size(); i++)
+		{
+			const glm::vec4& sphere = spheres[group.objects[i]];
+			minimum = glm::min(minimum, glm::vec3(sphere) - sphere.w);
+			maximum = glm::max(maximum, glm::vec3(sphere) + sphere.w);
+		}
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < group.objects.size(); i++)
+		{
+			const glm::vec4& sphere = spheres[group.objects[i]];
+			radius = std::max(radius, glm::length(glm::vec3(sphere) - center) + sphere.w);
+		}
+		group.sphere = glm::vec4(center, radius);
+		extentMin = glm::min(extentMin, minimum);
+		extentMax = glm::max(extentMax, maximum);
+	}
+	float spacing = std::max(extentMax.x - extentMin.x, extentMax.z - extentMin.z) * 1.2f;
+	int columns = (int)ceil(sqrt((double)m_copies));
+	m_offsets.resize(m_copies);
+	for (int copy = 0; copy < m_copies; copy++)
+	{
+		m_offsets[copy] = glm::vec3((float)(copy % columns) * spacing, 0.0f, -(float)(copy / columns) * spacing);
+	}
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, g_VertexShader, "impostor.vert"));
+	shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, g_FragmentShader, "impostor.frag"));
+	m_program = ShaderUtils::LinkProgram(shaders, "impostor");
+	if (m_program == 0)
+	{
+		return(false);
+	}
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+	m_pShaderManager->setIntValue("impostorAtlas", g_AtlasUnit);
+	m_pShaderManager->setIntValue("impostorFrames", m_frames);
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+
+	// one layer per group, with the views in a square grid
+	int atlasSize = m_frames * frameSize;
+	int levels = 0;
+	while ((levels < g_MaxAtlasLevel) && ((frameSize >> (levels + 1)) >= 4))
+	{
+		levels++;
+	}
+	glGenTextures(1, &m_atlas);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlas);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, atlasSize, atlasSize, (GLsizei)m_groups.size(), 0,
+		GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	GLDebugOutput::LabelObject(GL_TEXTURE, m_atlas, "texture:impostor.atlas");
+
+	// the capture goes through the scene program and its state,
+	// which is put back afterwards
+	double startTime = glfwGetTime();
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4] = { 0 };
+	GLfloat previousClearColor[4] = { 0.0f };
+	GLint blendSource[2] = { 0 };
+	GLint blendDestination[2] = { 0 };
+	GLboolean bBlend = glIsEnabled(GL_BLEND);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClearColor);
+	glGetIntegerv(GL_BLEND_SRC_RGB, &blendSource[0]);
+	glGetIntegerv(GL_BLEND_SRC_ALPHA, &blendSource[1]);
+	glGetIntegerv(GL_BLEND_DST_RGB, &blendDestination[0]);
+	glGetIntegerv(GL_BLEND_DST_ALPHA, &blendDestination[1]);
+
+	GLuint framebuffer = 0;
+	GLuint depthBuffer = 0;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, atlasSize, atlasSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	GLDebugOutput::LabelObject(GL_FRAMEBUFFER, framebuffer, "framebuffer:impostor.capture");
+	GLDebugOutput::LabelObject(GL_RENDERBUFFER, depthBuffer, "renderbuffer:impostor.capture.depth");
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+
+	// the colors are written premultiplied by their alpha
+	glEnable(GL_BLEND);
+	glBlendFuncSeparate(GL_SRC_ALPHA, GL_ZERO, GL_ONE, GL_ZERO);
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		CaptureGroup(m_groups[g], (int)g, frameSize);
+	}
+	glFinish();
+
+	glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClearColor[0], previousClearColor[1], previousClearColor[2], previousClearColor[3]);
+	glBlendFuncSeparate(blendSource[0], blendDestination[0], blendSource[1], blendDestination[1]);
+	if (!bBlend)
+	{
+		glDisable(GL_BLEND);
+	}
+	glDeleteRenderbuffers(1, &depthBuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlas);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	m_captureSeconds = glfwGetTime() - startTime;
+
+	// the quads are made in the vertex stage, only their centers
+	// are streamed each frame
+	glGenVertexArrays(1, &m_vertexArray);
+	glGenBuffers(1, &m_centerBuffer);
+	glBindVertexArray(m_vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, m_centerBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (const void*)0);
+	glVertexAttribDivisor(0, 1);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	GLDebugOutput::LabelObject(GL_BUFFER, m_centerBuffer, "buffer:impostor.centers");
+
+	std::cout << "INFO: Captured " << m_groups.size() << " impostors of " << m_frames * m_frames
+		<< " views in " << m_captureSeconds * 1000.0 << " ms" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  CaptureGroup()
+ *
+ *  This method draws the objects of a group into every cell
+ *  of its layer, each cell seen from the direction at the
+ *  center of the cell in the octahedral map, through the
+ *  capture framebuffer the caller has bound.
+ ***********************************************************/
+void ImpostorRenderer::CaptureGroup(const GROUP& group, int layer, int frameSize)
+{
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = m_pSceneManager->GetSceneObjects();
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_atlas, 0, layer);
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cerr << "WARNING: impostor capture framebuffer is incomplete, skipping " << group.name << std::endl;
+		return;
+	}
+	glViewport(0, 0, m_frames * frameSize, m_frames * frameSize);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	glm::vec3 center(group.sphere);
+	float radius = group.sphere.w;
+	m_pShaderManager->setMat4Value("projection", glm::ortho(-radius, radius, -radius, radius, radius * 0.5f, radius * 3.5f));
+	for (int y = 0; y < m_frames; y++)
+	{
+		for (int x = 0; x < m_frames; x++)
+		{
+			glm::vec2 point = (glm::vec2((float)x, (float)y) + 0.5f) / (float)m_frames * 2.0f - 1.0f;
+			glm::vec3 direction = DecodeDirection(point);
+			glm::vec3 up = (fabsf(direction.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+			glm::vec3 eye = center + direction * (radius * 2.0f);
+			m_pShaderManager->setMat4Value("view", glm::lookAt(eye, center, up));
+			m_pShaderManager->setVec3Value("viewPosition", eye);
+
+			glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+			for (size_t i = 0; i < group.objects.size(); i++)
+			{
+				m_pSceneManager->DrawSceneObject(objects[group.objects[i]]);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees every GL object of the renderer.
+ ***********************************************************/
+void ImpostorRenderer::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	if (m_atlas != 0)
+	{
+		glDeleteTextures(1, &m_atlas);
+		m_atlas = 0;
+	}
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	if (m_centerBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_centerBuffer);
+		m_centerBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method draws the objects outside the groups, then
+ *  every copy of a group inside the frustum, in full when
+ *  its sphere comes closer than the distance, and the rest
+ *  as one instanced draw of impostors per group.
+ ***********************************************************/
+void ImpostorRenderer::Render()
+{
+	if (m_program == 0)
+	{
+		return;
+	}
+
+	glm::mat4 viewProjection = m_pViewManager->GetProjectionMatrix() * m_pViewManager->GetViewMatrix();
+	glm::vec4 planes[6];
+	VisibilityCache::ExtractFrustumPlanes(viewProjection, planes);
+	glm::vec3 cameraPosition;
+	glm::vec3 cameraFront;
+	float zoom = 0.0f;
+	m_pViewManager->GetCameraPose(cameraPosition, cameraFront, zoom);
+
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->BeginPass("impostors");
+	}
+
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = m_pSceneManager->GetSceneObjects();
+	for (size_t i = 0; i < m_others.size(); i++)
+	{
+		m_pSceneManager->DrawSceneObject(objects[m_others[i]]);
+	}
+	m_draws += (long long)m_others.size();
+	m_triangles += m_otherTriangles;
+	m_fullDraws += (long long)m_others.size();
+	m_fullTriangles += m_otherTriangles;
+
+	m_centers.clear();
+	m_groupCounts.assign(m_groups.size(), 0);
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		const GROUP& group = m_groups[g];
+		for (size_t copy = 0; copy < m_offsets.size(); copy++)
+		{
+			glm::vec3 center = glm::vec3(group.sphere) + m_offsets[copy];
+			bool bCulled = false;
+			for (int p = 0; (p < 6) && !bCulled; p++)
+			{
+				bCulled = (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -group.sphere.w);
+			}
+			if (bCulled)
+			{
+				continue;
+			}
+			m_fullDraws += (long long)group.objects.size();
+			m_fullTriangles += group.triangleCount;
+
+			if (glm::length(center - cameraPosition) - group.sphere.w >= m_distance)
+			{
+				m_centers.push_back(center);
+				m_groupCounts[g]++;
+				continue;
+			}
+			for (size_t i = 0; i < group.objects.size(); i++)
+			{
+				m_moved = objects[group.objects[i]];
+				m_moved.position += m_offsets[copy];
+				m_pSceneManager->DrawSceneObject(m_moved);
+			}
+			m_draws += (long long)group.objects.size();
+			m_triangles += group.triangleCount;
+			m_nearCopies++;
+		}
+	}
+
+	if (!m_centers.empty())
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, m_centerBuffer);
+		glBufferData(GL_ARRAY_BUFFER, m_centers.size() * sizeof(glm::vec3), &m_centers[0], GL_STREAM_DRAW);
+
+		GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+		m_pShaderManager->setMat4Value("view", m_pViewManager->GetViewMatrix());
+		m_pShaderManager->setMat4Value("projection", m_pViewManager->GetProjectionMatrix());
+		m_pShaderManager->setVec3Value("viewPosition", cameraPosition);
+		glActiveTexture(GL_TEXTURE0 + g_AtlasUnit);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, m_atlas);
+		glBindVertexArray(m_vertexArray);
+
+		// each group starts the centers attribute at its own range
+		size_t first = 0;
+		for (size_t g = 0; g < m_groups.size(); g++)
+		{
+			if (m_groupCounts[g] == 0)
+			{
+				continue;
+			}
+			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (const void*)(first * sizeof(glm::vec3)));
+			m_pShaderManager->setFloatValue("impostorRadius", m_groups[g].sphere.w);
+			m_pShaderManager->setIntValue("impostorLayer", (int)g);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, m_groupCounts[g]);
+			m_draws++;
+			m_triangles += 2 * (long long)m_groupCounts[g];
+			first += m_groupCounts[g];
+		}
+		m_impostors += (long long)m_centers.size();
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glActiveTexture(GL_TEXTURE0);
+		ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+	}
+
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->EndPass();
+	}
+	m_renderedFrames++;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the copies drawn in full and as
+ *  impostors per frame, and the draws and triangles saved
+ *  against drawing every copy in the frustum in full.
+ ***********************************************************/
+void ImpostorRenderer::PrintReport() const
+{
+	if ((m_renderedFrames == 0) || m_groups.empty())
+	{
+		return;
+	}
+
+	size_t groupObjects = 0;
+	for (size_t g = 0; g < m_groups.size(); g++)
+	{
+		groupObjects += m_groups[g].objects.size();
+	}
+	double frames = (double)m_renderedFrames;
+	double drawReduction = (m_fullDraws > 0) ? 100.0 * (1.0 - (double)m_draws / (double)m_fullDraws) : 0.0;
+	double triangleReduction = (m_fullTriangles > 0) ? 100.0 * (1.0 - (double)m_triangles / (double)m_fullTriangles) : 0.0;
+
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << "INFO: Impostors: " << m_groups.size() << " composite objects x " << m_offsets.size()
+		<< " copies (" << groupObjects * m_offsets.size() << " objects), " << m_frames * m_frames
+		<< " views each, captured in " << m_captureSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << "INFO: Impostors per frame over " << m_renderedFrames << " frames: "
+		<< (double)m_nearCopies / frames << " copies in full, " << (double)m_impostors / frames
+		<< " as impostors beyond " << m_distance << " units" << std::endl;
+	std::cout << "INFO: Impostors per frame: " << (double)m_draws / frames << " draws and "
+		<< (double)m_triangles / frames << " triangles, against " << (double)m_fullDraws / frames
+		<< " draws and " << (double)m_fullTriangles / frames << " triangles in full ("
+		<< drawReduction << "% fewer draws, " << triangleReduction << "% fewer triangles)" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
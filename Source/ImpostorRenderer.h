@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// impostorrenderer.h
+// ============
+// draw distant composite objects as pre-rendered camera facing quads
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+#include "ViewManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ImpostorRenderer
+ *
+ *  This class captures each composite object of the scene,
+ *  like the bottle or the speaker, from a grid of directions
+ *  spread over the sphere with an octahedral mapping, into
+ *  one layer of a texture array at load time. The composite
+ *  objects can be repeated in a grid of copies. Each frame
+ *  the copies close to the camera are drawn in full, and the
+ *  ones further than a distance are drawn as quads showing
+ *  the view captured nearest to the direction of the camera,
+ *  with one instanced draw per composite object.
+ ***********************************************************/
+class ImpostorRenderer
+{
+public:
+	// constructor
+	ImpostorRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager);
+	// destructor
+	~ImpostorRenderer();
+
+	// repeat the composite objects in a square grid of copies,
+	// and draw them as impostors beyond a distance; set before
+	// Initialize()
+	void SetCopies(int copies) { m_copies = copies; }
+	void SetDistance(float distance) { m_distance = distance; }
+	// group the draw list, build the program and capture the
+	// atlas with frames x frames views of frameSize pixels each;
+	// call with the scene program current and its lights set
+	bool Initialize(int frames = 12, int frameSize = 64);
+	// free the program, the atlas and the buffers
+	void Destroy();
+
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+	// draw the scene, with the far copies as impostors
+	void Render();
+
+	// print the draws and triangles per frame against drawing
+	// every copy in full
+	void PrintReport() const;
+
+private:
+	// the objects of one composite object
+	struct GROUP
+	{
+		std::string name;
+		std::vector<int> objects;
+		// world bounding sphere of all its objects
+		glm::vec4 sphere;
+		// triangles of all its objects in full
+		long long triangleCount;
+	};
+
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+	GpuProfiler* m_pGpuProfiler;
+
+	GLuint m_program;
+	GLuint m_atlas;
+	GLuint m_vertexArray;
+	GLuint m_centerBuffer;
+	int m_frames;
+	int m_copies;
+	float m_distance;
+	std::vector<GROUP> m_groups;
+	// objects outside every group, drawn once
+	std::vector<int> m_others;
+	long long m_otherTriangles;
+	// offsets of the copies
+	std::vector<glm::vec3> m_offsets;
+	// triangles of each basic mesh
+	long long m_meshTriangles[SceneManager::MESH_COUNT];
+	// kept between frames so drawing does not allocate
+	std::vector<glm::vec3> m_centers;
+	std::vector<GLsizei> m_groupCounts;
+	SceneManager::SCENE_OBJECT m_moved;
+
+	// render every view of a group into its layer of the atlas,
+	// with the capture framebuffer bound
+	void CaptureGroup(const GROUP& group, int layer, int frameSize);
+
+	double m_captureSeconds;
+	long m_renderedFrames;
+	long long m_draws;
+	long long m_triangles;
+	long long m_fullDraws;
+	long long m_fullTriangles;
+	long long m_impostors;
+	long long m_nearCopies;
+};
@@ -0,0 +1,606 @@
+///////////////////////////////////////////////////////////////////////////////
+// LooseOctree.cpp
+// ===============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `LooseOctree` class, a spatial index for bounding
+// spheres that move every frame.
+//
+// FUNCTIONALITY:
+// - Place every sphere in the deepest node whose cell is at least as
+//   wide as its diameter, in the cell that holds its center. Such a node
+//   holds the sphere within its loose bounds, the cell grown by half its
+//   size on every side.
+// - Update a moved sphere in place while it still fits the loose bounds
+//   of its node, which allows it to drift up to half a cell out of its
+//   cell; only then unlink it and find its node again from the root.
+// - Keep the objects of a node in an intrusive doubly linked list, so
+//   linking and unlinking take constant time, and free the nodes that
+//   become empty.
+// - Take nodes and objects from pools with free lists that only grow.
+// - Answer frustum, sphere, box and ray queries by walking the nodes
+//   whose loose bounds touch the shape. Nodes that lie completely inside
+//   a frustum, sphere or box add all objects below them untested.
+//
+// NOTES:
+// Objects with their center outside the root cell stay in the root, and
+// the root is always visited by the queries, so nothing is lost when the
+// bounds are too small, it only gets slower. A sphere that shrinks stays
+// in its node until it leaves the loose bounds.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "LooseOctree.h"
+#include "SceneGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+
+/***********************************************************
+ *  QUERY
+ *
+ *  The shape of a query, with the tests of a loose node
+ *  box and of an object sphere against it.
+ ***********************************************************/
+struct LooseOctree::QUERY
+{
+	enum SHAPE
+	{
+		SHAPE_FRUSTUM = 0,
+		SHAPE_SPHERE,
+		SHAPE_BOX,
+		SHAPE_RAY
+	};
+
+	// results of the box test
+	enum OVERLAP
+	{
+		OVERLAP_OUTSIDE = 0,
+		OVERLAP_PARTIAL,
+		OVERLAP_INSIDE
+	};
+
+	SHAPE shape;
+	glm::vec4 planes[6];
+	glm::vec4 sphere;
+	glm::vec3 minimum;
+	glm::vec3 maximum;
+	glm::vec3 origin;
+	glm::vec3 direction;
+	glm::vec3 inverseDirection;
+	float maxDistance;
+
+	// squared distance from a point to a box, zero inside
+	static float BoxDistance2(const glm::vec3& point, const glm::vec3& boxMin, const glm::vec3& boxMax)
+	{
+		glm::vec3 closest = glm::clamp(point, boxMin, boxMax);
+		return(glm::dot(point - closest, point - closest));
+	}
+
+	OVERLAP TestBox(const glm::vec3& boxMin, const glm::vec3& boxMax) const
+	{
+		switch (shape)
+		{
+		case SHAPE_FRUSTUM:
+			{
+				OVERLAP overlap = OVERLAP_INSIDE;
+				for (int i = 0; i < 6; i++)
+				{
+					// corners furthest along and against the normal
+					glm::vec3 normal(planes[i]);
+					glm::vec3 positive(normal.x >= 0.0f ? boxMax.x : boxMin.x,
+						normal.y >= 0.0f ? boxMax.y : boxMin.y, normal.z >= 0.0f ? boxMax.z : boxMin.z);
+					glm::vec3 negative(normal.x >= 0.0f ? boxMin.x : boxMax.x,
+						normal.y >= 0.0f ? boxMin.y : boxMax.y, normal.z >= 0.0f ? boxMin.z : boxMax.z);
+					if (glm::dot(normal, positive) + planes[i].w < 0.0f)
+					{
+						return(OVERLAP_OUTSIDE);
+					}
+					if (glm::dot(normal, negative) + planes[i].w < 0.0f)
+					{
+						overlap = OVERLAP_PARTIAL;
+					}
+				}
+				return(overlap);
+			}
+
+		case SHAPE_SPHERE:
+			{
+				glm::vec3 center(sphere);
+				float radius2 = sphere.w * sphere.w;
+				if (BoxDistance2(center, boxMin, boxMax) > radius2)
+				{
+					return(OVERLAP_OUTSIDE);
+				}
+				glm::vec3 farthest = glm::max(glm::abs(center - boxMin), glm::abs(center - boxMax));
+				return((glm::dot(farthest, farthest) <= radius2) ? OVERLAP_INSIDE : OVERLAP_PARTIAL);
+			}
+
+		case SHAPE_BOX:
+			if ((boxMax.x < minimum.x) || (boxMin.x > maximum.x) ||
+				(boxMax.y < minimum.y) || (boxMin.y > maximum.y) ||
+				(boxMax.z < minimum.z) || (boxMin.z > maximum.z))
+			{
+				return(OVERLAP_OUTSIDE);
+			}
+			if ((boxMin.x >= minimum.x) && (boxMax.x <= maximum.x) &&
+				(boxMin.y >= minimum.y) && (boxMax.y <= maximum.y) &&
+				(boxMin.z >= minimum.z) && (boxMax.z <= maximum.z))
+			{
+				return(OVERLAP_INSIDE);
+			}
+			return(OVERLAP_PARTIAL);
+
+		case SHAPE_RAY:
+			{
+				// slab test clipped to the length of the ray
+				glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+				glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+				glm::vec3 tNear = glm::min(t0, t1);
+				glm::vec3 tFar = glm::max(t0, t1);
+				float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+				float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+				return((enter <= exit) ? OVERLAP_PARTIAL : OVERLAP_OUTSIDE);
+			}
+		}
+		return(OVERLAP_PARTIAL);
+	}
+
+	bool TestSphere(const glm::vec4& object) const
+	{
+		glm::vec3 center(object);
+		switch (shape)
+		{
+		case SHAPE_FRUSTUM:
+			for (int i = 0; i < 6; i++)
+			{
+				if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -object.w)
+				{
+					return(false);
+				}
+			}
+			return(true);
+
+		case SHAPE_SPHERE:
+			{
+				glm::vec3 offset = center - glm::vec3(sphere);
+				float reach = object.w + sphere.w;
+				return(glm::dot(offset, offset) <= reach * reach);
+			}
+
+		case SHAPE_BOX:
+			return(BoxDistance2(center, minimum, maximum) <= object.w * object.w);
+
+		case SHAPE_RAY:
+			{
+				float t = glm::clamp(glm::dot(center - origin, direction), 0.0f, maxDistance);
+				glm::vec3 offset = center - (origin + direction * t);
+				return(glm::dot(offset, offset) <= object.w * object.w);
+			}
+		}
+		return(true);
+	}
+};
+
+/***********************************************************
+ *  LooseOctree()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LooseOctree::LooseOctree(const glm::vec3& center, float halfSize, int maxDepth)
+{
+	m_freeNode = -1;
+	m_freeObject = -1;
+	m_maxDepth = maxDepth;
+	m_objectCount = 0;
+	m_nodeCount = 0;
+	m_inPlaceUpdates = 0;
+	m_reinsertions = 0;
+	m_root = AllocateNode(center, halfSize, 0, -1);
+}
+
+/***********************************************************
+ *  ~LooseOctree()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LooseOctree::~LooseOctree()
+{
+}
+
+/***********************************************************
+ *  AllocateNode()
+ *
+ *  This method takes a node from the free list, or grows
+ *  the pool when the list is empty.
+ ***********************************************************/
+int LooseOctree::AllocateNode(const glm::vec3& center, float halfSize, int depth, int parent)
+{
+	int index = m_freeNode;
+	if (index >= 0)
+	{
+		m_freeNode = m_nodes[index].nextFree;
+	}
+	else
+	{
+		index = (int)m_nodes.size();
+		m_nodes.push_back(NODE());
+	}
+
+	NODE& node = m_nodes[index];
+	node.center = center;
+	node.halfSize = halfSize;
+	node.depth = depth;
+	node.parent = parent;
+	for (int i = 0; i < 8; i++)
+	{
+		node.children[i] = -1;
+	}
+	node.childCount = 0;
+	node.firstObject = -1;
+	node.nextFree = -1;
+	m_nodeCount++;
+	return(index);
+}
+
+/***********************************************************
+ *  FreeNode()
+ *
+ *  This method returns a node to the free list.
+ ***********************************************************/
+void LooseOctree::FreeNode(int index)
+{
+	m_nodes[index].nextFree = m_freeNode;
+	m_freeNode = index;
+	m_nodeCount--;
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes every object and every node but a
+ *  new root of the same size.
+ ***********************************************************/
+void LooseOctree::Clear()
+{
+	glm::vec3 center = m_nodes[m_root].center;
+	float halfSize = m_nodes[m_root].halfSize;
+
+	m_nodes.clear();
+	m_objects.clear();
+	m_freeNode = -1;
+	m_freeObject = -1;
+	m_objectCount = 0;
+	m_nodeCount = 0;
+	m_root = AllocateNode(center, halfSize, 0, -1);
+}
+
+/***********************************************************
+ *  FitsNode()
+ *
+ *  This method returns true when a sphere lies inside the
+ *  loose bounds of a node; the root takes everything.
+ ***********************************************************/
+bool LooseOctree::FitsNode(const NODE& node, const glm::vec4& sphere) const
+{
+	if (node.parent < 0)
+	{
+		return(true);
+	}
+	glm::vec3 reach = glm::abs(glm::vec3(sphere) - node.center) + sphere.w;
+	float loose = node.halfSize * 2.0f;
+	return((reach.x <= loose) && (reach.y <= loose) && (reach.z <= loose));
+}
+
+/***********************************************************
+ *  FindNode()
+ *
+ *  This method walks down from the root along the cells
+ *  that hold the center of a sphere, creating the missing
+ *  nodes, until the child cells get smaller than the radius.
+ ***********************************************************/
+int LooseOctree::FindNode(const glm::vec4& sphere)
+{
+	glm::vec3 center(sphere);
+	int index = m_root;
+
+	// objects outside the root cell stay in the root
+	glm::vec3 offset = glm::abs(center - m_nodes[m_root].center);
+	float rootSize = m_nodes[m_root].halfSize;
+	if ((offset.x > rootSize) || (offset.y > rootSize) || (offset.z > rootSize))
+	{
+		return(index);
+	}
+
+	while (true)
+	{
+		// the node reference is not kept across AllocateNode()
+		const NODE& node = m_nodes[index];
+		float childSize = node.halfSize * 0.5f;
+		if ((node.depth >= m_maxDepth) || (sphere.w > childSize))
+		{
+			return(index);
+		}
+
+		int octant = ((center.x >= node.center.x) ? 1 : 0) |
+			((center.y >= node.center.y) ? 2 : 0) | ((center.z >= node.center.z) ? 4 : 0);
+		int child = node.children[octant];
+		if (child < 0)
+		{
+			glm::vec3 childCenter = node.center + glm::vec3((octant & 1) ? childSize : -childSize,
+				(octant & 2) ? childSize : -childSize, (octant & 4) ? childSize : -childSize);
+			child = AllocateNode(childCenter, childSize, node.depth + 1, index);
+			m_nodes[index].children[octant] = child;
+			m_nodes[index].childCount++;
+		}
+		index = child;
+	}
+}
+
+/***********************************************************
+ *  LinkObject()
+ *
+ *  This method puts an object at the head of the list of a
+ *  node.
+ ***********************************************************/
+void LooseOctree::LinkObject(int handle, int node)
+{
+	OBJECT& object = m_objects[handle];
+	object.node = node;
+	object.previous = -1;
+	object.next = m_nodes[node].firstObject;
+	if (object.next >= 0)
+	{
+		m_objects[object.next].previous = handle;
+	}
+	m_nodes[node].firstObject = handle;
+}
+
+/***********************************************************
+ *  UnlinkObject()
+ *
+ *  This method takes an object out of the list of its node
+ *  and frees the node, and then its parents, while they are
+ *  left without objects and children.
+ ***********************************************************/
+void LooseOctree::UnlinkObject(int handle)
+{
+	OBJECT& object = m_objects[handle];
+	int index = object.node;
+	if (object.previous >= 0)
+	{
+		m_objects[object.previous].next = object.next;
+	}
+	else
+	{
+		m_nodes[index].firstObject = object.next;
+	}
+	if (object.next >= 0)
+	{
+		m_objects[object.next].previous = object.previous;
+	}
+	object.node = -1;
+
+	while ((index != m_root) && (m_nodes[index].firstObject < 0) && (m_nodes[index].childCount == 0))
+	{
+		NODE& parent = m_nodes[m_nodes[index].parent];
+		for (int i = 0; i < 8; i++)
+		{
+			if (parent.children[i] == index)
+			{
+				parent.children[i] = -1;
+			}
+		}
+		parent.childCount--;
+		int parentIndex = m_nodes[index].parent;
+		FreeNode(index);
+		index = parentIndex;
+	}
+}
+
+/***********************************************************
+ *  Insert()
+ *
+ *  This method adds a sphere and returns the handle used to
+ *  update or remove it.
+ ***********************************************************/
+int LooseOctree::Insert(const glm::vec4& sphere, int userValue)
+{
+	int handle = m_freeObject;
+	if (handle >= 0)
+	{
+		m_freeObject = m_objects[handle].next;
+	}
+	else
+	{
+		handle = (int)m_objects.size();
+		m_objects.push_back(OBJECT());
+	}
+
+	m_objects[handle].sphere = sphere;
+	m_objects[handle].userValue = userValue;
+	LinkObject(handle, FindNode(sphere));
+	m_objectCount++;
+	return(handle);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method stores the new sphere of an object, and
+ *  moves it to another node only when it left the loose
+ *  bounds of its own.
+ ***********************************************************/
+void LooseOctree::Update(int handle, const glm::vec4& sphere)
+{
+	OBJECT& object = m_objects[handle];
+	object.sphere = sphere;
+	if (FitsNode(m_nodes[object.node], sphere))
+	{
+		m_inPlaceUpdates++;
+		return;
+	}
+
+	UnlinkObject(handle);
+	LinkObject(handle, FindNode(sphere));
+	m_reinsertions++;
+}
+
+/***********************************************************
+ *  Remove()
+ *
+ *  This method takes an object out of the tree and returns
+ *  its handle to the free list.
+ ***********************************************************/
+void LooseOctree::Remove(int handle)
+{
+	UnlinkObject(handle);
+	m_objects[handle].next = m_freeObject;
+	m_freeObject = handle;
+	m_objectCount--;
+}
+
+/***********************************************************
+ *  InsertSceneObjects()
+ *
+ *  This method adds the world bounding sphere of every
+ *  object of the draw list.
+ ***********************************************************/
+void LooseOctree::InsertSceneObjects(const std::vector<SceneManager::SCENE_OBJECT>& objects)
+{
+	std::vector<glm::vec4> spheres;
+	SceneGeometry::ComputeObjectSpheres(objects, spheres);
+	for (size_t i = 0; i < spheres.size(); i++)
+	{
+		Insert(spheres[i], (int)i);
+	}
+}
+
+/***********************************************************
+ *  QueryNode()
+ *
+ *  This method tests the loose bounds of a node against the
+ *  query, then its objects, and descends into its children.
+ ***********************************************************/
+void LooseOctree::QueryNode(int index, const QUERY& query, std::vector<int>& results) const
+{
+	const NODE& node = m_nodes[index];
+	if (index != m_root)
+	{
+		float loose = node.halfSize * 2.0f;
+		QUERY::OVERLAP overlap = query.TestBox(node.center - loose, node.center + loose);
+		if (overlap == QUERY::OVERLAP_OUTSIDE)
+		{
+			return;
+		}
+		if (overlap == QUERY::OVERLAP_INSIDE)
+		{
+			CollectNode(index, results);
+			return;
+		}
+	}
+
+	for (int handle = node.firstObject; handle >= 0; handle = m_objects[handle].next)
+	{
+		if (query.TestSphere(m_objects[handle].sphere))
+		{
+			results.push_back(m_objects[handle].userValue);
+		}
+	}
+	for (int i = 0; i < 8; i++)
+	{
+		if (node.children[i] >= 0)
+		{
+			QueryNode(node.children[i], query, results);
+		}
+	}
+}
+
+/***********************************************************
+ *  CollectNode()
+ *
+ *  This method adds the objects of a node and of all nodes
+ *  below it.
+ ***********************************************************/
+void LooseOctree::CollectNode(int index, std::vector<int>& results) const
+{
+	const NODE& node = m_nodes[index];
+	for (int handle = node.firstObject; handle >= 0; handle = m_objects[handle].next)
+	{
+		results.push_back(m_objects[handle].userValue);
+	}
+	for (int i = 0; i < 8; i++)
+	{
+		if (node.children[i] >= 0)
+		{
+			CollectNode(node.children[i], results);
+		}
+	}
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method finds the spheres inside the planes, which
+ *  face inwards like those of ExtractFrustumPlanes().
+ ***********************************************************/
+void LooseOctree::QueryFrustum(const glm::vec4 planes[6], std::vector<int>& results) const
+{
+	QUERY query;
+	query.shape = QUERY::SHAPE_FRUSTUM;
+	for (int i = 0; i < 6; i++)
+	{
+		query.planes[i] = planes[i];
+	}
+	QueryNode(m_root, query, results);
+}
+
+/***********************************************************
+ *  QuerySphere()
+ *
+ *  This method finds the spheres that overlap a sphere.
+ ***********************************************************/
+void LooseOctree::QuerySphere(const glm::vec4& sphere, std::vector<int>& results) const
+{
+	QUERY query;
+	query.shape = QUERY::SHAPE_SPHERE;
+	query.sphere = sphere;
+	QueryNode(m_root, query, results);
+}
+
+/***********************************************************
+ *  QueryBox()
+ *
+ *  This method finds the spheres that overlap a box.
+ ***********************************************************/
+void LooseOctree::QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, std::vector<int>& results) const
+{
+	QUERY query;
+	query.shape = QUERY::SHAPE_BOX;
+	query.minimum = minimum;
+	query.maximum = maximum;
+	QueryNode(m_root, query, results);
+}
+
+/***********************************************************
+ *  QueryRay()
+ *
+ *  This method finds the spheres that a ray segment hits,
+ *  in no particular order.
+ ***********************************************************/
+void LooseOctree::QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& results) const
+{
+	QUERY query;
+	query.shape = QUERY::SHAPE_RAY;
+	query.origin = origin;
+	query.direction = direction;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// a huge finite value keeps 0 * inverse out of NaN
+		query.inverseDirection[axis] = (fabsf(direction[axis]) > 1.0e-12f) ? 1.0f / direction[axis] :
+			((direction[axis] < 0.0f) ? -1.0e30f : 1.0e30f);
+	}
+	query.maxDistance = maxDistance;
+	QueryNode(m_root, query, results);
+}
@@ -0,0 +1,125 @@
+///////////////////////////////////////////////////////////////////////////////
+// looseoctree.h
+// ============
+// spatial index of moving bounding spheres
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LooseOctree
+ *
+ *  This class sorts bounding spheres into an octree whose
+ *  nodes hold everything that fits in their cell grown to
+ *  twice its size. The depth of an object follows from its
+ *  radius and the cell from its center, and an object that
+ *  moves but still fits the loose bounds of its node is
+ *  updated in place, without touching the tree. Objects are
+ *  kept in intrusive lists, and the nodes and objects come
+ *  from pools with free lists, so moving objects allocate
+ *  nothing once the pools have grown.
+ ***********************************************************/
+class LooseOctree
+{
+public:
+	// constructor; the root cell is the cube around center, and
+	// nodes are not split below maxDepth
+	LooseOctree(const glm::vec3& center, float halfSize, int maxDepth = 8);
+	// destructor
+	~LooseOctree();
+
+	// add a sphere (center in xyz, radius in w) and return its
+	// handle; queries return the user value
+	int Insert(const glm::vec4& sphere, int userValue);
+	// move a sphere; free unless it leaves the loose bounds of its node
+	void Update(int handle, const glm::vec4& sphere);
+	void Remove(int handle);
+	// remove every object and node
+	void Clear();
+
+	// add the spheres of the scene draw list with the object
+	// index as the user value
+	void InsertSceneObjects(const std::vector<SceneManager::SCENE_OBJECT>& objects);
+
+	// the queries append the user values of the objects whose
+	// sphere touches the shape
+	void QueryFrustum(const glm::vec4 planes[6], std::vector<int>& results) const;
+	void QuerySphere(const glm::vec4& sphere, std::vector<int>& results) const;
+	void QueryBox(const glm::vec3& minimum, const glm::vec3& maximum, std::vector<int>& results) const;
+	// spheres hit by the ray within maxDistance; the direction
+	// must be normalized
+	void QueryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance, std::vector<int>& results) const;
+
+	int GetObjectCount() const { return(m_objectCount); }
+	int GetNodeCount() const { return(m_nodeCount); }
+	// updates that stayed in their node and those that moved
+	long long GetInPlaceUpdates() const { return(m_inPlaceUpdates); }
+	long long GetReinsertions() const { return(m_reinsertions); }
+
+private:
+	struct NODE
+	{
+		// the cell, the loose bounds are twice its size
+		glm::vec3 center;
+		float halfSize;
+		int depth;
+		int parent;
+		int children[8];
+		int childCount;
+		// first object of the intrusive list, -1 for none
+		int firstObject;
+		// next free node while the node is in the free list
+		int nextFree;
+	};
+
+	struct OBJECT
+	{
+		glm::vec4 sphere;
+		int userValue;
+		// node and neighbours in its list; the node is -1 while the
+		// object is in the free list, and next links the free list
+		int node;
+		int previous;
+		int next;
+	};
+
+	// the part of a query that tests one node
+	struct QUERY;
+
+	std::vector<NODE> m_nodes;
+	std::vector<OBJECT> m_objects;
+	int m_freeNode;
+	int m_freeObject;
+	int m_root;
+	int m_maxDepth;
+	int m_objectCount;
+	int m_nodeCount;
+	long long m_inPlaceUpdates;
+	long long m_reinsertions;
+
+	// take a node from the pool or return one to it
+	int AllocateNode(const glm::vec3& center, float halfSize, int depth, int parent);
+	void FreeNode(int index);
+
+	// find or create the node for a sphere, starting at the root
+	int FindNode(const glm::vec4& sphere);
+	// true when the sphere fits in the loose bounds of a node
+	bool FitsNode(const NODE& node, const glm::vec4& sphere) const;
+	// add an object to the list of a node, or take it out and
+	// free the node and its empty parents
+	void LinkObject(int handle, int node);
+	void UnlinkObject(int handle);
+
+	// walk the nodes whose loose bounds the query touches
+	void QueryNode(int index, const QUERY& query, std::vector<int>& results) const;
+	// add every object below a node without testing them
+	void CollectNode(int index, std::vector<int>& results) const;
+};
@@ -31,6 +31,16 @@
 
 #include <iostream>         // error handling and output
 #include <cstdlib>          // EXIT_FAILURE
+#include <cstdio>           // sscanf
+#include <cstring>          // command line option parsing
+#include <string>
+#include <thread>           // hardware_concurrency
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cmath>
 
 #include <GL/glew.h>        // GLEW library
 #include "GLFW/glfw3.h"     // GLFW library
@@ -44,6 +54,31 @@
 #include "ViewManager.h"
 #include "ShapeMeshes.h"
 #include "ShaderManager.h"
+#include "FrameProfiler.h"
+#include "GLDebugOutput.h"
+#include "GpuProfiler.h"
+#include "DrawCostProfiler.h"
+#include "GLTrace.h"
+#include "GLReplay.h"
+#include "FrameCapture.h"
+#include "TiledScreenshot.h"
+#include "RenderServer.h"
+#include "RenderFarm.h"
+#include "MultiViewRenderer.h"
+#include "FrameGraph.h"
+#include "PostProcessStack.h"
+#include "SSAOPass.h"
+#include "BloomPass.h"
+#include "GpuCuller.h"
+#include "VisibilityCache.h"
+#include "LooseOctree.h"
+#include "ObjectPicker.h"
+#include "IdBufferPicker.h"
+#include "MeshletRenderer.h"
+#include "MeshSimplifier.h"
+#include "ImpostorRenderer.h"
+#include "PathTracer.h"
+#include "SoftwareRasterizer.h"
 
 // Namespace for declaring global variables
 namespace
@@ -51,6 +86,10 @@ namespace
 	// Macro for window title
 	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones"; 
 
+	// GLSL files of the scene program
+	const char* const VERTEX_SHADER_FILE = "../../Utilities/shaders/vertexShader.glsl";
+	const char* const FRAGMENT_SHADER_FILE = "../../Utilities/shaders/fragmentShader.glsl";
+
 	// Main GLFW window
 	GLFWwindow* g_Window = nullptr;
 
@@ -60,6 +99,153 @@ namespace
 	ShaderManager* g_ShaderManager = nullptr;
 	// view manager object for managing the 3D view setup and projection to 2D
 	ViewManager* g_ViewManager = nullptr;
+	// frame profiler object for detecting frame hitches
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// debug output object for counting driver messages
+	GLDebugOutput* g_DebugOutput = nullptr;
+	// GPU profiler object for measuring each render pass
+	GpuProfiler* g_GpuProfiler = nullptr;
+	// optional profiler for the GPU cost of each draw
+	DrawCostProfiler* g_DrawCostProfiler = nullptr;
+	// true once the draw cost ranking has been printed
+	bool g_bDrawCostReported = false;
+	// optional writer of the rendered frames to image files
+	FrameCapture* g_FrameCapture = nullptr;
+	// optional renderer of several cameras in one pass
+	MultiViewRenderer* g_MultiView = nullptr;
+	// optional graph that runs the render passes of a frame
+	FrameGraph* g_FrameGraph = nullptr;
+	// optional post effects fused into the frame graph
+	PostProcessStack* g_PostStack = nullptr;
+	// optional ambient occlusion before the post effects
+	SSAOPass* g_SSAO = nullptr;
+	// optional bloom of the HDR color before the post effects
+	BloomPass* g_Bloom = nullptr;
+	// optional culling and draw list generation on the GPU
+	GpuCuller* g_GpuCuller = nullptr;
+	// optional frustum culling that reuses earlier results
+	VisibilityCache* g_VisibilityCache = nullptr;
+	// optional selection of the object under a left click
+	ObjectPicker* g_ObjectPicker = nullptr;
+	// optional picking from an object id target of the scene pass
+	IdBufferPicker* g_IdBufferPicker = nullptr;
+	// optional drawing from culled meshlets
+	MeshletRenderer* g_MeshletRenderer = nullptr;
+	// optional levels of detail of the meshlet meshes
+	MeshSimplifier* g_MeshSimplifier = nullptr;
+	// optional impostors for the distant composite objects
+	ImpostorRenderer* g_ImpostorRenderer = nullptr;
+
+	// options that can be changed from the command line
+	struct APP_OPTIONS
+	{
+		// a frame hitches above this multiple of the median frame time
+		float hitchFactor = 2.0f;
+		// or above this absolute frame time, when greater than zero
+		double hitchMs = 0.0;
+		// file that receives the hitched frame snapshots
+		std::string hitchLog = "frame_hitches.log";
+		// seconds between CPU/GPU statistics reports, 0 disables them
+		double statsInterval = 0.0;
+		// frames of per-draw GPU costs to collect, 0 disables it
+		long drawCostFrames = 0;
+		// file that receives the GL call trace, empty disables capture
+		std::string captureFile;
+		// frames recorded into the trace after the scene setup
+		long captureFrames = 100;
+		// trace file to replay instead of running the application
+		std::string replayFile;
+		// passes over the recorded frames during replay
+		int replayLoops = 10;
+		// prefix of the image sequence files, empty disables it
+		std::string recordPrefix;
+		// format of the image sequence
+		ImageWriter::IMAGE_FORMAT recordFormat = ImageWriter::IMAGE_PNG;
+		// frames to write before closing, 0 records until closed
+		long recordFrames = 0;
+		// file that receives a tiled still at startup, empty disables it
+		std::string screenshotFile;
+		// size of the tiled still
+		int screenshotWidth = 8000;
+		int screenshotHeight = 6400;
+		// edge length of a screenshot tile
+		int tileSize = 1024;
+		// socket path of the render server, empty runs interactively
+		std::string serveSocket;
+		// most render farm contexts, 0 runs interactively
+		int farmContexts = 0;
+		// camera views rendered by each render farm pass
+		int farmJobs = 64;
+		// size of the render farm images
+		int farmWidth = 1000;
+		int farmHeight = 800;
+		// cameras drawn side by side in one pass, 0 draws one view
+		int viewCount = 0;
+		// draw with the CPU rasterizer instead of OpenGL
+		bool bSoftwareBackend = false;
+		// frames timed for each thread count of the CPU rasterizer
+		int softwareFrames = 30;
+		// size of the CPU rasterizer frames
+		int softwareWidth = 1000;
+		int softwareHeight = 800;
+		// samples per pixel of a path traced still, 0 runs interactively
+		int pathTraceSamples = 0;
+		// size of the path traced still
+		int pathTraceWidth = 1000;
+		int pathTraceHeight = 800;
+		// accumulation file that a path traced still resumes from
+		std::string pathTraceResume;
+		// moving objects of the octree benchmark, 0 runs interactively
+		int octreeObjects = 0;
+		// frames the octree benchmark moves and queries the objects
+		int octreeFrames = 100;
+		// run the frame through the render pass graph
+		bool bFrameGraph = false;
+		// comma separated post effects, empty for none
+		std::string postEffects;
+		// ambient occlusion preset, or "cycle" to compare them all
+		std::string ssaoQuality;
+		// frames each preset runs for when cycling
+		int ssaoCycleFrames = 300;
+		// bloom method, or "compare" to time both
+		std::string bloomMethod;
+		// frames each method runs for when comparing
+		int bloomCycleFrames = 300;
+		// "frustum" or "occlusion" to cull on the GPU, empty for off
+		std::string gpuCull;
+		// copies of the draw list culled on the GPU
+		int gpuCullCopies = 1;
+		// cull the scene on the CPU, re-testing only what the
+		// camera motion may have changed
+		bool bVisibilityCache = false;
+		// select the object under the cursor on a left click
+		bool bPicking = false;
+		// objects of the picking benchmark, 0 runs interactively
+		int pickObjects = 0;
+		// write object ids in the scene pass and read them back
+		bool bIdPicking = false;
+		// frames before an id pixel is read back
+		int idPickLatency = 2;
+		// frames the id target stays on and off, 0 keeps it on
+		int idPickCycleFrames = 0;
+		// draw the scene from meshlets culled on the CPU
+		bool bMeshlets = false;
+		// tessellation multiplier of the round shapes for meshlets
+		int meshletDetail = 4;
+		// draw the meshlets from simplified levels of detail
+		bool bMeshLods = false;
+		// file the levels are loaded from and saved to, empty for none
+		std::string meshLodCache;
+		// screen error in pixels allowed for a level of detail
+		float lodPixels = 1.0f;
+		// draw the far composite objects as impostors
+		bool bImpostors = false;
+		// copies of the composite objects in a grid
+		int impostorCopies = 1;
+		// distance from the camera where the impostors start
+		float impostorDistance = 30.0f;
+	};
+	APP_OPTIONS g_Options;
 }
 
 // Function declarations - all functions that are called manually
@@ -69,6 +255,15 @@ namespace
 //These operations are constant time operations, so the overall time complexity is O(1).
 bool InitializeGLFW();
 bool InitializeGLEW();
+bool ParseCommandLine(int argc, char* argv[]);
+int RunReplayMode();
+int RunFarmMode();
+int RunSoftwareMode();
+int RunPathTraceMode();
+int RunOctreeBenchMode();
+int RunPickBenchMode();
+void DrawSceneView();
+void RenderFrameGraph();
 
 
 /***********************************************************
@@ -80,18 +275,60 @@ bool InitializeGLEW();
 
 int main(int argc, char* argv[])
 {
+	// read the optional command line settings
+	if (ParseCommandLine(argc, argv) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// the CPU rasterizer works without any GPU driver
+	if (g_Options.bSoftwareBackend)
+	{
+		return(RunSoftwareMode());
+	}
+	if (g_Options.pathTraceSamples > 0)
+	{
+		return(RunPathTraceMode());
+	}
+	if (g_Options.octreeObjects > 0)
+	{
+		return(RunOctreeBenchMode());
+	}
+	if (g_Options.pickObjects > 0)
+	{
+		return(RunPickBenchMode());
+	}
+
 	// if GLFW fails initialization, then terminate the application
 	if (InitializeGLFW() == false)
 	{
 		return(EXIT_FAILURE);
 	}
 
+	// replaying a trace does not need any of the scene objects
+	if (!g_Options.replayFile.empty())
+	{
+		return(RunReplayMode());
+	}
+
+	// the render farm creates its own contexts and scenes
+	if (g_Options.farmContexts > 0)
+	{
+		return(RunFarmMode());
+	}
+
 	// try to create a new shader manager object
 	g_ShaderManager = new ShaderManager();
 	// try to create a new view manager object
 	g_ViewManager = new ViewManager(
 		g_ShaderManager);
 
+	// the render server only draws into its own framebuffers
+	if (!g_Options.serveSocket.empty())
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
 	// try to create the main display window
 	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
 
@@ -101,39 +338,416 @@ int main(int argc, char* argv[])
 		return(EXIT_FAILURE);
 	}
 
+	// record the GL calls from the first resource onwards
+	if (!g_Options.captureFile.empty())
+	{
+		GLTrace::BeginCapture(g_Options.captureFile);
+	}
+
+	// receive the driver messages before any resource is created
+	g_DebugOutput = new GLDebugOutput();
+	g_DebugOutput->Install();
+
 	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
+	g_ShaderManager->LoadShaders(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
 	g_ShaderManager->use();
+	GLint sceneProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &sceneProgram);
+	GLDebugOutput::LabelObject(GL_PROGRAM, (GLuint)sceneProgram, "program:scene");
+
+	// flag any frame that takes longer than the configured threshold
+	g_FrameProfiler = new FrameProfiler(120, g_Options.hitchFactor);
+	g_FrameProfiler->SetHitchThreshold(g_Options.hitchFactor, g_Options.hitchMs);
+	g_FrameProfiler->SetLogFile(g_Options.hitchLog);
 
 	// try to create a new scene manager object and prepare the 3D scene
 	g_SceneManager = new SceneManager(g_ShaderManager);
+	g_SceneManager->SetFrameProfiler(g_FrameProfiler);
 	g_SceneManager->PrepareScene();
 
+	// the scene setup becomes the first segment of the trace
+	if (GLTrace::IsCapturing())
+	{
+		GLTrace::MarkFrame();
+	}
+
+	// render the requested print resolution still before the first frame
+	if (!g_Options.screenshotFile.empty())
+	{
+		TiledScreenshot screenshot(g_ViewManager, g_SceneManager, g_Options.tileSize);
+		screenshot.Render(g_Options.screenshotFile, g_Options.screenshotWidth, g_Options.screenshotHeight);
+	}
+
+	// serve render requests instead of running the interactive loop
+	if (!g_Options.serveSocket.empty())
+	{
+		RenderServer server(g_ViewManager, g_SceneManager);
+		server.Run(g_Options.serveSocket);
+		glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+	}
+
+	// measure each render pass on the GPU without stalling
+	g_GpuProfiler = new GpuProfiler(4);
+	g_GpuProfiler->Initialize();
+	g_SceneManager->SetGpuProfiler(g_GpuProfiler);
+	double lastStatsTime = glfwGetTime();
+
+	// optionally attribute GPU time to every draw of the scene
+	if (g_Options.drawCostFrames > 0)
+	{
+		g_DrawCostProfiler = new DrawCostProfiler(4, 256);
+		g_DrawCostProfiler->Initialize();
+		g_SceneManager->SetDrawCostProfiler(g_DrawCostProfiler);
+	}
+
+	// optionally write every frame to an image sequence
+	if (!g_Options.recordPrefix.empty())
+	{
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+		g_FrameCapture = new FrameCapture(3);
+		g_FrameCapture->Initialize(framebufferWidth, framebufferHeight,
+			g_Options.recordPrefix, g_Options.recordFormat);
+	}
+
+	// optionally draw a grid of cameras, the first one interactive
+	if (g_Options.viewCount > 0)
+	{
+		g_MultiView = new MultiViewRenderer(g_ShaderManager, g_SceneManager);
+		if (g_MultiView->Initialize(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE))
+		{
+			g_MultiView->SetDefaultViews(g_Options.viewCount);
+		}
+		else
+		{
+			delete g_MultiView;
+			g_MultiView = NULL;
+		}
+	}
+
+	// optionally cull and build the draw list on the GPU
+	if (!g_Options.gpuCull.empty())
+	{
+		g_GpuCuller = new GpuCuller(g_ShaderManager, g_SceneManager, g_ViewManager);
+		if (g_GpuCuller->Initialize(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE))
+		{
+			g_GpuCuller->SetOcclusionCulling(g_Options.gpuCull == "occlusion");
+			g_GpuCuller->SetGpuProfiler(g_GpuProfiler);
+			g_GpuCuller->UploadObjects(g_Options.gpuCullCopies);
+		}
+		else
+		{
+			delete g_GpuCuller;
+			g_GpuCuller = NULL;
+		}
+	}
+
+	// optionally draw from meshlets culled by frustum and cone
+	if (g_Options.bMeshLods)
+	{
+		// errors of the levels as a fraction of the mesh radius
+		const float thresholds[] = { 0.002f, 0.008f, 0.03f, 0.1f };
+		g_MeshSimplifier = new MeshSimplifier();
+		g_MeshSimplifier->SetThresholds(std::vector<float>(thresholds, thresholds + 4));
+		if (g_Options.meshLodCache.empty() || !g_MeshSimplifier->LoadCache(g_Options.meshLodCache, g_Options.meshletDetail))
+		{
+			g_MeshSimplifier->BuildChains(g_Options.meshletDetail);
+			if (!g_Options.meshLodCache.empty())
+			{
+				g_MeshSimplifier->SaveCache(g_Options.meshLodCache);
+			}
+		}
+	}
+	if (g_Options.bMeshlets)
+	{
+		g_MeshletRenderer = new MeshletRenderer(g_ShaderManager, g_SceneManager, g_ViewManager);
+		g_MeshletRenderer->SetGpuProfiler(g_GpuProfiler);
+		g_MeshletRenderer->SetLods(g_MeshSimplifier, g_Options.lodPixels);
+		g_MeshletRenderer->Initialize(g_Options.meshletDetail);
+	}
+
+	// optionally draw the far composite objects from an atlas
+	// captured with the scene program
+	if (g_Options.bImpostors)
+	{
+		g_ImpostorRenderer = new ImpostorRenderer(g_ShaderManager, g_SceneManager, g_ViewManager);
+		g_ImpostorRenderer->SetGpuProfiler(g_GpuProfiler);
+		g_ImpostorRenderer->SetCopies(g_Options.impostorCopies);
+		g_ImpostorRenderer->SetDistance(g_Options.impostorDistance);
+		if (!g_ImpostorRenderer->Initialize())
+		{
+			delete g_ImpostorRenderer;
+			g_ImpostorRenderer = NULL;
+		}
+	}
+
+	// optionally cull the scene with the results of earlier frames
+	if (g_Options.bVisibilityCache)
+	{
+		g_VisibilityCache = new VisibilityCache();
+	}
+
+	// optionally select objects with the mouse
+	if (g_Options.bPicking)
+	{
+		g_ObjectPicker = new ObjectPicker();
+		g_ObjectPicker->Build(g_SceneManager->GetSceneObjects());
+	}
+	if (g_Options.bIdPicking)
+	{
+		if ((NULL != g_GpuCuller) || (NULL != g_MultiView) || (NULL != g_MeshletRenderer) || (NULL != g_ImpostorRenderer))
+		{
+			std::cout << "WARNING: ID buffer picking needs the draws of RenderScene(), "
+				"not the GPU culler, the meshlets, the impostors or the multi-view renderer" << std::endl;
+		}
+		else
+		{
+			g_IdBufferPicker = new IdBufferPicker(g_ShaderManager, g_SceneManager);
+			g_IdBufferPicker->SetLatency(g_Options.idPickLatency);
+			g_IdBufferPicker->SetCycleFrames(g_Options.idPickCycleFrames);
+			g_IdBufferPicker->SetGpuProfiler(g_GpuProfiler);
+			if (!g_IdBufferPicker->Initialize(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE))
+			{
+				delete g_IdBufferPicker;
+				g_IdBufferPicker = NULL;
+			}
+		}
+	}
+
+	// optionally route the frame through the render pass graph
+	if (g_Options.bFrameGraph)
+	{
+		g_FrameGraph = new FrameGraph();
+		g_FrameGraph->SetFrameProfiler(g_FrameProfiler);
+	}
+	if (!g_Options.postEffects.empty())
+	{
+		g_PostStack = new PostProcessStack();
+		g_PostStack->SetFrameProfiler(g_FrameProfiler);
+		g_PostStack->Initialize();
+		g_PostStack->AddEffects(g_Options.postEffects);
+	}
+	if (!g_Options.ssaoQuality.empty())
+	{
+		g_SSAO = new SSAOPass(g_ViewManager);
+		if (g_SSAO->Initialize())
+		{
+			SSAOPass::QUALITY quality = SSAOPass::QUALITY_MEDIUM;
+			if (SSAOPass::ParseQuality(g_Options.ssaoQuality, &quality))
+			{
+				g_SSAO->SetQuality(quality);
+			}
+			else
+			{
+				g_SSAO->SetQuality(SSAOPass::QUALITY_LOW);
+				g_SSAO->SetCycleFrames(g_Options.ssaoCycleFrames);
+			}
+			g_SSAO->SetGpuProfiler(g_GpuProfiler);
+		}
+		else
+		{
+			delete g_SSAO;
+			g_SSAO = NULL;
+		}
+	}
+	if (!g_Options.bloomMethod.empty())
+	{
+		g_Bloom = new BloomPass();
+		if (g_Bloom->Initialize())
+		{
+			BloomPass::METHOD method = BloomPass::METHOD_CHAIN;
+			if (BloomPass::ParseMethod(g_Options.bloomMethod, &method))
+			{
+				g_Bloom->SetMethod(method);
+			}
+			else
+			{
+				g_Bloom->SetCycleFrames(g_Options.bloomCycleFrames);
+			}
+			g_Bloom->SetGpuProfiler(g_GpuProfiler);
+		}
+		else
+		{
+			delete g_Bloom;
+			g_Bloom = NULL;
+		}
+	}
+
 	// loop will keep running until the application is closed 
 	// or until an error has occurred
 	while (!glfwWindowShouldClose(g_Window))
 	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
+		// start timing the frame for hitch detection
+		g_FrameProfiler->BeginFrame();
+		g_GpuProfiler->BeginFrame();
+		if (NULL != g_DrawCostProfiler)
+		{
+			g_DrawCostProfiler->BeginFrame();
+		}
 
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		// draw the scene directly or through the render pass graph
+		if (NULL != g_FrameGraph)
+		{
+			RenderFrameGraph();
+		}
+		else
+		{
+			DrawSceneView();
+		}
 
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
+		g_GpuProfiler->EndFrame();
+		if (NULL != g_DrawCostProfiler)
+		{
+			g_DrawCostProfiler->EndFrame();
 
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
+			// print the ranking once enough frames have been measured
+			if (!g_bDrawCostReported && (g_DrawCostProfiler->GetResolvedFrames() >= g_Options.drawCostFrames))
+			{
+				g_DrawCostProfiler->PrintReport(10);
+				g_bDrawCostReported = true;
+			}
+		}
+
+		// queue the readback of the finished frame before the swap
+		if (NULL != g_FrameCapture)
+		{
+			g_FrameProfiler->BeginZone("FrameCapture");
+			g_FrameCapture->CaptureFrame();
+			g_FrameProfiler->EndZone();
 
+			if ((g_Options.recordFrames > 0) && (g_FrameCapture->GetCapturedFrames() >= g_Options.recordFrames))
+			{
+				glfwSetWindowShouldClose(g_Window, GLFW_TRUE);
+			}
+		}
+
+		// close the frame in the trace and stop once enough are recorded
+		if (GLTrace::IsCapturing())
+		{
+			GLTrace::MarkFrame();
+			if (GLTrace::GetCapturedFrames() >= g_Options.captureFrames)
+			{
+				GLTrace::EndCapture();
+			}
+		}
 
 		// Flips the the back buffer with the front buffer every frame.
+		g_FrameProfiler->BeginZone("SwapBuffers");
 		glfwSwapBuffers(g_Window);
+		g_FrameProfiler->EndZone();
 
 		// query the latest GLFW events
+		g_FrameProfiler->BeginZone("PollEvents");
 		glfwPollEvents();
+		g_FrameProfiler->EndZone();
+
+		// report the driver messages of the frame to the profiler
+		g_DebugOutput->EndFrame(g_FrameProfiler);
+
+		// record the frame time and report it if it hitched
+		g_FrameProfiler->EndFrame();
+
+		// periodically report the CPU and GPU statistics together
+		if ((g_Options.statsInterval > 0.0) && (glfwGetTime() - lastStatsTime >= g_Options.statsInterval))
+		{
+			g_GpuProfiler->PrintReport(g_FrameProfiler);
+			lastStatsTime = glfwGetTime();
+		}
+	}
+
+	// finish the trace if the window closed before enough frames
+	if (GLTrace::IsCapturing())
+	{
+		GLTrace::EndCapture();
+	}
+
+	// write the frames still in flight before the context goes away
+	if (NULL != g_FrameCapture)
+	{
+		g_FrameCapture->Destroy();
+		g_FrameCapture->PrintReport();
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+
+	// the graph textures are freed while the context is current
+	if (NULL != g_Bloom)
+	{
+		g_Bloom->PrintReport();
+		delete g_Bloom;
+		g_Bloom = NULL;
+	}
+	if (NULL != g_SSAO)
+	{
+		g_SSAO->PrintReport();
+		delete g_SSAO;
+		g_SSAO = NULL;
+	}
+	if (NULL != g_PostStack)
+	{
+		delete g_PostStack;
+		g_PostStack = NULL;
+	}
+	if (NULL != g_FrameGraph)
+	{
+		delete g_FrameGraph;
+		g_FrameGraph = NULL;
+	}
+
+	// the id program and buffers are freed before the shader manager
+	if (NULL != g_IdBufferPicker)
+	{
+		g_IdBufferPicker->PrintReport();
+		delete g_IdBufferPicker;
+		g_IdBufferPicker = NULL;
+	}
+
+	if (NULL != g_ObjectPicker)
+	{
+		g_ObjectPicker->PrintReport();
+		delete g_ObjectPicker;
+		g_ObjectPicker = NULL;
+	}
+
+	if (NULL != g_VisibilityCache)
+	{
+		g_VisibilityCache->PrintReport();
+		delete g_VisibilityCache;
+		g_VisibilityCache = NULL;
+	}
+
+	// the culling program is freed before the shader manager
+	if (NULL != g_GpuCuller)
+	{
+		g_GpuCuller->PrintReport();
+		delete g_GpuCuller;
+		g_GpuCuller = NULL;
+	}
+	if (NULL != g_MeshletRenderer)
+	{
+		g_MeshletRenderer->PrintReport();
+		delete g_MeshletRenderer;
+		g_MeshletRenderer = NULL;
+	}
+	if (NULL != g_MeshSimplifier)
+	{
+		g_MeshSimplifier->PrintReport();
+		delete g_MeshSimplifier;
+		g_MeshSimplifier = NULL;
+	}
+	if (NULL != g_ImpostorRenderer)
+	{
+		g_ImpostorRenderer->PrintReport();
+		delete g_ImpostorRenderer;
+		g_ImpostorRenderer = NULL;
+	}
+
+	// the multi-view program is freed before the shader manager
+	if (NULL != g_MultiView)
+	{
+		delete g_MultiView;
+		g_MultiView = NULL;
 	}
 
 	// clear the allocated manager objects from memory
@@ -152,11 +766,1066 @@ int main(int argc, char* argv[])
 		delete g_ShaderManager;
 		g_ShaderManager = NULL;
 	}
+	if (NULL != g_DrawCostProfiler)
+	{
+		// a run shorter than the measured frames still gets its ranking
+		if (!g_bDrawCostReported)
+		{
+			g_DrawCostProfiler->PrintReport(10);
+			g_bDrawCostReported = true;
+		}
+		delete g_DrawCostProfiler;
+		g_DrawCostProfiler = NULL;
+	}
+	if (NULL != g_GpuProfiler)
+	{
+		delete g_GpuProfiler;
+		g_GpuProfiler = NULL;
+	}
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
+	if (NULL != g_DebugOutput)
+	{
+		g_DebugOutput->PrintSummary();
+		delete g_DebugOutput;
+		g_DebugOutput = NULL;
+	}
 
 	// Terminates the program successfully
 	exit(EXIT_SUCCESS); 
 }
 
+/***********************************************************
+ *	ParseCommandLine()
+ *
+ *  This function is used to read the optional settings
+ *  from the command line into the application options.
+ *
+ *  --hitch-factor <x>   hitch above x times the median
+ *  --hitch-ms <ms>      hitch above an absolute frame time
+ *  --hitch-log <file>   file that receives hitch snapshots
+ *  --stats <seconds>    report CPU and GPU pass statistics
+ *  --draw-costs <n>     rank the draws by GPU cost after n frames
+ *  --capture <file>     record the GL calls into a trace file; not
+ *                       with the render passes the replay lacks
+ *  --capture-frames <n> frames to record after the setup
+ *  --replay <file>      replay a trace headless and time it
+ *  --replay-loops <n>   passes over the recorded frames
+ *  --record <prefix>    write every frame to <prefix>_00000.png ...
+ *  --record-format <f>  png, qoi or exr
+ *  --record-frames <n>  close after writing n frames
+ *  --screenshot <file>  render a tiled PNG still at startup
+ *  --screenshot-size <w>x<h>  size of the still
+ *  --tile-size <n>      edge length of a screenshot tile
+ *  --serve <socket>     serve render requests on a socket
+ *  --farm <n>           time the render farm with up to n contexts
+ *  --farm-jobs <n>      camera views per render farm pass
+ *  --farm-size <w>x<h>  size of the render farm images
+ *  --views <n>          draw n cameras in a grid in one pass
+ *  --backend <name>     opengl, or software for the CPU rasterizer
+ *  --software-frames <n>  frames timed per thread count
+ *  --software-size <w>x<h>  size of the CPU rasterizer frames
+ *  --path-trace <n>     path trace a still with n samples per pixel
+ *  --path-trace-size <w>x<h>  size of the path traced still
+ *  --path-trace-resume <file>  continue from and save to an
+ *                       accumulation file
+ *  --frame-graph        run the frame through the render pass graph
+ *  --post <list>        fused post effects, e.g. tonemap,grade,
+ *                       vignette,fxaa,dither (implies --frame-graph)
+ *  --ssao <quality>     ambient occlusion, low, medium, high or
+ *                       cycle to time every preset (implies
+ *                       --frame-graph)
+ *  --ssao-cycle <n>     frames per preset when cycling
+ *  --bloom <method>     HDR bloom, chain, gaussian or compare to
+ *                       time both (implies --frame-graph)
+ *  --bloom-cycle <n>    frames per method when comparing
+ *  --gpu-cull <mode>    cull on the GPU and draw indirectly, frustum
+ *                       or occlusion (occlusion implies --frame-graph)
+ *  --gpu-cull-copies <n>  repeat the draw list n times in a grid
+ *  --visibility-cache   frustum cull on the CPU, re-testing only the
+ *                       objects the camera motion may have changed
+ *  --octree-bench <n>   move n objects in a loose octree and time the
+ *                       updates and queries, then exit
+ *  --octree-bench-frames <n>  frames the octree benchmark runs
+ *  --pick               print the object under the cursor on a left
+ *                       click
+ *  --pick-bench <n>     time ray picks against n objects, then exit
+ *  --id-pick            pick from an object id target of the scene
+ *                       pass, read back later (implies --frame-graph)
+ *  --id-pick-latency <n>  frames before an id pixel is read
+ *  --id-pick-cycle <n>  switch the id target on and off every n
+ *                       frames to time it
+ *  --meshlets           draw from meshlets, culling the ones off the
+ *                       frustum or facing away on the CPU
+ *  --meshlet-detail <n>  tessellation multiplier of the round shapes
+ *  --mesh-lods          draw the meshlets from simplified levels of
+ *                       detail (implies --meshlets)
+ *  --mesh-lod-cache <file>  load the levels from, or save them to, a
+ *                       cache file
+ *  --lod-pixels <n>     screen error in pixels allowed for a level
+ *  --impostors          draw the composite objects further than a
+ *                       distance as quads from a captured atlas
+ *  --impostor-copies <n>  repeat the composite objects n times in a
+ *                       grid
+ *  --impostor-distance <d>  distance where the impostors start
+ ***********************************************************/
+bool ParseCommandLine(int argc, char* argv[])
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* option = argv[i];
+		const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+		if ((strcmp(option, "--hitch-factor") == 0) && (NULL != value))
+		{
+			g_Options.hitchFactor = (float)atof(value);
+			i++;
+		}
+		else if ((strcmp(option, "--hitch-ms") == 0) && (NULL != value))
+		{
+			g_Options.hitchMs = atof(value);
+			i++;
+		}
+		else if ((strcmp(option, "--hitch-log") == 0) && (NULL != value))
+		{
+			g_Options.hitchLog = value;
+			i++;
+		}
+		else if ((strcmp(option, "--stats") == 0) && (NULL != value))
+		{
+			g_Options.statsInterval = atof(value);
+			i++;
+		}
+		else if ((strcmp(option, "--draw-costs") == 0) && (NULL != value))
+		{
+			g_Options.drawCostFrames = atol(value);
+			i++;
+		}
+		else if ((strcmp(option, "--capture") == 0) && (NULL != value))
+		{
+			g_Options.captureFile = value;
+			i++;
+		}
+		else if ((strcmp(option, "--capture-frames") == 0) && (NULL != value))
+		{
+			g_Options.captureFrames = atol(value);
+			i++;
+		}
+		else if ((strcmp(option, "--replay") == 0) && (NULL != value))
+		{
+			g_Options.replayFile = value;
+			i++;
+		}
+		else if ((strcmp(option, "--replay-loops") == 0) && (NULL != value))
+		{
+			g_Options.replayLoops = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--record") == 0) && (NULL != value))
+		{
+			g_Options.recordPrefix = value;
+			i++;
+		}
+		else if ((strcmp(option, "--record-format") == 0) && (NULL != value) &&
+			ImageWriter::ParseFormat(value, &g_Options.recordFormat))
+		{
+			i++;
+		}
+		else if ((strcmp(option, "--record-frames") == 0) && (NULL != value))
+		{
+			g_Options.recordFrames = atol(value);
+			i++;
+		}
+		else if ((strcmp(option, "--screenshot") == 0) && (NULL != value))
+		{
+			g_Options.screenshotFile = value;
+			i++;
+		}
+		else if ((strcmp(option, "--screenshot-size") == 0) && (NULL != value) &&
+			(sscanf(value, "%dx%d", &g_Options.screenshotWidth, &g_Options.screenshotHeight) == 2))
+		{
+			i++;
+		}
+		else if ((strcmp(option, "--tile-size") == 0) && (NULL != value))
+		{
+			g_Options.tileSize = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--serve") == 0) && (NULL != value))
+		{
+			g_Options.serveSocket = value;
+			i++;
+		}
+		else if ((strcmp(option, "--farm") == 0) && (NULL != value))
+		{
+			g_Options.farmContexts = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--farm-jobs") == 0) && (NULL != value))
+		{
+			g_Options.farmJobs = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--farm-size") == 0) && (NULL != value) &&
+			(sscanf(value, "%dx%d", &g_Options.farmWidth, &g_Options.farmHeight) == 2))
+		{
+			i++;
+		}
+		else if ((strcmp(option, "--views") == 0) && (NULL != value))
+		{
+			g_Options.viewCount = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--backend") == 0) && (NULL != value) &&
+			((strcmp(value, "opengl") == 0) || (strcmp(value, "software") == 0)))
+		{
+			g_Options.bSoftwareBackend = (strcmp(value, "software") == 0);
+			i++;
+		}
+		else if ((strcmp(option, "--software-frames") == 0) && (NULL != value))
+		{
+			g_Options.softwareFrames = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--software-size") == 0) && (NULL != value) &&
+			(sscanf(value, "%dx%d", &g_Options.softwareWidth, &g_Options.softwareHeight) == 2))
+		{
+			i++;
+		}
+		else if ((strcmp(option, "--path-trace") == 0) && (NULL != value))
+		{
+			g_Options.pathTraceSamples = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--path-trace-size") == 0) && (NULL != value) &&
+			(sscanf(value, "%dx%d", &g_Options.pathTraceWidth, &g_Options.pathTraceHeight) == 2))
+		{
+			i++;
+		}
+		else if ((strcmp(option, "--path-trace-resume") == 0) && (NULL != value))
+		{
+			g_Options.pathTraceResume = value;
+			i++;
+		}
+		else if (strcmp(option, "--frame-graph") == 0)
+		{
+			g_Options.bFrameGraph = true;
+		}
+		else if ((strcmp(option, "--post") == 0) && (NULL != value))
+		{
+			g_Options.postEffects = value;
+			g_Options.bFrameGraph = true;
+			i++;
+		}
+		else if ((strcmp(option, "--ssao") == 0) && (NULL != value))
+		{
+			SSAOPass::QUALITY quality;
+			if ((strcmp(value, "cycle") != 0) && !SSAOPass::ParseQuality(value, &quality))
+			{
+				std::cerr << "Unknown SSAO quality: " << value << std::endl;
+				return(false);
+			}
+			g_Options.ssaoQuality = value;
+			g_Options.bFrameGraph = true;
+			i++;
+		}
+		else if ((strcmp(option, "--ssao-cycle") == 0) && (NULL != value))
+		{
+			g_Options.ssaoCycleFrames = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--bloom") == 0) && (NULL != value))
+		{
+			BloomPass::METHOD method;
+			if ((strcmp(value, "compare") != 0) && !BloomPass::ParseMethod(value, &method))
+			{
+				std::cerr << "Unknown bloom method: " << value << std::endl;
+				return(false);
+			}
+			g_Options.bloomMethod = value;
+			g_Options.bFrameGraph = true;
+			i++;
+		}
+		else if ((strcmp(option, "--bloom-cycle") == 0) && (NULL != value))
+		{
+			g_Options.bloomCycleFrames = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--gpu-cull") == 0) && (NULL != value) &&
+			((strcmp(value, "frustum") == 0) || (strcmp(value, "occlusion") == 0)))
+		{
+			g_Options.gpuCull = value;
+			// the depth pyramid is built from the depth texture of the graph
+			g_Options.bFrameGraph = g_Options.bFrameGraph || (g_Options.gpuCull == "occlusion");
+			i++;
+		}
+		else if ((strcmp(option, "--gpu-cull-copies") == 0) && (NULL != value))
+		{
+			g_Options.gpuCullCopies = atoi(value);
+			i++;
+		}
+		else if (strcmp(option, "--visibility-cache") == 0)
+		{
+			g_Options.bVisibilityCache = true;
+		}
+		else if ((strcmp(option, "--octree-bench") == 0) && (NULL != value))
+		{
+			g_Options.octreeObjects = atoi(value);
+			i++;
+		}
+		else if (strcmp(option, "--pick") == 0)
+		{
+			g_Options.bPicking = true;
+		}
+		else if (strcmp(option, "--id-pick") == 0)
+		{
+			g_Options.bIdPicking = true;
+			g_Options.bFrameGraph = true;
+		}
+		else if ((strcmp(option, "--id-pick-latency") == 0) && (NULL != value))
+		{
+			g_Options.idPickLatency = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--id-pick-cycle") == 0) && (NULL != value))
+		{
+			g_Options.idPickCycleFrames = atoi(value);
+			i++;
+		}
+		else if (strcmp(option, "--meshlets") == 0)
+		{
+			g_Options.bMeshlets = true;
+		}
+		else if ((strcmp(option, "--meshlet-detail") == 0) && (NULL != value))
+		{
+			g_Options.meshletDetail = std::max(atoi(value), 1);
+			i++;
+		}
+		else if (strcmp(option, "--mesh-lods") == 0)
+		{
+			g_Options.bMeshLods = true;
+			g_Options.bMeshlets = true;
+		}
+		else if ((strcmp(option, "--mesh-lod-cache") == 0) && (NULL != value))
+		{
+			g_Options.meshLodCache = value;
+			i++;
+		}
+		else if ((strcmp(option, "--lod-pixels") == 0) && (NULL != value))
+		{
+			g_Options.lodPixels = (float)atof(value);
+			i++;
+		}
+		else if (strcmp(option, "--impostors") == 0)
+		{
+			g_Options.bImpostors = true;
+		}
+		else if ((strcmp(option, "--impostor-copies") == 0) && (NULL != value))
+		{
+			g_Options.impostorCopies = std::max(atoi(value), 1);
+			i++;
+		}
+		else if ((strcmp(option, "--impostor-distance") == 0) && (NULL != value))
+		{
+			g_Options.impostorDistance = (float)atof(value);
+			i++;
+		}
+		else if ((strcmp(option, "--pick-bench") == 0) && (NULL != value))
+		{
+			g_Options.pickObjects = atoi(value);
+			i++;
+		}
+		else if ((strcmp(option, "--octree-bench-frames") == 0) && (NULL != value))
+		{
+			g_Options.octreeFrames = std::max(atoi(value), 1);
+			i++;
+		}
+		else
+		{
+			std::cerr << "Unknown or incomplete option: " << option << std::endl;
+			return(false);
+		}
+	}
+
+	// the trace only notes the calls of these passes by name, so
+	// their frames could not be replayed
+	if (!g_Options.captureFile.empty() && (g_Options.bFrameGraph || (g_Options.viewCount > 0) ||
+		!g_Options.gpuCull.empty() || g_Options.bMeshlets || g_Options.bImpostors || g_Options.bIdPicking))
+	{
+		std::cerr << "--capture cannot record --frame-graph, --post, --ssao, --bloom, --gpu-cull, --views, "
+			"--meshlets, --impostors or --id-pick" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	RunReplayMode()
+ *
+ *  This function is used to replay a recorded GL trace in
+ *  a hidden window, without vsync, and report its timing.
+ ***********************************************************/
+int RunReplayMode()
+{
+	GLReplay replay;
+	bool bResult = false;
+
+	// the trace was recorded at the default window size
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	g_Window = glfwCreateWindow(1000, 800, WINDOW_TITLE, NULL, NULL);
+	if (NULL == g_Window)
+	{
+		std::cerr << "Failed to create the replay window" << std::endl;
+		glfwTerminate();
+		return(EXIT_FAILURE);
+	}
+	glfwMakeContextCurrent(g_Window);
+	glfwSwapInterval(0);
+
+	if (InitializeGLEW() && replay.Load(g_Options.replayFile))
+	{
+		bResult = replay.Run(g_Options.replayLoops);
+	}
+
+	glfwDestroyWindow(g_Window);
+	g_Window = nullptr;
+	glfwTerminate();
+
+	return(bResult ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	RunFarmMode()
+ *
+ *  This function is used to render orbit views of the scene
+ *  with a growing number of contexts and report how the
+ *  throughput scales.
+ ***********************************************************/
+int RunFarmMode()
+{
+	bool bResult = false;
+	{
+		RenderFarm farm(VERTEX_SHADER_FILE, FRAGMENT_SHADER_FILE);
+		farm.AddOrbitJobs(g_Options.farmJobs);
+		bResult = farm.Run(g_Options.farmContexts, g_Options.farmWidth, g_Options.farmHeight);
+	}
+
+	glfwTerminate();
+	return(bResult ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	RunSoftwareMode()
+ *
+ *  This function is used to draw the scene with the CPU
+ *  rasterizer from the default camera, time it with a
+ *  growing number of threads and optionally write the last
+ *  frame to the record prefix.
+ ***********************************************************/
+int RunSoftwareMode()
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	// the scene description needs no GL context
+	SceneManager scene(NULL);
+	scene.DefineObjectMaterials();
+	scene.DefineSceneObjects();
+	SceneGeometry geometry;
+	geometry.Load(scene);
+
+	// start from the default camera of the interactive view
+	glm::vec3 position;
+	glm::vec3 front;
+	float zoom = 80.0f;
+	ViewManager viewManager(NULL);
+	viewManager.GetCameraPose(position, front, zoom);
+	glm::mat4 view = glm::lookAt(position, position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(zoom),
+		(float)g_Options.softwareWidth / (float)g_Options.softwareHeight, 0.1f, 100.0f);
+
+	int maxThreads = (int)std::thread::hardware_concurrency();
+	if (maxThreads < 1)
+	{
+		maxThreads = 1;
+	}
+	std::vector<int> threadCounts;
+	for (int count = 1; count < maxThreads; count *= 2)
+	{
+		threadCounts.push_back(count);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::cout << "INFO: Software rasterizer, " << g_Options.softwareWidth << "x" << g_Options.softwareHeight
+		<< ", " << g_Options.softwareFrames << " frames per thread count" << std::endl;
+	double singleThreadMs = 0.0;
+	bool bResult = true;
+	for (size_t i = 0; i < threadCounts.size(); i++)
+	{
+		SoftwareRasterizer rasterizer(threadCounts[i]);
+		if (!rasterizer.Resize(g_Options.softwareWidth, g_Options.softwareHeight))
+		{
+			return(EXIT_FAILURE);
+		}
+
+		// one untimed frame sizes the triangle and bin arrays
+		rasterizer.Render(geometry, view, projection, position);
+		CLOCK::time_point start = CLOCK::now();
+		for (int frame = 0; frame < g_Options.softwareFrames; frame++)
+		{
+			rasterizer.Render(geometry, view, projection, position);
+		}
+		double frameMs = std::chrono::duration<double, std::milli>(CLOCK::now() - start).count() /
+			std::max(1, g_Options.softwareFrames);
+		if (i == 0)
+		{
+			singleThreadMs = frameMs;
+		}
+
+		std::cout << std::fixed << std::setprecision(2) << "INFO: " << threadCounts[i] << " threads: "
+			<< frameMs << " ms per frame, " << singleThreadMs / frameMs << "x, "
+			<< rasterizer.GetBinnedTriangles() << " triangles binned" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+
+		if ((i + 1 == threadCounts.size()) && !g_Options.recordPrefix.empty())
+		{
+			std::string filename = g_Options.recordPrefix + "_00000." + ImageWriter::GetExtension(g_Options.recordFormat);
+			bResult = ImageWriter::WriteFile(filename, g_Options.recordFormat, rasterizer.GetWidth(),
+				rasterizer.GetHeight(), rasterizer.GetColorBuffer(), true);
+		}
+	}
+
+	return(bResult ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	RunPathTraceMode()
+ *
+ *  This function is used to path trace a still of the scene
+ *  from the default camera until it has the requested
+ *  samples per pixel, and report the samples per second of
+ *  every core.
+ ***********************************************************/
+int RunPathTraceMode()
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	// the scene description needs no GL context
+	SceneManager scene(NULL);
+	scene.DefineObjectMaterials();
+	scene.DefineSceneObjects();
+	SceneGeometry geometry;
+	geometry.Load(scene);
+
+	glm::vec3 position;
+	glm::vec3 front;
+	float zoom = 80.0f;
+	ViewManager viewManager(NULL);
+	viewManager.GetCameraPose(position, front, zoom);
+
+	// a still has the machine to itself, so use every core
+	PathTracer tracer((int)std::max(1u, std::thread::hardware_concurrency()));
+	if (!tracer.Build(geometry) || !tracer.Resize(g_Options.pathTraceWidth, g_Options.pathTraceHeight))
+	{
+		return(EXIT_FAILURE);
+	}
+	tracer.SetCamera(position, front, zoom);
+
+	const std::string& resumeFile = g_Options.pathTraceResume;
+	if (!resumeFile.empty())
+	{
+		FILE* file = fopen(resumeFile.c_str(), "rb");
+		if (NULL != file)
+		{
+			fclose(file);
+			if (!tracer.LoadAccumulation(resumeFile))
+			{
+				return(EXIT_FAILURE);
+			}
+			std::cout << "INFO: Resuming at " << tracer.GetSampleCount() << " samples per pixel" << std::endl;
+		}
+	}
+
+	std::cout << "INFO: Path tracing " << tracer.GetWidth() << "x" << tracer.GetHeight() << " to "
+		<< g_Options.pathTraceSamples << " samples per pixel on " << tracer.GetThreadCount() << " threads, "
+		<< tracer.GetTriangleCount() << " triangles in " << tracer.GetNodeCount() << " BVH nodes" << std::endl;
+
+	// save every so often so an interrupted render loses little
+	CLOCK::time_point lastSave = CLOCK::now();
+	while (tracer.GetSampleCount() < g_Options.pathTraceSamples)
+	{
+		tracer.RenderPass();
+		if (!resumeFile.empty() && (std::chrono::duration<double>(CLOCK::now() - lastSave).count() >= 30.0))
+		{
+			tracer.SaveAccumulation(resumeFile);
+			lastSave = CLOCK::now();
+			std::cout << "INFO: " << tracer.GetSampleCount() << " samples per pixel saved" << std::endl;
+		}
+	}
+
+	bool bResult = resumeFile.empty() || tracer.SaveAccumulation(resumeFile);
+
+	const std::vector<PathTracer::WORKER_STATS>& stats = tracer.GetWorkerStats();
+	double totalRate = 0.0;
+	for (size_t i = 0; i < stats.size(); i++)
+	{
+		double rate = (stats[i].seconds > 0.0) ? (double)stats[i].samples / stats[i].seconds : 0.0;
+		totalRate += rate;
+		std::cout << std::fixed << std::setprecision(0) << "INFO: Core " << i << ": " << rate
+			<< " samples/sec, " << stats[i].stolenTiles << " tiles stolen" << std::endl;
+	}
+	std::cout << "INFO: " << totalRate << " samples/sec in total" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+
+	std::string prefix = g_Options.recordPrefix.empty() ? std::string("path_trace") : g_Options.recordPrefix;
+	std::string filename = prefix + "_00000." + ImageWriter::GetExtension(g_Options.recordFormat);
+	std::vector<unsigned char> pixels;
+	tracer.Resolve(pixels);
+	if (!ImageWriter::WriteFile(filename, g_Options.recordFormat, tracer.GetWidth(), tracer.GetHeight(), &pixels[0], true))
+	{
+		bResult = false;
+	}
+	else
+	{
+		std::cout << "INFO: Wrote " << filename << std::endl;
+	}
+
+	return(bResult ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/***********************************************************
+ *	RunOctreeBenchMode()
+ *
+ *  This function is used to spread copies of the scene
+ *  objects through a loose octree, move all of them every
+ *  frame, run frustum, sphere, box and ray queries, and
+ *  report the throughput of the updates and the queries.
+ ***********************************************************/
+int RunOctreeBenchMode()
+{
+	typedef std::chrono::steady_clock CLOCK;
+	const int queriesPerFrame = 100;
+	const float queryRadius = 5.0f;
+
+	// the scene description needs no GL context
+	SceneManager scene(NULL);
+	scene.DefineObjectMaterials();
+	scene.DefineSceneObjects();
+	std::vector<glm::vec4> sceneSpheres;
+	SceneGeometry::ComputeObjectSpheres(scene.GetSceneObjects(), sceneSpheres);
+	if (sceneSpheres.empty())
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// the copies keep about the same density for any count
+	int objectCount = g_Options.octreeObjects;
+	float halfSize = 4.0f * (float)cbrt((double)objectCount);
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<glm::vec4> spheres(objectCount);
+	std::vector<glm::vec3> velocities(objectCount);
+	LooseOctree octree(glm::vec3(0.0f), halfSize);
+	std::vector<int> handles(objectCount);
+	for (int i = 0; i < objectCount; i++)
+	{
+		glm::vec3 center(unit(random), unit(random), unit(random));
+		spheres[i] = glm::vec4(center * halfSize, sceneSpheres[i % sceneSpheres.size()].w);
+		// up to a fifth of a unit per frame in every direction
+		velocities[i] = glm::vec3(unit(random), unit(random), unit(random)) * 0.2f;
+		handles[i] = octree.Insert(spheres[i], i);
+	}
+
+	std::cout << "INFO: Octree benchmark: " << objectCount << " moving objects in a cube of "
+		<< halfSize * 2.0f << " units, " << g_Options.octreeFrames << " frames" << std::endl;
+
+	double updateSeconds = 0.0;
+	double frustumSeconds = 0.0;
+	double linearSeconds = 0.0;
+	double querySeconds[3] = { 0.0, 0.0, 0.0 };
+	long long frustumResults = 0;
+	long long queryResults[3] = { 0, 0, 0 };
+	long mismatches = 0;
+	std::vector<int> results;
+	results.reserve(objectCount);
+
+	for (int frame = 0; frame < g_Options.octreeFrames; frame++)
+	{
+		// move every object and bounce it off the walls of the cube
+		CLOCK::time_point start = CLOCK::now();
+		for (int i = 0; i < objectCount; i++)
+		{
+			glm::vec3 center = glm::vec3(spheres[i]) + velocities[i];
+			for (int axis = 0; axis < 3; axis++)
+			{
+				if (fabsf(center[axis]) > halfSize)
+				{
+					velocities[i][axis] = -velocities[i][axis];
+				}
+			}
+			spheres[i] = glm::vec4(center, spheres[i].w);
+			octree.Update(handles[i], spheres[i]);
+		}
+		updateSeconds += std::chrono::duration<double>(CLOCK::now() - start).count();
+
+		// a camera circling the center of the cube
+		float angle = (float)frame * 0.05f;
+		glm::vec3 eye = glm::vec3(cosf(angle), 0.3f, sinf(angle)) * halfSize * 0.5f;
+		glm::mat4 view = glm::lookAt(eye, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		glm::mat4 projection = glm::perspective(glm::radians(80.0f), 1000.0f / 800.0f, 0.1f, halfSize * 2.0f);
+		glm::vec4 planes[6];
+		VisibilityCache::ExtractFrustumPlanes(projection * view, planes);
+
+		results.clear();
+		start = CLOCK::now();
+		octree.QueryFrustum(planes, results);
+		frustumSeconds += std::chrono::duration<double>(CLOCK::now() - start).count();
+		frustumResults += (long long)results.size();
+
+		// the same test over every object, as the baseline and to
+		// check the octree does not lose any
+		start = CLOCK::now();
+		size_t linearCount = 0;
+		for (int i = 0; i < objectCount; i++)
+		{
+			bool bInside = true;
+			for (int p = 0; (p < 6) && bInside; p++)
+			{
+				bInside = (glm::dot(glm::vec3(planes[p]), glm::vec3(spheres[i])) + planes[p].w >= -spheres[i].w);
+			}
+			linearCount += bInside ? 1 : 0;
+		}
+		linearSeconds += std::chrono::duration<double>(CLOCK::now() - start).count();
+		if (linearCount != results.size())
+		{
+			mismatches++;
+		}
+
+		// spheres, boxes and rays at random places
+		for (int type = 0; type < 3; type++)
+		{
+			start = CLOCK::now();
+			for (int q = 0; q < queriesPerFrame; q++)
+			{
+				glm::vec3 point = glm::vec3(unit(random), unit(random), unit(random)) * halfSize;
+				results.clear();
+				if (type == 0)
+				{
+					octree.QuerySphere(glm::vec4(point, queryRadius), results);
+				}
+				else if (type == 1)
+				{
+					octree.QueryBox(point - queryRadius, point + queryRadius, results);
+				}
+				else
+				{
+					glm::vec3 direction = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 1e-3f);
+					octree.QueryRay(point, direction, halfSize, results);
+				}
+				queryResults[type] += (long long)results.size();
+			}
+			querySeconds[type] += std::chrono::duration<double>(CLOCK::now() - start).count();
+		}
+	}
+
+	double frames = (double)g_Options.octreeFrames;
+	double queries = frames * queriesPerFrame;
+	long long updates = octree.GetInPlaceUpdates() + octree.GetReinsertions();
+	std::cout << std::fixed << std::setprecision(2) << "INFO: Updates: "
+		<< (double)updates / updateSeconds / 1e6 << " million/sec, "
+		<< (double)octree.GetInPlaceUpdates() * 100.0 / (double)std::max(updates, 1LL) << "% in place, "
+		<< octree.GetNodeCount() << " nodes" << std::endl;
+	std::cout << std::setprecision(3) << "INFO: Frustum queries: " << frustumSeconds * 1000.0 / frames
+		<< " ms each for " << (double)frustumResults / frames << " objects, linear scan "
+		<< linearSeconds * 1000.0 / frames << " ms" << std::endl;
+	const char* queryNames[3] = { "Sphere", "Box", "Ray" };
+	for (int type = 0; type < 3; type++)
+	{
+		std::cout << std::setprecision(0) << "INFO: " << queryNames[type] << " queries: "
+			<< queries / querySeconds[type] << "/sec, " << std::setprecision(1)
+			<< (double)queryResults[type] / queries << " objects each" << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+
+	if (mismatches > 0)
+	{
+		std::cout << "WARNING: The octree frustum query differed from the linear scan in "
+			<< mismatches << " frames" << std::endl;
+		return(EXIT_FAILURE);
+	}
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	RunPickBenchMode()
+ *
+ *  This function is used to repeat the scene objects until
+ *  the requested count is reached, pick along rays through
+ *  random cursor positions of the default camera, and
+ *  report the picks per second.
+ ***********************************************************/
+int RunPickBenchMode()
+{
+	const int pickCount = 100000;
+
+	// the scene description needs no GL context
+	SceneManager scene(NULL);
+	scene.DefineObjectMaterials();
+	scene.DefineSceneObjects();
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = scene.GetSceneObjects();
+	if (objects.empty())
+	{
+		return(EXIT_FAILURE);
+	}
+
+	ObjectPicker picker;
+	int copies = (g_Options.pickObjects + (int)objects.size() - 1) / (int)objects.size();
+	picker.Build(objects, copies);
+
+	// rays of the default camera of the interactive view
+	glm::vec3 position;
+	glm::vec3 front;
+	float zoom = 80.0f;
+	ViewManager viewManager(NULL);
+	viewManager.GetCameraPose(position, front, zoom);
+	glm::mat4 view = glm::lookAt(position, position + front, glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 projection = glm::perspective(glm::radians(zoom), 1000.0f / 800.0f, 0.1f, 100.0f);
+	glm::mat4 inverse = glm::inverse(projection * view);
+
+	std::cout << "INFO: Pick benchmark: " << picker.GetObjectCount() << " objects (" << copies
+		<< " copies of " << objects.size() << "), " << pickCount << " picks" << std::endl;
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	for (int i = 0; i < pickCount; i++)
+	{
+		float x = unit(random);
+		float y = unit(random);
+		glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+		glm::vec3 origin = glm::vec3(nearPoint) / nearPoint.w;
+		glm::vec3 direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+		ObjectPicker::HIT hit;
+		picker.Pick(origin, direction, hit);
+	}
+
+	picker.PrintReport();
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	DrawSceneView()
+ *
+ *  This function is used to clear the bound framebuffer and
+ *  draw the scene from the interactive camera, or the grid
+ *  of cameras when multi-view is enabled.
+ ***********************************************************/
+void DrawSceneView()
+{
+	// Enable z-depth
+	glEnable(GL_DEPTH_TEST);
+
+	// Clear the frame and z buffers
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	// the object id target is an integer target with its own clear
+	if (NULL != g_IdBufferPicker)
+	{
+		g_IdBufferPicker->ClearIds();
+	}
+
+	// convert from 3D object space to 2D view
+	g_FrameProfiler->BeginZone("PrepareSceneView");
+	g_ViewManager->PrepareSceneView();
+	g_FrameProfiler->EndZone();
+
+	// select the object under a left click with the matrices
+	// of this frame
+	double xCursor = 0.0;
+	double yCursor = 0.0;
+	if (((NULL != g_ObjectPicker) || (NULL != g_IdBufferPicker)) && g_ViewManager->TakeClick(xCursor, yCursor))
+	{
+		// the id buffer answers a few frames later
+		if (NULL != g_IdBufferPicker)
+		{
+			g_IdBufferPicker->RequestSelection();
+		}
+		if (NULL != g_ObjectPicker)
+		{
+			glm::vec3 origin;
+			glm::vec3 direction;
+			ObjectPicker::HIT hit;
+			g_ViewManager->ComputeCursorRay(xCursor, yCursor, origin, direction);
+			if (g_ObjectPicker->Pick(origin, direction, hit))
+			{
+				const SceneManager::SCENE_OBJECT& object = g_SceneManager->GetSceneObjects()[hit.object];
+				std::cout << "INFO: Picked " << object.name << " (" << object.group << ", "
+					<< SceneManager::GetMeshName(object.mesh) << ") at distance " << hit.distance << std::endl;
+			}
+			else
+			{
+				std::cout << "INFO: Picked nothing" << std::endl;
+			}
+		}
+	}
+
+	// refresh the 3D scene
+	g_FrameProfiler->BeginZone("RenderScene");
+	if (NULL != g_MultiView)
+	{
+		MultiViewRenderer::VIEW view;
+		int framebufferWidth = 0;
+		int framebufferHeight = 0;
+		g_ViewManager->GetCameraPose(view.position, view.front, view.fov);
+		g_MultiView->SetView(0, view);
+		glfwGetFramebufferSize(g_Window, &framebufferWidth, &framebufferHeight);
+		g_MultiView->Render(framebufferWidth, framebufferHeight);
+	}
+	else if (NULL != g_GpuCuller)
+	{
+		g_GpuCuller->Render();
+	}
+	else if (NULL != g_MeshletRenderer)
+	{
+		g_MeshletRenderer->Render();
+	}
+	else if (NULL != g_ImpostorRenderer)
+	{
+		g_ImpostorRenderer->Render();
+	}
+	else if (NULL != g_VisibilityCache)
+	{
+		// only this camera uses the cache, other renders of the
+		// scene draw everything
+		g_VisibilityCache->Update(g_SceneManager->GetSceneObjects(), g_ViewManager->GetViewMatrix(),
+			g_ViewManager->GetProjectionMatrix(), g_ViewManager->GetCameraCuts());
+		g_SceneManager->SetVisibilityCache(g_VisibilityCache);
+		g_SceneManager->RenderScene();
+		g_SceneManager->SetVisibilityCache(NULL);
+	}
+	else
+	{
+		g_SceneManager->RenderScene();
+	}
+	g_FrameProfiler->EndZone();
+}
+
+/***********************************************************
+ *	RenderFrameGraph()
+ *
+ *  This function is used to declare the render passes of
+ *  the frame with the textures they read and write, and to
+ *  let the graph cull, order, alias and run them.
+ ***********************************************************/
+void RenderFrameGraph()
+{
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(g_Window, &width, &height);
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	FrameGraph& graph = *g_FrameGraph;
+	graph.Reset();
+	FrameGraph::TEXTURE_DESC backbufferDesc = { width, height, GL_RGBA8 };
+	FrameGraph::TEXTURE_DESC colorDesc = { width, height, GL_RGBA16F };
+	FrameGraph::TEXTURE_DESC depthDesc = { width, height, GL_DEPTH_COMPONENT24 };
+	FrameGraph::RESOURCE backbuffer = graph.ImportTexture("backbuffer", 0, backbufferDesc);
+	FrameGraph::RESOURCE sceneColor = graph.CreateTexture("scene.color", colorDesc);
+	FrameGraph::RESOURCE sceneDepth = graph.CreateTexture("scene.depth", depthDesc);
+
+	// the object ids are a second color target of the scene pass
+	bool bObjectIds = false;
+	if (NULL != g_IdBufferPicker)
+	{
+		double xCursor = 0.0;
+		double yCursor = 0.0;
+		int windowWidth = 0;
+		int windowHeight = 0;
+		glfwGetCursorPos(g_Window, &xCursor, &yCursor);
+		glfwGetWindowSize(g_Window, &windowWidth, &windowHeight);
+		g_IdBufferPicker->SetCursor(xCursor, yCursor, windowWidth, windowHeight);
+		bObjectIds = g_IdBufferPicker->BeginFrame();
+	}
+
+	int scenePass = graph.AddPass("Scene", [bObjectIds]()
+	{
+		if (bObjectIds)
+		{
+			g_IdBufferPicker->BeginScene();
+		}
+		DrawSceneView();
+		if (bObjectIds)
+		{
+			g_IdBufferPicker->EndScene();
+		}
+	});
+	graph.Write(scenePass, sceneColor);
+	if (bObjectIds)
+	{
+		FrameGraph::TEXTURE_DESC idDesc = { width, height, GL_R32UI };
+		FrameGraph::RESOURCE sceneIds = graph.CreateTexture("scene.ids", idDesc);
+		graph.Write(scenePass, sceneIds);
+
+		int readbackPass = graph.AddPass("PickReadback", [&graph, sceneIds, width, height]()
+		{
+			g_IdBufferPicker->ReadBack(graph.GetTexture(sceneIds), width, height);
+		});
+		graph.Read(readbackPass, sceneIds);
+		graph.SetSideEffect(readbackPass);
+	}
+	graph.Write(scenePass, sceneDepth);
+
+	// the depth of this frame is the occluder set of the next
+	if ((NULL != g_GpuCuller) && g_GpuCuller->IsOcclusionCulling())
+	{
+		int pyramidPass = graph.AddPass("DepthPyramid", [&graph, sceneDepth, width, height]()
+		{
+			g_GpuCuller->BuildDepthPyramid(graph.GetTexture(sceneDepth), width, height);
+		});
+		graph.Read(pyramidPass, sceneDepth);
+		graph.SetSideEffect(pyramidPass);
+	}
+
+	// the occlusion darkens the HDR color before the post effects
+	if (NULL != g_SSAO)
+	{
+		sceneColor = g_SSAO->AddPasses(graph, sceneColor, sceneDepth);
+	}
+	if (NULL != g_Bloom)
+	{
+		sceneColor = g_Bloom->AddPasses(graph, sceneColor);
+	}
+
+	// the post effects hand back the texture to present
+	FrameGraph::RESOURCE finalColor = sceneColor;
+	if (NULL != g_PostStack)
+	{
+		finalColor = g_PostStack->AddPasses(graph, sceneColor);
+	}
+
+	int presentPass = graph.AddPass("Present", [&graph, finalColor, width, height]()
+	{
+		graph.BlitTexture(finalColor, 0, width, height);
+	});
+	graph.Read(presentPass, finalColor);
+	graph.Write(presentPass, backbuffer);
+
+	if (graph.Compile())
+	{
+		if (graph.IsLayoutChanged())
+		{
+			graph.PrintReport();
+		}
+		graph.Execute();
+	}
+}
+
 /***********************************************************
  *	InitializeGLFW()
  * 
@@ -180,6 +1849,10 @@ bool InitializeGLFW()
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#endif
+#ifdef GL_DEBUG_OUTPUT_ENABLED
+	// request a debug context so the driver reports all messages
+	glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GL_TRUE);
 #endif
 	// GLFW: end -------------------------------
 
@@ -211,4 +1884,4 @@ bool InitializeGLEW()
 	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
 
 	return(true);
-}
\ No newline at end of file
+}
@@ -0,0 +1,795 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshSimplifier.cpp
+// ==================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `MeshSimplifier` class, which builds levels of
+// detail of the basic meshes with quadric error edge collapses.
+//
+// FUNCTIONALITY:
+// - Weld the copies of a position that the meshes keep for normal and
+//   texture seams, so the simplifier sees one connected surface.
+// - Sum the area weighted planes of the faces around every position
+//   into a quadric, with extra planes that hold open borders in place.
+// - Collapse each edge onto one of its ends, cheapest first, while the
+//   error stays below the threshold of the level. A collapse is refused
+//   when it would change the topology, turn a face over, or split a
+//   seam: every copy of the removed position needs a copy of the kept
+//   position beside it to move to.
+// - Simplify every level of every mesh from the full mesh as a separate
+//   task on the worker threads, and save or load the chains in a cache
+//   file.
+//
+// NOTES:
+// The kept position is one of the two ends, never a new point, so the
+// normals and texture coordinates of the remaining vertices stay exact.
+// The error is the square root of the quadric cost over its weight, a
+// mean distance to the planes around the position in object units.
+// The cache holds a version next to the detail and the thresholds; it
+// has to be raised when the meshes or the simplifier change, since the
+// file cannot tell that on its own.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <queue>
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_CacheMagic = "MESHLODC";
+	// raise whenever the basic meshes are tessellated differently
+	// or the simplifier collapses differently, so older caches are
+	// rebuilt
+	const int32_t g_CacheVersion = 1;
+	// a collapse may not turn a face further than this from where
+	// it pointed
+	const float g_MinNormalDot = 0.2f;
+	// weight of the planes along open borders, per squared length
+	const double g_BorderWeight = 10.0;
+	// positions closer than the size of the mesh over this are welded
+	const float g_WeldSteps = 1.0e5f;
+
+	// symmetric 4x4 matrix of the summed planes of a position
+	struct QUADRIC
+	{
+		double a2, ab, ac, ad, b2, bc, bd, c2, cd, d2;
+		double weight;
+	};
+
+	// an edge collapse waiting in the queue, cheapest on top
+	struct COLLAPSE
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		// versions of the two ends when the cost was computed
+		unsigned int fromVersion;
+		unsigned int toVersion;
+		bool operator<(const COLLAPSE& other) const { return(cost > other.cost); }
+	};
+
+	/***********************************************************
+	 *  AddPlane()
+	 *
+	 *  Adds the plane n.p + d = 0 with a weight to a quadric.
+	 ***********************************************************/
+	void AddPlane(QUADRIC& quadric, const glm::vec3& normal, float distance, double weight)
+	{
+		double a = normal.x;
+		double b = normal.y;
+		double c = normal.z;
+		double d = distance;
+		quadric.a2 += weight * a * a;
+		quadric.ab += weight * a * b;
+		quadric.ac += weight * a * c;
+		quadric.ad += weight * a * d;
+		quadric.b2 += weight * b * b;
+		quadric.bc += weight * b * c;
+		quadric.bd += weight * b * d;
+		quadric.c2 += weight * c * c;
+		quadric.cd += weight * c * d;
+		quadric.d2 += weight * d * d;
+		quadric.weight += weight;
+	}
+
+	/***********************************************************
+	 *  AddQuadric()
+	 *
+	 *  Adds one quadric to another.
+	 ***********************************************************/
+	void AddQuadric(QUADRIC& quadric, const QUADRIC& other)
+	{
+		quadric.a2 += other.a2;
+		quadric.ab += other.ab;
+		quadric.ac += other.ac;
+		quadric.ad += other.ad;
+		quadric.b2 += other.b2;
+		quadric.bc += other.bc;
+		quadric.bd += other.bd;
+		quadric.c2 += other.c2;
+		quadric.cd += other.cd;
+		quadric.d2 += other.d2;
+		quadric.weight += other.weight;
+	}
+
+	/***********************************************************
+	 *  EdgeKey()
+	 *
+	 *  Returns one key for both directions of an edge.
+	 ***********************************************************/
+	unsigned long long EdgeKey(unsigned int a, unsigned int b)
+	{
+		return(((unsigned long long)std::min(a, b) << 32) | (unsigned long long)std::max(a, b));
+	}
+
+	/***********************************************************
+	 *  CollapseCost()
+	 *
+	 *  Returns the mean squared distance of a point to the
+	 *  planes of two quadrics together.
+	 ***********************************************************/
+	double CollapseCost(const QUADRIC& first, const QUADRIC& second, const glm::vec3& position)
+	{
+		QUADRIC quadric = first;
+		AddQuadric(quadric, second);
+		double x = position.x;
+		double y = position.y;
+		double z = position.z;
+		double cost = quadric.a2 * x * x + quadric.b2 * y * y + quadric.c2 * z * z + quadric.d2 +
+			2.0 * (quadric.ab * x * y + quadric.ac * x * z + quadric.bc * y * z +
+				quadric.ad * x + quadric.bd * y + quadric.cd * z);
+		return(std::max(cost, 0.0) / std::max(quadric.weight, 1.0e-12));
+	}
+}
+
+/***********************************************************
+ *  MeshSimplifier()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshSimplifier::MeshSimplifier(int threadCount)
+	: m_workerPool(threadCount)
+{
+	m_detail = 1;
+	m_bFromCache = false;
+	m_seconds = 0.0;
+	m_sourceTriangles = 0;
+}
+
+/***********************************************************
+ *  ~MeshSimplifier()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshSimplifier::~MeshSimplifier()
+{
+	m_workerPool.WaitIdle();
+}
+
+/***********************************************************
+ *  Simplify()
+ *
+ *  This method collapses the edges of a mesh, cheapest
+ *  first, until the cheapest one left costs more than the
+ *  given error, and writes the triangles that remain with
+ *  only the vertices they use.
+ ***********************************************************/
+float MeshSimplifier::Simplify(const SceneGeometry::MESH& mesh, float maxError, SceneGeometry::MESH& result)
+{
+	result.vertices.clear();
+	result.indices.clear();
+	size_t vertexCount = mesh.vertices.size();
+	size_t triangleCount = mesh.indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return(0.0f);
+	}
+
+	// one welded position for all the copies of a vertex; the
+	// positions are snapped to a fine grid first, since the seams
+	// of the round shapes differ in the last bits
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		minimum = glm::min(minimum, mesh.vertices[i].position);
+		maximum = glm::max(maximum, mesh.vertices[i].position);
+	}
+	glm::vec3 extent = maximum - minimum;
+	float snap = g_WeldSteps / std::max(std::max(extent.x, extent.y), std::max(extent.z, 1.0e-6f));
+	std::vector<glm::ivec3> keys(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		glm::vec3 grid = (mesh.vertices[i].position - minimum) * snap;
+		keys[i] = glm::ivec3((int)floorf(grid.x + 0.5f), (int)floorf(grid.y + 0.5f), (int)floorf(grid.z + 0.5f));
+	}
+	std::vector<unsigned int> order(vertexCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::sort(order.begin(), order.end(), [&keys](unsigned int a, unsigned int b)
+	{
+		const glm::ivec3& p = keys[a];
+		const glm::ivec3& q = keys[b];
+		return((p.x < q.x) || ((p.x == q.x) && ((p.y < q.y) || ((p.y == q.y) && (p.z < q.z)))));
+	});
+	std::vector<unsigned int> weld(vertexCount);
+	std::vector<glm::vec3> positions;
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		if ((i == 0) || (keys[order[i]] != keys[order[i - 1]]))
+		{
+			positions.push_back(mesh.vertices[order[i]].position);
+		}
+		weld[order[i]] = (unsigned int)positions.size() - 1;
+	}
+	size_t positionCount = positions.size();
+
+	std::vector<unsigned int> indices(mesh.indices.begin(), mesh.indices.begin() + triangleCount * 3);
+	std::vector<bool> alive(triangleCount, true);
+	std::vector<std::vector<unsigned int> > around(positionCount);
+	std::vector<QUADRIC> quadrics(positionCount);
+	memset(&quadrics[0], 0, quadrics.size() * sizeof(QUADRIC));
+	// both ends of every edge, smaller first, to find the borders
+	std::vector<unsigned long long> edges;
+	edges.reserve(triangleCount * 3);
+
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		unsigned int w[3] = { weld[indices[t * 3]], weld[indices[t * 3 + 1]], weld[indices[t * 3 + 2]] };
+		if ((w[0] == w[1]) || (w[1] == w[2]) || (w[0] == w[2]))
+		{
+			alive[t] = false;
+			continue;
+		}
+		glm::vec3 normal = glm::cross(positions[w[1]] - positions[w[0]], positions[w[2]] - positions[w[0]]);
+		float length = glm::length(normal);
+		for (int k = 0; k < 3; k++)
+		{
+			around[w[k]].push_back((unsigned int)t);
+			edges.push_back(EdgeKey(w[k], w[(k + 1) % 3]));
+			if (length > 1.0e-12f)
+			{
+				AddPlane(quadrics[w[k]], normal / length, -glm::dot(normal / length, positions[w[0]]), 0.5 * length);
+			}
+		}
+	}
+
+	std::sort(edges.begin(), edges.end());
+
+	// planes through the open borders, upright to their face
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!alive[t])
+		{
+			continue;
+		}
+		unsigned int w[3] = { weld[indices[t * 3]], weld[indices[t * 3 + 1]], weld[indices[t * 3 + 2]] };
+		glm::vec3 normal = glm::cross(positions[w[1]] - positions[w[0]], positions[w[2]] - positions[w[0]]);
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int a = w[k];
+			unsigned int b = w[(k + 1) % 3];
+			std::pair<std::vector<unsigned long long>::iterator, std::vector<unsigned long long>::iterator> range =
+				std::equal_range(edges.begin(), edges.end(), EdgeKey(a, b));
+			if (range.second - range.first != 1)
+			{
+				continue;
+			}
+			glm::vec3 edge = positions[b] - positions[a];
+			glm::vec3 border = glm::cross(edge, normal);
+			float length = glm::length(border);
+			if (length > 1.0e-12f)
+			{
+				border /= length;
+				double weight = g_BorderWeight * glm::dot(edge, edge);
+				AddPlane(quadrics[a], border, -glm::dot(border, positions[a]), weight);
+				AddPlane(quadrics[b], border, -glm::dot(border, positions[a]), weight);
+			}
+		}
+	}
+
+	std::vector<unsigned int> versions(positionCount, 0);
+	std::vector<bool> removed(positionCount, false);
+	std::priority_queue<COLLAPSE> queue;
+	double maxCost = (double)maxError * (double)maxError;
+
+	// queue both directions of every edge around a position, and
+	// drop the dead triangles from its list on the way
+	std::vector<unsigned int> neighbors;
+	auto queueEdges = [&](unsigned int position)
+	{
+		std::vector<unsigned int>& triangles = around[position];
+		size_t kept = 0;
+		neighbors.clear();
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			unsigned int t = triangles[i];
+			if (!alive[t])
+			{
+				continue;
+			}
+			triangles[kept++] = t;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int other = weld[indices[t * 3 + k]];
+				if (other != position)
+				{
+					neighbors.push_back(other);
+				}
+			}
+		}
+		std::sort(neighbors.begin(), neighbors.end());
+		neighbors.erase(std::unique(neighbors.begin(), neighbors.end()), neighbors.end());
+		for (size_t i = 0; i < neighbors.size(); i++)
+		{
+			unsigned int other = neighbors[i];
+			COLLAPSE collapse;
+			collapse.from = position;
+			collapse.to = other;
+			collapse.fromVersion = versions[position];
+			collapse.toVersion = versions[other];
+			collapse.cost = CollapseCost(quadrics[position], quadrics[other], positions[other]);
+			queue.push(collapse);
+			std::swap(collapse.from, collapse.to);
+			std::swap(collapse.fromVersion, collapse.toVersion);
+			collapse.cost = CollapseCost(quadrics[other], quadrics[position], positions[position]);
+			queue.push(collapse);
+		}
+		triangles.resize(kept);
+	};
+	for (size_t position = 0; position < positionCount; position++)
+	{
+		queueEdges((unsigned int)position);
+	}
+
+	float reached = 0.0f;
+	std::vector<unsigned int> fromNeighbors;
+	std::vector<unsigned int> toNeighbors;
+	std::vector<unsigned int> common;
+	std::vector<std::pair<unsigned int, unsigned int> > moves;
+	while (!queue.empty())
+	{
+		COLLAPSE collapse = queue.top();
+		queue.pop();
+		if (collapse.cost > maxCost)
+		{
+			break;
+		}
+		unsigned int from = collapse.from;
+		unsigned int to = collapse.to;
+		if (removed[from] || removed[to] || (versions[from] != collapse.fromVersion) || (versions[to] != collapse.toVersion))
+		{
+			continue;
+		}
+
+		// the opposite corners of the shared triangles must be the
+		// only neighbours the two ends have in common
+		int shared = 0;
+		fromNeighbors.clear();
+		toNeighbors.clear();
+		for (size_t i = 0; i < around[from].size(); i++)
+		{
+			unsigned int t = around[from][i];
+			if (!alive[t])
+			{
+				continue;
+			}
+			bool bShared = false;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int w = weld[indices[t * 3 + k]];
+				bShared = bShared || (w == to);
+				if ((w != from) && (w != to))
+				{
+					fromNeighbors.push_back(w);
+				}
+			}
+			shared += bShared ? 1 : 0;
+		}
+		for (size_t i = 0; i < around[to].size(); i++)
+		{
+			unsigned int t = around[to][i];
+			for (int k = 0; alive[t] && (k < 3); k++)
+			{
+				unsigned int w = weld[indices[t * 3 + k]];
+				if ((w != from) && (w != to))
+				{
+					toNeighbors.push_back(w);
+				}
+			}
+		}
+		std::sort(fromNeighbors.begin(), fromNeighbors.end());
+		fromNeighbors.erase(std::unique(fromNeighbors.begin(), fromNeighbors.end()), fromNeighbors.end());
+		std::sort(toNeighbors.begin(), toNeighbors.end());
+		toNeighbors.erase(std::unique(toNeighbors.begin(), toNeighbors.end()), toNeighbors.end());
+		common.clear();
+		std::set_intersection(fromNeighbors.begin(), fromNeighbors.end(), toNeighbors.begin(), toNeighbors.end(),
+			std::back_inserter(common));
+		bool bValid = (shared > 0) && ((int)common.size() == shared);
+		if (!bValid)
+		{
+			continue;
+		}
+
+		// every copy of the removed position moves to a copy of the
+		// kept one that shares a triangle with it
+		moves.clear();
+		for (int pass = 0; pass < 2; pass++)
+		{
+			for (size_t i = 0; i < around[from].size(); i++)
+			{
+				unsigned int t = around[from][i];
+				unsigned int copy = (unsigned int)vertexCount;
+				unsigned int target = (unsigned int)vertexCount;
+				for (int k = 0; alive[t] && (k < 3); k++)
+				{
+					unsigned int w = weld[indices[t * 3 + k]];
+					copy = (w == from) ? indices[t * 3 + k] : copy;
+					target = (w == to) ? indices[t * 3 + k] : target;
+				}
+				if ((copy == vertexCount) || ((pass == 0) && (target == vertexCount)))
+				{
+					continue;
+				}
+				size_t m = 0;
+				while ((m < moves.size()) && (moves[m].first != copy))
+				{
+					m++;
+				}
+				if ((pass == 0) && (m == moves.size()))
+				{
+					moves.push_back(std::make_pair(copy, target));
+				}
+				// the second pass finds the copies without a target
+				bValid = bValid && ((pass == 0) || (m < moves.size()));
+			}
+		}
+		if (!bValid)
+		{
+			continue;
+		}
+
+		// no remaining face may turn over
+		for (size_t i = 0; bValid && (i < around[from].size()); i++)
+		{
+			unsigned int t = around[from][i];
+			if (!alive[t])
+			{
+				continue;
+			}
+			glm::vec3 corners[3];
+			glm::vec3 moved[3];
+			bool bShared = false;
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int w = weld[indices[t * 3 + k]];
+				bShared = bShared || (w == to);
+				corners[k] = positions[w];
+				moved[k] = (w == from) ? positions[to] : positions[w];
+			}
+			if (bShared)
+			{
+				continue;
+			}
+			glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+			glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+			float lengths = glm::length(before) * glm::length(after);
+			bValid = (lengths > 1.0e-20f) && (glm::dot(before, after) >= g_MinNormalDot * lengths);
+		}
+		if (!bValid)
+		{
+			continue;
+		}
+
+		for (size_t i = 0; i < around[from].size(); i++)
+		{
+			unsigned int t = around[from][i];
+			if (!alive[t])
+			{
+				continue;
+			}
+			bool bShared = false;
+			for (int k = 0; k < 3; k++)
+			{
+				bShared = bShared || (weld[indices[t * 3 + k]] == to);
+			}
+			if (bShared)
+			{
+				alive[t] = false;
+				continue;
+			}
+			for (int k = 0; k < 3; k++)
+			{
+				for (size_t m = 0; m < moves.size(); m++)
+				{
+					if (indices[t * 3 + k] == moves[m].first)
+					{
+						indices[t * 3 + k] = moves[m].second;
+						break;
+					}
+				}
+			}
+			around[to].push_back(t);
+		}
+		around[from].clear();
+		AddQuadric(quadrics[to], quadrics[from]);
+		removed[from] = true;
+		versions[to]++;
+		reached = std::max(reached, (float)sqrt(collapse.cost));
+		queueEdges(to);
+	}
+
+	// keep the vertices the remaining triangles use
+	std::vector<unsigned int> remap(vertexCount, (unsigned int)vertexCount);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		if (!alive[t])
+		{
+			continue;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			unsigned int vertex = indices[t * 3 + k];
+			if (remap[vertex] == vertexCount)
+			{
+				remap[vertex] = (unsigned int)result.vertices.size();
+				result.vertices.push_back(mesh.vertices[vertex]);
+			}
+			result.indices.push_back(remap[vertex]);
+		}
+	}
+	return(reached);
+}
+
+/***********************************************************
+ *  BuildChains()
+ *
+ *  This method builds the full basic meshes and simplifies
+ *  each of them once per threshold, every level as its own
+ *  task. Levels that removed nothing are dropped.
+ ***********************************************************/
+void MeshSimplifier::BuildChains(int detail)
+{
+	typedef std::chrono::steady_clock CLOCK;
+	CLOCK::time_point start = CLOCK::now();
+	m_detail = std::max(detail, 1);
+	m_bFromCache = false;
+	m_sourceTriangles = 0;
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		LOD_CHAIN& chain = m_chains[type];
+		chain.assign(m_thresholds.size() + 1, LOD());
+		SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, chain[0].mesh, m_detail);
+		chain[0].error = 0.0f;
+		float radius = SceneGeometry::ComputeBoundingSphere(chain[0].mesh).w;
+
+		for (size_t level = 0; level < m_thresholds.size(); level++)
+		{
+			float maxError = m_thresholds[level] * radius;
+			m_workerPool.Submit([&chain, level, maxError]()
+			{
+				LOD& lod = chain[level + 1];
+				lod.error = Simplify(chain[0].mesh, maxError, lod.mesh);
+			});
+			m_sourceTriangles += (long long)(chain[0].mesh.indices.size() / 3);
+		}
+	}
+	m_workerPool.WaitIdle();
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		LOD_CHAIN& chain = m_chains[type];
+		size_t kept = 1;
+		for (size_t level = 1; level < chain.size(); level++)
+		{
+			if (chain[level].mesh.indices.size() < chain[kept - 1].mesh.indices.size())
+			{
+				chain[level].error = std::max(chain[level].error, chain[kept - 1].error);
+				if (kept != level)
+				{
+					std::swap(chain[kept], chain[level]);
+				}
+				kept++;
+			}
+		}
+		chain.resize(kept);
+	}
+	m_seconds = std::chrono::duration<double>(CLOCK::now() - start).count();
+}
+
+/***********************************************************
+ *  ProjectError()
+ *
+ *  This method returns the pixels an error covers on the
+ *  screen at a distance.
+ ***********************************************************/
+float MeshSimplifier::ProjectError(float error, float scale, float distance, float pixelScale)
+{
+	return(error * scale * pixelScale / std::max(distance, 1.0e-4f));
+}
+
+/***********************************************************
+ *  SaveCache()
+ *
+ *  This method writes the version, the detail, the
+ *  thresholds and the vertices and indices of every level.
+ ***********************************************************/
+bool MeshSimplifier::SaveCache(const std::string& filename) const
+{
+	FILE* file = fopen(filename.c_str(), "wb");
+	if (NULL == file)
+	{
+		std::cerr << "Could not write the mesh LOD cache: " << filename << std::endl;
+		return(false);
+	}
+
+	int32_t header[4] = { g_CacheVersion, m_detail, SceneManager::MESH_COUNT, (int32_t)m_thresholds.size() };
+	bool bWritten = (fwrite(g_CacheMagic, 1, strlen(g_CacheMagic), file) == strlen(g_CacheMagic)) &&
+		(fwrite(header, sizeof(header), 1, file) == 1) &&
+		(m_thresholds.empty() || (fwrite(&m_thresholds[0], sizeof(float), m_thresholds.size(), file) == m_thresholds.size()));
+	for (int type = 0; bWritten && (type < SceneManager::MESH_COUNT); type++)
+	{
+		int32_t levels = (int32_t)m_chains[type].size();
+		bWritten = (fwrite(&levels, sizeof(levels), 1, file) == 1);
+		for (int32_t level = 0; bWritten && (level < levels); level++)
+		{
+			const LOD& lod = m_chains[type][level];
+			int32_t counts[2] = { (int32_t)lod.mesh.vertices.size(), (int32_t)lod.mesh.indices.size() };
+			bWritten = (fwrite(&lod.error, sizeof(float), 1, file) == 1) &&
+				(fwrite(counts, sizeof(counts), 1, file) == 1) &&
+				(lod.mesh.vertices.empty() || (fwrite(&lod.mesh.vertices[0], sizeof(SceneGeometry::VERTEX),
+					lod.mesh.vertices.size(), file) == lod.mesh.vertices.size())) &&
+				(lod.mesh.indices.empty() || (fwrite(&lod.mesh.indices[0], sizeof(unsigned int),
+					lod.mesh.indices.size(), file) == lod.mesh.indices.size()));
+		}
+	}
+	fclose(file);
+
+	if (!bWritten)
+	{
+		std::cerr << "Could not write the mesh LOD cache: " << filename << std::endl;
+	}
+	return(bWritten);
+}
+
+/***********************************************************
+ *  LoadCache()
+ *
+ *  This method reads chains written by SaveCache(); the
+ *  version, the detail and the thresholds must match, and
+ *  every count and index must fit the file and the level,
+ *  or the chains are left as they were.
+ ***********************************************************/
+bool MeshSimplifier::LoadCache(const std::string& filename, int detail)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	size_t magicLength = strlen(g_CacheMagic);
+	char magic[16] = { 0 };
+	int32_t header[4] = { 0 };
+	long fileSize = 0;
+
+	if (NULL == file)
+	{
+		return(false);
+	}
+	fseek(file, 0, SEEK_END);
+	fileSize = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if ((fread(magic, 1, magicLength, file) != magicLength) || (memcmp(magic, g_CacheMagic, magicLength) != 0) ||
+		(fread(header, sizeof(header), 1, file) != 1))
+	{
+		std::cerr << "Not a mesh LOD cache: " << filename << std::endl;
+		fclose(file);
+		return(false);
+	}
+	std::vector<float> thresholds(m_thresholds.size());
+	bool bMatches = (header[0] == g_CacheVersion) && (header[1] == std::max(detail, 1)) &&
+		(header[2] == SceneManager::MESH_COUNT) && (header[3] == (int32_t)m_thresholds.size()) &&
+		(thresholds.empty() || (fread(&thresholds[0], sizeof(float), thresholds.size(), file) == thresholds.size())) &&
+		(thresholds == m_thresholds);
+	if (!bMatches)
+	{
+		std::cout << "INFO: The mesh LOD cache " << filename << " was built with other settings" << std::endl;
+		fclose(file);
+		return(false);
+	}
+
+	LOD_CHAIN chains[SceneManager::MESH_COUNT];
+	bool bRead = true;
+	for (int type = 0; bRead && (type < SceneManager::MESH_COUNT); type++)
+	{
+		int32_t levels = 0;
+		bRead = (fread(&levels, sizeof(levels), 1, file) == 1) && (levels > 0) &&
+			(levels <= (int32_t)m_thresholds.size() + 1);
+		for (int32_t level = 0; bRead && (level < levels); level++)
+		{
+			LOD lod;
+			int32_t counts[2] = { 0 };
+			bRead = (fread(&lod.error, sizeof(float), 1, file) == 1) && (fread(counts, sizeof(counts), 1, file) == 1) &&
+				(counts[0] >= 0) && (counts[1] >= 0) && (counts[1] % 3 == 0);
+			// the counts come from the file, so they may not ask for
+			// more than is left of it
+			long long levelBytes = (long long)counts[0] * (long long)sizeof(SceneGeometry::VERTEX) +
+				(long long)counts[1] * (long long)sizeof(unsigned int);
+			bRead = bRead && (levelBytes <= (long long)fileSize - (long long)ftell(file));
+			if (bRead)
+			{
+				lod.mesh.vertices.resize(counts[0]);
+				lod.mesh.indices.resize(counts[1]);
+				bRead = (lod.mesh.vertices.empty() || (fread(&lod.mesh.vertices[0], sizeof(SceneGeometry::VERTEX),
+						lod.mesh.vertices.size(), file) == lod.mesh.vertices.size())) &&
+					(lod.mesh.indices.empty() || (fread(&lod.mesh.indices[0], sizeof(unsigned int),
+						lod.mesh.indices.size(), file) == lod.mesh.indices.size()));
+			}
+			for (size_t i = 0; bRead && (i < lod.mesh.indices.size()); i++)
+			{
+				bRead = (lod.mesh.indices[i] < lod.mesh.vertices.size());
+			}
+			chains[type].push_back(lod);
+		}
+	}
+	fclose(file);
+	if (!bRead)
+	{
+		std::cerr << "Could not read the mesh LOD cache: " << filename << std::endl;
+		return(false);
+	}
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		m_chains[type].swap(chains[type]);
+	}
+	m_detail = header[1];
+	m_bFromCache = true;
+	m_seconds = 0.0;
+	m_sourceTriangles = 0;
+	return(true);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the triangles and the error of every
+ *  level, and how fast the levels were built.
+ ***********************************************************/
+void MeshSimplifier::PrintReport() const
+{
+	if (m_bFromCache)
+	{
+		std::cout << "INFO: Mesh LODs: loaded from the cache at detail " << m_detail << std::endl;
+	}
+	else if (m_seconds > 0.0)
+	{
+		std::cout << std::fixed << std::setprecision(1) << "INFO: Mesh LODs: built at detail " << m_detail << " in "
+			<< m_seconds * 1000.0 << " ms on " << m_workerPool.GetThreadCount() << " threads, "
+			<< (double)m_sourceTriangles / m_seconds / 1.0e6 << " M source triangles/sec" << std::endl;
+	}
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		const LOD_CHAIN& chain = m_chains[type];
+		std::cout << std::fixed << std::setprecision(4) << "INFO: Mesh LODs: " << SceneManager::GetMeshName((SceneManager::MESH_TYPE)type);
+		for (size_t level = 0; level < chain.size(); level++)
+		{
+			std::cout << ((level == 0) ? " " : ", ") << chain[level].mesh.indices.size() / 3 << " triangles";
+			if (level > 0)
+			{
+				std::cout << " (error " << chain[level].error << ")";
+			}
+		}
+		std::cout << std::endl;
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,80 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshsimplifier.h
+// ============
+// build levels of detail of the meshes with quadric error collapses
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGeometry.h"
+#include "SceneManager.h"
+#include "WorkerPool.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  MeshSimplifier
+ *
+ *  This class builds a chain of simpler meshes for each of
+ *  the basic shapes. Edges are collapsed in the order of the
+ *  quadric error they add, until the next collapse would
+ *  move the surface further than the threshold of the level.
+ *  The levels of all meshes are simplified in parallel on
+ *  worker threads, and the chains can be saved to and loaded
+ *  from a cache file so they are only built once. At run
+ *  time the coarsest level whose error covers less than a
+ *  given number of pixels is drawn.
+ ***********************************************************/
+class MeshSimplifier
+{
+public:
+	struct LOD
+	{
+		SceneGeometry::MESH mesh;
+		// largest distance the surface moved, in object units
+		float error;
+	};
+	// level 0 is the full mesh
+	typedef std::vector<LOD> LOD_CHAIN;
+
+	// constructor; zero threads uses one less than the cores
+	MeshSimplifier(int threadCount = 0);
+	// destructor
+	~MeshSimplifier();
+
+	// collapse edges of a mesh while the error stays below
+	// maxError; returns the error of the last collapse
+	static float Simplify(const SceneGeometry::MESH& mesh, float maxError, SceneGeometry::MESH& result);
+
+	// errors of the levels after the first, as a fraction of the
+	// bounding radius of each mesh
+	void SetThresholds(const std::vector<float>& thresholds) { m_thresholds = thresholds; }
+	// build the chains of the basic meshes at a tessellation detail
+	void BuildChains(int detail);
+	// write the chains, and read chains built by the same cache
+	// version with the same detail and thresholds
+	bool SaveCache(const std::string& filename) const;
+	bool LoadCache(const std::string& filename, int detail);
+
+	const LOD_CHAIN& GetChain(SceneManager::MESH_TYPE mesh) const { return(m_chains[mesh]); }
+	// pixels an object space error covers once scaled into the
+	// world and seen from a distance; the pixel scale is half the
+	// screen height over the tangent of half the field of view
+	static float ProjectError(float error, float scale, float distance, float pixelScale);
+
+	// print the triangles of every level and the time taken
+	void PrintReport() const;
+
+private:
+	WorkerPool m_workerPool;
+	std::vector<float> m_thresholds;
+	LOD_CHAIN m_chains[SceneManager::MESH_COUNT];
+	int m_detail;
+	bool m_bFromCache;
+	double m_seconds;
+	// triangles fed to the simplifier over all levels
+	long long m_sourceTriangles;
+};
@@ -0,0 +1,601 @@
+///////////////////////////////////////////////////////////////////////////////
+// MeshletRenderer.cpp
+// ===================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `MeshletRenderer` class, which draws the scene
+// from small clusters of triangles and culls the clusters on the CPU.
+//
+// FUNCTIONALITY:
+// - Tessellate the round shapes with more segments and rings than the
+//   GPU meshes, to stand in for large meshes.
+// - Grow meshlets of at most 64 vertices and 124 triangles from a seed
+//   triangle, always adding the unused triangle that shares the most
+//   vertices with the meshlet, so the meshlets stay compact.
+// - Store a bounding sphere and a normal cone per meshlet, and reorder
+//   the index buffer so every meshlet is one contiguous range.
+// - Per object, skip the meshlets outside the frustum, and on closed
+//   meshes the meshlets whose cone faces away from the camera, then draw
+//   the rest with one glMultiDrawElements, joining neighbouring ranges.
+// - With the levels of a mesh simplifier, split every level and draw
+//   each object at the coarsest level whose error, projected from the
+//   near side of its sphere, covers less than a given number of pixels.
+//
+// NOTES:
+// The cone test runs in object space, with the camera moved into the
+// space of the object: which side of a triangle the camera is on does
+// not change under the model matrix, even with a non-uniform scale. The
+// frustum test uses the world sphere of each meshlet. The scene draws
+// without face culling, so the cone test is skipped for translucent
+// objects, whose back faces show through; on opaque ones it only removes
+// triangles the depth test would have hidden anyway and saves their
+// vertex and raster work.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "MeshletRenderer.h"
+#include "GLDebugOutput.h"
+#include "VisibilityCache.h"
+
+// GLFW library, used for timing the CPU side of a frame
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the meshlet size of the mesh shader pipelines
+	const int g_MaxMeshletVertices = 64;
+	const int g_MaxMeshletTriangles = 124;
+	// normals spreading wider than this from the axis give no cone
+	const float g_MinConeDot = 0.1f;
+
+	/***********************************************************
+	 *  ComputeMeshletBounds()
+	 *
+	 *  Computes the bounding sphere and the normal cone of the
+	 *  triangles of one meshlet. The face normals follow the
+	 *  winding but are turned toward the vertex normals, which
+	 *  point out of the shapes.
+	 ***********************************************************/
+	void ComputeMeshletBounds(const SceneGeometry::MESH& mesh, const std::vector<unsigned int>& vertices,
+		const std::vector<unsigned int>& triangles, MeshletRenderer::MESHLET& meshlet)
+	{
+		glm::vec3 minimum(1e30f);
+		glm::vec3 maximum(-1e30f);
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			minimum = glm::min(minimum, mesh.vertices[vertices[i]].position);
+			maximum = glm::max(maximum, mesh.vertices[vertices[i]].position);
+		}
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		float radius = 0.0f;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			radius = std::max(radius, glm::length(mesh.vertices[vertices[i]].position - center));
+		}
+		meshlet.sphere = glm::vec4(center, radius);
+
+		std::vector<glm::vec3> normals;
+		normals.reserve(triangles.size());
+		glm::vec3 axis(0.0f);
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			const SceneGeometry::VERTEX& a = mesh.vertices[mesh.indices[triangles[i] * 3 + 0]];
+			const SceneGeometry::VERTEX& b = mesh.vertices[mesh.indices[triangles[i] * 3 + 1]];
+			const SceneGeometry::VERTEX& c = mesh.vertices[mesh.indices[triangles[i] * 3 + 2]];
+			glm::vec3 normal = glm::cross(b.position - a.position, c.position - a.position);
+			float length = glm::length(normal);
+			if (length < 1.0e-12f)
+			{
+				continue;
+			}
+			normal /= length;
+			if (glm::dot(normal, a.normal + b.normal + c.normal) < 0.0f)
+			{
+				normal = -normal;
+			}
+			normals.push_back(normal);
+			axis += normal;
+		}
+
+		meshlet.coneAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+		meshlet.coneCutoff = 2.0f;
+		float axisLength = glm::length(axis);
+		if (normals.empty() || (axisLength < 1.0e-6f))
+		{
+			return;
+		}
+		axis /= axisLength;
+		float minimumDot = 1.0f;
+		for (size_t i = 0; i < normals.size(); i++)
+		{
+			minimumDot = std::min(minimumDot, glm::dot(axis, normals[i]));
+		}
+		meshlet.coneAxis = axis;
+		if (minimumDot > g_MinConeDot)
+		{
+			meshlet.coneCutoff = sqrtf(1.0f - minimumDot * minimumDot);
+		}
+	}
+}
+
+/***********************************************************
+ *  MeshletRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MeshletRenderer::MeshletRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_pViewManager = pViewManager;
+	m_pGpuProfiler = NULL;
+	m_vertexArray = 0;
+	m_vertexBuffer = 0;
+	m_indexBuffer = 0;
+	m_detail = 1;
+	m_pSimplifier = NULL;
+	m_maxPixels = 1.0f;
+	m_frames = 0;
+	m_cpuSeconds = 0.0;
+	m_triangles = 0;
+	m_frustumTriangles = 0;
+	m_coneTriangles = 0;
+	m_drawnMeshlets = 0;
+	m_draws = 0;
+	m_fullTriangles = 0;
+}
+
+/***********************************************************
+ *  ~MeshletRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MeshletRenderer::~MeshletRenderer()
+{
+	Destroy();
+	m_pShaderManager = NULL;
+	m_pSceneManager = NULL;
+	m_pViewManager = NULL;
+}
+
+/***********************************************************
+ *  BuildMeshlets()
+ *
+ *  This method grows meshlets over the triangles that share
+ *  vertices. A meshlet is closed when it is full or when no
+ *  unused triangle touches it, and the next one starts from
+ *  the first unused triangle in index order.
+ ***********************************************************/
+void MeshletRenderer::BuildMeshlets(const SceneGeometry::MESH& mesh, int maxVertices, int maxTriangles,
+	std::vector<MESHLET>& meshlets, std::vector<GLuint>& indices)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.vertices.size();
+	if (triangleCount == 0)
+	{
+		return;
+	}
+	maxVertices = std::max(maxVertices, 3);
+	maxTriangles = std::max(maxTriangles, 1);
+
+	// the triangles around every vertex
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacencyOffsets[mesh.indices[i] + 1]++;
+	}
+	for (size_t i = 0; i < vertexCount; i++)
+	{
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	}
+	std::vector<unsigned int> adjacency(triangleCount * 3);
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < triangleCount * 3; i++)
+	{
+		adjacency[fill[mesh.indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<bool> used(triangleCount, false);
+	// whether a vertex is in the meshlet being grown
+	std::vector<bool> inMeshlet(vertexCount, false);
+	std::vector<unsigned int> vertices;
+	std::vector<unsigned int> triangles;
+	vertices.reserve(maxVertices);
+	triangles.reserve(maxTriangles);
+	size_t nextSeed = 0;
+	size_t remaining = triangleCount;
+
+	while (remaining > 0)
+	{
+		// the fitting neighbour that adds the fewest vertices
+		int best = -1;
+		int bestShared = -1;
+		for (size_t v = 0; (v < vertices.size()) && (bestShared < 3); v++)
+		{
+			for (unsigned int a = adjacencyOffsets[vertices[v]]; a < adjacencyOffsets[vertices[v] + 1]; a++)
+			{
+				unsigned int triangle = adjacency[a];
+				if (used[triangle])
+				{
+					continue;
+				}
+				int shared = 0;
+				for (int k = 0; k < 3; k++)
+				{
+					shared += inMeshlet[mesh.indices[triangle * 3 + k]] ? 1 : 0;
+				}
+				if (((int)vertices.size() + 3 - shared <= maxVertices) && (shared > bestShared))
+				{
+					best = (int)triangle;
+					bestShared = shared;
+				}
+			}
+		}
+
+		if ((best < 0) && triangles.empty())
+		{
+			while (used[nextSeed])
+			{
+				nextSeed++;
+			}
+			best = (int)nextSeed;
+		}
+
+		if (best >= 0)
+		{
+			used[best] = true;
+			remaining--;
+			triangles.push_back((unsigned int)best);
+			for (int k = 0; k < 3; k++)
+			{
+				unsigned int vertex = mesh.indices[best * 3 + k];
+				if (!inMeshlet[vertex])
+				{
+					inMeshlet[vertex] = true;
+					vertices.push_back(vertex);
+				}
+			}
+		}
+
+		bool bFull = ((int)triangles.size() >= maxTriangles) || ((int)vertices.size() + 1 > maxVertices);
+		if ((best < 0) || bFull || (remaining == 0))
+		{
+			MESHLET meshlet;
+			meshlet.firstIndex = (GLuint)indices.size();
+			meshlet.triangleCount = (GLuint)triangles.size();
+			meshlet.vertexCount = (GLuint)vertices.size();
+			ComputeMeshletBounds(mesh, vertices, triangles, meshlet);
+			meshlets.push_back(meshlet);
+
+			for (size_t i = 0; i < triangles.size(); i++)
+			{
+				for (int k = 0; k < 3; k++)
+				{
+					indices.push_back((GLuint)mesh.indices[triangles[i] * 3 + k]);
+				}
+			}
+			for (size_t i = 0; i < vertices.size(); i++)
+			{
+				inMeshlet[vertices[i]] = false;
+			}
+			vertices.clear();
+			triangles.clear();
+		}
+	}
+}
+
+/***********************************************************
+ *  SetLods()
+ *
+ *  This method sets the levels of detail to draw and the
+ *  error in pixels allowed on the screen.
+ ***********************************************************/
+void MeshletRenderer::SetLods(const MeshSimplifier* pSimplifier, float maxPixels)
+{
+	m_pSimplifier = pSimplifier;
+	m_maxPixels = maxPixels;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the meshes, or takes every level of
+ *  detail, splits them into meshlets and uploads one vertex
+ *  and one index buffer for all of them, with position,
+ *  normal and texture coordinate at the attribute locations
+ *  of ShapeMeshes.
+ ***********************************************************/
+void MeshletRenderer::Initialize(int detail)
+{
+	Destroy();
+	m_detail = std::max(detail, 1);
+
+	std::vector<SceneGeometry::VERTEX> vertices;
+	std::vector<GLuint> indices;
+	size_t levelCount = 1;
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		MeshSimplifier::LOD_CHAIN chain;
+		if (NULL != m_pSimplifier)
+		{
+			chain = m_pSimplifier->GetChain((SceneManager::MESH_TYPE)type);
+		}
+		if (chain.empty())
+		{
+			chain.resize(1);
+			SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, chain[0].mesh, m_detail);
+			chain[0].error = 0.0f;
+		}
+
+		MESH_RANGE& range = m_meshes[type];
+		range.lods.clear();
+		range.sphere = SceneGeometry::ComputeBoundingSphere(chain[0].mesh);
+		range.bClosed = (type != SceneManager::MESH_PLANE);
+		for (size_t level = 0; level < chain.size(); level++)
+		{
+			const SceneGeometry::MESH& mesh = chain[level].mesh;
+			LOD_RANGE lod;
+			lod.firstMeshlet = (GLuint)m_meshlets.size();
+			lod.triangleCount = (GLuint)(mesh.indices.size() / 3);
+			lod.error = chain[level].error;
+
+			// the indices point into the merged vertex buffer
+			size_t firstIndex = indices.size();
+			BuildMeshlets(mesh, g_MaxMeshletVertices, g_MaxMeshletTriangles, m_meshlets, indices);
+			for (size_t i = firstIndex; i < indices.size(); i++)
+			{
+				indices[i] += (GLuint)vertices.size();
+			}
+			lod.meshletCount = (GLuint)m_meshlets.size() - lod.firstMeshlet;
+			vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+			range.lods.push_back(lod);
+		}
+		levelCount = std::max(levelCount, chain.size());
+	}
+	m_lodObjects.assign(levelCount, 0);
+
+	glGenVertexArrays(1, &m_vertexArray);
+	glBindVertexArray(m_vertexArray);
+	glGenBuffers(1, &m_vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(SceneGeometry::VERTEX), &vertices[0], GL_STATIC_DRAW);
+	GLDebugOutput::LabelObject(GL_BUFFER, m_vertexBuffer, "buffer:meshlets.vertices");
+	glGenBuffers(1, &m_indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices[0], GL_STATIC_DRAW);
+	GLDebugOutput::LabelObject(GL_BUFFER, m_indexBuffer, "buffer:meshlets.indices");
+	GLsizei stride = sizeof(SceneGeometry::VERTEX);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, position));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, normal));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(SceneGeometry::VERTEX, uv));
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	m_drawCounts.reserve(m_meshlets.size());
+	m_drawOffsets.reserve(m_meshlets.size());
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the buffers and the meshlets.
+ ***********************************************************/
+void MeshletRenderer::Destroy()
+{
+	GLuint* buffers[] = { &m_vertexBuffer, &m_indexBuffer };
+	for (int i = 0; i < 2; i++)
+	{
+		if (*buffers[i] != 0)
+		{
+			glDeleteBuffers(1, buffers[i]);
+			*buffers[i] = 0;
+		}
+	}
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+	m_meshlets.clear();
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method culls the meshlets of every object in the
+ *  draw list and draws the ones left. An object whose sphere
+ *  is inside every plane skips the frustum test of its
+ *  meshlets, and one outside a plane skips them all.
+ ***********************************************************/
+void MeshletRenderer::Render()
+{
+	if (m_meshlets.empty())
+	{
+		return;
+	}
+	double startTime = glfwGetTime();
+
+	glm::mat4 viewProjection = m_pViewManager->GetProjectionMatrix() * m_pViewManager->GetViewMatrix();
+	glm::vec4 planes[6];
+	VisibilityCache::ExtractFrustumPlanes(viewProjection, planes);
+	glm::vec3 cameraPosition;
+	glm::vec3 cameraFront;
+	float zoom = 0.0f;
+	m_pViewManager->GetCameraPose(cameraPosition, cameraFront, zoom);
+	// pixels per unit at a distance of one
+	GLint viewport[4] = { 0 };
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	float pixelScale = m_pViewManager->GetProjectionMatrix()[1][1] * (float)viewport[3] * 0.5f;
+
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->BeginPass("meshlets");
+	}
+	glBindVertexArray(m_vertexArray);
+
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = m_pSceneManager->GetSceneObjects();
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const SceneManager::SCENE_OBJECT& object = objects[i];
+		const MESH_RANGE& range = m_meshes[object.mesh];
+
+		glm::mat4 model = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+		glm::vec4 sphere = SceneGeometry::TransformSphere(model, range.sphere);
+		bool bOutside = false;
+		bool bInside = true;
+		for (int p = 0; p < 6; p++)
+		{
+			float distance = glm::dot(glm::vec3(planes[p]), glm::vec3(sphere)) + planes[p].w;
+			bOutside = bOutside || (distance < -sphere.w);
+			bInside = bInside && (distance > sphere.w);
+		}
+
+		// the largest axis scale of the model, for the meshlet spheres
+		// and the errors
+		float scale = SceneGeometry::TransformSphere(model, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f)).w;
+		float distance = glm::length(glm::vec3(sphere) - cameraPosition) - sphere.w;
+		size_t level = 0;
+		while ((level + 1 < range.lods.size()) &&
+			(MeshSimplifier::ProjectError(range.lods[level + 1].error, scale, distance, pixelScale) <= m_maxPixels))
+		{
+			level++;
+		}
+		const LOD_RANGE& lod = range.lods[level];
+		m_triangles += lod.triangleCount;
+		m_fullTriangles += range.lods[0].triangleCount;
+		if (bOutside)
+		{
+			m_frustumTriangles += lod.triangleCount;
+			continue;
+		}
+		m_lodObjects[level]++;
+		glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+		// the back of a translucent object shows through its front,
+		// so only opaque closed meshes may drop their back faces
+		bool bConeTest = range.bClosed && (object.bTextured || (object.color.a >= 1.0f));
+
+		m_drawCounts.clear();
+		m_drawOffsets.clear();
+		for (GLuint m = lod.firstMeshlet; m < lod.firstMeshlet + lod.meshletCount; m++)
+		{
+			const MESHLET& meshlet = m_meshlets[m];
+			glm::vec3 center(meshlet.sphere);
+
+			if (bConeTest)
+			{
+				glm::vec3 offset = center - localCamera;
+				if (glm::dot(offset, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(offset) + meshlet.sphere.w)
+				{
+					m_coneTriangles += meshlet.triangleCount;
+					continue;
+				}
+			}
+
+			if (!bInside)
+			{
+				glm::vec3 worldCenter = glm::vec3(model * glm::vec4(center, 1.0f));
+				float radius = meshlet.sphere.w * scale;
+				bool bCulled = false;
+				for (int p = 0; (p < 6) && !bCulled; p++)
+				{
+					bCulled = (glm::dot(glm::vec3(planes[p]), worldCenter) + planes[p].w < -radius);
+				}
+				if (bCulled)
+				{
+					m_frustumTriangles += meshlet.triangleCount;
+					continue;
+				}
+			}
+
+			// a meshlet that follows the last range extends it
+			GLsizei count = (GLsizei)(meshlet.triangleCount * 3);
+			const void* offset = (const void*)(meshlet.firstIndex * sizeof(GLuint));
+			if (!m_drawCounts.empty() &&
+				((const char*)m_drawOffsets.back() + m_drawCounts.back() * sizeof(GLuint) == (const char*)offset))
+			{
+				m_drawCounts.back() += count;
+			}
+			else
+			{
+				m_drawCounts.push_back(count);
+				m_drawOffsets.push_back(offset);
+			}
+			m_drawnMeshlets++;
+		}
+
+		if (m_drawCounts.empty())
+		{
+			continue;
+		}
+		m_pShaderManager->setMat4Value("model", model);
+		m_pSceneManager->ApplyObjectState(object);
+		glMultiDrawElements(GL_TRIANGLES, &m_drawCounts[0], GL_UNSIGNED_INT, &m_drawOffsets[0], (GLsizei)m_drawCounts.size());
+		m_draws += (long long)m_drawCounts.size();
+	}
+
+	glBindVertexArray(0);
+	if (NULL != m_pGpuProfiler)
+	{
+		m_pGpuProfiler->EndPass();
+	}
+	m_cpuSeconds += glfwGetTime() - startTime;
+	m_frames++;
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints how full the meshlets are and which
+ *  share of the triangles the two tests removed per frame.
+ ***********************************************************/
+void MeshletRenderer::PrintReport() const
+{
+	if ((m_frames == 0) || m_meshlets.empty())
+	{
+		return;
+	}
+
+	double vertices = 0.0;
+	double triangles = 0.0;
+	for (size_t i = 0; i < m_meshlets.size(); i++)
+	{
+		vertices += (double)m_meshlets[i].vertexCount;
+		triangles += (double)m_meshlets[i].triangleCount;
+	}
+	double meshlets = (double)m_meshlets.size();
+	double frames = (double)m_frames;
+	double submitted = std::max((double)m_triangles, 1.0);
+
+	std::cout << std::fixed << std::setprecision(1) << "INFO: Meshlets: " << m_meshlets.size() << " meshlets over "
+		<< (long long)triangles << " triangles at detail " << m_detail << ", " << vertices / meshlets
+		<< " vertices and " << triangles / meshlets << " triangles each" << std::endl;
+	std::cout << "INFO: Meshlets: " << (double)(m_frustumTriangles + m_coneTriangles) * 100.0 / submitted
+		<< "% of the triangles culled, " << (double)m_frustumTriangles * 100.0 / submitted << "% by the frustum and "
+		<< (double)m_coneTriangles * 100.0 / submitted << "% facing away, " << (double)m_drawnMeshlets / frames
+		<< " meshlets in " << (double)m_draws / frames << " ranges per frame" << std::endl;
+	if (m_lodObjects.size() > 1)
+	{
+		std::cout << "INFO: Meshlets: levels of detail drew " << (double)m_triangles * 100.0 / std::max((double)m_fullTriangles, 1.0)
+			<< "% of the full triangles, objects per frame by level:";
+		for (size_t level = 0; level < m_lodObjects.size(); level++)
+		{
+			std::cout << " " << (double)m_lodObjects[level] / frames;
+		}
+		std::cout << std::endl;
+	}
+	std::cout << std::setprecision(3) << "INFO: Meshlets CPU time: " << m_cpuSeconds * 1000.0 / frames
+		<< " ms per frame over " << m_frames << " frames" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// meshletrenderer.h
+// ============
+// split the meshes into meshlets and cull them before drawing
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GpuProfiler.h"
+#include "MeshSimplifier.h"
+#include "SceneGeometry.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+#include "ViewManager.h"
+
+#include <vector>
+
+/***********************************************************
+ *  MeshletRenderer
+ *
+ *  This class splits the basic meshes, tessellated finer
+ *  than the GPU meshes, into small clusters of connected
+ *  triangles. Every cluster keeps a bounding sphere and a
+ *  cone around the normals of its triangles. Each frame the
+ *  clusters of every object are tested on the CPU: the ones
+ *  outside the frustum, and the ones whose triangles all
+ *  face away from the camera, are left out, and the rest are
+ *  drawn with one multi-draw per object. With levels of
+ *  detail, each object draws the meshlets of the coarsest
+ *  level whose error stays under a number of pixels.
+ ***********************************************************/
+class MeshletRenderer
+{
+public:
+	struct MESHLET
+	{
+		// range in the index buffer, ordered by meshlet
+		GLuint firstIndex;
+		GLuint triangleCount;
+		GLuint vertexCount;
+		// object space bounding sphere, center in xyz and radius in w
+		glm::vec4 sphere;
+		// average normal, and the sine of the angle between it and
+		// the furthest normal; above 1 when the normals spread too
+		// far for the cone to cull anything
+		glm::vec3 coneAxis;
+		float coneCutoff;
+	};
+
+	// constructor
+	MeshletRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager, ViewManager* pViewManager);
+	// destructor
+	~MeshletRenderer();
+
+	// draw the levels of a simplifier, chosen by their error on
+	// the screen; set before Initialize()
+	void SetLods(const MeshSimplifier* pSimplifier, float maxPixels);
+	// build the meshes with the given detail, or take the levels
+	// of detail, split them into meshlets and upload them
+	void Initialize(int detail);
+	// free the buffers
+	void Destroy();
+
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+	// cull and draw the draw list with the current scene program
+	void Render();
+
+	// split a mesh into meshlets of connected triangles, appending
+	// their triangles to the indices in meshlet order
+	static void BuildMeshlets(const SceneGeometry::MESH& mesh, int maxVertices, int maxTriangles,
+		std::vector<MESHLET>& meshlets, std::vector<GLuint>& indices);
+
+	// print the meshlet sizes and the share of the triangles
+	// culled per frame, by frustum and by cone
+	void PrintReport() const;
+
+private:
+	// meshlets of one level of detail of a mesh
+	struct LOD_RANGE
+	{
+		GLuint firstMeshlet;
+		GLuint meshletCount;
+		GLuint triangleCount;
+		// object space error of the level
+		float error;
+	};
+
+	// levels of a mesh and its bounds
+	struct MESH_RANGE
+	{
+		std::vector<LOD_RANGE> lods;
+		glm::vec4 sphere;
+		// open surfaces are seen from both sides, so their cones
+		// are not used
+		bool bClosed;
+	};
+
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+	ViewManager* m_pViewManager;
+	GpuProfiler* m_pGpuProfiler;
+
+	GLuint m_vertexArray;
+	GLuint m_vertexBuffer;
+	GLuint m_indexBuffer;
+	MESH_RANGE m_meshes[SceneManager::MESH_COUNT];
+	std::vector<MESHLET> m_meshlets;
+	int m_detail;
+	const MeshSimplifier* m_pSimplifier;
+	float m_maxPixels;
+	// kept between frames so drawing does not allocate
+	std::vector<GLsizei> m_drawCounts;
+	std::vector<const void*> m_drawOffsets;
+
+	long m_frames;
+	double m_cpuSeconds;
+	long long m_triangles;
+	long long m_frustumTriangles;
+	long long m_coneTriangles;
+	long long m_drawnMeshlets;
+	long long m_draws;
+	// triangles the full meshes would have drawn, and the objects
+	// drawn at each level
+	long long m_fullTriangles;
+	std::vector<long long> m_lodObjects;
+};
@@ -0,0 +1,270 @@
+///////////////////////////////////////////////////////////////////////////////
+// MultiViewRenderer.cpp
+// =====================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `MultiViewRenderer` class, which draws quad view
+// and surveillance style grids of the scene without repeating the draw
+// list once per camera.
+//
+// FUNCTIONALITY:
+// - Insert a geometry shader between the scene vertex and fragment
+//   shaders. It is invoked once per view and writes gl_ViewportIndex.
+// - Reject triangles that lie outside a view's frustum before they reach
+//   the rasterizer of that view.
+// - Lay the views out in a grid of viewports and upload all view matrices
+//   with a single uniform call per frame.
+//
+// NOTES:
+// The vertex shader outputs are renamed in the source text so that the
+// geometry stage can pass them on under the names the fragment shader
+// expects. The fragment shader has a single viewPosition uniform, so the
+// specular highlights of every view use the position of the first view.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "MultiViewRenderer.h"
+#include "ShaderUtils.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// declaration of the global variables and defines
+namespace
+{
+	// the orbit views circle the scene at the default camera distance
+	const glm::vec3 g_SceneCenter = glm::vec3(0.0f, 2.0f, 0.0f);
+	const float g_OrbitRadius = 13.0f;
+
+	// runs once per view for each triangle of the scene
+	const char* g_GeometryShader =
+		"#version 410 core\n"
+		"layout(triangles, invocations = 16) in;\n"
+		"layout(triangle_strip, max_vertices = 3) out;\n"
+		"uniform int viewCount;\n"
+		"uniform mat4 viewProjections[16];\n"
+		"in vec3 multiViewPosition[];\n"
+		"in vec3 multiViewNormal[];\n"
+		"in vec2 multiViewTextureCoordinate[];\n"
+		"out vec3 fragmentPosition;\n"
+		"out vec3 fragmentVertexNormal;\n"
+		"out vec2 fragmentTextureCoordinate;\n"
+		"void main()\n"
+		"{\n"
+		"	if (gl_InvocationID >= viewCount) return;\n"
+		"	vec4 clip[3];\n"
+		"	for (int i = 0; i < 3; i++)\n"
+		"		clip[i] = viewProjections[gl_InvocationID] * vec4(multiViewPosition[i], 1.0);\n"
+		"	// skip the triangle if all corners are outside one plane\n"
+		"	for (int axis = 0; axis < 3; axis++)\n"
+		"	{\n"
+		"		if (clip[0][axis] > clip[0].w && clip[1][axis] > clip[1].w && clip[2][axis] > clip[2].w) return;\n"
+		"		if (clip[0][axis] < -clip[0].w && clip[1][axis] < -clip[1].w && clip[2][axis] < -clip[2].w) return;\n"
+		"	}\n"
+		"	for (int i = 0; i < 3; i++)\n"
+		"	{\n"
+		"		gl_Position = clip[i];\n"
+		"		gl_ViewportIndex = gl_InvocationID;\n"
+		"		fragmentPosition = multiViewPosition[i];\n"
+		"		fragmentVertexNormal = multiViewNormal[i];\n"
+		"		fragmentTextureCoordinate = multiViewTextureCoordinate[i];\n"
+		"		EmitVertex();\n"
+		"	}\n"
+		"	EndPrimitive();\n"
+		"}\n";
+}
+
+/***********************************************************
+ *  MultiViewRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MultiViewRenderer::MultiViewRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager)
+{
+	m_pShaderManager = pShaderManager;
+	m_pSceneManager = pSceneManager;
+	m_program = 0;
+	m_viewProjectionsLocation = -1;
+	m_viewCountLocation = -1;
+	m_viewCount = 0;
+}
+
+/***********************************************************
+ *  ~MultiViewRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MultiViewRenderer::~MultiViewRenderer()
+{
+	Destroy();
+	m_pShaderManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the multi-view program and sets the
+ *  scene lights into it.
+ ***********************************************************/
+bool MultiViewRenderer::Initialize(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	if (!GLEW_VERSION_4_1 && !(GLEW_ARB_viewport_array && GLEW_ARB_gpu_shader5))
+	{
+		std::cout << "WARNING: Multi-view rendering needs viewport arrays and geometry shader instancing" << std::endl;
+		return(false);
+	}
+
+	std::string vertexSource;
+	std::string fragmentSource;
+	if (!ShaderUtils::ReadFile(vertexShader, vertexSource) || !ShaderUtils::ReadFile(fragmentShader, fragmentSource))
+	{
+		return(false);
+	}
+
+	// the vertex outputs become the inputs of the geometry stage
+	ShaderUtils::ReplaceAll(vertexSource, "fragmentPosition", "multiViewPosition");
+	ShaderUtils::ReplaceAll(vertexSource, "fragmentVertexNormal", "multiViewNormal");
+	ShaderUtils::ReplaceAll(vertexSource, "fragmentTextureCoordinate", "multiViewTextureCoordinate");
+
+	std::vector<GLuint> shaders;
+	shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, vertexSource, "multi-view.vert"));
+	shaders.push_back(ShaderUtils::CompileShader(GL_GEOMETRY_SHADER, g_GeometryShader, "multi-view.geom"));
+	shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, fragmentSource, "multi-view.frag"));
+	m_program = ShaderUtils::LinkProgram(shaders, "multi-view");
+	if (m_program == 0)
+	{
+		return(false);
+	}
+
+	m_viewProjectionsLocation = glGetUniformLocation(m_program, "viewProjections");
+	m_viewCountLocation = glGetUniformLocation(m_program, "viewCount");
+
+	// the lights are set once, like in the scene program
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+	m_pSceneManager->SetupSceneLights();
+	m_pShaderManager->setMat4Value("view", glm::mat4(1.0f));
+	m_pShaderManager->setMat4Value("projection", glm::mat4(1.0f));
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the multi-view program.
+ ***********************************************************/
+void MultiViewRenderer::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  SetDefaultViews()
+ *
+ *  This method sets up the quad layout cameras, and views
+ *  around the scene for any further cells.
+ ***********************************************************/
+void MultiViewRenderer::SetDefaultViews(int count)
+{
+	m_viewCount = (count < 1) ? 1 : ((count > MAX_VIEWS) ? MAX_VIEWS : count);
+
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		VIEW& view = m_views[i];
+		view.fov = 60.0f;
+
+		switch (i)
+		{
+		case 1:
+			// top, tilted slightly so the up vector stays valid
+			view.position = g_SceneCenter + glm::vec3(0.0f, g_OrbitRadius, 0.5f);
+			break;
+		case 2:
+			// front
+			view.position = g_SceneCenter + glm::vec3(0.0f, 0.0f, g_OrbitRadius);
+			break;
+		case 3:
+			// side
+			view.position = g_SceneCenter + glm::vec3(g_OrbitRadius, 0.0f, 0.0f);
+			break;
+		default:
+			{
+				float angle = 6.2831853f * (float)i / (float)m_viewCount;
+				view.position = g_SceneCenter + glm::vec3(g_OrbitRadius * sinf(angle), 3.0f, g_OrbitRadius * cosf(angle));
+			}
+			break;
+		}
+		view.front = glm::normalize(g_SceneCenter - view.position);
+	}
+}
+
+/***********************************************************
+ *  SetView()
+ *
+ *  This method replaces the camera of one cell.
+ ***********************************************************/
+void MultiViewRenderer::SetView(int index, const VIEW& view)
+{
+	if ((index >= 0) && (index < m_viewCount))
+	{
+		m_views[index] = view;
+	}
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method sets one viewport and one matrix per view
+ *  and draws the scene once for all of them.
+ ***********************************************************/
+void MultiViewRenderer::Render(int width, int height)
+{
+	if ((m_program == 0) || (m_viewCount == 0) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	// the grid is as square as the view count allows
+	int columns = (int)ceil(sqrt((double)m_viewCount));
+	int rows = (m_viewCount + columns - 1) / columns;
+	float cellWidth = (float)width / (float)columns;
+	float cellHeight = (float)height / (float)rows;
+
+	GLfloat viewports[MAX_VIEWS * 4];
+	glm::mat4 viewProjections[MAX_VIEWS];
+	for (int i = 0; i < m_viewCount; i++)
+	{
+		// the first view is in the top left cell
+		viewports[i * 4 + 0] = (float)(i % columns) * cellWidth;
+		viewports[i * 4 + 1] = (float)height - (float)(i / columns + 1) * cellHeight;
+		viewports[i * 4 + 2] = cellWidth;
+		viewports[i * 4 + 3] = cellHeight;
+
+		const VIEW& view = m_views[i];
+		glm::mat4 projection = glm::perspective(glm::radians(view.fov), cellWidth / cellHeight, 0.1f, 100.0f);
+		viewProjections[i] = projection *
+			glm::lookAt(view.position, view.position + view.front, glm::vec3(0.0f, 1.0f, 0.0f));
+	}
+
+	GLuint sceneProgram = ShaderUtils::SwapProgram(m_pShaderManager, m_program);
+	glUniform1i(m_viewCountLocation, m_viewCount);
+	glUniformMatrix4fv(m_viewProjectionsLocation, m_viewCount, GL_FALSE, &viewProjections[0][0][0]);
+	m_pShaderManager->setVec3Value("viewPosition", m_views[0].position);
+	glViewportArrayv(0, m_viewCount, viewports);
+
+	m_pSceneManager->RenderScene();
+
+	// glViewport resets every viewport of the array
+	glViewport(0, 0, width, height);
+	ShaderUtils::SwapProgram(m_pShaderManager, sceneProgram);
+}
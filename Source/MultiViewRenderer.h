@@ -0,0 +1,72 @@
+///////////////////////////////////////////////////////////////////////////////
+// multiviewrenderer.h
+// ============
+// draw the scene from several cameras in a single geometry pass
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "SceneManager.h"
+#include "ShaderManager.h"
+
+#include <string>
+
+/***********************************************************
+ *  MultiViewRenderer
+ *
+ *  This class renders the scene into a grid of viewports,
+ *  one per camera, with one pass over the draw list. The
+ *  scene shaders get a geometry stage that runs once per
+ *  view (instanced geometry shader invocations), transforms
+ *  the triangle with that view's matrix and routes it to the
+ *  view's viewport through gl_ViewportIndex. The number of
+ *  draw calls and uniform updates stays that of one view.
+ ***********************************************************/
+class MultiViewRenderer
+{
+public:
+	// at least 16 viewports are guaranteed by ARB_viewport_array
+	static const int MAX_VIEWS = 16;
+
+	// one camera of the grid
+	struct VIEW
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		// vertical field of view, in degrees
+		float fov;
+	};
+
+	// constructor
+	MultiViewRenderer(ShaderManager* pShaderManager, SceneManager* pSceneManager);
+	// destructor
+	~MultiViewRenderer();
+
+	// build the multi-view program from the scene shader files
+	bool Initialize(const std::string& vertexShader, const std::string& fragmentShader);
+	// free the program
+	void Destroy();
+
+	// use the quad layout cameras (top, front, side) followed
+	// by views around the scene for the remaining cells
+	void SetDefaultViews(int count);
+	// replace one camera, e.g. to follow the interactive one
+	void SetView(int index, const VIEW& view);
+	int GetViewCount() const { return(m_viewCount); }
+
+	// draw every view into its cell of the framebuffer
+	void Render(int width, int height);
+
+private:
+	ShaderManager* m_pShaderManager;
+	SceneManager* m_pSceneManager;
+	GLuint m_program;
+	GLint m_viewProjectionsLocation;
+	GLint m_viewCountLocation;
+
+	int m_viewCount;
+	VIEW m_views[MAX_VIEWS];
+};
@@ -0,0 +1,281 @@
+///////////////////////////////////////////////////////////////////////////////
+// ObjectPicker.cpp
+// ================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `ObjectPicker` class, which selects the scene
+// object under the cursor with a ray cast on the CPU.
+//
+// FUNCTIONALITY:
+// - Build the basic meshes once, and for every object its world bounding
+//   sphere and the inverse of its model matrix. The draw list can be
+//   repeated in a grid, like the GPU culler does, to measure large object
+//   counts.
+// - Ask a loose octree for the spheres the ray passes through, and sort
+//   them by the distance where the ray enters them.
+// - Move the ray into the space of each candidate and test the triangles
+//   of its mesh with the Moller-Trumbore test, keeping the closest hit.
+//   The direction is not normalized after the move, so the distances
+//   stay in world units and compare across objects.
+// - Stop at the first candidate whose sphere starts behind the closest
+//   hit, so a pick usually tests one or two meshes.
+//
+// NOTES:
+// Nothing is read back from the GPU, so a pick never waits for the frames
+// in flight. Triangles are hit from both sides, like the scene draws them
+// without culling.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "ObjectPicker.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  ObjectPicker()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ObjectPicker::ObjectPicker()
+{
+	m_pOctree = NULL;
+	m_picks = 0;
+	m_hits = 0;
+	m_candidateCount = 0;
+	m_meshTests = 0;
+	m_seconds = 0.0;
+
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, m_meshes[type]);
+	}
+}
+
+/***********************************************************
+ *  ~ObjectPicker()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ObjectPicker::~ObjectPicker()
+{
+	if (NULL != m_pOctree)
+	{
+		delete m_pOctree;
+		m_pOctree = NULL;
+	}
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method places the objects, repeated in a square
+ *  grid when more than one copy is asked for, and sorts
+ *  their spheres into a new octree around all of them.
+ ***********************************************************/
+void ObjectPicker::Build(const std::vector<SceneManager::SCENE_OBJECT>& objects, int copies)
+{
+	copies = std::max(copies, 1);
+	m_instances.clear();
+	if (NULL != m_pOctree)
+	{
+		delete m_pOctree;
+		m_pOctree = NULL;
+	}
+	if (objects.empty())
+	{
+		return;
+	}
+
+	std::vector<glm::vec4> spheres;
+	SceneGeometry::ComputeObjectSpheres(objects, spheres);
+
+	// the copies are spaced by the extent of the scene
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	for (size_t i = 0; i < spheres.size(); i++)
+	{
+		minimum = glm::min(minimum, glm::vec3(spheres[i]) - spheres[i].w);
+		maximum = glm::max(maximum, glm::vec3(spheres[i]) + spheres[i].w);
+	}
+	float spacing = std::max(maximum.x - minimum.x, maximum.z - minimum.z) * 1.2f;
+	int columns = (int)ceil(sqrt((double)copies));
+
+	m_instances.reserve(objects.size() * copies);
+	glm::vec3 worldMin(1e30f);
+	glm::vec3 worldMax(-1e30f);
+	for (int copy = 0; copy < copies; copy++)
+	{
+		glm::vec3 offset((float)(copy % columns) * spacing, 0.0f, -(float)(copy / columns) * spacing);
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			const SceneManager::SCENE_OBJECT& object = objects[i];
+			glm::mat4 model = glm::translate(offset) *
+				SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+
+			INSTANCE instance;
+			instance.inverseModel = glm::inverse(model);
+			instance.sphere = spheres[i] + glm::vec4(offset, 0.0f);
+			instance.object = (int)i;
+			instance.copy = copy;
+			instance.mesh = object.mesh;
+			m_instances.push_back(instance);
+
+			worldMin = glm::min(worldMin, glm::vec3(instance.sphere) - instance.sphere.w);
+			worldMax = glm::max(worldMax, glm::vec3(instance.sphere) + instance.sphere.w);
+		}
+	}
+
+	glm::vec3 extent = (worldMax - worldMin) * 0.5f;
+	m_pOctree = new LooseOctree((worldMin + worldMax) * 0.5f, std::max(extent.x, std::max(extent.y, extent.z)));
+	for (size_t i = 0; i < m_instances.size(); i++)
+	{
+		m_pOctree->Insert(m_instances[i].sphere, (int)i);
+	}
+	m_queryResults.reserve(256);
+	m_candidates.reserve(256);
+}
+
+/***********************************************************
+ *  IntersectMesh()
+ *
+ *  This method tests every triangle of a mesh against a ray
+ *  with the Moller-Trumbore test.
+ ***********************************************************/
+bool ObjectPicker::IntersectMesh(const SceneGeometry::MESH& mesh, const glm::vec3& origin, const glm::vec3& direction, float& distance) const
+{
+	bool bHit = false;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const glm::vec3& v0 = mesh.vertices[mesh.indices[i]].position;
+		glm::vec3 edge1 = mesh.vertices[mesh.indices[i + 1]].position - v0;
+		glm::vec3 edge2 = mesh.vertices[mesh.indices[i + 2]].position - v0;
+
+		glm::vec3 p = glm::cross(direction, edge2);
+		float determinant = glm::dot(edge1, p);
+		if (fabsf(determinant) < 1.0e-12f)
+		{
+			continue;
+		}
+		float inverse = 1.0f / determinant;
+		glm::vec3 s = origin - v0;
+		float u = glm::dot(s, p) * inverse;
+		if ((u < 0.0f) || (u > 1.0f))
+		{
+			continue;
+		}
+		glm::vec3 q = glm::cross(s, edge1);
+		float v = glm::dot(direction, q) * inverse;
+		if ((v < 0.0f) || (u + v > 1.0f))
+		{
+			continue;
+		}
+		float t = glm::dot(edge2, q) * inverse;
+		if ((t >= 0.0f) && (t < distance))
+		{
+			distance = t;
+			bHit = true;
+		}
+	}
+	return(bHit);
+}
+
+/***********************************************************
+ *  Pick()
+ *
+ *  This method finds the closest object along a ray. The
+ *  candidates are tested front to back by the entry point
+ *  of their sphere, which lets the search end early.
+ ***********************************************************/
+bool ObjectPicker::Pick(const glm::vec3& origin, const glm::vec3& direction, HIT& hit)
+{
+	typedef std::chrono::steady_clock CLOCK;
+	CLOCK::time_point start = CLOCK::now();
+
+	hit.object = -1;
+	hit.copy = -1;
+	hit.distance = 1e30f;
+	hit.position = origin;
+	if (NULL == m_pOctree)
+	{
+		return(false);
+	}
+
+	m_queryResults.clear();
+	m_pOctree->QueryRay(origin, direction, 1e30f, m_queryResults);
+
+	m_candidates.clear();
+	for (size_t i = 0; i < m_queryResults.size(); i++)
+	{
+		// where the ray enters the sphere, 0 when it starts inside
+		const glm::vec4& sphere = m_instances[m_queryResults[i]].sphere;
+		glm::vec3 offset = glm::vec3(sphere) - origin;
+		float along = glm::dot(offset, direction);
+		float inside = sphere.w * sphere.w - (glm::dot(offset, offset) - along * along);
+		CANDIDATE candidate;
+		candidate.entry = std::max(along - sqrtf(std::max(inside, 0.0f)), 0.0f);
+		candidate.instance = m_queryResults[i];
+		m_candidates.push_back(candidate);
+	}
+	std::sort(m_candidates.begin(), m_candidates.end());
+
+	float distance = 1e30f;
+	int closest = -1;
+	for (size_t i = 0; i < m_candidates.size(); i++)
+	{
+		if (m_candidates[i].entry > distance)
+		{
+			break;
+		}
+		const INSTANCE& instance = m_instances[m_candidates[i].instance];
+		glm::vec3 localOrigin = glm::vec3(instance.inverseModel * glm::vec4(origin, 1.0f));
+		glm::vec3 localDirection = glm::mat3(instance.inverseModel) * direction;
+		m_meshTests++;
+		if (IntersectMesh(m_meshes[instance.mesh], localOrigin, localDirection, distance))
+		{
+			closest = m_candidates[i].instance;
+		}
+	}
+
+	m_picks++;
+	m_candidateCount += (long long)m_candidates.size();
+	if (closest >= 0)
+	{
+		hit.object = m_instances[closest].object;
+		hit.copy = m_instances[closest].copy;
+		hit.distance = distance;
+		hit.position = origin + direction * distance;
+		m_hits++;
+	}
+	m_seconds += std::chrono::duration<double>(CLOCK::now() - start).count();
+	return(closest >= 0);
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints how many picks ran, their average
+ *  time and how many spheres and meshes each one tested.
+ ***********************************************************/
+void ObjectPicker::PrintReport() const
+{
+	if (m_picks == 0)
+	{
+		return;
+	}
+
+	double picks = (double)m_picks;
+	std::cout << std::fixed << std::setprecision(2) << "INFO: Picking: " << m_picks << " picks over "
+		<< m_instances.size() << " objects, " << m_seconds * 1e6 / picks << " us each ("
+		<< std::setprecision(0) << picks / std::max(m_seconds, 1e-9) << " picks/sec), "
+		<< std::setprecision(1) << (double)m_hits * 100.0 / picks << "% hits" << std::endl;
+	std::cout << std::setprecision(2) << "INFO: Picking: " << (double)m_candidateCount / picks
+		<< " spheres on the ray and " << (double)m_meshTests / picks << " meshes tested per pick" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// objectpicker.h
+// ============
+// select the scene object under the cursor on the CPU
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "LooseOctree.h"
+#include "SceneGeometry.h"
+#include "SceneManager.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  ObjectPicker
+ *
+ *  This class finds the object a ray hits first without
+ *  reading anything back from the GPU. The bounding spheres
+ *  of the objects sit in a loose octree; the spheres along
+ *  the ray are sorted by where the ray enters them, and the
+ *  triangles of their meshes are tested exactly, in object
+ *  space, until the next sphere starts behind the closest
+ *  hit found so far.
+ ***********************************************************/
+class ObjectPicker
+{
+public:
+	struct HIT
+	{
+		// index into the draw list, -1 when nothing was hit
+		int object;
+		// copy of the draw list the object belongs to
+		int copy;
+		float distance;
+		glm::vec3 position;
+	};
+
+	// constructor
+	ObjectPicker();
+	// destructor
+	~ObjectPicker();
+
+	// index the draw list, repeated in a grid of copies to
+	// measure large object counts like the GPU culler
+	void Build(const std::vector<SceneManager::SCENE_OBJECT>& objects, int copies = 1);
+
+	// the closest object along a ray with a normalized direction;
+	// false when the ray hits nothing
+	bool Pick(const glm::vec3& origin, const glm::vec3& direction, HIT& hit);
+
+	int GetObjectCount() const { return((int)m_instances.size()); }
+	// print the pick count, the average time and the work per pick
+	void PrintReport() const;
+
+private:
+	// one placed object, with its world to object transform
+	struct INSTANCE
+	{
+		glm::mat4 inverseModel;
+		glm::vec4 sphere;
+		int object;
+		int copy;
+		SceneManager::MESH_TYPE mesh;
+	};
+
+	// a sphere on the ray and the distance where the ray enters it
+	struct CANDIDATE
+	{
+		float entry;
+		int instance;
+		bool operator<(const CANDIDATE& other) const { return(entry < other.entry); }
+	};
+
+	SceneGeometry::MESH m_meshes[SceneManager::MESH_COUNT];
+	std::vector<INSTANCE> m_instances;
+	LooseOctree* m_pOctree;
+	// kept between picks so picking does not allocate
+	std::vector<int> m_queryResults;
+	std::vector<CANDIDATE> m_candidates;
+
+	long long m_picks;
+	long long m_hits;
+	long long m_candidateCount;
+	long long m_meshTests;
+	double m_seconds;
+
+	// closest triangle of a mesh hit by an object space ray
+	// before maxDistance; the distance is left unchanged on a miss
+	bool IntersectMesh(const SceneGeometry::MESH& mesh, const glm::vec3& origin, const glm::vec3& direction, float& distance) const;
+};
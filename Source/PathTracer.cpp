@@ -0,0 +1,1086 @@
+///////////////////////////////////////////////////////////////////////////////
+// PathTracer.cpp
+// ==============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `PathTracer` class, an offline renderer for
+// reference stills of the scene. It reads the same meshes, materials,
+// textures and lights as the OpenGL path through `SceneGeometry`.
+//
+// FUNCTIONALITY:
+// - Transform every object's triangles into world space and build a
+//   binary BVH with the binned surface area heuristic, then collapse it
+//   into four wide nodes.
+// - Test the four child boxes of a node in one go with SSE2, with a
+//   scalar version for other processors.
+// - Trace one path per pixel and pass: the scene lights are sampled
+//   directly with shadow rays and the Phong terms of the scene shader,
+//   and the indirect light follows cosine weighted diffuse bounces with
+//   Russian roulette.
+// - Deal the tiles of a pass round robin to one queue per worker; a
+//   worker whose queue runs dry steals from the back of another queue.
+// - Save and load the accumulation so a still can be refined over
+//   several runs. A save writes a temporary file next to the old one
+//   and renames it over the old one, so a run killed in the middle of a
+//   checkpoint keeps the previous accumulation.
+//
+// NOTES:
+// The scene lights have no falloff, like in the fragment shader. Rays
+// that leave the scene after a bounce pick up the sum of the ambient
+// light colors, which stands in for the ambient term; camera rays that
+// miss stay black like the cleared frame. Translucent objects let paths
+// and shadow rays through with a probability of one minus their alpha.
+// The random numbers are seeded per pixel and sample, so the image does
+// not depend on which worker traced a tile.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "PathTracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define PATH_TRACER_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	const char* g_AccumulationMagic = "PTACCUM1";
+	const float g_Pi = 3.14159265f;
+	// rays start this far from the surface they leave
+	const float g_RayOffset = 1.0e-3f;
+	const float g_Infinity = 1.0e30f;
+	// bounces before Russian roulette may end a path
+	const int g_MinBounces = 2;
+	const int g_MaxBounces = 8;
+	// translucent surfaces a path may pass through
+	const int g_MaxSegments = 16;
+	const int g_MaxLeafTriangles = 4;
+	const int g_SahBins = 12;
+	const int g_StackSize = 64;
+
+	/***********************************************************
+	 *  ReplaceWithFile()
+	 *
+	 *  Renames a file over another one, replacing it in one
+	 *  step where the file system allows it.
+	 ***********************************************************/
+	bool ReplaceWithFile(const std::string& source, const std::string& target)
+	{
+#ifdef _WIN32
+		return(MoveFileExA(source.c_str(), target.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0);
+#else
+		return(rename(source.c_str(), target.c_str()) == 0);
+#endif
+	}
+
+	/***********************************************************
+	 *  BOUNDS
+	 *
+	 *  An axis aligned box.
+	 ***********************************************************/
+	struct BOUNDS
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+
+		BOUNDS() : min(g_Infinity), max(-g_Infinity) {}
+		void Grow(const glm::vec3& point) { min = glm::min(min, point); max = glm::max(max, point); }
+		void Grow(const BOUNDS& other) { min = glm::min(min, other.min); max = glm::max(max, other.max); }
+		float Area() const
+		{
+			glm::vec3 size = glm::max(max - min, glm::vec3(0.0f));
+			return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+		}
+	};
+
+	/***********************************************************
+	 *  BUILD_NODE
+	 *
+	 *  A node of the binary BVH before it is collapsed; a leaf
+	 *  has no children and covers count references at first.
+	 ***********************************************************/
+	struct BUILD_NODE
+	{
+		BOUNDS bounds;
+		int children[2];
+		int first;
+		int count;
+	};
+
+	/***********************************************************
+	 *  BUILDER
+	 *
+	 *  The state of one binary BVH build.
+	 ***********************************************************/
+	struct BUILDER
+	{
+		std::vector<BOUNDS> triangleBounds;
+		std::vector<glm::vec3> centroids;
+		std::vector<uint32_t> references;
+		std::vector<BUILD_NODE> nodes;
+
+		/***********************************************************
+		 *  Build()
+		 *
+		 *  Splits the references from first to first + count at
+		 *  the cheapest of the binned planes and returns the node.
+		 ***********************************************************/
+		int Build(int first, int count)
+		{
+			BUILD_NODE node;
+			node.children[0] = -1;
+			node.children[1] = -1;
+			node.first = first;
+			node.count = count;
+			BOUNDS centroidBounds;
+			for (int i = first; i < first + count; i++)
+			{
+				node.bounds.Grow(triangleBounds[references[i]]);
+				centroidBounds.Grow(centroids[references[i]]);
+			}
+
+			int nodeIndex = (int)nodes.size();
+			nodes.push_back(node);
+			if (count <= g_MaxLeafTriangles)
+			{
+				return(nodeIndex);
+			}
+
+			// find the cheapest split over the bins of every axis
+			float bestCost = node.bounds.Area() * (float)count;
+			int bestAxis = -1;
+			int bestBin = 0;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+				if (extent <= 0.0f)
+				{
+					continue;
+				}
+
+				BOUNDS bins[g_SahBins];
+				int binCounts[g_SahBins] = { 0 };
+				for (int i = first; i < first + count; i++)
+				{
+					int bin = std::min(g_SahBins - 1,
+						(int)((centroids[references[i]][axis] - centroidBounds.min[axis]) / extent * g_SahBins));
+					bins[bin].Grow(triangleBounds[references[i]]);
+					binCounts[bin]++;
+				}
+
+				// areas and counts to the right of each plane
+				float rightAreas[g_SahBins];
+				int rightCounts[g_SahBins];
+				BOUNDS right;
+				int rightCount = 0;
+				for (int bin = g_SahBins - 1; bin > 0; bin--)
+				{
+					right.Grow(bins[bin]);
+					rightCount += binCounts[bin];
+					rightAreas[bin] = right.Area();
+					rightCounts[bin] = rightCount;
+				}
+
+				BOUNDS left;
+				int leftCount = 0;
+				for (int bin = 0; bin < g_SahBins - 1; bin++)
+				{
+					left.Grow(bins[bin]);
+					leftCount += binCounts[bin];
+					if ((leftCount == 0) || (rightCounts[bin + 1] == 0))
+					{
+						continue;
+					}
+					float cost = left.Area() * (float)leftCount + rightAreas[bin + 1] * (float)rightCounts[bin + 1];
+					if (cost < bestCost)
+					{
+						bestCost = cost;
+						bestAxis = axis;
+						bestBin = bin;
+					}
+				}
+			}
+
+			int middle = first + count / 2;
+			if (bestAxis < 0)
+			{
+				if (count <= 4 * g_MaxLeafTriangles)
+				{
+					return(nodeIndex);
+				}
+
+				// no plane pays off; split the longest axis at the median
+				glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+				int axis = (extent.x > extent.y) ? ((extent.x > extent.z) ? 0 : 2) : ((extent.y > extent.z) ? 1 : 2);
+				std::nth_element(&references[first], &references[middle], &references[first] + count,
+					[&](uint32_t a, uint32_t b) { return(centroids[a][axis] < centroids[b][axis]); });
+			}
+			else
+			{
+				float extent = centroidBounds.max[bestAxis] - centroidBounds.min[bestAxis];
+				float minimum = centroidBounds.min[bestAxis];
+				uint32_t* pMiddle = std::partition(&references[first], &references[first] + count,
+					[&](uint32_t reference)
+					{
+						int bin = std::min(g_SahBins - 1,
+							(int)((centroids[reference][bestAxis] - minimum) / extent * g_SahBins));
+						return(bin <= bestBin);
+					});
+				middle = (int)(pMiddle - &references[0]);
+			}
+
+			int leftChild = Build(first, middle - first);
+			int rightChild = Build(middle, first + count - middle);
+			nodes[nodeIndex].children[0] = leftChild;
+			nodes[nodeIndex].children[1] = rightChild;
+			return(nodeIndex);
+		}
+	};
+
+	/***********************************************************
+	 *  Collapse()
+	 *
+	 *  Turns a binary node into a four wide node by pulling up
+	 *  the children of its largest inner children, and returns
+	 *  the index of the new node.
+	 ***********************************************************/
+	template <typename NODE>
+	int Collapse(const std::vector<BUILD_NODE>& buildNodes, int buildIndex, std::vector<NODE>& nodes)
+	{
+		int children[4] = { buildNodes[buildIndex].children[0], buildNodes[buildIndex].children[1], -1, -1 };
+		int childCount = 2;
+		while (childCount < 4)
+		{
+			int largest = -1;
+			for (int i = 0; i < childCount; i++)
+			{
+				const BUILD_NODE& child = buildNodes[children[i]];
+				if ((child.children[0] >= 0) &&
+					((largest < 0) || (child.bounds.Area() > buildNodes[children[largest]].bounds.Area())))
+				{
+					largest = i;
+				}
+			}
+			if (largest < 0)
+			{
+				break;
+			}
+			const BUILD_NODE& opened = buildNodes[children[largest]];
+			children[largest] = opened.children[0];
+			children[childCount++] = opened.children[1];
+		}
+
+		int nodeIndex = (int)nodes.size();
+		nodes.push_back(NODE());
+		for (int i = 0; i < 4; i++)
+		{
+			int32_t index = 0;
+			int32_t count = -1;
+			BOUNDS bounds;
+			if (i < childCount)
+			{
+				const BUILD_NODE& child = buildNodes[children[i]];
+				bounds = child.bounds;
+				if (child.children[0] < 0)
+				{
+					index = child.first;
+					count = child.count;
+				}
+				else
+				{
+					index = Collapse(buildNodes, children[i], nodes);
+					count = 0;
+				}
+			}
+
+			// the vector may have grown, so index it again
+			NODE& node = nodes[nodeIndex];
+			node.minX[i] = bounds.min.x;
+			node.minY[i] = bounds.min.y;
+			node.minZ[i] = bounds.min.z;
+			node.maxX[i] = bounds.max.x;
+			node.maxY[i] = bounds.max.y;
+			node.maxZ[i] = bounds.max.z;
+			node.index[i] = index;
+			node.count[i] = count;
+		}
+		return(nodeIndex);
+	}
+
+	/***********************************************************
+	 *  Hash()
+	 *
+	 *  PCG style integer hash for seeding the samples.
+	 ***********************************************************/
+	uint32_t Hash(uint32_t value)
+	{
+		uint32_t state = value * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return((word >> 22u) ^ word);
+	}
+
+	/***********************************************************
+	 *  Random()
+	 *
+	 *  Advances the generator and returns a number in [0, 1).
+	 ***********************************************************/
+	float Random(uint32_t& state)
+	{
+		state = Hash(state);
+		return((float)(state >> 8) * (1.0f / 16777216.0f));
+	}
+
+	/***********************************************************
+	 *  SampleCosine()
+	 *
+	 *  Picks a direction around the normal with a density
+	 *  proportional to the cosine.
+	 ***********************************************************/
+	glm::vec3 SampleCosine(const glm::vec3& normal, uint32_t& rng)
+	{
+		float angle = 2.0f * g_Pi * Random(rng);
+		float radius = sqrtf(Random(rng));
+		glm::vec3 helper = (fabsf(normal.x) > 0.5f) ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+		glm::vec3 tangent = glm::normalize(glm::cross(helper, normal));
+		glm::vec3 bitangent = glm::cross(normal, tangent);
+		return(glm::normalize(tangent * (radius * cosf(angle)) + bitangent * (radius * sinf(angle)) +
+			normal * sqrtf(std::max(0.0f, 1.0f - radius * radius))));
+	}
+}
+
+/***********************************************************
+ *  PathTracer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PathTracer::PathTracer(int threadCount)
+	: m_workerPool(threadCount)
+{
+	m_width = 0;
+	m_height = 0;
+	m_cameraPosition = glm::vec3(0.0f);
+	m_cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+	m_cameraFov = 80.0f;
+	m_sampleCount = 0;
+
+	int workers = m_workerPool.GetThreadCount();
+	m_tileQueues.resize(workers);
+	m_workerStats.resize(workers);
+	for (int i = 0; i < workers; i++)
+	{
+		m_queueMutexes.push_back(new std::mutex());
+		m_workerStats[i].samples = 0;
+		m_workerStats[i].seconds = 0.0;
+		m_workerStats[i].stolenTiles = 0;
+	}
+}
+
+/***********************************************************
+ *  ~PathTracer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PathTracer::~PathTracer()
+{
+	m_workerPool.WaitIdle();
+	for (size_t i = 0; i < m_queueMutexes.size(); i++)
+	{
+		delete m_queueMutexes[i];
+	}
+	m_queueMutexes.clear();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method transforms the draw list into world space
+ *  triangles and builds the four wide BVH over them.
+ ***********************************************************/
+bool PathTracer::Build(const SceneGeometry& scene)
+{
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = scene.GetObjects();
+	std::vector<TRIANGLE> triangles;
+	m_surfaces.resize(objects.size());
+
+	for (size_t objectIndex = 0; objectIndex < objects.size(); objectIndex++)
+	{
+		const SceneManager::SCENE_OBJECT& object = objects[objectIndex];
+		const SceneGeometry::MESH& mesh = scene.GetMesh(object.mesh);
+		const SceneManager::OBJECT_MATERIAL* pMaterial = scene.FindMaterial(object.materialTag);
+
+		SURFACE& surface = m_surfaces[objectIndex];
+		surface.pTexture = object.bTextured ? scene.FindTexture(object.textureTag) : NULL;
+		surface.uvScale = object.uvScale;
+		surface.color = object.color;
+		if (NULL != pMaterial)
+		{
+			surface.material = *pMaterial;
+		}
+		else
+		{
+			surface.material.ambientColor = glm::vec3(1.0f);
+			surface.material.ambientStrength = 1.0f;
+			surface.material.diffuseColor = glm::vec3(1.0f);
+			surface.material.specularColor = glm::vec3(0.0f);
+			surface.material.shininess = 1.0f;
+		}
+
+		glm::mat4 model = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+		{
+			glm::vec3 positions[3];
+			TRIANGLE triangle;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const SceneGeometry::VERTEX& vertex = mesh.vertices[mesh.indices[i + corner]];
+				positions[corner] = glm::vec3(model * glm::vec4(vertex.position, 1.0f));
+				triangle.normals[corner] = glm::normalize(normalMatrix * vertex.normal);
+				triangle.uvs[corner] = vertex.uv;
+			}
+			triangle.v0 = positions[0];
+			triangle.edge1 = positions[1] - positions[0];
+			triangle.edge2 = positions[2] - positions[0];
+			triangle.objectIndex = (int)objectIndex;
+			triangles.push_back(triangle);
+		}
+	}
+
+	m_nodes.clear();
+	m_triangles.clear();
+	if (triangles.empty())
+	{
+		std::cout << "WARNING: The path tracer has no triangles to trace" << std::endl;
+		return(false);
+	}
+
+	BUILDER builder;
+	builder.triangleBounds.resize(triangles.size());
+	builder.centroids.resize(triangles.size());
+	builder.references.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		BOUNDS& bounds = builder.triangleBounds[i];
+		bounds.Grow(triangles[i].v0);
+		bounds.Grow(triangles[i].v0 + triangles[i].edge1);
+		bounds.Grow(triangles[i].v0 + triangles[i].edge2);
+		builder.centroids[i] = (bounds.min + bounds.max) * 0.5f;
+		builder.references[i] = (uint32_t)i;
+	}
+	int root = builder.Build(0, (int)triangles.size());
+
+	// store the triangles in leaf order so a leaf is one range
+	m_triangles.resize(triangles.size());
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		m_triangles[i] = triangles[builder.references[i]];
+	}
+
+	if (builder.nodes[root].children[0] < 0)
+	{
+		// a single leaf still needs a node above it
+		BUILD_NODE top = builder.nodes[root];
+		top.children[0] = root;
+		top.children[1] = root;
+		builder.nodes.push_back(top);
+		Collapse(builder.nodes, (int)builder.nodes.size() - 1, m_nodes);
+		m_nodes[0].count[1] = -1;
+	}
+	else
+	{
+		Collapse(builder.nodes, root, m_nodes);
+	}
+
+	ResetAccumulation();
+	return(true);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method sizes the accumulation for a new image.
+ ***********************************************************/
+bool PathTracer::Resize(int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	ResetAccumulation();
+	return(true);
+}
+
+/***********************************************************
+ *  SetCamera()
+ *
+ *  This method places the camera; the old samples belong to
+ *  another view, so a move clears them.
+ ***********************************************************/
+void PathTracer::SetCamera(const glm::vec3& position, const glm::vec3& front, float fov)
+{
+	glm::vec3 direction = glm::normalize(front);
+	if ((position != m_cameraPosition) || (direction != m_cameraFront) || (fov != m_cameraFov))
+	{
+		m_cameraPosition = position;
+		m_cameraFront = direction;
+		m_cameraFov = fov;
+		ResetAccumulation();
+	}
+}
+
+/***********************************************************
+ *  ResetAccumulation()
+ *
+ *  This method clears the samples and the worker counters.
+ ***********************************************************/
+void PathTracer::ResetAccumulation()
+{
+	m_accumulation.assign((size_t)m_width * m_height * 3, 0.0f);
+	m_sampleCount = 0;
+	for (size_t i = 0; i < m_workerStats.size(); i++)
+	{
+		m_workerStats[i].samples = 0;
+		m_workerStats[i].seconds = 0.0;
+		m_workerStats[i].stolenTiles = 0;
+	}
+}
+
+/***********************************************************
+ *  RenderPass()
+ *
+ *  This method deals the tiles out to the worker queues and
+ *  lets every worker trace until no tile is left anywhere.
+ ***********************************************************/
+void PathTracer::RenderPass()
+{
+	if (m_accumulation.empty() || m_nodes.empty())
+	{
+		return;
+	}
+
+	int tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	int tilesY = (m_height + TILE_SIZE - 1) / TILE_SIZE;
+	int workers = (int)m_tileQueues.size();
+	for (int tile = 0; tile < tilesX * tilesY; tile++)
+	{
+		m_tileQueues[tile % workers].push_back(tile);
+	}
+
+	for (int worker = 0; worker < workers; worker++)
+	{
+		m_workerPool.Submit([this, worker]()
+		{
+			typedef std::chrono::steady_clock CLOCK;
+			CLOCK::time_point start = CLOCK::now();
+			long long samples = 0;
+			int tile = 0;
+			while (NextTile(worker, tile))
+			{
+				TraceTile(tile, samples);
+			}
+			m_workerStats[worker].samples += samples;
+			m_workerStats[worker].seconds += std::chrono::duration<double>(CLOCK::now() - start).count();
+		});
+	}
+	m_workerPool.WaitIdle();
+	m_sampleCount++;
+}
+
+/***********************************************************
+ *  NextTile()
+ *
+ *  This method pops the next tile of the worker's own queue,
+ *  or steals the last tile of another queue.
+ ***********************************************************/
+bool PathTracer::NextTile(int worker, int& tile)
+{
+	int workers = (int)m_tileQueues.size();
+	for (int i = 0; i < workers; i++)
+	{
+		int victim = (worker + i) % workers;
+		std::lock_guard<std::mutex> lock(*m_queueMutexes[victim]);
+		std::deque<int>& queue = m_tileQueues[victim];
+		if (queue.empty())
+		{
+			continue;
+		}
+
+		if (victim == worker)
+		{
+			tile = queue.front();
+			queue.pop_front();
+		}
+		else
+		{
+			// the far end of the queue is the work its owner reaches last
+			tile = queue.back();
+			queue.pop_back();
+			m_workerStats[worker].stolenTiles++;
+		}
+		return(true);
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  TraceTile()
+ *
+ *  This method adds one jittered sample to every pixel of a
+ *  tile. The tiles do not overlap, so no locks are needed.
+ ***********************************************************/
+void PathTracer::TraceTile(int tile, long long& samples)
+{
+	int tilesX = (m_width + TILE_SIZE - 1) / TILE_SIZE;
+	int x0 = (tile % tilesX) * TILE_SIZE;
+	int y0 = (tile / tilesX) * TILE_SIZE;
+	int x1 = std::min(x0 + TILE_SIZE, m_width);
+	int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+	glm::vec3 right = glm::normalize(glm::cross(m_cameraFront, glm::vec3(0.0f, 1.0f, 0.0f)));
+	glm::vec3 up = glm::cross(right, m_cameraFront);
+	float tanHalfFov = tanf(glm::radians(m_cameraFov) * 0.5f);
+	float aspect = (float)m_width / (float)m_height;
+
+	for (int y = y0; y < y1; y++)
+	{
+		for (int x = x0; x < x1; x++)
+		{
+			size_t pixel = (size_t)y * m_width + x;
+			uint32_t rng = Hash((uint32_t)pixel ^ Hash((uint32_t)m_sampleCount * 0x9E3779B9u));
+
+			// row 0 is the bottom of the image, like glReadPixels
+			float ndcX = ((float)x + Random(rng)) / (float)m_width * 2.0f - 1.0f;
+			float ndcY = ((float)y + Random(rng)) / (float)m_height * 2.0f - 1.0f;
+			glm::vec3 direction = glm::normalize(m_cameraFront +
+				right * (ndcX * tanHalfFov * aspect) + up * (ndcY * tanHalfFov));
+
+			glm::vec3 radiance = TracePath(m_cameraPosition, direction, rng);
+			m_accumulation[pixel * 3 + 0] += radiance.r;
+			m_accumulation[pixel * 3 + 1] += radiance.g;
+			m_accumulation[pixel * 3 + 2] += radiance.b;
+		}
+	}
+	samples += (long long)(x1 - x0) * (y1 - y0);
+}
+
+/***********************************************************
+ *  TracePath()
+ *
+ *  This method follows a path through the scene, adding the
+ *  shadowed direct light at every diffuse bounce.
+ ***********************************************************/
+glm::vec3 PathTracer::TracePath(glm::vec3 origin, glm::vec3 direction, uint32_t& rng) const
+{
+	glm::vec3 environment(0.0f);
+	for (int i = 0; i < SceneManager::LIGHT_COUNT; i++)
+	{
+		environment += SceneManager::GetLightSource(i).ambientColor;
+	}
+
+	glm::vec3 radiance(0.0f);
+	glm::vec3 throughput(1.0f);
+	int bounce = 0;
+	for (int segment = 0; (segment < g_MaxSegments) && (bounce < g_MaxBounces); segment++)
+	{
+		HIT hit;
+		if (!Intersect(origin, direction, g_Infinity, hit))
+		{
+			if (bounce > 0)
+			{
+				radiance += throughput * environment;
+			}
+			break;
+		}
+
+		const TRIANGLE& triangle = m_triangles[hit.triangle];
+		const SURFACE& surface = m_surfaces[triangle.objectIndex];
+		glm::vec3 position = origin + direction * hit.t;
+		float w = 1.0f - hit.u - hit.v;
+		glm::vec2 uv = triangle.uvs[0] * w + triangle.uvs[1] * hit.u + triangle.uvs[2] * hit.v;
+		glm::vec4 color = SurfaceColor(surface, uv);
+
+		// translucent surfaces let some paths through unchanged
+		if ((color.a < 1.0f) && (Random(rng) >= color.a))
+		{
+			origin = position + direction * g_RayOffset;
+			continue;
+		}
+
+		glm::vec3 normal = glm::normalize(triangle.normals[0] * w + triangle.normals[1] * hit.u +
+			triangle.normals[2] * hit.v);
+		if (glm::dot(normal, direction) > 0.0f)
+		{
+			normal = -normal;
+		}
+		glm::vec3 baseColor(color);
+		glm::vec3 shadowOrigin = position + normal * g_RayOffset;
+
+		// direct light with the diffuse and specular terms of the shader
+		for (int i = 0; i < SceneManager::LIGHT_COUNT; i++)
+		{
+			const SceneManager::LIGHT_SOURCE& light = SceneManager::GetLightSource(i);
+			glm::vec3 toLight = light.position - shadowOrigin;
+			float distance = glm::length(toLight);
+			glm::vec3 lightDirection = toLight / distance;
+			float impact = glm::dot(normal, lightDirection);
+			if ((impact <= 0.0f) || Occluded(shadowOrigin, lightDirection, distance, rng))
+			{
+				continue;
+			}
+
+			glm::vec3 reflectDirection = glm::reflect(-lightDirection, normal);
+			float specular = powf(std::max(glm::dot(-direction, reflectDirection), 0.0f), light.focalStrength);
+			radiance += throughput * baseColor * (impact * light.diffuseColor * surface.material.diffuseColor +
+				light.specularIntensity * specular * surface.material.specularColor);
+		}
+
+		// the cosine sampling cancels the cosine and the 1/pi of the BRDF
+		throughput *= baseColor * surface.material.diffuseColor;
+		bounce++;
+		if (bounce > g_MinBounces)
+		{
+			float survival = glm::clamp(std::max(throughput.r, std::max(throughput.g, throughput.b)), 0.05f, 0.95f);
+			if (Random(rng) >= survival)
+			{
+				break;
+			}
+			throughput /= survival;
+		}
+
+		origin = shadowOrigin;
+		direction = SampleCosine(normal, rng);
+	}
+
+	return(radiance);
+}
+
+/***********************************************************
+ *  Intersect()
+ *
+ *  This method walks the BVH front to back and returns the
+ *  closest triangle hit before tMax.
+ ***********************************************************/
+bool PathTracer::Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMax, HIT& hit) const
+{
+	glm::vec3 inverse;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		// a huge finite value keeps 0 * inverse out of NaN
+		inverse[axis] = (fabsf(direction[axis]) > 1.0e-12f) ? 1.0f / direction[axis] :
+			((direction[axis] < 0.0f) ? -g_Infinity : g_Infinity);
+	}
+
+	bool bHit = false;
+	hit.t = tMax;
+	int32_t stack[g_StackSize];
+	float stackNear[g_StackSize];
+	int top = 0;
+	stack[top] = 0;
+	stackNear[top++] = 0.0f;
+
+#ifdef PATH_TRACER_SSE2
+	__m128 originX = _mm_set1_ps(origin.x);
+	__m128 originY = _mm_set1_ps(origin.y);
+	__m128 originZ = _mm_set1_ps(origin.z);
+	__m128 inverseX = _mm_set1_ps(inverse.x);
+	__m128 inverseY = _mm_set1_ps(inverse.y);
+	__m128 inverseZ = _mm_set1_ps(inverse.z);
+#endif
+
+	while (top > 0)
+	{
+		top--;
+		if (stackNear[top] > hit.t)
+		{
+			continue;
+		}
+		const BVH4_NODE& node = m_nodes[stack[top]];
+
+		// slab test of the four child boxes
+		float tNear[4];
+		int mask = 0;
+#ifdef PATH_TRACER_SSE2
+		__m128 t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), originX), inverseX);
+		__m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), originX), inverseX);
+		__m128 entry = _mm_min_ps(t0, t1);
+		__m128 exit = _mm_max_ps(t0, t1);
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), originY), inverseY);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), originY), inverseY);
+		entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+		exit = _mm_min_ps(exit, _mm_max_ps(t0, t1));
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), originZ), inverseZ);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), originZ), inverseZ);
+		entry = _mm_max_ps(_mm_max_ps(entry, _mm_min_ps(t0, t1)), _mm_setzero_ps());
+		exit = _mm_min_ps(_mm_min_ps(exit, _mm_max_ps(t0, t1)), _mm_set1_ps(hit.t));
+		mask = _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+		_mm_storeu_ps(tNear, entry);
+#else
+		const float* minimums[3] = { node.minX, node.minY, node.minZ };
+		const float* maximums[3] = { node.maxX, node.maxY, node.maxZ };
+		for (int child = 0; child < 4; child++)
+		{
+			float entry = 0.0f;
+			float exit = hit.t;
+			for (int axis = 0; axis < 3; axis++)
+			{
+				float t0 = (minimums[axis][child] - origin[axis]) * inverse[axis];
+				float t1 = (maximums[axis][child] - origin[axis]) * inverse[axis];
+				entry = std::max(entry, std::min(t0, t1));
+				exit = std::min(exit, std::max(t0, t1));
+			}
+			tNear[child] = entry;
+			if (entry <= exit)
+			{
+				mask |= 1 << child;
+			}
+		}
+#endif
+
+		// test the leaves now and push the inner nodes far to near
+		int inner[4];
+		int innerCount = 0;
+		for (int child = 0; child < 4; child++)
+		{
+			if (!(mask & (1 << child)) || (node.count[child] < 0))
+			{
+				continue;
+			}
+			if (node.count[child] == 0)
+			{
+				int position = innerCount++;
+				while ((position > 0) && (tNear[inner[position - 1]] < tNear[child]))
+				{
+					inner[position] = inner[position - 1];
+					position--;
+				}
+				inner[position] = child;
+				continue;
+			}
+
+			for (int32_t i = node.index[child]; i < node.index[child] + node.count[child]; i++)
+			{
+				const TRIANGLE& triangle = m_triangles[i];
+				glm::vec3 p = glm::cross(direction, triangle.edge2);
+				float determinant = glm::dot(triangle.edge1, p);
+				if (fabsf(determinant) < 1.0e-12f)
+				{
+					continue;
+				}
+				float inverseDeterminant = 1.0f / determinant;
+				glm::vec3 s = origin - triangle.v0;
+				float u = glm::dot(s, p) * inverseDeterminant;
+				if ((u < 0.0f) || (u > 1.0f))
+				{
+					continue;
+				}
+				glm::vec3 q = glm::cross(s, triangle.edge1);
+				float v = glm::dot(direction, q) * inverseDeterminant;
+				if ((v < 0.0f) || (u + v > 1.0f))
+				{
+					continue;
+				}
+				float t = glm::dot(triangle.edge2, q) * inverseDeterminant;
+				if ((t > 0.0f) && (t < hit.t))
+				{
+					hit.t = t;
+					hit.u = u;
+					hit.v = v;
+					hit.triangle = (uint32_t)i;
+					bHit = true;
+				}
+			}
+		}
+
+		for (int i = 0; (i < innerCount) && (top < g_StackSize); i++)
+		{
+			stack[top] = node.index[inner[i]];
+			stackNear[top++] = tNear[inner[i]];
+		}
+	}
+
+	return(bHit);
+}
+
+/***********************************************************
+ *  Occluded()
+ *
+ *  This method checks a shadow ray; a translucent surface
+ *  blocks it with the probability of its alpha.
+ ***********************************************************/
+bool PathTracer::Occluded(glm::vec3 origin, const glm::vec3& direction, float distance, uint32_t& rng) const
+{
+	for (int segment = 0; segment < g_MaxSegments; segment++)
+	{
+		HIT hit;
+		if (!Intersect(origin, direction, distance, hit))
+		{
+			return(false);
+		}
+
+		const TRIANGLE& triangle = m_triangles[hit.triangle];
+		float w = 1.0f - hit.u - hit.v;
+		glm::vec2 uv = triangle.uvs[0] * w + triangle.uvs[1] * hit.u + triangle.uvs[2] * hit.v;
+		float alpha = SurfaceColor(m_surfaces[triangle.objectIndex], uv).a;
+		if ((alpha >= 1.0f) || (Random(rng) < alpha))
+		{
+			return(true);
+		}
+
+		origin += direction * (hit.t + g_RayOffset);
+		distance -= hit.t + g_RayOffset;
+		if (distance <= 0.0f)
+		{
+			return(false);
+		}
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  SurfaceColor()
+ *
+ *  This method returns the texture color, or the object
+ *  color for untextured objects, like the scene shader.
+ ***********************************************************/
+glm::vec4 PathTracer::SurfaceColor(const SURFACE& surface, const glm::vec2& uv) const
+{
+	if (NULL != surface.pTexture)
+	{
+		return(glm::vec4(glm::vec3(SceneGeometry::SampleTexture(*surface.pTexture, uv * surface.uvScale)), 1.0f));
+	}
+	return(surface.color);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method averages the accumulated samples into 8 bit
+ *  RGBA pixels.
+ ***********************************************************/
+void PathTracer::Resolve(std::vector<unsigned char>& pixels) const
+{
+	pixels.assign((size_t)m_width * m_height * 4, 255);
+	float scale = (m_sampleCount > 0) ? 1.0f / (float)m_sampleCount : 0.0f;
+	for (size_t pixel = 0; pixel < (size_t)m_width * m_height; pixel++)
+	{
+		for (int channel = 0; channel < 3; channel++)
+		{
+			float value = glm::clamp(m_accumulation[pixel * 3 + channel] * scale, 0.0f, 1.0f);
+			pixels[pixel * 4 + channel] = (unsigned char)(value * 255.0f + 0.5f);
+		}
+	}
+}
+
+/***********************************************************
+ *  SaveAccumulation()
+ *
+ *  This method writes the image size, the camera, the sample
+ *  count and the sums of every pixel to a temporary file,
+ *  then renames it over the old accumulation.
+ ***********************************************************/
+bool PathTracer::SaveAccumulation(const std::string& filename) const
+{
+	// the old accumulation stays until the new one is complete
+	std::string temporaryName = filename + ".tmp";
+	FILE* file = fopen(temporaryName.c_str(), "wb");
+	if (NULL == file)
+	{
+		std::cerr << "Could not write the path tracer accumulation: " << temporaryName << std::endl;
+		return(false);
+	}
+
+	int32_t header[3] = { m_width, m_height, m_sampleCount };
+	float camera[7] = { m_cameraPosition.x, m_cameraPosition.y, m_cameraPosition.z,
+		m_cameraFront.x, m_cameraFront.y, m_cameraFront.z, m_cameraFov };
+	bool bWritten = (fwrite(g_AccumulationMagic, 1, strlen(g_AccumulationMagic), file) == strlen(g_AccumulationMagic)) &&
+		(fwrite(header, sizeof(header), 1, file) == 1) &&
+		(fwrite(camera, sizeof(camera), 1, file) == 1) &&
+		(m_accumulation.empty() ||
+			(fwrite(&m_accumulation[0], sizeof(float), m_accumulation.size(), file) == m_accumulation.size()));
+	bWritten = (fclose(file) == 0) && bWritten;
+
+	if (!bWritten)
+	{
+		std::cerr << "Could not write the path tracer accumulation: " << temporaryName << std::endl;
+		remove(temporaryName.c_str());
+		return(false);
+	}
+	if (!ReplaceWithFile(temporaryName, filename))
+	{
+		std::cerr << "Could not replace the path tracer accumulation: " << filename << std::endl;
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  LoadAccumulation()
+ *
+ *  This method reads an accumulation written by
+ *  SaveAccumulation(); the image size must match, and the
+ *  saved camera replaces the current one.
+ ***********************************************************/
+bool PathTracer::LoadAccumulation(const std::string& filename)
+{
+	FILE* file = fopen(filename.c_str(), "rb");
+	size_t magicLength = strlen(g_AccumulationMagic);
+	char magic[16] = { 0 };
+	int32_t header[3] = { 0 };
+	float camera[7] = { 0 };
+
+	if (NULL == file)
+	{
+		std::cerr << "Could not open the path tracer accumulation: " << filename << std::endl;
+		return(false);
+	}
+	if ((fread(magic, 1, magicLength, file) != magicLength) || (memcmp(magic, g_AccumulationMagic, magicLength) != 0) ||
+		(fread(header, sizeof(header), 1, file) != 1) || (fread(camera, sizeof(camera), 1, file) != 1))
+	{
+		std::cerr << "Not a path tracer accumulation: " << filename << std::endl;
+		fclose(file);
+		return(false);
+	}
+	if ((header[0] != m_width) || (header[1] != m_height))
+	{
+		std::cerr << "The accumulation in " << filename << " is " << header[0] << "x" << header[1]
+			<< ", not " << m_width << "x" << m_height << std::endl;
+		fclose(file);
+		return(false);
+	}
+
+	std::vector<float> accumulation((size_t)m_width * m_height * 3);
+	if (fread(&accumulation[0], sizeof(float), accumulation.size(), file) != accumulation.size())
+	{
+		std::cerr << "Could not read the path tracer accumulation: " << filename << std::endl;
+		fclose(file);
+		return(false);
+	}
+	fclose(file);
+
+	m_cameraPosition = glm::vec3(camera[0], camera[1], camera[2]);
+	m_cameraFront = glm::vec3(camera[3], camera[4], camera[5]);
+	m_cameraFov = camera[6];
+	ResetAccumulation();
+	m_accumulation.swap(accumulation);
+	m_sampleCount = header[2];
+	return(true);
+}
@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// pathtracer.h
+// ============
+// progressive CPU path tracer for reference stills of the scene
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGeometry.h"
+#include "WorkerPool.h"
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  PathTracer
+ *
+ *  This class renders the scene with Monte Carlo path
+ *  tracing. The scene triangles are kept in world space
+ *  under a four wide bounding volume hierarchy whose boxes
+ *  are tested four at a time with SSE2. Every pass adds one
+ *  sample per pixel to a floating point accumulation; the
+ *  tiles of a pass are dealt out to per worker queues and
+ *  idle workers steal from the others. The accumulation can
+ *  be saved and loaded, so long renders can be resumed.
+ ***********************************************************/
+class PathTracer
+{
+public:
+	// edge length of a work tile, in pixels
+	static const int TILE_SIZE = 32;
+
+	// samples and busy time of one worker over all passes
+	struct WORKER_STATS
+	{
+		long long samples;
+		double seconds;
+		long stolenTiles;
+	};
+
+	// constructor; zero threads uses one less than the cores
+	PathTracer(int threadCount = 0);
+	// destructor
+	~PathTracer();
+
+	// copy the scene triangles into world space and build the BVH
+	bool Build(const SceneGeometry& scene);
+	// set the image size; clears the accumulation
+	bool Resize(int width, int height);
+	// set the camera; clears the accumulation when it moves
+	void SetCamera(const glm::vec3& position, const glm::vec3& front, float fov);
+	// forget all samples
+	void ResetAccumulation();
+
+	// add one sample to every pixel
+	void RenderPass();
+	// samples per pixel accumulated so far
+	int GetSampleCount() const { return(m_sampleCount); }
+
+	// write or read the accumulation and the camera it belongs to
+	bool SaveAccumulation(const std::string& filename) const;
+	bool LoadAccumulation(const std::string& filename);
+
+	// average the samples into RGBA pixels, bottom row first
+	void Resolve(std::vector<unsigned char>& pixels) const;
+
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_workerPool.GetThreadCount()); }
+	const std::vector<WORKER_STATS>& GetWorkerStats() const { return(m_workerStats); }
+	// number of BVH nodes and triangles, for the log
+	size_t GetNodeCount() const { return(m_nodes.size()); }
+	size_t GetTriangleCount() const { return(m_triangles.size()); }
+
+private:
+	// a world space triangle, stored for the Moller-Trumbore test
+	struct TRIANGLE
+	{
+		glm::vec3 v0;
+		glm::vec3 edge1;
+		glm::vec3 edge2;
+		glm::vec3 normals[3];
+		glm::vec2 uvs[3];
+		int objectIndex;
+	};
+
+	// four child boxes in structure of arrays layout; a child is
+	// an inner node when count is 0, a leaf of count triangles
+	// starting at index otherwise, and empty when count is -1
+	struct BVH4_NODE
+	{
+		float minX[4];
+		float minY[4];
+		float minZ[4];
+		float maxX[4];
+		float maxY[4];
+		float maxZ[4];
+		int32_t index[4];
+		int32_t count[4];
+	};
+
+	// the surface of one object, resolved once per build
+	struct SURFACE
+	{
+		const SceneGeometry::TEXTURE* pTexture;
+		glm::vec2 uvScale;
+		glm::vec4 color;
+		SceneManager::OBJECT_MATERIAL material;
+	};
+
+	struct HIT
+	{
+		float t;
+		float u;
+		float v;
+		uint32_t triangle;
+	};
+
+	WorkerPool m_workerPool;
+	std::vector<TRIANGLE> m_triangles;
+	std::vector<BVH4_NODE> m_nodes;
+	std::vector<SURFACE> m_surfaces;
+
+	int m_width;
+	int m_height;
+	glm::vec3 m_cameraPosition;
+	glm::vec3 m_cameraFront;
+	float m_cameraFov;
+	// RGB sums of all samples per pixel
+	std::vector<float> m_accumulation;
+	int m_sampleCount;
+
+	// the tile queues of one pass, one per worker
+	std::vector<std::deque<int> > m_tileQueues;
+	std::vector<std::mutex*> m_queueMutexes;
+	std::vector<WORKER_STATS> m_workerStats;
+
+	// take a tile from the own queue, or steal one
+	bool NextTile(int worker, int& tile);
+	// trace one sample for every pixel of a tile
+	void TraceTile(int tile, long long& samples);
+	// radiance arriving along a camera ray
+	glm::vec3 TracePath(glm::vec3 origin, glm::vec3 direction, uint32_t& rng) const;
+	// closest hit along a ray, or false for a miss
+	bool Intersect(const glm::vec3& origin, const glm::vec3& direction, float tMax, HIT& hit) const;
+	// true when an opaque enough surface blocks the segment
+	bool Occluded(glm::vec3 origin, const glm::vec3& direction, float distance, uint32_t& rng) const;
+	// reflectance and opacity at a hit
+	glm::vec4 SurfaceColor(const SURFACE& surface, const glm::vec2& uv) const;
+};
@@ -0,0 +1,539 @@
+///////////////////////////////////////////////////////////////////////////////
+// PostProcessStack.cpp
+// ====================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `PostProcessStack` class, which applies the post
+// effects of the frame (tonemapping, color grading, vignette, FXAA and
+// dithering) without a full resolution read and write per effect.
+//
+// FUNCTIONALITY:
+// - Keep every effect as a GLSL snippet whose names start with `$`; the
+//   fuser replaces it with a stage prefix so several effects can share a
+//   program.
+// - Group the enabled effects into passes: per pixel effects always join
+//   the current pass, and an effect that samples neighbours starts a new
+//   pass only if the current one already has such an effect.
+// - Generate one compute shader per pass, or a fullscreen triangle and a
+//   fragment shader where compute shaders are not available, and cache
+//   the linked program by its generated source.
+// - Declare the passes in the frame graph, with RGBA16F textures between
+//   passes and an RGBA8 result.
+//
+// NOTES:
+// A neighbourhood effect reads its taps through a generated input
+// function that applies the effects before it to each tap, so FXAA sees
+// the tonemapped and graded image although the pass only reads the HDR
+// scene color once per tap. The parameters are plain uniforms, so
+// changing them never rebuilds a program; changing the order or the set
+// of effects does, once.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "PostProcessStack.h"
+#include "ShaderUtils.h"
+
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const int g_WorkGroupSize = 8;
+
+	/***********************************************************
+	 *  EFFECT_SOURCE
+	 *
+	 *  The snippet and default parameters of an effect. A per
+	 *  pixel snippet defines $apply(color, uv, pixel); a
+	 *  neighbourhood snippet defines $apply(uv, pixel) and
+	 *  reads its taps through $input(uv).
+	 ***********************************************************/
+	struct EFFECT_SOURCE
+	{
+		const char* name;
+		bool bNeighborhood;
+		float defaults[4];
+		const char* code;
+	};
+
+	const EFFECT_SOURCE g_EffectSources[PostProcessStack::EFFECT_COUNT] =
+	{
+		// x = exposure; the ACES fit of Krzysztof Narkowicz
+		{ "tonemap", false, { 1.0f, 0.0f, 0.0f, 0.0f },
+			"vec4 $apply(vec4 color, vec2 uv, vec2 pixel)\n"
+			"{\n"
+			"	vec3 c = color.rgb * $parameters.x;\n"
+			"	c = clamp((c * (2.51 * c + 0.03)) / (c * (2.43 * c + 0.59) + 0.14), 0.0, 1.0);\n"
+			"	return(vec4(c, color.a));\n"
+			"}\n" },
+
+		// x = saturation, y = contrast, z = gamma, w = brightness
+		{ "grade", false, { 1.1f, 1.05f, 1.0f, 0.0f },
+			"vec4 $apply(vec4 color, vec2 uv, vec2 pixel)\n"
+			"{\n"
+			"	vec3 c = color.rgb;\n"
+			"	float luma = dot(c, vec3(0.2126, 0.7152, 0.0722));\n"
+			"	c = mix(vec3(luma), c, $parameters.x);\n"
+			"	c = (c - 0.5) * $parameters.y + 0.5 + $parameters.w;\n"
+			"	c = pow(max(c, 0.0), vec3(1.0 / $parameters.z));\n"
+			"	return(vec4(c, color.a));\n"
+			"}\n" },
+
+		// x = strength, y = radius, z = softness
+		{ "vignette", false, { 0.35f, 0.8f, 0.45f, 0.0f },
+			"vec4 $apply(vec4 color, vec2 uv, vec2 pixel)\n"
+			"{\n"
+			"	vec2 offset = uv - 0.5;\n"
+			"	offset.x *= texelSize.y / texelSize.x;\n"
+			"	float falloff = smoothstep($parameters.y, $parameters.y - $parameters.z, length(offset));\n"
+			"	return(vec4(color.rgb * mix(1.0 - $parameters.x, 1.0, falloff), color.a));\n"
+			"}\n" },
+
+		// x = span limit in pixels, y = reduce multiplier, z = reduce minimum
+		{ "fxaa", true, { 8.0f, 1.0f / 8.0f, 1.0f / 128.0f, 0.0f },
+			"vec4 $apply(vec2 uv, vec2 pixel)\n"
+			"{\n"
+			"	const vec3 lumaWeights = vec3(0.299, 0.587, 0.114);\n"
+			"	vec4 center = $input(uv);\n"
+			"	float lumaNW = dot($input(uv + vec2(-1.0, -1.0) * texelSize).rgb, lumaWeights);\n"
+			"	float lumaNE = dot($input(uv + vec2(1.0, -1.0) * texelSize).rgb, lumaWeights);\n"
+			"	float lumaSW = dot($input(uv + vec2(-1.0, 1.0) * texelSize).rgb, lumaWeights);\n"
+			"	float lumaSE = dot($input(uv + vec2(1.0, 1.0) * texelSize).rgb, lumaWeights);\n"
+			"	float lumaM = dot(center.rgb, lumaWeights);\n"
+			"	float lumaMin = min(lumaM, min(min(lumaNW, lumaNE), min(lumaSW, lumaSE)));\n"
+			"	float lumaMax = max(lumaM, max(max(lumaNW, lumaNE), max(lumaSW, lumaSE)));\n"
+			"	vec2 direction = vec2(-((lumaNW + lumaNE) - (lumaSW + lumaSE)), (lumaNW + lumaSW) - (lumaNE + lumaSE));\n"
+			"	float reduce = max((lumaNW + lumaNE + lumaSW + lumaSE) * 0.25 * $parameters.y, $parameters.z);\n"
+			"	float scale = 1.0 / (min(abs(direction.x), abs(direction.y)) + reduce);\n"
+			"	direction = clamp(direction * scale, -$parameters.x, $parameters.x) * texelSize;\n"
+			"	vec3 a = 0.5 * ($input(uv + direction * (1.0 / 3.0 - 0.5)).rgb + $input(uv + direction * (2.0 / 3.0 - 0.5)).rgb);\n"
+			"	vec3 b = a * 0.5 + 0.25 * ($input(uv - direction * 0.5).rgb + $input(uv + direction * 0.5).rgb);\n"
+			"	float lumaB = dot(b, lumaWeights);\n"
+			"	return(vec4(((lumaB < lumaMin) || (lumaB > lumaMax)) ? a : b, center.a));\n"
+			"}\n" },
+
+		// x = amplitude in 8 bit steps; interleaved gradient noise
+		{ "dither", false, { 1.0f, 0.0f, 0.0f, 0.0f },
+			"vec4 $apply(vec4 color, vec2 uv, vec2 pixel)\n"
+			"{\n"
+			"	float noise = fract(52.9829189 * fract(dot(floor(pixel), vec2(0.06711056, 0.00583715))));\n"
+			"	return(vec4(color.rgb + (noise - 0.5) * $parameters.x / 255.0, color.a));\n"
+			"}\n" },
+	};
+}
+
+/***********************************************************
+ *  PostProcessStack()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PostProcessStack::PostProcessStack()
+{
+	m_vertexArray = 0;
+	m_pFrameProfiler = NULL;
+	m_bCompute = false;
+	m_passCount = 0;
+}
+
+/***********************************************************
+ *  ~PostProcessStack()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PostProcessStack::~PostProcessStack()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method chooses compute passes when the context has
+ *  compute shaders and image stores.
+ ***********************************************************/
+bool PostProcessStack::Initialize()
+{
+	m_bCompute = GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_image_load_store);
+	if (!m_bCompute)
+	{
+		std::cout << "INFO: Post processing falls back to fragment passes without compute shaders" << std::endl;
+	}
+
+	glGenVertexArrays(1, &m_vertexArray);
+	return(m_vertexArray != 0);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the cached programs.
+ ***********************************************************/
+void PostProcessStack::Destroy()
+{
+	for (std::map<std::string, GLuint>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+	{
+		if (it->second != 0)
+		{
+			glDeleteProgram(it->second);
+		}
+	}
+	m_programs.clear();
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  AddEffect()
+ *
+ *  This method appends an effect to the end of the stack.
+ ***********************************************************/
+int PostProcessStack::AddEffect(EFFECT_TYPE type)
+{
+	EFFECT effect;
+	effect.type = type;
+	effect.parameters = glm::vec4(g_EffectSources[type].defaults[0], g_EffectSources[type].defaults[1],
+		g_EffectSources[type].defaults[2], g_EffectSources[type].defaults[3]);
+	effect.bEnabled = true;
+	m_effects.push_back(effect);
+	return((int)m_effects.size() - 1);
+}
+
+/***********************************************************
+ *  SetParameters()
+ *
+ *  This method changes the four parameters of an effect.
+ ***********************************************************/
+void PostProcessStack::SetParameters(int index, const glm::vec4& parameters)
+{
+	if ((index >= 0) && (index < (int)m_effects.size()))
+	{
+		m_effects[index].parameters = parameters;
+	}
+}
+
+/***********************************************************
+ *  SetEnabled()
+ *
+ *  This method switches an effect on or off.
+ ***********************************************************/
+void PostProcessStack::SetEnabled(int index, bool bEnabled)
+{
+	if ((index >= 0) && (index < (int)m_effects.size()))
+	{
+		m_effects[index].bEnabled = bEnabled;
+	}
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method removes every effect; the programs stay
+ *  cached.
+ ***********************************************************/
+void PostProcessStack::Clear()
+{
+	m_effects.clear();
+}
+
+/***********************************************************
+ *  ParseEffectName()
+ *
+ *  This method looks up an effect by its name.
+ ***********************************************************/
+bool PostProcessStack::ParseEffectName(const std::string& name, EFFECT_TYPE* pType)
+{
+	for (int i = 0; i < EFFECT_COUNT; i++)
+	{
+		if (name == g_EffectSources[i].name)
+		{
+			*pType = (EFFECT_TYPE)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  AddEffects()
+ *
+ *  This method appends the effects of a list such as
+ *  "tonemap,grade,vignette,fxaa,dither".
+ ***********************************************************/
+bool PostProcessStack::AddEffects(const std::string& list)
+{
+	std::istringstream stream(list);
+	std::string name;
+	while (std::getline(stream, name, ','))
+	{
+		EFFECT_TYPE type = EFFECT_TONEMAP;
+		if (!ParseEffectName(name, &type))
+		{
+			std::cerr << "Unknown post effect: " << name << std::endl;
+			return(false);
+		}
+		AddEffect(type);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  PlanPasses()
+ *
+ *  This method groups the enabled effects; a pass may hold
+ *  any number of per pixel effects and one neighbourhood
+ *  effect.
+ ***********************************************************/
+void PostProcessStack::PlanPasses(std::vector<std::vector<int> >& passes) const
+{
+	passes.clear();
+	bool bGatherInPass = false;
+	for (size_t i = 0; i < m_effects.size(); i++)
+	{
+		if (!m_effects[i].bEnabled)
+		{
+			continue;
+		}
+
+		bool bNeighborhood = g_EffectSources[m_effects[i].type].bNeighborhood;
+		if (passes.empty() || (bNeighborhood && bGatherInPass))
+		{
+			passes.push_back(std::vector<int>());
+			bGatherInPass = false;
+		}
+		passes.back().push_back((int)i);
+		bGatherInPass = bGatherInPass || bNeighborhood;
+	}
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method generates the fused source of a pass and
+ *  returns its program from the cache, building it on the
+ *  first use and reporting the build to the frame profiler.
+ ***********************************************************/
+GLuint PostProcessStack::GetProgram(const std::vector<int>& effects, bool bFinal)
+{
+	std::ostringstream source;
+	source << (m_bCompute ? "#version 430 core\n" : "#version 410 core\n");
+	source << "uniform sampler2D sourceTexture;\n";
+	source << "uniform vec2 texelSize;\n";
+
+	int gather = -1;
+	for (size_t stage = 0; stage < effects.size(); stage++)
+	{
+		const EFFECT_SOURCE& effect = g_EffectSources[m_effects[effects[stage]].type];
+		std::ostringstream prefix;
+		prefix << "stage" << stage << "_";
+		source << "uniform vec4 " << prefix.str() << "parameters;\n";
+
+		// the taps of a neighbourhood effect see the stages before it
+		if (effect.bNeighborhood)
+		{
+			gather = (int)stage;
+			source << "vec4 " << prefix.str() << "input(vec2 uv)\n{\n";
+			source << "	vec2 pixel = uv / texelSize;\n";
+			source << "	vec4 color = textureLod(sourceTexture, uv, 0.0);\n";
+			for (size_t previous = 0; previous < stage; previous++)
+			{
+				source << "	color = stage" << previous << "_apply(color, uv, pixel);\n";
+			}
+			source << "	return(color);\n}\n";
+		}
+
+		std::string code = effect.code;
+		ShaderUtils::ReplaceAll(code, "$", prefix.str());
+		source << code;
+	}
+
+	source << "vec4 postProcess(vec2 uv, vec2 pixel)\n{\n";
+	if (gather >= 0)
+	{
+		source << "	vec4 color = stage" << gather << "_apply(uv, pixel);\n";
+	}
+	else
+	{
+		source << "	vec4 color = textureLod(sourceTexture, uv, 0.0);\n";
+	}
+	for (size_t stage = gather + 1; stage < effects.size(); stage++)
+	{
+		source << "	color = stage" << stage << "_apply(color, uv, pixel);\n";
+	}
+	source << "	return(color);\n}\n";
+
+	if (m_bCompute)
+	{
+		source << "layout(local_size_x = " << g_WorkGroupSize << ", local_size_y = " << g_WorkGroupSize << ") in;\n";
+		source << "layout(" << (bFinal ? "rgba8" : "rgba16f") << ") uniform writeonly image2D targetImage;\n";
+		source << "void main()\n{\n";
+		source << "	ivec2 coordinate = ivec2(gl_GlobalInvocationID.xy);\n";
+		source << "	if (any(greaterThanEqual(coordinate, imageSize(targetImage)))) return;\n";
+		source << "	vec2 pixel = vec2(coordinate) + 0.5;\n";
+		source << "	imageStore(targetImage, coordinate, postProcess(pixel * texelSize, pixel));\n";
+		source << "}\n";
+	}
+	else
+	{
+		source << "out vec4 outputColor;\n";
+		source << "void main()\n{\n";
+		source << "	outputColor = postProcess(gl_FragCoord.xy * texelSize, gl_FragCoord.xy);\n";
+		source << "}\n";
+	}
+
+	std::map<std::string, GLuint>::iterator cached = m_programs.find(source.str());
+	if (cached != m_programs.end())
+	{
+		return(cached->second);
+	}
+
+	std::ostringstream name;
+	name << "post";
+	for (size_t stage = 0; stage < effects.size(); stage++)
+	{
+		name << "." << g_EffectSources[m_effects[effects[stage]].type].name;
+	}
+
+	typedef std::chrono::steady_clock CLOCK;
+	CLOCK::time_point start = CLOCK::now();
+	std::vector<GLuint> shaders;
+	if (m_bCompute)
+	{
+		shaders.push_back(ShaderUtils::CompileShader(GL_COMPUTE_SHADER, source.str(), name.str() + ".comp"));
+	}
+	else
+	{
+		shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, ShaderUtils::FULLSCREEN_VERTEX_SHADER, name.str() + ".vert"));
+		shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, source.str(), name.str() + ".frag"));
+	}
+	GLuint program = ShaderUtils::LinkProgram(shaders, name.str());
+	if (NULL != m_pFrameProfiler)
+	{
+		m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_SHADER_COMPILE, "fused program " + name.str(),
+			std::chrono::duration<double, std::milli>(CLOCK::now() - start).count());
+	}
+
+	// a failed build is cached too, so it is not retried every frame
+	m_programs[source.str()] = program;
+	return(program);
+}
+
+/***********************************************************
+ *  AddPasses()
+ *
+ *  This method declares one graph pass per group of fused
+ *  effects and returns the texture the last one writes.
+ ***********************************************************/
+FrameGraph::RESOURCE PostProcessStack::AddPasses(FrameGraph& graph, FrameGraph::RESOURCE source)
+{
+	std::vector<std::vector<int> > passes;
+	PlanPasses(passes);
+
+	std::ostringstream plan;
+	for (size_t pass = 0; pass < passes.size(); pass++)
+	{
+		plan << ((pass == 0) ? "" : " | ");
+		for (size_t stage = 0; stage < passes[pass].size(); stage++)
+		{
+			plan << ((stage == 0) ? "" : "+") << g_EffectSources[m_effects[passes[pass][stage]].type].name;
+		}
+	}
+	m_passCount = (int)passes.size();
+	if (plan.str() != m_lastPlan)
+	{
+		std::cout << "INFO: Post processing in " << m_passCount << (m_bCompute ? " compute" : " fragment")
+			<< ((m_passCount == 1) ? " pass: " : " passes: ") << plan.str() << std::endl;
+		m_lastPlan = plan.str();
+	}
+
+	const FrameGraph::TEXTURE_DESC& sourceDesc = graph.GetDesc(source);
+	FrameGraph::RESOURCE input = source;
+	for (size_t pass = 0; pass < passes.size(); pass++)
+	{
+		bool bFinal = (pass + 1 == passes.size());
+		FrameGraph::TEXTURE_DESC desc = { sourceDesc.width, sourceDesc.height, (GLenum)(bFinal ? GL_RGBA8 : GL_RGBA16F) };
+		std::ostringstream name;
+		name << "post." << pass;
+		FrameGraph::RESOURCE output = graph.CreateTexture(name.str(), desc);
+
+		GLuint program = GetProgram(passes[pass], bFinal);
+		std::vector<int> effects = passes[pass];
+		int index = graph.AddPass("Post" + std::to_string(pass), [this, &graph, program, effects, input, output, bFinal, desc]()
+		{
+			RunPass(program, effects, graph.GetTexture(input), graph.GetTexture(output), bFinal, desc.width, desc.height);
+		});
+		graph.Read(index, input);
+		graph.Write(index, output);
+		input = output;
+	}
+	return(input);
+}
+
+/***********************************************************
+ *  RunPass()
+ *
+ *  This method sets the uniforms of a fused pass and runs
+ *  it as a dispatch or as a fullscreen triangle into the
+ *  framebuffer the graph has bound.
+ ***********************************************************/
+void PostProcessStack::RunPass(GLuint program, const std::vector<int>& effects, GLuint source, GLuint target,
+	bool bFinal, int width, int height)
+{
+	if ((program == 0) || (source == 0) || (target == 0))
+	{
+		return;
+	}
+
+	// the scene program receives its uniforms through the shader
+	// manager, so it has to be current again afterwards
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(program);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, source);
+	glUniform1i(glGetUniformLocation(program, "sourceTexture"), 0);
+	glUniform2f(glGetUniformLocation(program, "texelSize"), 1.0f / (float)width, 1.0f / (float)height);
+	for (size_t stage = 0; stage < effects.size(); stage++)
+	{
+		std::ostringstream name;
+		name << "stage" << stage << "_parameters";
+		glUniform4fv(glGetUniformLocation(program, name.str().c_str()), 1, &m_effects[effects[stage]].parameters[0]);
+	}
+
+	if (m_bCompute)
+	{
+		glBindImageTexture(0, target, 0, GL_FALSE, 0, GL_WRITE_ONLY, bFinal ? GL_RGBA8 : GL_RGBA16F);
+		glUniform1i(glGetUniformLocation(program, "targetImage"), 0);
+		glDispatchCompute((width + g_WorkGroupSize - 1) / g_WorkGroupSize, (height + g_WorkGroupSize - 1) / g_WorkGroupSize, 1);
+		// the next pass samples or blits what was stored
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+	}
+	else
+	{
+		GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+		GLboolean bBlend = glIsEnabled(GL_BLEND);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_BLEND);
+		glBindVertexArray(m_vertexArray);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+		glBindVertexArray(0);
+		if (bDepthTest)
+		{
+			glEnable(GL_DEPTH_TEST);
+		}
+		if (bBlend)
+		{
+			glEnable(GL_BLEND);
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// postprocessstack.h
+// ============
+// post effects fused into as few fullscreen passes as possible
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "FrameGraph.h"
+#include "FrameProfiler.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  PostProcessStack
+ *
+ *  This class holds an ordered list of post effects, each a
+ *  GLSL snippet with four parameters. Instead of one pass
+ *  per effect it generates a program that applies a run of
+ *  effects in one go, normally the whole stack in a single
+ *  compute dispatch, and caches the program by its source.
+ *  Effects that sample neighbouring pixels, such as FXAA,
+ *  apply the effects before them to every tap, so only a
+ *  second such effect starts another pass.
+ ***********************************************************/
+class PostProcessStack
+{
+public:
+	enum EFFECT_TYPE
+	{
+		EFFECT_TONEMAP = 0,
+		EFFECT_COLOR_GRADE,
+		EFFECT_VIGNETTE,
+		EFFECT_FXAA,
+		EFFECT_DITHER,
+		EFFECT_COUNT
+	};
+
+	// constructor
+	PostProcessStack();
+	// destructor
+	~PostProcessStack();
+
+	// pick compute or fragment passes and create the GL objects
+	bool Initialize();
+	// free the cached programs
+	void Destroy();
+
+	// append an effect with its default parameters
+	int AddEffect(EFFECT_TYPE type);
+	void SetParameters(int index, const glm::vec4& parameters);
+	void SetEnabled(int index, bool bEnabled);
+	void Clear();
+	int GetEffectCount() const { return((int)m_effects.size()); }
+
+	// effect for a name such as "fxaa"; false when unknown
+	static bool ParseEffectName(const std::string& name, EFFECT_TYPE* pType);
+	// append the comma separated effects of a list
+	bool AddEffects(const std::string& list);
+
+	// declare the fused passes that turn the source into an 8 bit
+	// result; returns the source when no effect is enabled
+	FrameGraph::RESOURCE AddPasses(FrameGraph& graph, FrameGraph::RESOURCE source);
+
+	// number of passes of the last plan
+	int GetPassCount() const { return(m_passCount); }
+	bool IsUsingCompute() const { return(m_bCompute); }
+
+	// receives the fused programs built mid frame
+	void SetFrameProfiler(FrameProfiler* pFrameProfiler) { m_pFrameProfiler = pFrameProfiler; }
+
+private:
+	struct EFFECT
+	{
+		EFFECT_TYPE type;
+		glm::vec4 parameters;
+		bool bEnabled;
+	};
+
+	std::vector<EFFECT> m_effects;
+	// generated source of a pass -> linked program
+	std::map<std::string, GLuint> m_programs;
+	// empty vertex array for the fullscreen triangle
+	GLuint m_vertexArray;
+	FrameProfiler* m_pFrameProfiler;
+	bool m_bCompute;
+	int m_passCount;
+	std::string m_lastPlan;
+
+	// group the enabled effects into passes
+	void PlanPasses(std::vector<std::vector<int> >& passes) const;
+	// build the source of one pass and return its program
+	GLuint GetProgram(const std::vector<int>& effects, bool bFinal);
+	// run one pass from the source texture into the target
+	void RunPass(GLuint program, const std::vector<int>& effects, GLuint source, GLuint target,
+		bool bFinal, int width, int height);
+};
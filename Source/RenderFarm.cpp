@@ -0,0 +1,362 @@
+///////////////////////////////////////////////////////////////////////////////
+// RenderFarm.cpp
+// ==============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `RenderFarm` class, which renders a list of camera
+// views with one GL context per worker thread and measures how the
+// throughput scales with the number of contexts.
+//
+// FUNCTIONALITY:
+// - Create one hidden window per worker on the main thread, as GLFW
+//   requires, with no context sharing, so each worker has its own copy of
+//   the shaders, meshes and textures made by `SceneManager::PrepareScene`.
+// - Let the workers pull views from a shared atomic queue, render them
+//   into their own framebuffer and read the pixels back.
+// - Time only the rendering, from when every context has finished its
+//   setup until the last image is read back, and report images per
+//   second, speedup and scaling efficiency.
+//
+// NOTES:
+// The views set the view and projection uniforms directly, because the
+// camera of `ViewManager` is a single global and cannot be shared by
+// several threads. The contexts come from hidden GLFW windows, so the
+// farm still needs a display server; on a headless box run it under a
+// virtual one such as Xvfb.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "RenderFarm.h"
+#include "SceneManager.h"
+#include "ShaderManager.h"
+
+#include <glm/gtx/transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+
+// declaration of the global variables and defines
+namespace
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	// the orbit views circle the default camera distance and
+	// look at the middle of the scene
+	const glm::vec3 g_OrbitTarget = glm::vec3(0.0f, 2.0f, 0.0f);
+	const float g_OrbitRadius = 13.0f;
+	const float g_OrbitHeight = 5.0f;
+	const float g_OrbitFov = 80.0f;
+}
+
+/***********************************************************
+ *  RenderFarm()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderFarm::RenderFarm(const std::string& vertexShader, const std::string& fragmentShader)
+{
+	m_vertexShader = vertexShader;
+	m_fragmentShader = fragmentShader;
+	m_nextJob = 0;
+	m_readyWorkers = 0;
+	m_bStart = false;
+}
+
+/***********************************************************
+ *  ~RenderFarm()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderFarm::~RenderFarm()
+{
+	m_jobs.clear();
+}
+
+/***********************************************************
+ *  AddOrbitJobs()
+ *
+ *  This method adds views evenly spaced on a circle around
+ *  the scene, all looking at its middle.
+ ***********************************************************/
+void RenderFarm::AddOrbitJobs(int count)
+{
+	for (int i = 0; i < count; i++)
+	{
+		float angle = 6.2831853f * (float)i / (float)count;
+
+		CAMERA_JOB job;
+		job.position = glm::vec3(g_OrbitRadius * sinf(angle), g_OrbitHeight, g_OrbitRadius * cosf(angle));
+		job.front = glm::normalize(g_OrbitTarget - job.position);
+		job.fov = g_OrbitFov;
+		m_jobs.push_back(job);
+	}
+}
+
+/***********************************************************
+ *  AddJob()
+ *
+ *  This method adds one view to the job list.
+ ***********************************************************/
+void RenderFarm::AddJob(const CAMERA_JOB& job)
+{
+	m_jobs.push_back(job);
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method renders every job once for each number of
+ *  contexts and prints the scaling table.
+ ***********************************************************/
+bool RenderFarm::Run(int maxContexts, int width, int height)
+{
+	if ((maxContexts <= 0) || (width <= 0) || (height <= 0) || m_jobs.empty())
+	{
+		return(false);
+	}
+
+	std::vector<int> contextCounts;
+	for (int count = 1; count < maxContexts; count *= 2)
+	{
+		contextCounts.push_back(count);
+	}
+	contextCounts.push_back(maxContexts);
+
+	std::cout << "INFO: Render farm: " << m_jobs.size() << " views of " << width << "x" << height
+		<< ", up to " << maxContexts << " contexts" << std::endl;
+
+	double singleRate = 0.0;
+	std::cout << "INFO: contexts   images/s   speedup   efficiency" << std::endl;
+	for (size_t i = 0; i < contextCounts.size(); i++)
+	{
+		double seconds = 0.0;
+		if (!RunPass(contextCounts[i], width, height, seconds))
+		{
+			return(false);
+		}
+
+		double rate = (seconds > 0.0) ? (double)m_jobs.size() / seconds : 0.0;
+		if (i == 0)
+		{
+			singleRate = rate;
+		}
+		double speedup = (singleRate > 0.0) ? rate / singleRate : 0.0;
+
+		std::cout << std::fixed << std::setprecision(2) << "INFO: "
+			<< std::setw(8) << contextCounts[i] << " "
+			<< std::setw(10) << rate << " "
+			<< std::setw(8) << speedup << "x "
+			<< std::setw(10) << 100.0 * speedup / contextCounts[i] << "%" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  RunPass()
+ *
+ *  This method starts the workers, waits until all of them
+ *  have prepared their scene and then times the rendering
+ *  of the whole job list.
+ ***********************************************************/
+bool RenderFarm::RunPass(int contextCount, int width, int height, double& seconds)
+{
+	// GLFW windows can only be created on the main thread
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	std::vector<WORKER> workers(contextCount);
+	bool bCreated = true;
+	for (int i = 0; i < contextCount; i++)
+	{
+		workers[i].pWindow = glfwCreateWindow(width, height, "render farm", NULL, NULL);
+		workers[i].bFailed = false;
+		workers[i].setupSeconds = 0.0;
+		workers[i].renderedJobs = 0;
+		workers[i].renderEnd = CLOCK::time_point();
+		bCreated = bCreated && (NULL != workers[i].pWindow);
+	}
+
+	if (!bCreated)
+	{
+		std::cerr << "Could not create " << contextCount << " render farm contexts" << std::endl;
+		for (int i = 0; i < contextCount; i++)
+		{
+			if (NULL != workers[i].pWindow)
+			{
+				glfwDestroyWindow(workers[i].pWindow);
+			}
+		}
+		return(false);
+	}
+
+	m_nextJob = 0;
+	m_readyWorkers = 0;
+	m_bStart = false;
+	for (int i = 0; i < contextCount; i++)
+	{
+		workers[i].thread = std::thread(&RenderFarm::WorkerMain, this, &workers[i], width, height);
+	}
+
+	CLOCK::time_point start;
+	{
+		std::unique_lock<std::mutex> lock(m_startMutex);
+		m_startChanged.wait(lock, [this, contextCount]() { return(m_readyWorkers == contextCount); });
+		start = CLOCK::now();
+		m_bStart = true;
+	}
+	m_startChanged.notify_all();
+
+	// the time ends with the last image read back; freeing the
+	// scene of every context is not part of the rendering
+	CLOCK::time_point end = start;
+	for (int i = 0; i < contextCount; i++)
+	{
+		workers[i].thread.join();
+		end = std::max(end, workers[i].renderEnd);
+	}
+	seconds = std::chrono::duration<double>(end - start).count();
+
+	bool bResult = true;
+	double setupSeconds = 0.0;
+	for (int i = 0; i < contextCount; i++)
+	{
+		glfwDestroyWindow(workers[i].pWindow);
+		bResult = bResult && !workers[i].bFailed;
+		setupSeconds += workers[i].setupSeconds;
+	}
+
+	if (!bResult)
+	{
+		std::cerr << "A render farm worker failed to prepare its context" << std::endl;
+	}
+	else if (contextCount > 1)
+	{
+		// the jobs a worker took show how evenly the queue spread them
+		std::cout << "INFO:   setup " << std::fixed << std::setprecision(2) << setupSeconds / contextCount
+			<< " s per context, jobs per context:";
+		std::cout.unsetf(std::ios::floatfield);
+		for (int i = 0; i < contextCount; i++)
+		{
+			std::cout << " " << workers[i].renderedJobs;
+		}
+		std::cout << std::endl;
+	}
+	return(bResult);
+}
+
+/***********************************************************
+ *  WorkerMain()
+ *
+ *  This method runs on a worker thread. It prepares its own
+ *  copy of the scene, then renders views from the shared
+ *  queue until none are left.
+ ***********************************************************/
+void RenderFarm::WorkerMain(WORKER* pWorker, int width, int height)
+{
+	glfwMakeContextCurrent(pWorker->pWindow);
+
+	ShaderManager* pShaderManager = NULL;
+	SceneManager* pSceneManager = NULL;
+	CLOCK::time_point setupStart = CLOCK::now();
+	{
+		std::lock_guard<std::mutex> lock(m_setupMutex);
+		if (glewInit() == GLEW_OK)
+		{
+			pShaderManager = new ShaderManager();
+			pShaderManager->LoadShaders(m_vertexShader.c_str(), m_fragmentShader.c_str());
+			pShaderManager->use();
+			pSceneManager = new SceneManager(pShaderManager);
+			pSceneManager->PrepareScene();
+		}
+	}
+
+	GLuint framebuffer = 0;
+	GLuint renderbuffers[2] = { 0, 0 };
+	if (NULL != pSceneManager)
+	{
+		glGenFramebuffers(1, &framebuffer);
+		glGenRenderbuffers(2, renderbuffers);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+		pWorker->bFailed = (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE);
+		glFinish();
+	}
+	else
+	{
+		pWorker->bFailed = true;
+	}
+	pWorker->setupSeconds = std::chrono::duration<double>(CLOCK::now() - setupStart).count();
+
+	SignalReady();
+	{
+		std::unique_lock<std::mutex> lock(m_startMutex);
+		m_startChanged.wait(lock, [this]() { return(m_bStart); });
+	}
+
+	if (!pWorker->bFailed)
+	{
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+		glm::mat4 projection;
+		glViewport(0, 0, width, height);
+		glEnable(GL_DEPTH_TEST);
+		// the same blending ViewManager::CreateDisplayWindow sets,
+		// so the translucent objects look as they do in the app
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+		size_t jobIndex;
+		while ((jobIndex = m_nextJob.fetch_add(1)) < m_jobs.size())
+		{
+			const CAMERA_JOB& job = m_jobs[jobIndex];
+			projection = glm::perspective(glm::radians(job.fov), (float)width / (float)height, 0.1f, 100.0f);
+
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			pShaderManager->setMat4Value("view", glm::lookAt(job.position, job.position + job.front, glm::vec3(0.0f, 1.0f, 0.0f)));
+			pShaderManager->setMat4Value("projection", projection);
+			pShaderManager->setVec3Value("viewPosition", job.position);
+			pSceneManager->RenderScene();
+
+			// reading the pixels makes the timing cover the whole image
+			glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+			pWorker->renderedJobs++;
+		}
+	}
+	pWorker->renderEnd = CLOCK::now();
+
+	// the scene objects free their GL resources in this context
+	if (framebuffer != 0)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &framebuffer);
+		glDeleteRenderbuffers(2, renderbuffers);
+	}
+	delete pSceneManager;
+	delete pShaderManager;
+	glfwMakeContextCurrent(NULL);
+}
+
+/***********************************************************
+ *  SignalReady()
+ *
+ *  This method counts a worker as ready to start.
+ ***********************************************************/
+void RenderFarm::SignalReady()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_startMutex);
+		m_readyWorkers++;
+	}
+	m_startChanged.notify_all();
+}
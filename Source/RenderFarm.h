@@ -0,0 +1,92 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderfarm.h
+// ============
+// render many camera views in parallel, one GL context per thread
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+#include <glm/glm.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  RenderFarm
+ *
+ *  This class renders a list of camera views with several
+ *  worker threads. Every worker owns a hidden window with an
+ *  unshared context and its own shaders and scene, so the
+ *  workers never wait on each other's GL state. The workers take the next view from a
+ *  shared queue until it is empty. On a software renderer
+ *  such as llvmpipe this spreads the work over the cores that
+ *  a single context leaves idle.
+ ***********************************************************/
+class RenderFarm
+{
+public:
+	// one view to render
+	struct CAMERA_JOB
+	{
+		glm::vec3 position;
+		glm::vec3 front;
+		// vertical field of view, in degrees
+		float fov;
+	};
+
+	// constructor
+	RenderFarm(const std::string& vertexShader, const std::string& fragmentShader);
+	// destructor
+	~RenderFarm();
+
+	// add views evenly spaced on a circle around the scene
+	void AddOrbitJobs(int count);
+	void AddJob(const CAMERA_JOB& job);
+
+	// render every job with 1, 2, 4 ... maxContexts contexts and
+	// report how the throughput scales
+	bool Run(int maxContexts, int width, int height);
+
+private:
+	struct WORKER
+	{
+		GLFWwindow* pWindow;
+		std::thread thread;
+		bool bFailed;
+		double setupSeconds;
+		long renderedJobs;
+		// when the last image was read back, before the teardown
+		std::chrono::steady_clock::time_point renderEnd;
+	};
+
+	std::string m_vertexShader;
+	std::string m_fragmentShader;
+	std::vector<CAMERA_JOB> m_jobs;
+
+	// index of the next job to take from m_jobs
+	std::atomic<size_t> m_nextJob;
+	// workers wait here until every context is ready
+	std::mutex m_startMutex;
+	std::condition_variable m_startChanged;
+	int m_readyWorkers;
+	bool m_bStart;
+	// stb_image and GLEW keep global state, so the scene setup
+	// of the workers runs one at a time
+	std::mutex m_setupMutex;
+
+	// render all jobs with the given number of contexts
+	bool RunPass(int contextCount, int width, int height, double& seconds);
+	// body of a worker thread
+	void WorkerMain(WORKER* pWorker, int width, int height);
+	// tell the main thread that a worker can start
+	void SignalReady();
+};
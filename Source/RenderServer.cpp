@@ -0,0 +1,793 @@
+///////////////////////////////////////////////////////////////////////////////
+// RenderServer.cpp
+// ================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `RenderServer` class, which drives the renderer as
+// a local service. The application starts with a hidden window, prepares
+// the scene once and then renders whatever camera poses clients ask for,
+// replying with the encoded image bytes.
+//
+// FUNCTIONALITY:
+// - Listen on a Unix domain socket (AF_UNIX, also available on Windows 10
+//   through afunix.h) and serve up to 64 clients at once with select().
+// - Queue the requests and render them in batches that share a size, so
+//   the framebuffer is only reallocated when the size changes.
+// - Read each image into its own pixel buffer object and fence it, so the
+//   transfer of one image overlaps the rendering of the next.
+// - Encode the images on a worker pool and send the replies without
+//   blocking the render loop.
+// - Track images per second, queue latency and total latency; they are
+//   printed every few seconds and returned by the STATS request.
+//
+// NOTES:
+// Only one scene exists, so every request shares it; the batch key is the
+// image size. Requests of other sizes wait for the next batch. A request
+// may ask for at most 4096x4096 pixels, and large images make smaller
+// batches, so no client can make the server reserve gigabytes of pixel
+// buffers.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "RenderServer.h"
+#include "GLDebugOutput.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <afunix.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+
+// declaration of the global variables and defines
+namespace
+{
+#ifdef _WIN32
+	typedef SOCKET NATIVE_SOCKET;
+	const int g_SendFlags = 0;
+#else
+	typedef int NATIVE_SOCKET;
+	// a client that disconnects must not raise SIGPIPE
+	const int g_SendFlags = MSG_NOSIGNAL;
+#endif
+	const std::uintptr_t g_InvalidSocket = (std::uintptr_t)(NATIVE_SOCKET)-1;
+
+	// seconds between the metrics printed to the console
+	const double g_ReportInterval = 5.0;
+	// largest image a request may ask for, 4096x4096 pixels, and
+	// the most pixel buffer memory one batch may take
+	const long long g_MaxImagePixels = 4096LL * 4096LL;
+	const long long g_MaxBatchBytes = 256LL * 1024LL * 1024LL;
+	// most clients served at once; select() only takes sockets that
+	// fit an fd_set, which also holds the listening socket
+	const size_t g_MaxClients = (FD_SETSIZE - 1 < 64) ? FD_SETSIZE - 1 : 64;
+	// longest request line; a RENDER line needs well under 1 KB
+	const size_t g_MaxLineLength = 4096;
+
+	/***********************************************************
+	 *  IsValidCamera()
+	 *
+	 *  True when a view can be built from the direction and the
+	 *  field of view: the direction is not zero nor along the
+	 *  world up axis, and the angle is strictly between 0 and
+	 *  180 degrees.
+	 ***********************************************************/
+	bool IsValidCamera(const glm::vec3& front, float fov)
+	{
+		float length = glm::length(front);
+		if (!std::isfinite(length) || (length < 1.0e-6f) || !std::isfinite(fov))
+		{
+			return(false);
+		}
+		return((std::fabs(front.y / length) < 0.9999f) && (fov > 0.0f) && (fov < 180.0f));
+	}
+
+	/***********************************************************
+	 *  CloseSocket()
+	 *
+	 *  Closes a socket handle.
+	 ***********************************************************/
+	void CloseSocket(std::uintptr_t handle)
+	{
+#ifdef _WIN32
+		closesocket((NATIVE_SOCKET)handle);
+#else
+		close((NATIVE_SOCKET)handle);
+#endif
+	}
+
+	/***********************************************************
+	 *  SetNonBlocking()
+	 *
+	 *  Switches a socket to non-blocking mode.
+	 ***********************************************************/
+	bool SetNonBlocking(std::uintptr_t handle)
+	{
+#ifdef _WIN32
+		u_long mode = 1;
+		return(ioctlsocket((NATIVE_SOCKET)handle, FIONBIO, &mode) == 0);
+#else
+		int flags = fcntl((NATIVE_SOCKET)handle, F_GETFL, 0);
+		return(fcntl((NATIVE_SOCKET)handle, F_SETFL, flags | O_NONBLOCK) == 0);
+#endif
+	}
+
+	/***********************************************************
+	 *  WouldBlock()
+	 *
+	 *  True when the last socket call failed only because it
+	 *  would have had to wait.
+	 ***********************************************************/
+	bool WouldBlock()
+	{
+#ifdef _WIN32
+		return(WSAGetLastError() == WSAEWOULDBLOCK);
+#else
+		return((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR));
+#endif
+	}
+}
+
+/***********************************************************
+ *  RenderServer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderServer::RenderServer(ViewManager* pViewManager, SceneManager* pSceneManager)
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_listenSocket = g_InvalidSocket;
+	m_bStopping = false;
+	m_maxImageSize = 0;
+	m_nextClientId = 1;
+
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+	for (int i = 0; i < MAX_BATCH; i++)
+	{
+		m_packBuffers[i] = 0;
+		m_packBufferSizes[i] = 0;
+	}
+
+	m_receivedRequests = 0;
+	m_completedImages = 0;
+	m_batches = 0;
+	m_totalQueueMs = 0.0;
+	m_maxQueueMs = 0.0;
+	m_totalLatencyMs = 0.0;
+}
+
+/***********************************************************
+ *  ~RenderServer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderServer::~RenderServer()
+{
+	m_workerPool.WaitIdle();
+	DestroyTarget();
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  Run()
+ *
+ *  This method opens the socket and serves requests until a
+ *  client sends QUIT.
+ ***********************************************************/
+bool RenderServer::Run(const std::string& socketPath)
+{
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if (socketPath.size() >= sizeof(address.sun_path))
+	{
+		std::cerr << "Socket path is too long: " << socketPath << std::endl;
+		return(false);
+	}
+	strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+#ifdef _WIN32
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+	{
+		std::cerr << "Could not initialize Winsock" << std::endl;
+		return(false);
+	}
+#endif
+
+	// a socket file left behind by an earlier run blocks bind()
+	std::remove(socketPath.c_str());
+
+	m_listenSocket = (std::uintptr_t)socket(AF_UNIX, SOCK_STREAM, 0);
+	if ((m_listenSocket == g_InvalidSocket) ||
+		(bind((NATIVE_SOCKET)m_listenSocket, (sockaddr*)&address, sizeof(address)) != 0) ||
+		(listen((NATIVE_SOCKET)m_listenSocket, 16) != 0) ||
+		!SetNonBlocking(m_listenSocket))
+	{
+		std::cerr << "Could not listen on " << socketPath << std::endl;
+		if (m_listenSocket != g_InvalidSocket)
+		{
+			CloseSocket(m_listenSocket);
+			m_listenSocket = g_InvalidSocket;
+		}
+#ifdef _WIN32
+		WSACleanup();
+#endif
+		return(false);
+	}
+
+	GLint maxRenderbufferSize = 0;
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+	m_maxImageSize = maxRenderbufferSize;
+	m_lastReportTime = CLOCK::now();
+	m_bStopping = false;
+
+	std::cout << "INFO: Render server listening on " << socketPath << std::endl;
+
+	while (!m_bStopping)
+	{
+		// wait for input only when there is nothing to render or send
+		bool bBusy = !m_queue.empty() || (m_workerPool.GetPendingCount() > 0);
+		PollSockets(bBusy ? 1 : 50);
+
+		if (!m_queue.empty())
+		{
+			RenderNextBatch();
+		}
+		CollectReplies();
+
+		if ((m_completedImages > 0) &&
+			(std::chrono::duration<double>(CLOCK::now() - m_lastReportTime).count() >= g_ReportInterval))
+		{
+			std::cout << "INFO: " << FormatStats() << std::endl;
+			m_lastReportTime = CLOCK::now();
+		}
+	}
+
+	// answer everything that was already rendered before closing
+	m_workerPool.WaitIdle();
+	CollectReplies();
+	CLOCK::time_point drainStart = CLOCK::now();
+	while (std::chrono::duration<double>(CLOCK::now() - drainStart).count() < 1.0)
+	{
+		bool bPending = false;
+		for (std::map<int, CLIENT>::iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+		{
+			bPending = bPending || !it->second.output.empty();
+		}
+		if (!bPending)
+		{
+			break;
+		}
+		PollSockets(10);
+	}
+
+	while (!m_clients.empty())
+	{
+		CloseClient(m_clients.begin()->first);
+	}
+	CloseSocket(m_listenSocket);
+	m_listenSocket = g_InvalidSocket;
+	std::remove(socketPath.c_str());
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	DestroyTarget();
+	std::cout << "INFO: Render server stopped. " << FormatStats() << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  PollSockets()
+ *
+ *  This method accepts new clients, reads requests and
+ *  sends pending replies, waiting at most the timeout.
+ *  Clients beyond the limit, or whose socket does not fit
+ *  an fd_set, are closed as soon as they are accepted.
+ ***********************************************************/
+void RenderServer::PollSockets(int timeoutMs)
+{
+	fd_set readSet;
+	fd_set writeSet;
+	FD_ZERO(&readSet);
+	FD_ZERO(&writeSet);
+
+	NATIVE_SOCKET maxSocket = (NATIVE_SOCKET)m_listenSocket;
+	FD_SET((NATIVE_SOCKET)m_listenSocket, &readSet);
+	for (std::map<int, CLIENT>::iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+	{
+		NATIVE_SOCKET handle = (NATIVE_SOCKET)it->second.socket;
+		FD_SET(handle, &readSet);
+		if (!it->second.output.empty())
+		{
+			FD_SET(handle, &writeSet);
+		}
+		maxSocket = std::max(maxSocket, handle);
+	}
+
+	timeval timeout;
+	timeout.tv_sec = 0;
+	timeout.tv_usec = timeoutMs * 1000;
+	if (select((int)maxSocket + 1, &readSet, &writeSet, NULL, &timeout) <= 0)
+	{
+		return;
+	}
+
+	if (FD_ISSET((NATIVE_SOCKET)m_listenSocket, &readSet))
+	{
+		while (true)
+		{
+			std::uintptr_t handle = (std::uintptr_t)accept((NATIVE_SOCKET)m_listenSocket, NULL, NULL);
+			if (handle == g_InvalidSocket)
+			{
+				break;
+			}
+#ifndef _WIN32
+			bool bFits = (handle < (std::uintptr_t)FD_SETSIZE);
+#else
+			bool bFits = true;
+#endif
+			if (!bFits || (m_clients.size() >= g_MaxClients))
+			{
+				CloseSocket(handle);
+				continue;
+			}
+			SetNonBlocking(handle);
+
+			CLIENT client;
+			client.socket = handle;
+			client.sentBytes = 0;
+			m_clients[m_nextClientId++] = client;
+		}
+	}
+
+	// handling a line can close a client, so walk a copy of the ids
+	std::vector<int> clientIds;
+	for (std::map<int, CLIENT>::iterator it = m_clients.begin(); it != m_clients.end(); ++it)
+	{
+		clientIds.push_back(it->first);
+	}
+
+	for (size_t i = 0; i < clientIds.size(); i++)
+	{
+		int clientId = clientIds[i];
+		if (m_clients.find(clientId) == m_clients.end())
+		{
+			continue;
+		}
+		NATIVE_SOCKET handle = (NATIVE_SOCKET)m_clients[clientId].socket;
+
+		if (FD_ISSET(handle, &readSet))
+		{
+			char buffer[4096];
+			int received = (int)recv(handle, buffer, sizeof(buffer), 0);
+			if ((received == 0) || ((received < 0) && !WouldBlock()))
+			{
+				CloseClient(clientId);
+				continue;
+			}
+			if (received > 0)
+			{
+				m_clients[clientId].input.append(buffer, received);
+
+				size_t lineEnd;
+				while ((m_clients.find(clientId) != m_clients.end()) &&
+					((lineEnd = m_clients[clientId].input.find('\n')) != std::string::npos))
+				{
+					std::string line = m_clients[clientId].input.substr(0, lineEnd);
+					m_clients[clientId].input.erase(0, lineEnd + 1);
+					if (!line.empty() && (line[line.size() - 1] == '\r'))
+					{
+						line.erase(line.size() - 1);
+					}
+					HandleLine(clientId, line);
+				}
+
+				// a client that never ends its line is dropped instead
+				// of buffered without bound
+				if ((m_clients.find(clientId) != m_clients.end()) &&
+					(m_clients[clientId].input.size() > g_MaxLineLength))
+				{
+					std::cout << "WARNING: Render server client sent a line over "
+						<< g_MaxLineLength << " bytes, closing it" << std::endl;
+					CloseClient(clientId);
+					continue;
+				}
+			}
+		}
+
+		if ((m_clients.find(clientId) != m_clients.end()) && FD_ISSET(handle, &writeSet))
+		{
+			CLIENT& client = m_clients[clientId];
+			int sent = (int)send(handle, (const char*)&client.output[client.sentBytes],
+				(int)(client.output.size() - client.sentBytes), g_SendFlags);
+			if ((sent < 0) && !WouldBlock())
+			{
+				CloseClient(clientId);
+				continue;
+			}
+			if (sent > 0)
+			{
+				client.sentBytes += sent;
+				if (client.sentBytes == client.output.size())
+				{
+					client.output.clear();
+					client.sentBytes = 0;
+				}
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  HandleLine()
+ *
+ *  This method parses one request line from a client.
+ ***********************************************************/
+void RenderServer::HandleLine(int clientId, const std::string& line)
+{
+	std::istringstream input(line);
+	std::string command;
+	input >> command;
+
+	if (command.empty())
+	{
+		return;
+	}
+	else if (command == "RENDER")
+	{
+		REQUEST request;
+		std::string format;
+		input >> request.id >> request.width >> request.height >> format
+			>> request.position.x >> request.position.y >> request.position.z
+			>> request.front.x >> request.front.y >> request.front.z >> request.fov;
+
+		if (input.fail())
+		{
+			QueueReply(clientId, "ERROR " + (request.id.empty() ? std::string("-") : request.id) + " malformed request\n");
+		}
+		else if (!ImageWriter::ParseFormat(format, &request.format))
+		{
+			QueueReply(clientId, "ERROR " + request.id + " unsupported format\n");
+		}
+		else if ((request.width <= 0) || (request.height <= 0) ||
+			(request.width > m_maxImageSize) || (request.height > m_maxImageSize) ||
+			((long long)request.width * request.height > g_MaxImagePixels))
+		{
+			QueueReply(clientId, "ERROR " + request.id + " unsupported size\n");
+		}
+		else if (!IsValidCamera(request.front, request.fov))
+		{
+			QueueReply(clientId, "ERROR " + request.id + " invalid camera\n");
+		}
+		else
+		{
+			request.clientId = clientId;
+			request.arrival = CLOCK::now();
+			request.queueMs = 0.0;
+			if (m_receivedRequests == 0)
+			{
+				m_firstRequestTime = request.arrival;
+			}
+			m_receivedRequests++;
+			m_queue.push_back(request);
+		}
+	}
+	else if (command == "STATS")
+	{
+		QueueReply(clientId, FormatStats() + "\n");
+	}
+	else if (command == "QUIT")
+	{
+		QueueReply(clientId, "BYE\n");
+		m_bStopping = true;
+	}
+	else
+	{
+		QueueReply(clientId, "ERROR - unknown command " + command + "\n");
+	}
+}
+
+/***********************************************************
+ *  QueueReply()
+ *
+ *  This method appends text to a client's pending output.
+ ***********************************************************/
+void RenderServer::QueueReply(int clientId, const std::string& text)
+{
+	std::map<int, CLIENT>::iterator client = m_clients.find(clientId);
+	if (client != m_clients.end())
+	{
+		client->second.output.insert(client->second.output.end(), text.begin(), text.end());
+	}
+}
+
+/***********************************************************
+ *  CollectReplies()
+ *
+ *  This method moves the replies finished by the workers to
+ *  the output of their clients.
+ ***********************************************************/
+void RenderServer::CollectReplies()
+{
+	std::vector<REPLY> replies;
+	{
+		std::lock_guard<std::mutex> lock(m_replyMutex);
+		replies.swap(m_replies);
+	}
+
+	for (size_t i = 0; i < replies.size(); i++)
+	{
+		std::map<int, CLIENT>::iterator client = m_clients.find(replies[i].clientId);
+		if (client != m_clients.end())
+		{
+			client->second.output.insert(client->second.output.end(),
+				replies[i].bytes.begin(), replies[i].bytes.end());
+		}
+	}
+}
+
+/***********************************************************
+ *  CloseClient()
+ *
+ *  This method closes a client connection. Its queued
+ *  requests are still rendered, but the replies are dropped.
+ ***********************************************************/
+void RenderServer::CloseClient(int clientId)
+{
+	std::map<int, CLIENT>::iterator client = m_clients.find(clientId);
+	if (client != m_clients.end())
+	{
+		CloseSocket(client->second.socket);
+		m_clients.erase(client);
+	}
+}
+
+/***********************************************************
+ *  RenderNextBatch()
+ *
+ *  This method takes the oldest request and every queued
+ *  request of the same size, renders them back to back and
+ *  hands the pixels to the workers for encoding.
+ ***********************************************************/
+void RenderServer::RenderNextBatch()
+{
+	const int width = m_queue.front().width;
+	const int height = m_queue.front().height;
+	// computed in 64 bits, the requests are limited to a size that
+	// fits a 32 bit GLsizeiptr
+	const long long imageBytes = (long long)width * height * 4;
+	const int maxBatch = (int)std::max(1LL, std::min((long long)MAX_BATCH, g_MaxBatchBytes / imageBytes));
+
+	std::vector<REQUEST> batch;
+	for (std::deque<REQUEST>::iterator it = m_queue.begin(); (it != m_queue.end()) && ((int)batch.size() < maxBatch);)
+	{
+		if ((it->width == width) && (it->height == height))
+		{
+			batch.push_back(*it);
+			it = m_queue.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (!ResizeTarget(width, height))
+	{
+		for (size_t i = 0; i < batch.size(); i++)
+		{
+			QueueReply(batch[i].clientId, "ERROR " + batch[i].id + " no render target\n");
+		}
+		return;
+	}
+	m_batches++;
+
+	GLsync fences[MAX_BATCH];
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		REQUEST& request = batch[i];
+		request.queueMs = std::chrono::duration<double, std::milli>(CLOCK::now() - request.arrival).count();
+
+		m_pViewManager->SetCameraPose(request.position, request.front, request.fov);
+		m_pViewManager->SetProjectionTile(width, height, 0, 0, width, height);
+
+		glEnable(GL_DEPTH_TEST);
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		m_pViewManager->PrepareSceneView();
+		m_pSceneManager->RenderScene();
+
+		// the copy into the pixel buffer runs while the next image renders
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_packBuffers[i]);
+		if (m_packBufferSizes[i] < imageBytes)
+		{
+			// the buffer exists once it is first bound, so it is
+			// labelled with its first storage
+			if (m_packBufferSizes[i] == 0)
+			{
+				GLDebugOutput::LabelObject(GL_BUFFER, m_packBuffers[i], "buffer:render-server.pack" + std::to_string(i));
+			}
+			glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)imageBytes, NULL, GL_STREAM_READ);
+			m_packBufferSizes[i] = (GLsizeiptr)imageBytes;
+		}
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+		fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	m_pViewManager->ClearProjectionTile();
+
+	for (size_t i = 0; i < batch.size(); i++)
+	{
+		glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(fences[i]);
+
+		std::shared_ptr<std::vector<unsigned char> > pixels(new std::vector<unsigned char>((size_t)imageBytes));
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_packBuffers[i]);
+		const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)imageBytes, GL_MAP_READ_BIT);
+		if (NULL == mapped)
+		{
+			QueueReply(batch[i].clientId, "ERROR " + batch[i].id + " readback failed\n");
+			continue;
+		}
+		memcpy(&(*pixels)[0], mapped, (size_t)imageBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+		REQUEST request = batch[i];
+		m_workerPool.Submit([this, request, pixels]()
+		{
+			REPLY reply;
+			reply.clientId = request.clientId;
+
+			std::vector<unsigned char> encoded;
+			std::ostringstream header;
+			if (ImageWriter::Encode(request.format, request.width, request.height, &(*pixels)[0], true, encoded))
+			{
+				double totalMs = std::chrono::duration<double, std::milli>(CLOCK::now() - request.arrival).count();
+				header << std::fixed << std::setprecision(3) << "OK " << request.id << " " << encoded.size()
+					<< " " << request.queueMs << " " << totalMs << "\n";
+
+				std::lock_guard<std::mutex> lock(m_replyMutex);
+				m_completedImages++;
+				m_totalQueueMs += request.queueMs;
+				m_maxQueueMs = std::max(m_maxQueueMs, request.queueMs);
+				m_totalLatencyMs += totalMs;
+			}
+			else
+			{
+				header << "ERROR " << request.id << " encoding failed\n";
+				encoded.clear();
+			}
+
+			std::string text = header.str();
+			reply.bytes.assign(text.begin(), text.end());
+			reply.bytes.insert(reply.bytes.end(), encoded.begin(), encoded.end());
+
+			std::lock_guard<std::mutex> lock(m_replyMutex);
+			m_replies.push_back(reply);
+		});
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+/***********************************************************
+ *  ResizeTarget()
+ *
+ *  This method makes sure the render target has the given
+ *  size, recreating it only when the size changes.
+ ***********************************************************/
+bool RenderServer::ResizeTarget(int width, int height)
+{
+	if ((m_framebuffer != 0) && (m_targetWidth == width) && (m_targetHeight == height))
+	{
+		return(true);
+	}
+
+	if (m_framebuffer == 0)
+	{
+		glGenFramebuffers(1, &m_framebuffer);
+		glGenRenderbuffers(1, &m_colorBuffer);
+		glGenRenderbuffers(1, &m_depthBuffer);
+		glGenBuffers(MAX_BATCH, m_packBuffers);
+		GLDebugOutput::LabelObject(GL_FRAMEBUFFER, m_framebuffer, "framebuffer:render-server");
+		GLDebugOutput::LabelObject(GL_RENDERBUFFER, m_colorBuffer, "renderbuffer:render-server.color");
+		GLDebugOutput::LabelObject(GL_RENDERBUFFER, m_depthBuffer, "renderbuffer:render-server.depth");
+	}
+
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	bool bComplete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	m_targetWidth = bComplete ? width : 0;
+	m_targetHeight = bComplete ? height : 0;
+	return(bComplete);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method frees the render target and pixel buffers.
+ ***********************************************************/
+void RenderServer::DestroyTarget()
+{
+	if (m_framebuffer == 0)
+	{
+		return;
+	}
+
+	glDeleteFramebuffers(1, &m_framebuffer);
+	glDeleteRenderbuffers(1, &m_colorBuffer);
+	glDeleteRenderbuffers(1, &m_depthBuffer);
+	glDeleteBuffers(MAX_BATCH, m_packBuffers);
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	for (int i = 0; i < MAX_BATCH; i++)
+	{
+		m_packBuffers[i] = 0;
+		m_packBufferSizes[i] = 0;
+	}
+	m_targetWidth = 0;
+	m_targetHeight = 0;
+}
+
+/***********************************************************
+ *  FormatStats()
+ *
+ *  This method returns the server metrics as one line.
+ ***********************************************************/
+std::string RenderServer::FormatStats()
+{
+	std::lock_guard<std::mutex> lock(m_replyMutex);
+	std::ostringstream stats;
+
+	double seconds = (m_receivedRequests > 0) ?
+		std::chrono::duration<double>(CLOCK::now() - m_firstRequestTime).count() : 0.0;
+	long completedImages = m_completedImages;
+	double completed = (completedImages > 0) ? (double)completedImages : 1.0;
+
+	stats << std::fixed << std::setprecision(2)
+		<< "STATS images=" << completedImages
+		<< " received=" << m_receivedRequests
+		<< " queued=" << m_queue.size()
+		<< " batches=" << m_batches
+		<< " avg_batch=" << ((m_batches > 0) ? (double)completedImages / m_batches : 0.0)
+		<< " images_per_sec=" << ((seconds > 0.0) ? completedImages / seconds : 0.0)
+		<< " queue_ms_avg=" << m_totalQueueMs / completed
+		<< " queue_ms_max=" << m_maxQueueMs
+		<< " latency_ms_avg=" << m_totalLatencyMs / completed;
+	return(stats.str());
+}
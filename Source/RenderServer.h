@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderserver.h
+// ============
+// serve render requests received on a local Unix domain socket
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "ImageWriter.h"
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  RenderServer
+ *
+ *  This class turns the application into a headless render
+ *  service. Clients connect to a Unix domain socket and send
+ *  one request per line:
+ *
+ *    RENDER <id> <width> <height> <png|qoi|exr>
+ *           <x> <y> <z> <frontX> <frontY> <frontZ> <fov>
+ *    STATS
+ *    QUIT
+ *
+ *  A render is answered with "OK <id> <bytes> <queueMs>
+ *  <totalMs>" and a newline, followed by the image bytes, or
+ *  with "ERROR <id> <reason>". Requests of the same size are
+ *  rendered as a batch through one framebuffer, with the
+ *  readback of each image overlapping the next render.
+ ***********************************************************/
+class RenderServer
+{
+public:
+	// constructor
+	RenderServer(ViewManager* pViewManager, SceneManager* pSceneManager);
+	// destructor
+	~RenderServer();
+
+	// listen on the socket path and serve until a QUIT request
+	bool Run(const std::string& socketPath);
+
+private:
+	typedef std::chrono::steady_clock CLOCK;
+	// native socket handle, wide enough for SOCKET on Windows
+	typedef std::uintptr_t SOCKET_HANDLE;
+
+	// largest number of requests rendered in one batch
+	static const int MAX_BATCH = 8;
+
+	struct CLIENT
+	{
+		SOCKET_HANDLE socket;
+		// received bytes that do not form a whole line yet
+		std::string input;
+		// reply bytes not yet sent, starting at sentBytes
+		std::vector<unsigned char> output;
+		size_t sentBytes;
+	};
+
+	struct REQUEST
+	{
+		int clientId;
+		std::string id;
+		int width;
+		int height;
+		ImageWriter::IMAGE_FORMAT format;
+		glm::vec3 position;
+		glm::vec3 front;
+		float fov;
+		CLOCK::time_point arrival;
+		double queueMs;
+	};
+
+	// reply produced by a worker, waiting to be queued for sending
+	struct REPLY
+	{
+		int clientId;
+		std::vector<unsigned char> bytes;
+	};
+
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	SOCKET_HANDLE m_listenSocket;
+	bool m_bStopping;
+	// largest width or height a request may ask for
+	int m_maxImageSize;
+
+	std::map<int, CLIENT> m_clients;
+	int m_nextClientId;
+	std::deque<REQUEST> m_queue;
+
+	// render target, sized for the current batch
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	int m_targetWidth;
+	int m_targetHeight;
+	// pixel buffers for the pipelined readback of a batch
+	GLuint m_packBuffers[MAX_BATCH];
+	GLsizeiptr m_packBufferSizes[MAX_BATCH];
+
+	// encodes the images and builds the replies
+	WorkerPool m_workerPool;
+	std::mutex m_replyMutex;
+	std::vector<REPLY> m_replies;
+
+	// metrics, written by the workers under m_replyMutex; the
+	// image count is also read by the render thread without it
+	CLOCK::time_point m_firstRequestTime;
+	long m_receivedRequests;
+	std::atomic<long> m_completedImages;
+	long m_batches;
+	double m_totalQueueMs;
+	double m_maxQueueMs;
+	double m_totalLatencyMs;
+	CLOCK::time_point m_lastReportTime;
+
+	// read from and write to the connected sockets
+	void PollSockets(int timeoutMs);
+	void HandleLine(int clientId, const std::string& line);
+	void QueueReply(int clientId, const std::string& text);
+	void CollectReplies();
+	void CloseClient(int clientId);
+
+	// render the next batch of requests that share a size
+	void RenderNextBatch();
+	bool ResizeTarget(int width, int height);
+	void DestroyTarget();
+
+	// metrics as a single line of text
+	std::string FormatStats();
+};
@@ -0,0 +1,668 @@
+///////////////////////////////////////////////////////////////////////////////
+// SSAOPass.cpp
+// ============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `SSAOPass` class, which adds ambient occlusion to
+// the scene color of the frame graph in five fullscreen passes at a
+// fraction of the screen resolution.
+//
+// FUNCTIONALITY:
+// - Reduce the scene depth to a linear view depth at 1/2 or 1/4 of the
+//   resolution, keeping the nearest depth of every block.
+// - Estimate the occlusion with a hemisphere kernel oriented along the
+//   normal rebuilt from the depth, rotated per pixel with interleaved
+//   gradient noise instead of a noise texture.
+// - Blur the occlusion horizontally and vertically with weights that fall
+//   off across depth discontinuities.
+// - Upsample the occlusion with the four nearest low resolution texels,
+//   weighted by bilinear position and by how close their depth is to the
+//   full resolution depth, and multiply it into the scene color.
+// - Time the passes of each quality preset under its own profiler name
+//   and report the averages.
+//
+// NOTES:
+// The scene shader writes lit color only, so the occlusion darkens the
+// whole color rather than its ambient term alone; the strength keeps the
+// effect on direct light moderate. The textures between the passes are
+// transient graph textures, so the raw and the blurred occlusion share
+// memory through the aliasing of the graph.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "SSAOPass.h"
+#include "ShaderUtils.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <iomanip>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	struct QUALITY_PRESET
+	{
+		const char* name;
+		// name of the passes in the GPU profiler
+		const char* profileName;
+		// divisor of the screen resolution
+		int scale;
+		int samples;
+		int blurRadius;
+	};
+
+	const QUALITY_PRESET g_Presets[SSAOPass::QUALITY_COUNT] =
+	{
+		{ "low", "SSAO low", 4, 8, 2 },
+		{ "medium", "SSAO medium", 2, 12, 3 },
+		{ "high", "SSAO high", 2, 24, 4 },
+	};
+
+	// how sharply the blur and the upsample stop at depth edges
+	const float g_DepthSharpness = 16.0f;
+
+	// keeps the nearest depth of each block as a linear view depth
+	const char* g_DepthFragmentShader =
+		"#version 410 core\n"
+		"uniform sampler2D depthTexture;\n"
+		"uniform int blockSize;\n"
+		"uniform vec2 depthParameters;\n"
+		"out float linearDepth;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 size = textureSize(depthTexture, 0);\n"
+		"	ivec2 origin = ivec2(gl_FragCoord.xy) * blockSize;\n"
+		"	float nearest = 1.0;\n"
+		"	for (int y = 0; y < blockSize; y++)\n"
+		"	{\n"
+		"		for (int x = 0; x < blockSize; x++)\n"
+		"		{\n"
+		"			nearest = min(nearest, texelFetch(depthTexture, min(origin + ivec2(x, y), size - 1), 0).r);\n"
+		"		}\n"
+		"	}\n"
+		"	linearDepth = depthParameters.y / (nearest * 2.0 - 1.0 + depthParameters.x);\n"
+		"}\n";
+
+	// hemisphere occlusion around the normal rebuilt from the depth
+	const char* g_OcclusionFragmentShader =
+		"#version 410 core\n"
+		"uniform sampler2D depthTexture;\n"
+		"uniform mat4 projection;\n"
+		"uniform vec3 kernel[32];\n"
+		"uniform int sampleCount;\n"
+		"uniform float radius;\n"
+		"uniform float farDepth;\n"
+		"out float ambientOcclusion;\n"
+		"ivec2 size;\n"
+		"vec3 ViewPosition(ivec2 texel)\n"
+		"{\n"
+		"	texel = clamp(texel, ivec2(0), size - 1);\n"
+		"	float depth = texelFetch(depthTexture, texel, 0).r;\n"
+		"	vec2 ndc = (vec2(texel) + 0.5) / vec2(size) * 2.0 - 1.0;\n"
+		"	return(vec3(ndc * depth / vec2(projection[0][0], projection[1][1]), -depth));\n"
+		"}\n"
+		"void main()\n"
+		"{\n"
+		"	size = textureSize(depthTexture, 0);\n"
+		"	ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"	vec3 center = ViewPosition(texel);\n"
+		"	if (-center.z >= farDepth)\n"
+		"	{\n"
+		"		ambientOcclusion = 1.0;\n"
+		"		return;\n"
+		"	}\n"
+		"	// take the neighbour on the side without a depth edge\n"
+		"	vec3 left = ViewPosition(texel - ivec2(1, 0));\n"
+		"	vec3 right = ViewPosition(texel + ivec2(1, 0));\n"
+		"	vec3 down = ViewPosition(texel - ivec2(0, 1));\n"
+		"	vec3 up = ViewPosition(texel + ivec2(0, 1));\n"
+		"	vec3 dx = (abs(right.z - center.z) < abs(center.z - left.z)) ? right - center : center - left;\n"
+		"	vec3 dy = (abs(up.z - center.z) < abs(center.z - down.z)) ? up - center : center - down;\n"
+		"	vec3 normal = normalize(cross(dx, dy));\n"
+		"	float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));\n"
+		"	vec3 random = vec3(cos(angle), sin(angle), 0.0);\n"
+		"	vec3 tangent = normalize(random - normal * dot(random, normal));\n"
+		"	mat3 basis = mat3(tangent, cross(normal, tangent), normal);\n"
+		"	float bias = 0.02 * radius;\n"
+		"	float occlusion = 0.0;\n"
+		"	for (int i = 0; i < sampleCount; i++)\n"
+		"	{\n"
+		"		vec3 position = center + basis * kernel[i] * radius;\n"
+		"		vec4 clip = projection * vec4(position, 1.0);\n"
+		"		vec2 uv = clip.xy / clip.w * 0.5 + 0.5;\n"
+		"		float depth = texelFetch(depthTexture, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), 0).r;\n"
+		"		float range = smoothstep(0.0, 1.0, radius / abs(-center.z - depth));\n"
+		"		occlusion += ((depth <= -position.z - bias) ? 1.0 : 0.0) * range;\n"
+		"	}\n"
+		"	ambientOcclusion = 1.0 - occlusion / float(sampleCount);\n"
+		"}\n";
+
+	// one direction of a gaussian that stops at depth edges
+	const char* g_BlurFragmentShader =
+		"#version 410 core\n"
+		"uniform sampler2D occlusionTexture;\n"
+		"uniform sampler2D depthTexture;\n"
+		"uniform ivec2 direction;\n"
+		"uniform int blurRadius;\n"
+		"uniform float sharpness;\n"
+		"out float ambientOcclusion;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 size = textureSize(occlusionTexture, 0);\n"
+		"	ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"	float centerDepth = texelFetch(depthTexture, texel, 0).r;\n"
+		"	float sigma = float(blurRadius) * 0.5 + 0.5;\n"
+		"	float total = 0.0;\n"
+		"	float weights = 0.0;\n"
+		"	for (int i = -blurRadius; i <= blurRadius; i++)\n"
+		"	{\n"
+		"		ivec2 tap = clamp(texel + direction * i, ivec2(0), size - 1);\n"
+		"		float depth = texelFetch(depthTexture, tap, 0).r;\n"
+		"		float weight = exp(-float(i * i) / (2.0 * sigma * sigma)) *\n"
+		"			exp(-abs(depth - centerDepth) / centerDepth * sharpness);\n"
+		"		total += texelFetch(occlusionTexture, tap, 0).r * weight;\n"
+		"		weights += weight;\n"
+		"	}\n"
+		"	ambientOcclusion = total / weights;\n"
+		"}\n";
+
+	// depth aware upsample of the occlusion into the scene color
+	const char* g_ApplyFragmentShader =
+		"#version 410 core\n"
+		"uniform sampler2D colorTexture;\n"
+		"uniform sampler2D sceneDepthTexture;\n"
+		"uniform sampler2D depthTexture;\n"
+		"uniform sampler2D occlusionTexture;\n"
+		"uniform vec2 depthParameters;\n"
+		"uniform float sharpness;\n"
+		"uniform float strength;\n"
+		"out vec4 fragmentColor;\n"
+		"void main()\n"
+		"{\n"
+		"	ivec2 texel = ivec2(gl_FragCoord.xy);\n"
+		"	vec4 color = texelFetch(colorTexture, texel, 0);\n"
+		"	float depth = depthParameters.y / (texelFetch(sceneDepthTexture, texel, 0).r * 2.0 - 1.0 + depthParameters.x);\n"
+		"	ivec2 lowSize = textureSize(depthTexture, 0);\n"
+		"	vec2 position = gl_FragCoord.xy / vec2(textureSize(colorTexture, 0)) * vec2(lowSize) - 0.5;\n"
+		"	ivec2 base = ivec2(floor(position));\n"
+		"	vec2 fraction = position - vec2(base);\n"
+		"	float total = 0.0;\n"
+		"	float weights = 0.0;\n"
+		"	for (int i = 0; i < 4; i++)\n"
+		"	{\n"
+		"		ivec2 offset = ivec2(i & 1, i >> 1);\n"
+		"		ivec2 tap = clamp(base + offset, ivec2(0), lowSize - 1);\n"
+		"		vec2 bilinear = mix(1.0 - fraction, fraction, vec2(offset));\n"
+		"		float difference = abs(texelFetch(depthTexture, tap, 0).r - depth) / depth;\n"
+		"		float weight = bilinear.x * bilinear.y / (0.001 + difference * sharpness) + 1e-5;\n"
+		"		total += texelFetch(occlusionTexture, tap, 0).r * weight;\n"
+		"		weights += weight;\n"
+		"	}\n"
+		"	float occlusion = total / weights;\n"
+		"	fragmentColor = vec4(color.rgb * mix(1.0, occlusion, strength), color.a);\n"
+		"}\n";
+
+	/***********************************************************
+	 *  NextRandom()
+	 *
+	 *  Linear congruential step, so the kernel is the same in
+	 *  every run and the presets can be compared.
+	 ***********************************************************/
+	float NextRandom(unsigned int& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return((float)(state >> 8) / 16777216.0f);
+	}
+
+	/***********************************************************
+	 *  LinkFullscreenProgram()
+	 *
+	 *  Link a fragment shader with the fullscreen triangle.
+	 ***********************************************************/
+	GLuint LinkFullscreenProgram(const char* fragmentSource, const std::string& name)
+	{
+		std::vector<GLuint> shaders;
+		shaders.push_back(ShaderUtils::CompileShader(GL_VERTEX_SHADER, ShaderUtils::FULLSCREEN_VERTEX_SHADER, name + ".vert"));
+		shaders.push_back(ShaderUtils::CompileShader(GL_FRAGMENT_SHADER, fragmentSource, name + ".frag"));
+		return(ShaderUtils::LinkProgram(shaders, name));
+	}
+}
+
+/***********************************************************
+ *  SSAOPass()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SSAOPass::SSAOPass(ViewManager* pViewManager)
+{
+	m_pViewManager = pViewManager;
+	m_pGpuProfiler = NULL;
+	m_depthProgram = 0;
+	m_occlusionProgram = 0;
+	m_blurProgram = 0;
+	m_applyProgram = 0;
+	m_vertexArray = 0;
+	m_quality = QUALITY_MEDIUM;
+	m_lastQuality = -1;
+	m_cycleFrames = 0;
+	m_frameCount = 0;
+	m_radius = 0.5f;
+	m_strength = 0.8f;
+}
+
+/***********************************************************
+ *  ~SSAOPass()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SSAOPass::~SSAOPass()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method builds the four programs of the passes.
+ ***********************************************************/
+bool SSAOPass::Initialize()
+{
+	m_depthProgram = LinkFullscreenProgram(g_DepthFragmentShader, "ssao.depth");
+	m_occlusionProgram = LinkFullscreenProgram(g_OcclusionFragmentShader, "ssao.occlusion");
+	m_blurProgram = LinkFullscreenProgram(g_BlurFragmentShader, "ssao.blur");
+	m_applyProgram = LinkFullscreenProgram(g_ApplyFragmentShader, "ssao.apply");
+	glGenVertexArrays(1, &m_vertexArray);
+	BuildKernel(g_Presets[m_quality].samples);
+
+	if ((m_depthProgram == 0) || (m_occlusionProgram == 0) || (m_blurProgram == 0) ||
+		(m_applyProgram == 0) || (m_vertexArray == 0))
+	{
+		std::cout << "WARNING: SSAO is disabled, its programs could not be built" << std::endl;
+		Destroy();
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method frees the programs and the vertex array.
+ ***********************************************************/
+void SSAOPass::Destroy()
+{
+	GLuint* programs[] = { &m_depthProgram, &m_occlusionProgram, &m_blurProgram, &m_applyProgram };
+	for (int i = 0; i < 4; i++)
+	{
+		if (*programs[i] != 0)
+		{
+			glDeleteProgram(*programs[i]);
+			*programs[i] = 0;
+		}
+	}
+
+	if (m_vertexArray != 0)
+	{
+		glDeleteVertexArrays(1, &m_vertexArray);
+		m_vertexArray = 0;
+	}
+}
+
+/***********************************************************
+ *  SetQuality()
+ *
+ *  This method selects a preset and rebuilds the kernel for
+ *  its sample count.
+ ***********************************************************/
+void SSAOPass::SetQuality(QUALITY quality)
+{
+	if ((quality < 0) || (quality >= QUALITY_COUNT))
+	{
+		return;
+	}
+	m_quality = quality;
+	BuildKernel(g_Presets[m_quality].samples);
+}
+
+/***********************************************************
+ *  ParseQuality()
+ *
+ *  This method looks up a preset by its name.
+ ***********************************************************/
+bool SSAOPass::ParseQuality(const std::string& name, QUALITY* pQuality)
+{
+	for (int i = 0; i < QUALITY_COUNT; i++)
+	{
+		if (name == g_Presets[i].name)
+		{
+			*pQuality = (QUALITY)i;
+			return(true);
+		}
+	}
+	return(false);
+}
+
+/***********************************************************
+ *  GetQualityName()
+ *
+ *  This method returns the name of a preset.
+ ***********************************************************/
+const char* SSAOPass::GetQualityName(QUALITY quality)
+{
+	return(((quality >= 0) && (quality < QUALITY_COUNT)) ? g_Presets[quality].name : "unknown");
+}
+
+/***********************************************************
+ *  BuildKernel()
+ *
+ *  This method places the samples in the unit hemisphere
+ *  around +z, denser towards the center so that the close
+ *  occluders weigh more.
+ ***********************************************************/
+void SSAOPass::BuildKernel(int sampleCount)
+{
+	unsigned int state = 0x2545F491u;
+	m_kernel.clear();
+	while ((int)m_kernel.size() < sampleCount)
+	{
+		glm::vec3 sample(NextRandom(state) * 2.0f - 1.0f, NextRandom(state) * 2.0f - 1.0f, NextRandom(state));
+		float length = glm::length(sample);
+		if ((length < 0.1f) || (length > 1.0f))
+		{
+			continue;
+		}
+
+		float t = (float)m_kernel.size() / (float)sampleCount;
+		float scale = 0.1f + 0.9f * t * t;
+		m_kernel.push_back(sample * scale);
+	}
+}
+
+/***********************************************************
+ *  GetDepthParameters()
+ *
+ *  This method returns the two projection terms that turn
+ *  a window depth d into the view depth
+ *  y / (2d - 1 + x).
+ ***********************************************************/
+glm::vec2 SSAOPass::GetDepthParameters() const
+{
+	const glm::mat4& projection = m_pViewManager->GetProjectionMatrix();
+	return(glm::vec2(projection[2][2], projection[3][2]));
+}
+
+/***********************************************************
+ *  AddPasses()
+ *
+ *  This method declares the depth, occlusion, blur and apply
+ *  passes at the resolution of the current preset and
+ *  returns the occluded color.
+ ***********************************************************/
+FrameGraph::RESOURCE SSAOPass::AddPasses(FrameGraph& graph, FrameGraph::RESOURCE color, FrameGraph::RESOURCE depth)
+{
+	if (m_applyProgram == 0)
+	{
+		return(color);
+	}
+
+	// step through the presets so the report can compare them
+	if ((m_cycleFrames > 0) && (m_frameCount > 0) && ((m_frameCount % m_cycleFrames) == 0))
+	{
+		SetQuality((QUALITY)((m_quality + 1) % QUALITY_COUNT));
+	}
+	m_frameCount++;
+
+	const QUALITY_PRESET& preset = g_Presets[m_quality];
+	const FrameGraph::TEXTURE_DESC& colorDesc = graph.GetDesc(color);
+	int width = (colorDesc.width + preset.scale - 1) / preset.scale;
+	int height = (colorDesc.height + preset.scale - 1) / preset.scale;
+	if (m_lastQuality != (int)m_quality)
+	{
+		std::cout << "INFO: SSAO " << preset.name << " at 1/" << preset.scale << " resolution (" << width << "x"
+			<< height << "), " << preset.samples << " samples, blur radius " << preset.blurRadius << std::endl;
+		m_lastQuality = (int)m_quality;
+	}
+
+	FrameGraph::TEXTURE_DESC depthDesc = { width, height, GL_R32F };
+	FrameGraph::TEXTURE_DESC occlusionDesc = { width, height, GL_R8 };
+	FrameGraph::TEXTURE_DESC outputDesc = { colorDesc.width, colorDesc.height, colorDesc.internalFormat };
+	FrameGraph::RESOURCE linearDepth = graph.CreateTexture("ssao.depth", depthDesc);
+	FrameGraph::RESOURCE occlusion = graph.CreateTexture("ssao.occlusion", occlusionDesc);
+	FrameGraph::RESOURCE blurred = graph.CreateTexture("ssao.blur", occlusionDesc);
+	FrameGraph::RESOURCE filtered = graph.CreateTexture("ssao.filtered", occlusionDesc);
+	FrameGraph::RESOURCE output = graph.CreateTexture("ssao.color", outputDesc);
+
+	// the profiler pass spans the first to the last pass, so each
+	// preset is timed as a whole under its own name
+	int blockSize = preset.scale;
+	const char* profileName = preset.profileName;
+	int index = graph.AddPass("SSAO.Depth", [this, &graph, depth, blockSize, profileName]()
+	{
+		if (NULL != m_pGpuProfiler)
+		{
+			m_pGpuProfiler->BeginPass(profileName);
+		}
+		RunDepthPass(graph.GetTexture(depth), blockSize);
+	});
+	graph.Read(index, depth);
+	graph.Write(index, linearDepth);
+
+	int sampleCount = preset.samples;
+	index = graph.AddPass("SSAO", [this, &graph, linearDepth, sampleCount]()
+	{
+		RunOcclusionPass(graph.GetTexture(linearDepth), sampleCount);
+	});
+	graph.Read(index, linearDepth);
+	graph.Write(index, occlusion);
+
+	int blurRadius = preset.blurRadius;
+	index = graph.AddPass("SSAO.BlurH", [this, &graph, occlusion, linearDepth, blurRadius]()
+	{
+		RunBlurPass(graph.GetTexture(occlusion), graph.GetTexture(linearDepth), 1, 0, blurRadius);
+	});
+	graph.Read(index, occlusion);
+	graph.Read(index, linearDepth);
+	graph.Write(index, blurred);
+
+	index = graph.AddPass("SSAO.BlurV", [this, &graph, blurred, linearDepth, blurRadius]()
+	{
+		RunBlurPass(graph.GetTexture(blurred), graph.GetTexture(linearDepth), 0, 1, blurRadius);
+	});
+	graph.Read(index, blurred);
+	graph.Read(index, linearDepth);
+	graph.Write(index, filtered);
+
+	index = graph.AddPass("SSAO.Apply", [this, &graph, color, depth, linearDepth, filtered]()
+	{
+		RunApplyPass(graph.GetTexture(color), graph.GetTexture(depth), graph.GetTexture(linearDepth),
+			graph.GetTexture(filtered));
+		if (NULL != m_pGpuProfiler)
+		{
+			m_pGpuProfiler->EndPass();
+		}
+	});
+	graph.Read(index, color);
+	graph.Read(index, depth);
+	graph.Read(index, linearDepth);
+	graph.Read(index, filtered);
+	graph.Write(index, output);
+	return(output);
+}
+
+/***********************************************************
+ *  RunDepthPass()
+ *
+ *  This method writes the nearest linear depth of each
+ *  block of the scene depth.
+ ***********************************************************/
+void SSAOPass::RunDepthPass(GLuint depth, int blockSize)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_depthProgram);
+
+	glm::vec2 depthParameters = GetDepthParameters();
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, depth);
+	glUniform1i(glGetUniformLocation(m_depthProgram, "depthTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_depthProgram, "blockSize"), blockSize);
+	glUniform2fv(glGetUniformLocation(m_depthProgram, "depthParameters"), 1, glm::value_ptr(depthParameters));
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunOcclusionPass()
+ *
+ *  This method estimates the occlusion of every low
+ *  resolution pixel.
+ ***********************************************************/
+void SSAOPass::RunOcclusionPass(GLuint linearDepth, int sampleCount)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_occlusionProgram);
+
+	glm::vec2 depthParameters = GetDepthParameters();
+	sampleCount = glm::min(sampleCount, glm::min((int)m_kernel.size(), (int)MAX_SAMPLES));
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, linearDepth);
+	glUniform1i(glGetUniformLocation(m_occlusionProgram, "depthTexture"), 0);
+	glUniformMatrix4fv(glGetUniformLocation(m_occlusionProgram, "projection"), 1, GL_FALSE,
+		glm::value_ptr(m_pViewManager->GetProjectionMatrix()));
+	glUniform3fv(glGetUniformLocation(m_occlusionProgram, "kernel"), sampleCount, glm::value_ptr(m_kernel[0]));
+	glUniform1i(glGetUniformLocation(m_occlusionProgram, "sampleCount"), sampleCount);
+	glUniform1f(glGetUniformLocation(m_occlusionProgram, "radius"), m_radius);
+	// the view depth of the far plane, where nothing is occluded
+	glUniform1f(glGetUniformLocation(m_occlusionProgram, "farDepth"),
+		0.999f * depthParameters.y / (1.0f + depthParameters.x));
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunBlurPass()
+ *
+ *  This method blurs the occlusion along one axis.
+ ***********************************************************/
+void SSAOPass::RunBlurPass(GLuint occlusion, GLuint linearDepth, int directionX, int directionY, int blurRadius)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_blurProgram);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, occlusion);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, linearDepth);
+	glUniform1i(glGetUniformLocation(m_blurProgram, "occlusionTexture"), 0);
+	glUniform1i(glGetUniformLocation(m_blurProgram, "depthTexture"), 1);
+	glUniform2i(glGetUniformLocation(m_blurProgram, "direction"), directionX, directionY);
+	glUniform1i(glGetUniformLocation(m_blurProgram, "blurRadius"), blurRadius);
+	glUniform1f(glGetUniformLocation(m_blurProgram, "sharpness"), g_DepthSharpness);
+	DrawFullscreen();
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  RunApplyPass()
+ *
+ *  This method upsamples the occlusion and multiplies it
+ *  into the scene color.
+ ***********************************************************/
+void SSAOPass::RunApplyPass(GLuint color, GLuint depth, GLuint linearDepth, GLuint occlusion)
+{
+	GLint previousProgram = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previousProgram);
+	glUseProgram(m_applyProgram);
+
+	glm::vec2 depthParameters = GetDepthParameters();
+	GLuint textures[] = { color, depth, linearDepth, occlusion };
+	const char* samplers[] = { "colorTexture", "sceneDepthTexture", "depthTexture", "occlusionTexture" };
+	for (int i = 0; i < 4; i++)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glUniform1i(glGetUniformLocation(m_applyProgram, samplers[i]), i);
+	}
+	glUniform2fv(glGetUniformLocation(m_applyProgram, "depthParameters"), 1, glm::value_ptr(depthParameters));
+	glUniform1f(glGetUniformLocation(m_applyProgram, "sharpness"), g_DepthSharpness);
+	glUniform1f(glGetUniformLocation(m_applyProgram, "strength"), m_strength);
+	DrawFullscreen();
+
+	for (int i = 3; i >= 0; i--)
+	{
+		glActiveTexture(GL_TEXTURE0 + i);
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+	glUseProgram((GLuint)previousProgram);
+}
+
+/***********************************************************
+ *  DrawFullscreen()
+ *
+ *  This method draws the fullscreen triangle without depth
+ *  test or blending and restores both afterwards.
+ ***********************************************************/
+void SSAOPass::DrawFullscreen()
+{
+	GLboolean bDepthTest = glIsEnabled(GL_DEPTH_TEST);
+	GLboolean bBlend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glBindVertexArray(m_vertexArray);
+	glDrawArrays(GL_TRIANGLES, 0, 3);
+	glBindVertexArray(0);
+	if (bDepthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (bBlend)
+	{
+		glEnable(GL_BLEND);
+	}
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints the averaged GPU time of the passes
+ *  of every preset next to its resolution and sample count.
+ ***********************************************************/
+void SSAOPass::PrintReport() const
+{
+	if (NULL == m_pGpuProfiler)
+	{
+		return;
+	}
+
+	const std::vector<GpuProfiler::PASS_STATS>& stats = m_pGpuProfiler->GetPassStats();
+	std::cout << "INFO: SSAO GPU time per quality preset" << std::endl;
+	std::cout << std::fixed << std::setprecision(3);
+	for (int quality = 0; quality < QUALITY_COUNT; quality++)
+	{
+		const QUALITY_PRESET& preset = g_Presets[quality];
+		for (size_t i = 0; i < stats.size(); i++)
+		{
+			if (stats[i].name != preset.profileName)
+			{
+				continue;
+			}
+			std::cout << "INFO:   " << std::left << std::setw(8) << preset.name << std::right
+				<< " 1/" << preset.scale << " resolution, " << std::setw(2) << preset.samples << " samples: "
+				<< stats[i].average[GpuProfiler::QUERY_TIME_ELAPSED] / 1000000.0 << " ms average over "
+				<< stats[i].resolvedFrames << " frames" << std::endl;
+		}
+	}
+	std::cout.unsetf(std::ios::floatfield);
+}
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// ssaopass.h
+// ============
+// screen space ambient occlusion at a reduced resolution
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include "FrameGraph.h"
+#include "GpuProfiler.h"
+#include "ViewManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SSAOPass
+ *
+ *  This class darkens the scene color where the depth buffer
+ *  shows nearby occluders. The occlusion is estimated at a
+ *  fraction of the screen resolution from a downsampled
+ *  linear depth, blurred with a separable filter that does
+ *  not cross depth edges, and brought back to full size with
+ *  a depth aware upsample, so its cost is bounded by the
+ *  resolution scale of the quality preset and not by the
+ *  size of the window.
+ ***********************************************************/
+class SSAOPass
+{
+public:
+	enum QUALITY
+	{
+		QUALITY_LOW = 0,
+		QUALITY_MEDIUM,
+		QUALITY_HIGH,
+		QUALITY_COUNT
+	};
+
+	// the largest sample count of a preset
+	static const int MAX_SAMPLES = 32;
+
+	// constructor
+	SSAOPass(ViewManager* pViewManager);
+	// destructor
+	~SSAOPass();
+
+	// compile the programs and create the GL objects
+	bool Initialize();
+	// free the programs
+	void Destroy();
+
+	void SetQuality(QUALITY quality);
+	QUALITY GetQuality() const { return(m_quality); }
+	// move to the next preset every given number of frames, 0 stops
+	void SetCycleFrames(int frames) { m_cycleFrames = frames; }
+	// world space radius of the sampled hemisphere and the share
+	// of the occlusion that is applied
+	void SetRadius(float radius) { m_radius = radius; }
+	void SetStrength(float strength) { m_strength = strength; }
+	// time the passes of each preset under its own name
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler) { m_pGpuProfiler = pGpuProfiler; }
+
+	// preset for a name such as "medium"; false when unknown
+	static bool ParseQuality(const std::string& name, QUALITY* pQuality);
+	static const char* GetQualityName(QUALITY quality);
+
+	// declare the occlusion passes and return the occluded color
+	FrameGraph::RESOURCE AddPasses(FrameGraph& graph, FrameGraph::RESOURCE color, FrameGraph::RESOURCE depth);
+
+	// print the measured GPU time of every preset that has run
+	void PrintReport() const;
+
+private:
+	ViewManager* m_pViewManager;
+	GpuProfiler* m_pGpuProfiler;
+
+	GLuint m_depthProgram;
+	GLuint m_occlusionProgram;
+	GLuint m_blurProgram;
+	GLuint m_applyProgram;
+	// empty vertex array for the fullscreen triangle
+	GLuint m_vertexArray;
+
+	QUALITY m_quality;
+	// quality of the last declared passes, to log changes
+	int m_lastQuality;
+	int m_cycleFrames;
+	long m_frameCount;
+	float m_radius;
+	float m_strength;
+	// hemisphere offsets for the sample count of the preset
+	std::vector<glm::vec3> m_kernel;
+
+	// fill the kernel for the sample count of the preset
+	void BuildKernel(int sampleCount);
+	// projection terms that turn window depth into view depth
+	glm::vec2 GetDepthParameters() const;
+
+	// the passes, each drawing into the framebuffer of the graph
+	void RunDepthPass(GLuint depth, int blockSize);
+	void RunOcclusionPass(GLuint linearDepth, int sampleCount);
+	void RunBlurPass(GLuint occlusion, GLuint linearDepth, int directionX, int directionY, int blurRadius);
+	void RunApplyPass(GLuint color, GLuint depth, GLuint linearDepth, GLuint occlusion);
+	// draw the fullscreen triangle with the current program
+	void DrawFullscreen();
+};
@@ -0,0 +1,394 @@
+///////////////////////////////////////////////////////////////////////////////
+// SceneGeometry.cpp
+// =================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `SceneGeometry` class, the CPU side copy of the
+// scene that the renderers without OpenGL draw from.
+//
+// FUNCTIONALITY:
+// - Build triangle lists for the plane, box, cylinder, cone and sphere
+//   with the same extents as ShapeMeshes: the plane spans -1..1 in X and
+//   Z, the box -0.5..0.5, the cylinder and cone have radius 1 and stand
+//   on y = 0 with height 1, and the sphere has radius 1.
+// - Load the scene texture files into RGBA pixel arrays and sample them
+//   bilinearly like the OpenGL textures.
+// - Copy the materials and the draw list of the scene manager.
+//
+// NOTES:
+// The shapes are tessellated here, so their triangle counts can differ
+// from the GPU meshes; the outlines, normals and texture coordinates
+// follow the same conventions.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "SceneGeometry.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// declaration of the global variables and defines
+namespace
+{
+	const float g_Pi = 3.14159265f;
+	// segments around the round shapes
+	const int g_RoundSegments = 36;
+	// rings from pole to pole of the sphere
+	const int g_SphereRings = 18;
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Appends a vertex and returns its index.
+	 ***********************************************************/
+	unsigned int AddVertex(SceneGeometry::MESH& mesh, glm::vec3 position, glm::vec3 normal, glm::vec2 uv)
+	{
+		SceneGeometry::VERTEX vertex;
+		vertex.position = position;
+		vertex.normal = normal;
+		vertex.uv = uv;
+		mesh.vertices.push_back(vertex);
+		return((unsigned int)mesh.vertices.size() - 1);
+	}
+
+	/***********************************************************
+	 *  AddQuad()
+	 *
+	 *  Appends two triangles for four vertices in order.
+	 ***********************************************************/
+	void AddQuad(SceneGeometry::MESH& mesh, unsigned int a, unsigned int b, unsigned int c, unsigned int d)
+	{
+		unsigned int indices[6] = { a, b, c, a, c, d };
+		mesh.indices.insert(mesh.indices.end(), indices, indices + 6);
+	}
+
+	/***********************************************************
+	 *  AddDisc()
+	 *
+	 *  Appends a flat disc of radius 1 at the given height,
+	 *  with the given number of segments.
+	 ***********************************************************/
+	void AddDisc(SceneGeometry::MESH& mesh, float y, float normalY, int segments)
+	{
+		unsigned int center = AddVertex(mesh, glm::vec3(0.0f, y, 0.0f), glm::vec3(0.0f, normalY, 0.0f), glm::vec2(0.5f, 0.5f));
+		for (int i = 0; i <= segments; i++)
+		{
+			float angle = 2.0f * g_Pi * (float)i / (float)segments;
+			AddVertex(mesh, glm::vec3(cosf(angle), y, sinf(angle)), glm::vec3(0.0f, normalY, 0.0f),
+				glm::vec2(0.5f + 0.5f * cosf(angle), 0.5f + 0.5f * sinf(angle)));
+		}
+		for (int i = 0; i < segments; i++)
+		{
+			mesh.indices.push_back(center);
+			mesh.indices.push_back(center + 1 + i);
+			mesh.indices.push_back(center + 2 + i);
+		}
+	}
+}
+
+/***********************************************************
+ *  SceneGeometry()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneGeometry::SceneGeometry()
+{
+}
+
+/***********************************************************
+ *  ~SceneGeometry()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneGeometry::~SceneGeometry()
+{
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method copies the scene description, builds the
+ *  meshes and loads the textures.
+ ***********************************************************/
+bool SceneGeometry::Load(const SceneManager& scene)
+{
+	m_objects = scene.GetSceneObjects();
+	m_materials = scene.GetObjectMaterials();
+
+	for (int i = 0; i < SceneManager::MESH_COUNT; i++)
+	{
+		BuildMesh((SceneManager::MESH_TYPE)i, m_meshes[i]);
+	}
+
+	// the rows are flipped like the OpenGL textures of the scene
+	bool bLoaded = true;
+	stbi_set_flip_vertically_on_load(true);
+	m_textures.clear();
+	for (int i = 0; i < SceneManager::GetTextureFileCount(); i++)
+	{
+		const SceneManager::TEXTURE_FILE& file = SceneManager::GetTextureFile(i);
+		int channels = 0;
+		TEXTURE texture;
+		texture.tag = file.tag;
+
+		unsigned char* image = stbi_load(file.filename, &texture.width, &texture.height, &channels, 4);
+		if (NULL == image)
+		{
+			std::cerr << "Failed to load texture: " << file.tag << std::endl;
+			bLoaded = false;
+			continue;
+		}
+		texture.pixels.assign(image, image + (size_t)texture.width * texture.height * 4);
+		stbi_image_free(image);
+		m_textures.push_back(texture);
+	}
+
+	return(bLoaded);
+}
+
+/***********************************************************
+ *  FindTexture()
+ *
+ *  This method returns the texture loaded for a tag.
+ ***********************************************************/
+const SceneGeometry::TEXTURE* SceneGeometry::FindTexture(const std::string& tag) const
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		if (m_textures[i].tag == tag)
+		{
+			return(&m_textures[i]);
+		}
+	}
+	return(NULL);
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method returns the material defined for a tag.
+ ***********************************************************/
+const SceneManager::OBJECT_MATERIAL* SceneGeometry::FindMaterial(const std::string& tag) const
+{
+	for (size_t i = 0; i < m_materials.size(); i++)
+	{
+		if (m_materials[i].tag == tag)
+		{
+			return(&m_materials[i]);
+		}
+	}
+	return(NULL);
+}
+
+/***********************************************************
+ *  SampleTexture()
+ *
+ *  This method does a bilinear lookup with repeat wrapping,
+ *  like the scene textures (GL_REPEAT, GL_LINEAR).
+ ***********************************************************/
+glm::vec4 SceneGeometry::SampleTexture(const TEXTURE& texture, glm::vec2 uv)
+{
+	float x = (uv.x - floorf(uv.x)) * texture.width - 0.5f;
+	float y = (uv.y - floorf(uv.y)) * texture.height - 0.5f;
+	int x0 = (int)floorf(x);
+	int y0 = (int)floorf(y);
+	float fx = x - (float)x0;
+	float fy = y - (float)y0;
+
+	int xs[2] = { (x0 % texture.width + texture.width) % texture.width, 0 };
+	int ys[2] = { (y0 % texture.height + texture.height) % texture.height, 0 };
+	xs[1] = (xs[0] + 1) % texture.width;
+	ys[1] = (ys[0] + 1) % texture.height;
+
+	glm::vec4 texels[4];
+	for (int i = 0; i < 4; i++)
+	{
+		const unsigned char* p = &texture.pixels[((size_t)ys[i / 2] * texture.width + xs[i % 2]) * 4];
+		texels[i] = glm::vec4(p[0], p[1], p[2], p[3]) / 255.0f;
+	}
+	glm::vec4 bottom = texels[0] + (texels[1] - texels[0]) * fx;
+	glm::vec4 top = texels[2] + (texels[3] - texels[2]) * fx;
+	return(bottom + (top - bottom) * fy);
+}
+
+/***********************************************************
+ *  ComputeBoundingSphere()
+ *
+ *  This method returns the sphere around the center of the
+ *  bounding box of a mesh that holds all of its vertices.
+ ***********************************************************/
+glm::vec4 SceneGeometry::ComputeBoundingSphere(const MESH& mesh)
+{
+	glm::vec3 minimum(1e30f);
+	glm::vec3 maximum(-1e30f);
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		minimum = glm::min(minimum, mesh.vertices[i].position);
+		maximum = glm::max(maximum, mesh.vertices[i].position);
+	}
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	float radius = 0.0f;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		radius = std::max(radius, glm::length(mesh.vertices[i].position - center));
+	}
+	return(glm::vec4(center, radius));
+}
+
+/***********************************************************
+ *  TransformSphere()
+ *
+ *  This method moves a sphere with a model matrix; the
+ *  radius grows with the longest of the scaled axes, so the
+ *  result holds the sphere under any scale.
+ ***********************************************************/
+glm::vec4 SceneGeometry::TransformSphere(const glm::mat4& model, const glm::vec4& sphere)
+{
+	float scale = std::max(glm::length(glm::vec3(model[0])),
+		std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	return(glm::vec4(glm::vec3(model * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w * scale));
+}
+
+/***********************************************************
+ *  ComputeObjectSpheres()
+ *
+ *  This method returns the bounding sphere of the mesh of
+ *  every object, moved into the world.
+ ***********************************************************/
+void SceneGeometry::ComputeObjectSpheres(const std::vector<SceneManager::SCENE_OBJECT>& objects, std::vector<glm::vec4>& spheres)
+{
+	glm::vec4 meshSpheres[SceneManager::MESH_COUNT];
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		MESH mesh;
+		BuildMesh((SceneManager::MESH_TYPE)type, mesh);
+		meshSpheres[type] = ComputeBoundingSphere(mesh);
+	}
+
+	spheres.resize(objects.size());
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		const SceneManager::SCENE_OBJECT& object = objects[i];
+		glm::mat4 model = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+		spheres[i] = TransformSphere(model, meshSpheres[object.mesh]);
+	}
+}
+
+/***********************************************************
+ *  BuildMesh()
+ *
+ *  This method tessellates one of the basic shapes.
+ ***********************************************************/
+void SceneGeometry::BuildMesh(SceneManager::MESH_TYPE type, MESH& mesh, int detail)
+{
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	detail = std::max(detail, 1);
+	int segments = g_RoundSegments * detail;
+	int rings = g_SphereRings * detail;
+
+	switch (type)
+	{
+	case SceneManager::MESH_PLANE:
+		{
+			glm::vec3 up(0.0f, 1.0f, 0.0f);
+			unsigned int a = AddVertex(mesh, glm::vec3(-1.0f, 0.0f, 1.0f), up, glm::vec2(0.0f, 0.0f));
+			unsigned int b = AddVertex(mesh, glm::vec3(1.0f, 0.0f, 1.0f), up, glm::vec2(1.0f, 0.0f));
+			unsigned int c = AddVertex(mesh, glm::vec3(1.0f, 0.0f, -1.0f), up, glm::vec2(1.0f, 1.0f));
+			unsigned int d = AddVertex(mesh, glm::vec3(-1.0f, 0.0f, -1.0f), up, glm::vec2(0.0f, 1.0f));
+			AddQuad(mesh, a, b, c, d);
+		}
+		break;
+
+	case SceneManager::MESH_BOX:
+		{
+			// one face per axis direction, each with its own normal
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int side = -1; side <= 1; side += 2)
+				{
+					glm::vec3 normal(0.0f);
+					glm::vec3 u(0.0f);
+					glm::vec3 v(0.0f);
+					normal[axis] = (float)side;
+					u[(axis + 1) % 3] = 0.5f;
+					v[(axis + 2) % 3] = 0.5f;
+					if (side < 0)
+					{
+						u = -u;
+					}
+
+					glm::vec3 center = normal * 0.5f;
+					unsigned int a = AddVertex(mesh, center - u - v, normal, glm::vec2(0.0f, 0.0f));
+					unsigned int b = AddVertex(mesh, center + u - v, normal, glm::vec2(1.0f, 0.0f));
+					unsigned int c = AddVertex(mesh, center + u + v, normal, glm::vec2(1.0f, 1.0f));
+					unsigned int d = AddVertex(mesh, center - u + v, normal, glm::vec2(0.0f, 1.0f));
+					AddQuad(mesh, a, b, c, d);
+				}
+			}
+		}
+		break;
+
+	case SceneManager::MESH_CYLINDER:
+	case SceneManager::MESH_CONE:
+		{
+			bool bCone = (type == SceneManager::MESH_CONE);
+			unsigned int first = (unsigned int)mesh.vertices.size();
+			for (int i = 0; i <= segments; i++)
+			{
+				float angle = 2.0f * g_Pi * (float)i / (float)segments;
+				float u = (float)i / (float)segments;
+				// the side of a cone with height and radius 1 leans 45 degrees
+				glm::vec3 normal = bCone ?
+					glm::normalize(glm::vec3(cosf(angle), 1.0f, sinf(angle))) :
+					glm::vec3(cosf(angle), 0.0f, sinf(angle));
+				glm::vec3 top = bCone ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(cosf(angle), 1.0f, sinf(angle));
+
+				AddVertex(mesh, glm::vec3(cosf(angle), 0.0f, sinf(angle)), normal, glm::vec2(u, 0.0f));
+				AddVertex(mesh, top, normal, glm::vec2(u, 1.0f));
+			}
+			for (int i = 0; i < segments; i++)
+			{
+				unsigned int base = first + 2 * i;
+				AddQuad(mesh, base, base + 1, base + 3, base + 2);
+			}
+
+			AddDisc(mesh, 0.0f, -1.0f, segments);
+			if (!bCone)
+			{
+				AddDisc(mesh, 1.0f, 1.0f, segments);
+			}
+		}
+		break;
+
+	case SceneManager::MESH_SPHERE:
+		{
+			for (int ring = 0; ring <= rings; ring++)
+			{
+				float polar = g_Pi * (float)ring / (float)rings;
+				for (int i = 0; i <= segments; i++)
+				{
+					float angle = 2.0f * g_Pi * (float)i / (float)segments;
+					glm::vec3 position(sinf(polar) * cosf(angle), cosf(polar), sinf(polar) * sinf(angle));
+					AddVertex(mesh, position, position,
+						glm::vec2((float)i / (float)segments, 1.0f - (float)ring / (float)rings));
+				}
+			}
+			for (int ring = 0; ring < rings; ring++)
+			{
+				for (int i = 0; i < segments; i++)
+				{
+					unsigned int a = ring * (segments + 1) + i;
+					unsigned int b = a + segments + 1;
+					AddQuad(mesh, a, b, b + 1, a + 1);
+				}
+			}
+		}
+		break;
+
+	default:
+		break;
+	}
+}
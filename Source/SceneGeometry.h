@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenegeometry.h
+// ============
+// CPU side copy of the scene meshes, textures, materials and objects
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneGeometry
+ *
+ *  This class holds everything the CPU renderers need to
+ *  draw the scene without OpenGL: triangle lists of the
+ *  basic meshes in the layout of ShapeMeshes, the texture
+ *  images as RGBA pixels, and the materials, lights and
+ *  draw list of the scene manager.
+ ***********************************************************/
+class SceneGeometry
+{
+public:
+	struct VERTEX
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	struct MESH
+	{
+		std::vector<VERTEX> vertices;
+		// three indices per triangle
+		std::vector<unsigned int> indices;
+	};
+
+	struct TEXTURE
+	{
+		std::string tag;
+		int width;
+		int height;
+		// RGBA, bottom row first like the OpenGL textures
+		std::vector<unsigned char> pixels;
+	};
+
+	// constructor
+	SceneGeometry();
+	// destructor
+	~SceneGeometry();
+
+	// copy the draw list and materials of the scene, build the
+	// meshes and load the texture files
+	bool Load(const SceneManager& scene);
+
+	const MESH& GetMesh(SceneManager::MESH_TYPE mesh) const { return(m_meshes[mesh]); }
+	const std::vector<SceneManager::SCENE_OBJECT>& GetObjects() const { return(m_objects); }
+	// NULL when the tag is not loaded or defined
+	const TEXTURE* FindTexture(const std::string& tag) const;
+	const SceneManager::OBJECT_MATERIAL* FindMaterial(const std::string& tag) const;
+
+	// bilinear texture lookup with repeat wrapping
+	static glm::vec4 SampleTexture(const TEXTURE& texture, glm::vec2 uv);
+	// fill a mesh with the triangles of a basic shape; detail
+	// multiplies the segments and rings of the round shapes
+	static void BuildMesh(SceneManager::MESH_TYPE type, MESH& mesh, int detail = 1);
+	// sphere around the vertices of a mesh, center in xyz and
+	// radius in w
+	static glm::vec4 ComputeBoundingSphere(const MESH& mesh);
+	// sphere around a transformed sphere, scaled by the largest
+	// axis scale of the matrix
+	static glm::vec4 TransformSphere(const glm::mat4& model, const glm::vec4& sphere);
+	// world bounding sphere of every object of a draw list
+	static void ComputeObjectSpheres(const std::vector<SceneManager::SCENE_OBJECT>& objects, std::vector<glm::vec4>& spheres);
+
+private:
+	MESH m_meshes[SceneManager::MESH_COUNT];
+	std::vector<TEXTURE> m_textures;
+	std::vector<SceneManager::OBJECT_MATERIAL> m_materials;
+	std::vector<SceneManager::SCENE_OBJECT> m_objects;
+};
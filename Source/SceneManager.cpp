@@ -42,6 +42,8 @@
 
 
 #include "SceneManager.h"
+#include "GLDebugOutput.h"
+#include "VisibilityCache.h"
 
 #ifndef STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -51,6 +53,9 @@
 
 #include <glm/gtx/transform.hpp>
 
+// GLFW library, used for timing the warm-up pass
+#include "GLFW/glfw3.h"
+
 // declaration of global variables
 namespace
 {
@@ -59,6 +64,43 @@ namespace
 	const char* g_TextureValueName = "objectTexture";
 	const char* g_UseTextureName = "bUseTexture";
 	const char* g_UseLightingName = "bUseLighting";
+	// object id written by the optional id buffer picker
+	const char* g_PickIdName = "pickId";
+
+	// readable names of the basic mesh types
+	const char* g_MeshNames[SceneManager::MESH_COUNT] =
+	{
+		"plane",
+		"cylinder",
+		"cone",
+		"box",
+		"sphere"
+	};
+
+	// texture files of the scene and the tags they are drawn by
+	const SceneManager::TEXTURE_FILE g_TextureFiles[] =
+	{
+		// floor texture
+		{ "../../Utilities/textures/mattwhite.jpg", "floor" },
+		// used for mesh objects such as the speaker grille
+		{ "../../Utilities/textures/blackMesh.jpg", "mesh" },
+		// used for any object requiring a gold appearance
+		{ "../../Utilities/textures/gold-seamless-texture.jpg", "golds" }
+	};
+
+	// light sources of the scene, in shader slot order
+	const SceneManager::LIGHT_SOURCE g_LightSources[SceneManager::LIGHT_COUNT] =
+	{
+		// blueish key light above the scene
+		{ glm::vec3(0.0f, 8.0f, 0.0f), glm::vec3(0.1f, 0.1f, 0.4f), glm::vec3(0.4f, 0.4f, 0.8f),
+			glm::vec3(0.0f, 0.0f, 0.2f), 60.0f, 0.05f },
+		{ glm::vec3(3.0f, 2.0f, -1.0f), glm::vec3(0.01f, 0.01f, 0.01f), glm::vec3(0.4f, 0.4f, 0.4f),
+			glm::vec3(0.0f, 0.0f, 0.0f), 60.0f, 0.05f },
+		{ glm::vec3(-5.0f, 5.0f, -5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.1f, 0.1f, 0.1f),
+			glm::vec3(0.0f, 0.0f, 0.0f), 60.0f, 0.5f },
+		{ glm::vec3(5.0f, 5.0f, 5.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.1f, 0.1f, 0.1f),
+			glm::vec3(0.0f, 0.0f, 0.0f), 60.0f, 0.5f }
+	};
 }
 
 /***********************************************************
@@ -99,6 +141,19 @@ SceneManager::SceneManager(ShaderManager *pShaderManager)
 		m_textureIDs[i].ID = -1;
 	}
 	m_loadedTextures = 0;
+
+	// no draw states have been issued yet
+	m_pFrameProfiler = NULL;
+	m_pGpuProfiler = NULL;
+	m_pDrawCostProfiler = NULL;
+	m_pVisibilityCache = NULL;
+	m_bObjectIds = false;
+	m_bTextureEnabled = false;
+	for (int i = 0; i < MESH_COUNT; i++)
+	{
+		m_usedDrawStates[i][0] = false;
+		m_usedDrawStates[i][1] = false;
+	}
 }
 
 /***********************************************************
@@ -167,6 +222,8 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 	int colorChannels = 0;
 	GLuint textureID = 0;
 
+	double startTime = glfwGetTime();
+
 	// Ensure images are flipped vertically upon loading
 	stbi_set_flip_vertically_on_load(true);
 
@@ -189,6 +246,7 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		// Generate and bind a new texture ID
 		glGenTextures(1, &textureID);
 		glBindTexture(GL_TEXTURE_2D, textureID);
+		GLDebugOutput::LabelObject(GL_TEXTURE, textureID, "texture:" + tag);
 
 		// Set texture wrapping parameters (repeat texture when out of bounds)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -228,6 +286,13 @@ bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
 		m_textureIDs[m_loadedTextures].tag = tag;
 		m_loadedTextures++;
 
+		if (NULL != m_pFrameProfiler)
+		{
+			m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_RESOURCE_LOAD,
+				std::string("texture '") + tag + "' from " + filename,
+				(glfwGetTime() - startTime) * 1000.0);
+		}
+
 		return true;
 	}
 
@@ -265,6 +330,12 @@ void SceneManager::DestroyGLTextures()
 	{
 		glDeleteTextures(1, &m_textureIDs[i].ID);
 	}
+
+	if ((NULL != m_pFrameProfiler) && (m_loadedTextures > 0))
+	{
+		m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_RESOURCE_DELETE,
+			std::to_string(m_loadedTextures) + " textures deleted");
+	}
 }
 
 
@@ -370,6 +441,26 @@ void SceneManager::SetTransformations(
 {
 	// variables for this method
 	glm::mat4 modelView;
+
+	modelView = ComputeModelMatrix(scaleXYZ,
+		glm::vec3(XrotationDegrees, YrotationDegrees, ZrotationDegrees), positionXYZ);
+
+	if (NULL != m_pShaderManager)
+	{
+		m_pShaderManager->setMat4Value(g_ModelName, modelView);
+	}
+}
+
+/***********************************************************
+ *  ComputeModelMatrix()
+ *
+ *  This method is used for building the model matrix of an
+ *  object: scale, then rotation about X, Y and Z, and then
+ *  translation.
+ ***********************************************************/
+glm::mat4 SceneManager::ComputeModelMatrix(glm::vec3 scaleXYZ, glm::vec3 rotationDegrees, glm::vec3 positionXYZ)
+{
+	// variables for this method
 	glm::mat4 scale;
 	glm::mat4 rotationX;
 	glm::mat4 rotationY;
@@ -379,18 +470,13 @@ void SceneManager::SetTransformations(
 	// set the scale value in the transform buffer
 	scale = glm::scale(scaleXYZ);
 	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
+	rotationX = glm::rotate(glm::radians(rotationDegrees.x), glm::vec3(1.0f, 0.0f, 0.0f));
+	rotationY = glm::rotate(glm::radians(rotationDegrees.y), glm::vec3(0.0f, 1.0f, 0.0f));
+	rotationZ = glm::rotate(glm::radians(rotationDegrees.z), glm::vec3(0.0f, 0.0f, 1.0f));
 	// set the translation value in the transform buffer
 	translation = glm::translate(positionXYZ);
 
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
+	return(translation * rotationX * rotationY * rotationZ * scale);
 }
 
 /***********************************************************
@@ -413,6 +499,8 @@ void SceneManager::SetShaderColor(
 	currentColor.b = blueColorValue;
 	currentColor.a = alphaValue;
 
+	m_bTextureEnabled = false;
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setIntValue(g_UseTextureName, false);
@@ -429,6 +517,8 @@ void SceneManager::SetShaderColor(
 void SceneManager::SetShaderTexture(
 	std::string textureTag)
 {
+	m_bTextureEnabled = true;
+
 	if (NULL != m_pShaderManager)
 	{
 		m_pShaderManager->setIntValue(g_UseTextureName, true);
@@ -500,29 +590,16 @@ void SceneManager::SetTextureUVScale(float u, float v)
 void SceneManager::LoadSceneTextures() {
 	bool bReturn;
 
-	// Attempt to load and create texture for the floor
-	// The texture file is located in the "../../Utilities/textures" directory
-	// and will be referenced by the name "floor" in the rendering pipeline.
-	bReturn = CreateGLTexture("../../Utilities/textures/mattwhite.jpg", "floor");
-	if (!bReturn) {
-		// Output an error message if texture creation fails
-		std::cerr << "Failed to load texture: floor" << std::endl;
-	}
-
-	// Attempt to load and create texture for the mesh
-	// This texture is used for mesh objects and will be referenced as "mesh".
-	bReturn = CreateGLTexture("../../Utilities/textures/blackMesh.jpg", "mesh");
-	if (!bReturn) {
-		// Output an error message if texture creation fails
-		std::cerr << "Failed to load texture: mesh" << std::endl;
-	}
-
-	// Attempt to load and create texture for gold materials
-	// This texture will be used for any object requiring a gold appearance, referenced as "golds".
-	bReturn = CreateGLTexture("../../Utilities/textures/gold-seamless-texture.jpg", "golds");
-	if (!bReturn) {
-		// Output an error message if texture creation fails
-		std::cerr << "Failed to load texture: golds" << std::endl;
+	// Attempt to load and create a texture for every entry of the
+	// texture table; each is referenced by its tag in the rendering
+	// pipeline
+	for (int i = 0; i < GetTextureFileCount(); i++)
+	{
+		bReturn = CreateGLTexture(g_TextureFiles[i].filename, g_TextureFiles[i].tag);
+		if (!bReturn) {
+			// Output an error message if texture creation fails
+			std::cerr << "Failed to load texture: " << g_TextureFiles[i].tag << std::endl;
+		}
 	}
 
 	// After all textures are loaded, bind them to the OpenGL context
@@ -557,6 +634,177 @@ void SceneManager::SetShaderMaterial(
 	}
 }
 
+/***********************************************************
+ *  SetFrameProfiler()
+ *
+ *  This method is used for passing in the frame profiler
+ *  that receives likely causes of frame hitches.
+ ***********************************************************/
+void SceneManager::SetFrameProfiler(FrameProfiler* pFrameProfiler)
+{
+	m_pFrameProfiler = pFrameProfiler;
+}
+
+/***********************************************************
+ *  SetGpuProfiler()
+ *
+ *  This method is used for passing in the GPU profiler that
+ *  measures each render pass of the scene.
+ ***********************************************************/
+void SceneManager::SetGpuProfiler(GpuProfiler* pGpuProfiler)
+{
+	m_pGpuProfiler = pGpuProfiler;
+}
+
+/***********************************************************
+ *  SetDrawCostProfiler()
+ *
+ *  This method is used for passing in the profiler that
+ *  measures the GPU cost of every draw of the scene.
+ ***********************************************************/
+void SceneManager::SetDrawCostProfiler(DrawCostProfiler* pDrawCostProfiler)
+{
+	m_pDrawCostProfiler = pDrawCostProfiler;
+}
+
+/***********************************************************
+ *  DrawBasicMesh()
+ *
+ *  This method is used for drawing one of the basic meshes
+ *  with the current shader state. The first time a mesh is
+ *  drawn with a given texture variant, the driver may have
+ *  to compile the state on the fly, so that draw is noted
+ *  as a likely hitch cause for the current frame.
+ ***********************************************************/
+void SceneManager::DrawBasicMesh(MESH_TYPE mesh)
+{
+	int variant = m_bTextureEnabled ? 1 : 0;
+
+	if (m_usedDrawStates[mesh][variant] == false)
+	{
+		m_usedDrawStates[mesh][variant] = true;
+		if (NULL != m_pFrameProfiler)
+		{
+			m_pFrameProfiler->NoteCause(std::string("first use of ") + g_MeshNames[mesh] +
+				" mesh with " + (variant ? "textured" : "color") + " shader variant (not warmed up)");
+		}
+	}
+
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh(true);
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  WarmUpDrawStates()
+ *
+ *  This method is used for issuing a tiny offscreen draw of
+ *  every basic mesh (vertex format) with every shader
+ *  variant the scene uses, so that drivers compile the
+ *  shader/state combinations before the first real frame
+ *  instead of hitching in the middle of the rendering loop.
+ *
+ *  Time Complexity: O(m * v) draws, where m is the number of
+ *  meshes and v is the number of shader variants.
+ ***********************************************************/
+void SceneManager::WarmUpDrawStates()
+{
+	GLint previousViewport[4];
+	GLuint frameBuffer = 0;
+	GLuint renderBuffers[2] = { 0, 0 };
+	double startTime = glfwGetTime();
+	int warmedStates = 0;
+
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+	// a 4x4 target keeps the fragment work negligible while still
+	// going through the same depth and blend state as the scene
+	glGenFramebuffers(1, &frameBuffer);
+	glGenRenderbuffers(2, renderBuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderBuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, 4, 4);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderBuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 4, 4);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, frameBuffer);
+	GLDebugOutput::LabelObject(GL_FRAMEBUFFER, frameBuffer, "framebuffer:warm-up");
+	GLDebugOutput::LabelObject(GL_RENDERBUFFER, renderBuffers[0], "renderbuffer:warm-up.color");
+	GLDebugOutput::LabelObject(GL_RENDERBUFFER, renderBuffers[1], "renderbuffer:warm-up.depth");
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderBuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderBuffers[1]);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+	{
+		glViewport(0, 0, 4, 4);
+		glEnable(GL_DEPTH_TEST);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		ApplyTransformations(glm::vec3(1.0f), glm::vec3(0.0f), glm::vec3(0.0f));
+
+		for (int variant = 0; variant < 2; variant++)
+		{
+			if (variant == 0)
+			{
+				SetShaderColor(1.0f, 1.0f, 1.0f, 1.0f);
+			}
+			else if (m_loadedTextures > 0)
+			{
+				SetShaderTexture(m_textureIDs[0].tag);
+			}
+			else
+			{
+				continue;
+			}
+
+			for (int mesh = 0; mesh < MESH_COUNT; mesh++)
+			{
+				m_usedDrawStates[mesh][variant] = true;
+				DrawBasicMesh((MESH_TYPE)mesh);
+				warmedStates++;
+			}
+		}
+
+		// block here, at load time, until the driver has finished
+		// compiling and executing every warm-up draw
+		glFinish();
+	}
+	else
+	{
+		std::cerr << "WARNING: warm-up framebuffer is incomplete, skipping shader warm-up" << std::endl;
+	}
+
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glDeleteRenderbuffers(2, renderBuffers);
+	glDeleteFramebuffers(1, &frameBuffer);
+
+	std::cout << "INFO: Warmed up " << warmedStates << " draw states in "
+		<< (glfwGetTime() - startTime) * 1000.0 << " ms" << std::endl;
+	if (NULL != m_pFrameProfiler)
+	{
+		m_pFrameProfiler->RecordEvent(FrameProfiler::EVENT_SHADER_COMPILE,
+			std::to_string(warmedStates) + " draw states warmed up",
+			(glfwGetTime() - startTime) * 1000.0);
+	}
+}
+
 /**************************************************************/
 /*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
 /*** preparing and rendering their own 3D replicated scenes.***/
@@ -611,37 +859,20 @@ void SceneManager::SetupSceneLights()
 	/*** Up to four light sources can be defined. Refer to the code ***/
 	/*** in the OpenGL Sample for help                              ***/
 
-	m_pShaderManager->setVec3Value("lightSources[0].position", 0.0f, 8.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.1f, 0.1f, 0.4f); // Blueish ambient color
-	m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.4f, 0.4f, 0.8f); // Blueish diffuse color
-	m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.0f, 0.0f, 0.2f); // Darker blueish specular color
-	m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 60.0f);
-	m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.05f);
-
-
-
-	m_pShaderManager->setVec3Value("lightSources[1].position", 3.0f, 2.0f, -1.0f);
-	m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.01f, 0.01f, 0.01f);
-	m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.4f, 0.4f, 0.4f);
-	m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 60.0f);
-	m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.05f);
-
-	m_pShaderManager->setVec3Value("lightSources[2].position", -5.0f, 5.0f, -5.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].ambientColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[2].diffuseColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[2].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].focalStrength", 60.0f);
-	m_pShaderManager->setFloatValue("lightSources[2].specularIntensity", 0.5f);
-	
-	m_pShaderManager->setVec3Value("lightSources[3].position", 5.0f, 5.0f, 5.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].ambientColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setVec3Value("lightSources[3].diffuseColor", 0.1f, 0.1f, 0.1f);
-	m_pShaderManager->setVec3Value("lightSources[3].specularColor", 0.0f, 0.0f, 0.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].focalStrength", 60.0f);
-	m_pShaderManager->setFloatValue("lightSources[3].specularIntensity", 0.5f);
-
-
+	// the light values live in a table so that other renderers
+	// can light the scene the same way
+	for (int i = 0; i < LIGHT_COUNT; i++)
+	{
+		const LIGHT_SOURCE& light = g_LightSources[i];
+		std::string name = "lightSources[" + std::to_string(i) + "].";
+
+		m_pShaderManager->setVec3Value(name + "position", light.position);
+		m_pShaderManager->setVec3Value(name + "ambientColor", light.ambientColor);
+		m_pShaderManager->setVec3Value(name + "diffuseColor", light.diffuseColor);
+		m_pShaderManager->setVec3Value(name + "specularColor", light.specularColor);
+		m_pShaderManager->setFloatValue(name + "focalStrength", light.focalStrength);
+		m_pShaderManager->setFloatValue(name + "specularIntensity", light.specularIntensity);
+	}
 
 	m_pShaderManager->setBoolValue("bUseLighting", true);
 
@@ -662,13 +893,28 @@ void SceneManager::PrepareScene()
 	LoadSceneTextures();
 	DefineObjectMaterials();
 	SetupSceneLights();
+	DefineSceneObjects();
 
+	// the mesh buffers are created inside ShapeMeshes, so they
+	// are labelled from the names handed out during each load
+	GLDebugOutput::NAME_MARK mark = GLDebugOutput::MarkNames();
 	m_basicMeshes->LoadPlaneMesh();
+	GLDebugOutput::LabelNamesSince(mark, "mesh:plane");
+	mark = GLDebugOutput::MarkNames();
 	m_basicMeshes->LoadCylinderMesh();
+	GLDebugOutput::LabelNamesSince(mark, "mesh:cylinder");
+	mark = GLDebugOutput::MarkNames();
 	m_basicMeshes->LoadConeMesh();
+	GLDebugOutput::LabelNamesSince(mark, "mesh:cone");
+	mark = GLDebugOutput::MarkNames();
 	m_basicMeshes->LoadBoxMesh();
+	GLDebugOutput::LabelNamesSince(mark, "mesh:box");
+	mark = GLDebugOutput::MarkNames();
 	m_basicMeshes->LoadSphereMesh();
+	GLDebugOutput::LabelNamesSince(mark, "mesh:sphere");
 
+	// compile every shader/vertex format combination up front
+	WarmUpDrawStates();
 }
 
 /**This method applies a series of transformations—scaling, rotation, and translation—to the
@@ -694,89 +940,249 @@ void SceneManager::ApplyTransformations(glm::vec3 scale, glm::vec3 rotation, glm
 
 
 /***********************************************************
- *  RenderScene()
+ *  DefineSceneObjects()
  *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
+ *  This method is used for filling the scene draw list with
+ *  the objects of the 3D scene: the water bottle, the
+ *  speaker and the floor. Each entry holds its mesh type,
+ *  transformation and the shader state used to draw it.
  ***********************************************************/
-void SceneManager::RenderScene()
+void SceneManager::DefineSceneObjects()
 {
-	// Declare transformation variables
-	glm::vec3 scaleXYZ;
-	glm::vec3 rotationDegrees = glm::vec3(0.0f, 0.0f, 0.0f);
-	glm::vec3 positionXYZ;
+	SCENE_OBJECT object;
+
+	m_sceneObjects.clear();
+
+	// defaults shared by every object unless overwritten below
+	object.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
+	object.bTextured = false;
+	object.uvScale = glm::vec2(1.0f, 1.0f);
+	object.materialTag = "wood";
 
 	///////////////////////////////////////////////////////////////////////////
 	// Water Bottle
 	///////////////////////////////////////////////////////////////////////////
+	object.group = "bottle";
 
 	// Bottle Body
-	glm::vec3 cylinderScale = glm::vec3(1.5f, 6.0f, 1.5f);
-	glm::vec3 cylinderPosition = glm::vec3(-3.0f, 0.0f, 0.0f);
-	ApplyTransformations(cylinderScale, rotationDegrees, cylinderPosition);
-	SetShaderColor(0.635f, 0.635f, 0.635f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
+	object.name = "bottle.body";
+	object.mesh = MESH_CYLINDER;
+	object.scale = glm::vec3(1.5f, 6.0f, 1.5f);
+	object.position = glm::vec3(-3.0f, 0.0f, 0.0f);
+	object.color = glm::vec4(0.635f, 0.635f, 0.635f, 1.0f);
+	m_sceneObjects.push_back(object);
 
 	// Bottle Triangle
-	glm::vec3 coneScale = glm::vec3(1.5f, 1.5f, 1.5f);
-	glm::vec3 conePosition = glm::vec3(-3.0f, 6.0f, 0.0f);
-	ApplyTransformations(coneScale, rotationDegrees, conePosition);
-	SetShaderColor(0.635f, 0.635f, 0.635f, 0.5f);
-	m_basicMeshes->DrawConeMesh(true);
+	object.name = "bottle.shoulder";
+	object.mesh = MESH_CONE;
+	object.scale = glm::vec3(1.5f, 1.5f, 1.5f);
+	object.position = glm::vec3(-3.0f, 6.0f, 0.0f);
+	object.color = glm::vec4(0.635f, 0.635f, 0.635f, 0.5f);
+	m_sceneObjects.push_back(object);
 
 	// Bottle Tip
-	glm::vec3 tipCylinderScale = glm::vec3(1.0f, 0.3f, 1.0f);
-	glm::vec3 tipCylinderPosition = glm::vec3(-3.0f, 6.5f, 0.0f);
-	ApplyTransformations(tipCylinderScale, rotationDegrees, tipCylinderPosition);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
+	object.name = "bottle.tip";
+	object.mesh = MESH_CYLINDER;
+	object.scale = glm::vec3(1.0f, 0.3f, 1.0f);
+	object.position = glm::vec3(-3.0f, 6.5f, 0.0f);
+	object.color = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+	m_sceneObjects.push_back(object);
 
 	// Bottle Cap
-	glm::vec3 capCylinderScale = glm::vec3(1.0f, 0.7f, 1.0f);
-	glm::vec3 capCylinderPosition = glm::vec3(-3.0f, 6.8f, 0.0f);
-	ApplyTransformations(capCylinderScale, rotationDegrees, capCylinderPosition);
-	SetShaderColor(0.69f, 0.69f, 0.69f, 1.0f);
-	m_basicMeshes->DrawCylinderMesh();
+	object.name = "bottle.cap";
+	object.mesh = MESH_CYLINDER;
+	object.scale = glm::vec3(1.0f, 0.7f, 1.0f);
+	object.position = glm::vec3(-3.0f, 6.8f, 0.0f);
+	object.color = glm::vec4(0.69f, 0.69f, 0.69f, 1.0f);
+	m_sceneObjects.push_back(object);
 
 	///////////////////////////////////////////////////////////////////////////
 	// Speakers
 	///////////////////////////////////////////////////////////////////////////
+	object.group = "speaker";
+	object.materialTag = "gold";
 
 	// Speaker Body
-	glm::vec3 cubeScale = glm::vec3(4.0f, 4.0f, 4.0f);
-	glm::vec3 cubePosition = glm::vec3(2.0f, 2.0f, -1.52f);
-	ApplyTransformations(cubeScale, rotationDegrees, cubePosition);
-	SetTextureUVScale(1.0, 1.0);
-	SetShaderTexture("golds");
-	SetShaderMaterial("gold");
-	m_basicMeshes->DrawBoxMesh();
+	object.name = "speaker.body";
+	object.mesh = MESH_BOX;
+	object.scale = glm::vec3(4.0f, 4.0f, 4.0f);
+	object.position = glm::vec3(2.0f, 2.0f, -1.52f);
+	object.bTextured = true;
+	object.textureTag = "golds";
+	m_sceneObjects.push_back(object);
 
 	// Speaker Mesh
-	glm::vec3 speakerMeshScale = glm::vec3(1.5f, 1.5f, 1.5f);
-	glm::vec3 speakerMeshPosition = glm::vec3(2.0f, 2.0f, 0.5f);
-	glm::vec3 speakerMeshRotation = glm::vec3(-90.0f, 50.0f, 0.0f);
-	ApplyTransformations(speakerMeshScale, speakerMeshRotation, speakerMeshPosition);
-	SetShaderTexture("mesh");
-	m_basicMeshes->DrawConeMesh(true);
+	object.name = "speaker.grille";
+	object.mesh = MESH_CONE;
+	object.scale = glm::vec3(1.5f, 1.5f, 1.5f);
+	object.rotation = glm::vec3(-90.0f, 50.0f, 0.0f);
+	object.position = glm::vec3(2.0f, 2.0f, 0.5f);
+	object.textureTag = "mesh";
+	m_sceneObjects.push_back(object);
 
 	// Speaker Hole
-	glm::vec3 speakerHoleScale = glm::vec3(0.4f, 0.15f, 0.4f);
-	glm::vec3 speakerHolePosition = glm::vec3(2.0f, 2.0f, 0.5f);
-	glm::vec3 speakerHoleRotation = glm::vec3(-90.0f, 0.0f, 0.0f);
-	ApplyTransformations(speakerHoleScale, speakerHoleRotation, speakerHolePosition);
-	SetShaderColor(0.2f, 0.2f, 0.2f, 1.0f);
-	m_basicMeshes->DrawSphereMesh();
+	object.name = "speaker.hole";
+	object.mesh = MESH_SPHERE;
+	object.scale = glm::vec3(0.4f, 0.15f, 0.4f);
+	object.rotation = glm::vec3(-90.0f, 0.0f, 0.0f);
+	object.position = glm::vec3(2.0f, 2.0f, 0.5f);
+	object.bTextured = false;
+	object.color = glm::vec4(0.2f, 0.2f, 0.2f, 1.0f);
+	m_sceneObjects.push_back(object);
 
 	///////////////////////////////////////////////////////////////////////////
 	// Floor
 	///////////////////////////////////////////////////////////////////////////
+	object.group = "floor";
+	object.name = "floor";
+	object.mesh = MESH_PLANE;
+	object.scale = glm::vec3(20.0f, 1.0f, 10.0f);
+	object.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
+	object.position = glm::vec3(0.0f, 0.0f, 0.0f);
+	object.bTextured = true;
+	object.textureTag = "floor";
+	object.materialTag = "wood";
+	m_sceneObjects.push_back(object);
+}
 
-	// Set transformations for the floor
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-	ApplyTransformations(scaleXYZ, rotationDegrees, positionXYZ);
-	SetShaderMaterial("wood");
-	SetShaderTexture("floor");
-	m_basicMeshes->DrawPlaneMesh();
+/***********************************************************
+ *  GetTextureFileCount()
+ *
+ *  This method returns the number of scene texture files.
+ ***********************************************************/
+int SceneManager::GetTextureFileCount()
+{
+	return((int)(sizeof(g_TextureFiles) / sizeof(g_TextureFiles[0])));
 }
 
+/***********************************************************
+ *  GetTextureFile()
+ *
+ *  This method returns one entry of the texture table.
+ ***********************************************************/
+const SceneManager::TEXTURE_FILE& SceneManager::GetTextureFile(int index)
+{
+	return(g_TextureFiles[index]);
+}
+
+/***********************************************************
+ *  GetLightSource()
+ *
+ *  This method returns one entry of the light table.
+ ***********************************************************/
+const SceneManager::LIGHT_SOURCE& SceneManager::GetLightSource(int index)
+{
+	return(g_LightSources[index]);
+}
+
+/***********************************************************
+ *  GetMeshName()
+ *
+ *  This method returns a readable name for a mesh type.
+ ***********************************************************/
+const char* SceneManager::GetMeshName(MESH_TYPE mesh)
+{
+	if ((mesh < 0) || (mesh >= MESH_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_MeshNames[mesh]);
+}
+
+/***********************************************************
+ *  DrawSceneObject()
+ *
+ *  This method is used for setting the transformation and
+ *  shader state of one scene object and drawing its mesh.
+ ***********************************************************/
+void SceneManager::DrawSceneObject(const SCENE_OBJECT& object)
+{
+	ApplyTransformations(object.scale, object.rotation, object.position);
+	ApplyObjectState(object);
+
+	if (NULL != m_pDrawCostProfiler)
+	{
+		m_pDrawCostProfiler->BeginDraw(object.name, GetMeshName(object.mesh), object.materialTag);
+		DrawBasicMesh(object.mesh);
+		m_pDrawCostProfiler->EndDraw();
+	}
+	else
+	{
+		DrawBasicMesh(object.mesh);
+	}
+}
+
+/***********************************************************
+ *  ApplyObjectState()
+ *
+ *  This method is used for setting the color or texture and
+ *  the material of a scene object into the shader, without
+ *  its transformation.
+ ***********************************************************/
+void SceneManager::ApplyObjectState(const SCENE_OBJECT& object)
+{
+	if (object.bTextured)
+	{
+		SetTextureUVScale(object.uvScale.x, object.uvScale.y);
+		SetShaderTexture(object.textureTag);
+	}
+	else
+	{
+		SetShaderColor(object.color.r, object.color.g, object.color.b, object.color.a);
+	}
+	if (!object.materialTag.empty())
+	{
+		SetShaderMaterial(object.materialTag);
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  transforming and drawing the basic 3D shapes in the
+ *  scene draw list, less the objects the visibility cache
+ *  culled when one is set
+ ***********************************************************/
+void SceneManager::RenderScene()
+{
+	const char* currentPass = NULL;
+
+	for (size_t i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		if ((NULL != m_pVisibilityCache) && !m_pVisibilityCache->IsVisible(i))
+		{
+			continue;
+		}
+
+		// the props and the floor are measured as separate passes
+		// to see how much of the fragment work the floor takes, and
+		// apart from the passes that also write the object ids
+		const char* objectPass = (object.group == "floor") ? "floor" : "props";
+		if (m_bObjectIds)
+		{
+			objectPass = (object.group == "floor") ? "floor+ids" : "props+ids";
+		}
+		if ((NULL != m_pGpuProfiler) && (objectPass != currentPass))
+		{
+			if (NULL != currentPass)
+			{
+				m_pGpuProfiler->EndPass();
+			}
+			m_pGpuProfiler->BeginPass(objectPass);
+			currentPass = objectPass;
+		}
+
+		if (m_bObjectIds)
+		{
+			m_pShaderManager->setIntValue(g_PickIdName, (int)i + 1);
+		}
+		DrawSceneObject(object);
+	}
+
+	if ((NULL != m_pGpuProfiler) && (NULL != currentPass))
+	{
+		m_pGpuProfiler->EndPass();
+	}
+}
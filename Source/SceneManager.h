@@ -11,11 +11,16 @@
 
 #include "ShaderManager.h"
 #include "ShapeMeshes.h"
+#include "FrameProfiler.h"
+#include "GpuProfiler.h"
+#include "DrawCostProfiler.h"
 #include <stb_image.h>
 
 #include <string>
 #include <vector>
 
+class VisibilityCache;
+
 
 /***********************************************************
  *  SceneManager
@@ -47,6 +52,55 @@ public:
 		std::string tag;
 	};
 
+	// basic mesh types that can be drawn by the scene
+	enum MESH_TYPE
+	{
+		MESH_PLANE = 0,
+		MESH_CYLINDER,
+		MESH_CONE,
+		MESH_BOX,
+		MESH_SPHERE,
+		MESH_COUNT
+	};
+
+	// image file of a scene texture and the tag it is drawn by
+	struct TEXTURE_FILE
+	{
+		const char* filename;
+		const char* tag;
+	};
+
+	// number of light sources in the scene shaders
+	static const int LIGHT_COUNT = 4;
+
+	// one light source of the scene shaders
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+	};
+
+	struct SCENE_OBJECT
+	{
+		// unique object name and the composite object it belongs to
+		std::string name;
+		std::string group;
+		MESH_TYPE mesh;
+		glm::vec3 scale;
+		glm::vec3 rotation;
+		glm::vec3 position;
+		// solid color, used when the object is not textured
+		glm::vec4 color;
+		bool bTextured;
+		std::string textureTag;
+		glm::vec2 uvScale;
+		std::string materialTag;
+	};
+
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
@@ -58,6 +112,22 @@ private:
 	TEXTURE_INFO m_textureIDs[16];
 	// defined object materials
 	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// optional frame profiler that receives likely hitch causes
+	FrameProfiler* m_pFrameProfiler;
+	// optional GPU profiler that measures each render pass
+	GpuProfiler* m_pGpuProfiler;
+	// optional profiler that measures the GPU cost of each draw
+	DrawCostProfiler* m_pDrawCostProfiler;
+	// optional frustum culling results of RenderScene()
+	VisibilityCache* m_pVisibilityCache;
+	// true when RenderScene() sets the pick id of each object
+	bool m_bObjectIds;
+	// objects drawn by RenderScene(), in draw order
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// true when the next draw samples a texture
+	bool m_bTextureEnabled;
+	// draw states (mesh and texture variant) already issued once
+	bool m_usedDrawStates[MESH_COUNT][2];
 
 	// load texture images and convert to OpenGL texture data
 	bool CreateGLTexture(const char* filename, std::string tag);
@@ -99,6 +169,11 @@ private:
 	void SetShaderMaterial(
 		std::string materialTag);
 
+	// draw one of the basic meshes with the current shader state
+	void DrawBasicMesh(MESH_TYPE mesh);
+	// issue a tiny offscreen draw for every draw state the scene uses
+	void WarmUpDrawStates();
+
 public:
 	/*** The following methods are for the students to ***/
 	/*** customize for their own 3D scene              ***/
@@ -111,6 +186,38 @@ public:
 	// pre-define the object materials for lighting
 	void DefineObjectMaterials();
 	void LoadSceneTextures();
-
+	// fill the scene draw list
+	void DefineSceneObjects();
+	// objects drawn by RenderScene()
+	const std::vector<SCENE_OBJECT>& GetSceneObjects() const { return(m_sceneObjects); }
+	// set the color or texture and the material of an object,
+	// for renderers that supply the transformation themselves
+	void ApplyObjectState(const SCENE_OBJECT& object);
+	// set the state of a scene object and draw it, for renderers
+	// that draw part of the draw list or a moved copy of it
+	void DrawSceneObject(const SCENE_OBJECT& object);
+	// readable name of a mesh type
+	static const char* GetMeshName(MESH_TYPE mesh);
+	// model matrix used for drawing an object
+	static glm::mat4 ComputeModelMatrix(glm::vec3 scale, glm::vec3 rotationDegrees, glm::vec3 position);
+	// defined object materials
+	const std::vector<OBJECT_MATERIAL>& GetObjectMaterials() const { return(m_objectMaterials); }
+	// texture files loaded by LoadSceneTextures()
+	static int GetTextureFileCount();
+	static const TEXTURE_FILE& GetTextureFile(int index);
+	// light sources set by SetupSceneLights()
+	static const LIGHT_SOURCE& GetLightSource(int index);
+
+	// receive likely hitch causes during rendering (may be NULL)
+	void SetFrameProfiler(FrameProfiler* pFrameProfiler);
+	// measure the render passes on the GPU (may be NULL)
+	void SetGpuProfiler(GpuProfiler* pGpuProfiler);
+	// measure the GPU cost of each draw (may be NULL)
+	void SetDrawCostProfiler(DrawCostProfiler* pDrawCostProfiler);
+	// skip the objects the cache culled in RenderScene() (may be NULL)
+	void SetVisibilityCache(VisibilityCache* pVisibilityCache) { m_pVisibilityCache = pVisibilityCache; }
+	// set the pickId uniform to the draw list index + 1 before
+	// each object RenderScene() draws, for an object id target
+	void SetObjectIds(bool bEnabled) { m_bObjectIds = bEnabled; }
 
 };
\ No newline at end of file
@@ -0,0 +1,196 @@
+///////////////////////////////////////////////////////////////////////////////
+// ShaderUtils.cpp
+// ===============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `ShaderUtils` helpers, which compile and link
+// shader programs from source text for the render passes that need more
+// than the vertex and fragment stage of the scene program.
+//
+// FUNCTIONALITY:
+// - Read shader files and patch names in their source text.
+// - Compile stages and link programs, printing the driver log on failure.
+// - Label the programs for the debug output and graphics debuggers.
+// - Temporarily route the uniforms of `SceneManager` to another program.
+//
+// NOTES:
+// `SceneManager` sets its uniforms through `ShaderManager`, which looks
+// them up in its own program, so a pass that draws the scene with another
+// program swaps that program in and restores it afterwards.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUtils.h"
+#include "GLDebugOutput.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// covers the screen with one triangle from gl_VertexID
+const char* const ShaderUtils::FULLSCREEN_VERTEX_SHADER =
+	"#version 410 core\n"
+	"void main()\n"
+	"{\n"
+	"	vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);\n"
+	"	gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+
+/***********************************************************
+ *  ReadFile()
+ *
+ *  This method reads a whole text file into a string.
+ ***********************************************************/
+bool ShaderUtils::ReadFile(const std::string& filename, std::string& text)
+{
+	std::ifstream file(filename.c_str());
+	if (!file.is_open())
+	{
+		std::cerr << "Could not open shader file: " << filename << std::endl;
+		return(false);
+	}
+
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	text = buffer.str();
+	return(true);
+}
+
+/***********************************************************
+ *  ReplaceAll()
+ *
+ *  This method replaces every occurrence of a string.
+ ***********************************************************/
+void ShaderUtils::ReplaceAll(std::string& text, const std::string& from, const std::string& to)
+{
+	if (from.empty())
+	{
+		return;
+	}
+
+	size_t position = 0;
+	while ((position = text.find(from, position)) != std::string::npos)
+	{
+		text.replace(position, from.size(), to);
+		position += to.size();
+	}
+}
+
+/***********************************************************
+ *  InsertAfterVersion()
+ *
+ *  This method inserts code after the #version line, or at
+ *  the start of a source without one.
+ ***********************************************************/
+void ShaderUtils::InsertAfterVersion(std::string& text, const std::string& code)
+{
+	size_t position = text.find("#version");
+	if (position == std::string::npos)
+	{
+		text.insert(0, code);
+		return;
+	}
+
+	position = text.find('\n', position);
+	if (position == std::string::npos)
+	{
+		text += "\n" + code;
+		return;
+	}
+	text.insert(position + 1, code);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method compiles one shader stage.
+ ***********************************************************/
+GLuint ShaderUtils::CompileShader(GLenum type, const std::string& source, const std::string& name)
+{
+	GLuint shader = glCreateShader(type);
+	const char* text = source.c_str();
+	glShaderSource(shader, 1, &text, NULL);
+	glCompileShader(shader);
+
+	GLint status = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE)
+	{
+		char log[1024];
+		glGetShaderInfoLog(shader, sizeof(log), NULL, log);
+		std::cerr << "Could not compile shader " << name << ":\n" << log << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+	return(shader);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method links the compiled stages into a program.
+ *  The stages are deleted either way.
+ ***********************************************************/
+GLuint ShaderUtils::LinkProgram(const std::vector<GLuint>& shaders, const std::string& name)
+{
+	bool bComplete = !shaders.empty();
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		bComplete = bComplete && (shaders[i] != 0);
+	}
+
+	GLuint program = 0;
+	if (bComplete)
+	{
+		program = glCreateProgram();
+		for (size_t i = 0; i < shaders.size(); i++)
+		{
+			glAttachShader(program, shaders[i]);
+		}
+		glLinkProgram(program);
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE)
+		{
+			char log[1024];
+			glGetProgramInfoLog(program, sizeof(log), NULL, log);
+			std::cerr << "Could not link program " << name << ":\n" << log << std::endl;
+			glDeleteProgram(program);
+			program = 0;
+		}
+	}
+
+	for (size_t i = 0; i < shaders.size(); i++)
+	{
+		if (shaders[i] != 0)
+		{
+			if (program != 0)
+			{
+				glDetachShader(program, shaders[i]);
+			}
+			glDeleteShader(shaders[i]);
+		}
+	}
+
+	if (program != 0)
+	{
+		GLDebugOutput::LabelObject(GL_PROGRAM, program, "program:" + name);
+	}
+	return(program);
+}
+
+/***********************************************************
+ *  SwapProgram()
+ *
+ *  This method makes a program current for the shader
+ *  manager and returns the one it replaced.
+ ***********************************************************/
+GLuint ShaderUtils::SwapProgram(ShaderManager* pShaderManager, GLuint program)
+{
+	GLuint previous = pShaderManager->m_programID;
+	pShaderManager->m_programID = program;
+	glUseProgram(program);
+	return(previous);
+}
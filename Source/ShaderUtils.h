@@ -0,0 +1,51 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderutils.h
+// ============
+// build shader programs from source text for the extra render passes
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "ShaderManager.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  ShaderUtils
+ *
+ *  ShaderManager only builds the scene program from its two
+ *  GLSL files. These helpers compile and link programs from
+ *  source text, so a render pass can add its own stages or
+ *  patch the scene shaders, and let such a program take the
+ *  place of the scene program while the scene is drawn.
+ ***********************************************************/
+class ShaderUtils
+{
+public:
+	// read a whole text file
+	static bool ReadFile(const std::string& filename, std::string& text);
+	// replace every occurrence of a word in a shader source
+	static void ReplaceAll(std::string& text, const std::string& from, const std::string& to);
+	// insert declarations right after the #version line, where
+	// extensions and defines have to go
+	static void InsertAfterVersion(std::string& text, const std::string& code);
+
+	// compile one stage, returns 0 and prints the log on failure
+	static GLuint CompileShader(GLenum type, const std::string& source, const std::string& name);
+	// link the stages into a labelled program and delete the
+	// stages, returns 0 and prints the log on failure
+	static GLuint LinkProgram(const std::vector<GLuint>& shaders, const std::string& name);
+
+	// make the program current and the target of the uniforms
+	// set through the shader manager; returns the program it
+	// replaced so that it can be restored afterwards
+	static GLuint SwapProgram(ShaderManager* pShaderManager, GLuint program);
+
+	// vertex stage that covers the screen with one triangle drawn
+	// from an empty vertex array, for the fullscreen passes
+	static const char* const FULLSCREEN_VERTEX_SHADER;
+};
@@ -0,0 +1,566 @@
+///////////////////////////////////////////////////////////////////////////////
+// SoftwareRasterizer.cpp
+// ======================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `SoftwareRasterizer` class, a CPU backend that
+// draws the same meshes, textures, materials and lights as the OpenGL
+// path of the scene.
+//
+// FUNCTIONALITY:
+// - Split the scene triangles into one slice per worker; each slice is
+//   transformed, clipped against the near plane and binned into 64x64
+//   pixel tiles.
+// - Hand out the tiles to the workers through an atomic counter and
+//   rasterize each tile with the bins of every slice in draw order.
+// - Evaluate the edge functions and the depth test for four pixels at a
+//   time with SSE2, with a scalar version for other processors.
+// - Interpolate the attributes with perspective correction, sample the
+//   textures bilinearly with repeat wrapping and apply the Phong model of
+//   the scene fragment shader.
+// - Blend with source alpha, like the OpenGL state set by `ViewManager`.
+//
+// NOTES:
+// Triangles are drawn without face culling, as on the GPU. The textures
+// are sampled without mipmaps.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "SoftwareRasterizer.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#define SOFTWARE_RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	// triangles closer than this to the eye are clipped
+	const float g_NearW = 1.0e-5f;
+
+	/***********************************************************
+	 *  CLIP_VERTEX
+	 *
+	 *  A vertex in clip space with its world attributes.
+	 ***********************************************************/
+	struct CLIP_VERTEX
+	{
+		glm::vec4 clip;
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 uv;
+	};
+
+	/***********************************************************
+	 *  LerpVertex()
+	 *
+	 *  Interpolates two clip space vertices.
+	 ***********************************************************/
+	CLIP_VERTEX LerpVertex(const CLIP_VERTEX& a, const CLIP_VERTEX& b, float t)
+	{
+		CLIP_VERTEX result;
+		result.clip = a.clip + (b.clip - a.clip) * t;
+		result.position = a.position + (b.position - a.position) * t;
+		result.normal = a.normal + (b.normal - a.normal) * t;
+		result.uv = a.uv + (b.uv - a.uv) * t;
+		return(result);
+	}
+
+}
+
+/***********************************************************
+ *  SoftwareRasterizer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SoftwareRasterizer::SoftwareRasterizer(int threadCount)
+	: m_workerPool(threadCount)
+{
+	m_width = 0;
+	m_height = 0;
+	m_tilesX = 0;
+	m_tilesY = 0;
+	m_nextTile = 0;
+	m_binnedTriangles = 0;
+	m_triangles.resize(m_workerPool.GetThreadCount());
+	m_bins.resize(m_workerPool.GetThreadCount());
+}
+
+/***********************************************************
+ *  ~SoftwareRasterizer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SoftwareRasterizer::~SoftwareRasterizer()
+{
+	m_workerPool.WaitIdle();
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method sizes the buffers and the tile grid.
+ ***********************************************************/
+bool SoftwareRasterizer::Resize(int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	m_width = width;
+	m_height = height;
+	m_tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+	m_tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+	m_colorBuffer.assign((size_t)width * height * 4, 0);
+	m_depthBuffer.assign((size_t)width * height + 4, 1.0f);
+	for (size_t i = 0; i < m_bins.size(); i++)
+	{
+		m_bins[i].assign((size_t)m_tilesX * m_tilesY, std::vector<uint32_t>());
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method runs the geometry stage and then the raster
+ *  stage on the workers.
+ ***********************************************************/
+void SoftwareRasterizer::Render(const SceneGeometry& scene, const glm::mat4& view,
+	const glm::mat4& projection, const glm::vec3& viewPosition)
+{
+	if (m_colorBuffer.empty())
+	{
+		return;
+	}
+
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = scene.GetObjects();
+	m_viewPosition = viewPosition;
+
+	// resolve the shader state of every object once
+	m_shadeStates.resize(objects.size());
+	size_t totalTriangles = 0;
+	for (size_t i = 0; i < objects.size(); i++)
+	{
+		SHADE_STATE& state = m_shadeStates[i];
+		const SceneManager::OBJECT_MATERIAL* pMaterial = scene.FindMaterial(objects[i].materialTag);
+		state.pTexture = objects[i].bTextured ? scene.FindTexture(objects[i].textureTag) : NULL;
+		state.bTextured = (NULL != state.pTexture);
+		state.uvScale = objects[i].uvScale;
+		state.color = objects[i].color;
+		if (NULL != pMaterial)
+		{
+			state.material = *pMaterial;
+		}
+		else
+		{
+			state.material.ambientColor = glm::vec3(1.0f);
+			state.material.ambientStrength = 1.0f;
+			state.material.diffuseColor = glm::vec3(1.0f);
+			state.material.specularColor = glm::vec3(0.0f);
+			state.material.shininess = 1.0f;
+		}
+		totalTriangles += scene.GetMesh(objects[i].mesh).indices.size() / 3;
+	}
+
+	// geometry stage: equal slices of the triangles, in draw order
+	glm::mat4 viewProjection = projection * view;
+	int jobs = (int)m_triangles.size();
+	for (int job = 0; job < jobs; job++)
+	{
+		size_t first = totalTriangles * job / jobs;
+		size_t last = totalTriangles * (job + 1) / jobs;
+		m_workerPool.Submit([this, &scene, viewProjection, job, first, last]()
+		{
+			ProcessGeometry(scene, viewProjection, job, first, last);
+		});
+	}
+	m_workerPool.WaitIdle();
+
+	m_binnedTriangles = 0;
+	for (int job = 0; job < jobs; job++)
+	{
+		m_binnedTriangles += (long)m_triangles[job].size();
+	}
+
+	// raster stage: clear and draw whole tiles
+	m_nextTile = 0;
+	for (int worker = 0; worker < m_workerPool.GetThreadCount(); worker++)
+	{
+		m_workerPool.Submit([this]() { RasterTiles(); });
+	}
+	m_workerPool.WaitIdle();
+}
+
+/***********************************************************
+ *  ProcessGeometry()
+ *
+ *  This method transforms a range of the scene triangles,
+ *  counted over the objects in draw order, clips them at
+ *  the near plane and bins them.
+ ***********************************************************/
+void SoftwareRasterizer::ProcessGeometry(const SceneGeometry& scene, const glm::mat4& viewProjection,
+	int job, size_t firstTriangle, size_t lastTriangle)
+{
+	const std::vector<SceneManager::SCENE_OBJECT>& objects = scene.GetObjects();
+	m_triangles[job].clear();
+	for (size_t tile = 0; tile < m_bins[job].size(); tile++)
+	{
+		m_bins[job][tile].clear();
+	}
+
+	size_t objectStart = 0;
+	for (size_t objectIndex = 0; (objectIndex < objects.size()) && (objectStart < lastTriangle); objectIndex++)
+	{
+		const SceneManager::SCENE_OBJECT& object = objects[objectIndex];
+		const SceneGeometry::MESH& mesh = scene.GetMesh(object.mesh);
+		size_t triangleCount = mesh.indices.size() / 3;
+		size_t objectEnd = objectStart + triangleCount;
+		if (objectEnd <= firstTriangle)
+		{
+			objectStart = objectEnd;
+			continue;
+		}
+
+		glm::mat4 model = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+
+		size_t begin = std::max(firstTriangle, objectStart) - objectStart;
+		size_t end = std::min(lastTriangle, objectEnd) - objectStart;
+		for (size_t t = begin; t < end; t++)
+		{
+			CLIP_VERTEX input[3];
+			int inside = 0;
+			for (int corner = 0; corner < 3; corner++)
+			{
+				const SceneGeometry::VERTEX& vertex = mesh.vertices[mesh.indices[t * 3 + corner]];
+				glm::vec4 world = model * glm::vec4(vertex.position, 1.0f);
+				input[corner].position = glm::vec3(world);
+				input[corner].normal = normalMatrix * vertex.normal;
+				input[corner].uv = vertex.uv;
+				input[corner].clip = viewProjection * world;
+				if (input[corner].clip.z >= -input[corner].clip.w)
+				{
+					inside++;
+				}
+			}
+			if (inside == 0)
+			{
+				continue;
+			}
+
+			// clip the polygon against the near plane (z = -w)
+			CLIP_VERTEX polygon[4];
+			int corners = 0;
+			if (inside == 3)
+			{
+				polygon[0] = input[0];
+				polygon[1] = input[1];
+				polygon[2] = input[2];
+				corners = 3;
+			}
+			else
+			{
+				for (int corner = 0; corner < 3; corner++)
+				{
+					const CLIP_VERTEX& a = input[corner];
+					const CLIP_VERTEX& b = input[(corner + 1) % 3];
+					float da = a.clip.z + a.clip.w;
+					float db = b.clip.z + b.clip.w;
+					if (da >= 0.0f)
+					{
+						polygon[corners++] = a;
+					}
+					if ((da >= 0.0f) != (db >= 0.0f))
+					{
+						polygon[corners++] = LerpVertex(a, b, da / (da - db));
+					}
+				}
+			}
+
+			// perspective divide and viewport transform
+			RASTER_VERTEX raster[4];
+			bool bVisible = true;
+			for (int corner = 0; corner < corners; corner++)
+			{
+				const CLIP_VERTEX& vertex = polygon[corner];
+				float w = std::max(vertex.clip.w, g_NearW);
+				float invW = 1.0f / w;
+				raster[corner].x = (vertex.clip.x * invW * 0.5f + 0.5f) * m_width;
+				raster[corner].y = (vertex.clip.y * invW * 0.5f + 0.5f) * m_height;
+				raster[corner].z = vertex.clip.z * invW * 0.5f + 0.5f;
+				raster[corner].invW = invW;
+				raster[corner].positionOverW = vertex.position * invW;
+				raster[corner].normalOverW = vertex.normal * invW;
+				raster[corner].uvOverW = vertex.uv * invW;
+				bVisible = bVisible && (vertex.clip.w > 0.0f);
+			}
+			if (!bVisible)
+			{
+				continue;
+			}
+
+			for (int fan = 1; fan + 1 < corners; fan++)
+			{
+				TRIANGLE triangle;
+				triangle.v[0] = raster[0];
+				triangle.v[1] = raster[fan];
+				triangle.v[2] = raster[fan + 1];
+				triangle.objectIndex = (int)objectIndex;
+				BinTriangle(job, triangle);
+			}
+		}
+		objectStart = objectEnd;
+	}
+}
+
+/***********************************************************
+ *  BinTriangle()
+ *
+ *  This method stores a triangle and adds it to the bin of
+ *  every tile that its bounding box touches.
+ ***********************************************************/
+void SoftwareRasterizer::BinTriangle(int job, const TRIANGLE& triangle)
+{
+	const RASTER_VERTEX* v = triangle.v;
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+	if (fabsf(area) < 1.0e-8f)
+	{
+		return;
+	}
+
+	float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+	float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+	float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+	float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+	if ((maxX < 0.0f) || (maxY < 0.0f) || (minX >= (float)m_width) || (minY >= (float)m_height))
+	{
+		return;
+	}
+
+	int tileX0 = std::max(0, (int)minX / TILE_SIZE);
+	int tileY0 = std::max(0, (int)minY / TILE_SIZE);
+	int tileX1 = std::min(m_tilesX - 1, (int)std::min(maxX, (float)m_width - 1.0f) / TILE_SIZE);
+	int tileY1 = std::min(m_tilesY - 1, (int)std::min(maxY, (float)m_height - 1.0f) / TILE_SIZE);
+
+	uint32_t index = (uint32_t)m_triangles[job].size();
+	m_triangles[job].push_back(triangle);
+	for (int tileY = tileY0; tileY <= tileY1; tileY++)
+	{
+		for (int tileX = tileX0; tileX <= tileX1; tileX++)
+		{
+			m_bins[job][tileY * m_tilesX + tileX].push_back(index);
+		}
+	}
+}
+
+/***********************************************************
+ *  RasterTiles()
+ *
+ *  This method takes tiles until none are left, clears them
+ *  and draws their triangles in submission order.
+ ***********************************************************/
+void SoftwareRasterizer::RasterTiles()
+{
+	const int tileCount = m_tilesX * m_tilesY;
+	int tile;
+	while ((tile = m_nextTile.fetch_add(1)) < tileCount)
+	{
+		int x0 = (tile % m_tilesX) * TILE_SIZE;
+		int y0 = (tile / m_tilesX) * TILE_SIZE;
+		int x1 = std::min(x0 + TILE_SIZE, m_width);
+		int y1 = std::min(y0 + TILE_SIZE, m_height);
+
+		for (int y = y0; y < y1; y++)
+		{
+			unsigned char* color = &m_colorBuffer[((size_t)y * m_width + x0) * 4];
+			float* depth = &m_depthBuffer[(size_t)y * m_width + x0];
+			for (int x = x0; x < x1; x++)
+			{
+				color[0] = 0;
+				color[1] = 0;
+				color[2] = 0;
+				color[3] = 255;
+				color += 4;
+				*depth++ = 1.0f;
+			}
+		}
+
+		for (size_t job = 0; job < m_bins.size(); job++)
+		{
+			const std::vector<uint32_t>& bin = m_bins[job][tile];
+			for (size_t i = 0; i < bin.size(); i++)
+			{
+				DrawTriangle(m_triangles[job][bin[i]], x0, y0, x1, y1);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  DrawTriangle()
+ *
+ *  This method finds the covered pixels of a triangle in a
+ *  tile four at a time, depth tests them and shades the
+ *  ones that pass.
+ ***********************************************************/
+void SoftwareRasterizer::DrawTriangle(const TRIANGLE& triangle, int x0, int y0, int x1, int y1)
+{
+	const RASTER_VERTEX* v = triangle.v;
+	const SHADE_STATE& state = m_shadeStates[triangle.objectIndex];
+
+	// edge i is opposite vertex i; the signs make inside positive
+	float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+	float sign = (area > 0.0f) ? 1.0f : -1.0f;
+	float invArea = 1.0f / fabsf(area);
+	float a[3];
+	float b[3];
+	float c[3];
+	for (int i = 0; i < 3; i++)
+	{
+		const RASTER_VERTEX& p = v[(i + 1) % 3];
+		const RASTER_VERTEX& q = v[(i + 2) % 3];
+		a[i] = sign * (p.y - q.y) * invArea;
+		b[i] = sign * (q.x - p.x) * invArea;
+		c[i] = sign * (p.x * q.y - p.y * q.x) * invArea;
+	}
+
+	// clamp the loops to the triangle bounds inside the tile
+	int minX = std::max(x0, (int)floorf(std::min(v[0].x, std::min(v[1].x, v[2].x))));
+	int maxX = std::min(x1, (int)ceilf(std::max(v[0].x, std::max(v[1].x, v[2].x))) + 1);
+	int minY = std::max(y0, (int)floorf(std::min(v[0].y, std::min(v[1].y, v[2].y))));
+	int maxY = std::min(y1, (int)ceilf(std::max(v[0].y, std::max(v[1].y, v[2].y))) + 1);
+
+#ifdef SOFTWARE_RASTERIZER_SSE2
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]);
+	const __m128 z0 = _mm_set1_ps(v[0].z), z1 = _mm_set1_ps(v[1].z), z2 = _mm_set1_ps(v[2].z);
+#endif
+
+	for (int y = minY; y < maxY; y++)
+	{
+		float py = (float)y + 0.5f;
+		float rowBase[3] = { b[0] * py + c[0], b[1] * py + c[1], b[2] * py + c[2] };
+		float* depthRow = &m_depthBuffer[(size_t)y * m_width];
+
+		for (int x = minX; x < maxX; x += 4)
+		{
+			float weights[3][4];
+			float depths[4];
+			int mask;
+
+#ifdef SOFTWARE_RASTERIZER_SSE2
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+			__m128 w0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(rowBase[0]));
+			__m128 w1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(rowBase[1]));
+			__m128 w2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(rowBase[2]));
+			__m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+			__m128 z = _mm_add_ps(_mm_mul_ps(w0, z0), _mm_add_ps(_mm_mul_ps(w1, z1), _mm_mul_ps(w2, z2)));
+			__m128 depthTest = _mm_and_ps(_mm_cmplt_ps(z, _mm_loadu_ps(depthRow + x)),
+				_mm_and_ps(_mm_cmpge_ps(z, zero), _mm_cmple_ps(z, one)));
+			mask = _mm_movemask_ps(_mm_and_ps(inside, depthTest));
+
+			_mm_storeu_ps(weights[0], w0);
+			_mm_storeu_ps(weights[1], w1);
+			_mm_storeu_ps(weights[2], w2);
+			_mm_storeu_ps(depths, z);
+#else
+			mask = 0;
+			for (int lane = 0; lane < 4; lane++)
+			{
+				float px = (float)(x + lane) + 0.5f;
+				for (int i = 0; i < 3; i++)
+				{
+					weights[i][lane] = a[i] * px + rowBase[i];
+				}
+				depths[lane] = weights[0][lane] * v[0].z + weights[1][lane] * v[1].z + weights[2][lane] * v[2].z;
+				if ((weights[0][lane] >= 0.0f) && (weights[1][lane] >= 0.0f) && (weights[2][lane] >= 0.0f) &&
+					(depths[lane] < depthRow[x + lane]) && (depths[lane] >= 0.0f) && (depths[lane] <= 1.0f))
+				{
+					mask |= 1 << lane;
+				}
+			}
+#endif
+			// lanes past the tile edge are never written
+			if (maxX - x < 4)
+			{
+				mask &= (1 << (maxX - x)) - 1;
+			}
+
+			while (mask != 0)
+			{
+				int lane = 0;
+				while ((mask & (1 << lane)) == 0)
+				{
+					lane++;
+				}
+				mask &= ~(1 << lane);
+
+				// perspective correct attributes
+				float b0 = weights[0][lane];
+				float b1 = weights[1][lane];
+				float b2 = weights[2][lane];
+				float invW = b0 * v[0].invW + b1 * v[1].invW + b2 * v[2].invW;
+				float w = 1.0f / invW;
+				glm::vec3 position = (v[0].positionOverW * b0 + v[1].positionOverW * b1 + v[2].positionOverW * b2) * w;
+				glm::vec3 normal = (v[0].normalOverW * b0 + v[1].normalOverW * b1 + v[2].normalOverW * b2) * w;
+				glm::vec2 uv = (v[0].uvOverW * b0 + v[1].uvOverW * b1 + v[2].uvOverW * b2) * w;
+
+				glm::vec4 source = ShadePixel(state, position, normal, uv);
+				unsigned char* pixel = &m_colorBuffer[((size_t)y * m_width + x + lane) * 4];
+				float alpha = glm::clamp(source.a, 0.0f, 1.0f);
+				for (int channel = 0; channel < 4; channel++)
+				{
+					float destination = (float)pixel[channel] / 255.0f;
+					float blended = glm::clamp(source[channel], 0.0f, 1.0f) * alpha + destination * (1.0f - alpha);
+					pixel[channel] = (unsigned char)(blended * 255.0f + 0.5f);
+				}
+				depthRow[x + lane] = depths[lane];
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  ShadePixel()
+ *
+ *  This method applies the Phong model of the scene
+ *  fragment shader: per light an ambient term, a Lambert
+ *  diffuse term and a reflected specular term, modulated by
+ *  the material, times the texture or object color.
+ ***********************************************************/
+glm::vec4 SoftwareRasterizer::ShadePixel(const SHADE_STATE& state, const glm::vec3& position,
+	const glm::vec3& normal, const glm::vec2& uv) const
+{
+	glm::vec3 lightNormal = glm::normalize(normal);
+	glm::vec3 viewDirection = glm::normalize(m_viewPosition - position);
+	glm::vec3 phong(0.0f);
+
+	for (int i = 0; i < SceneManager::LIGHT_COUNT; i++)
+	{
+		const SceneManager::LIGHT_SOURCE& light = SceneManager::GetLightSource(i);
+		glm::vec3 lightDirection = glm::normalize(light.position - position);
+		float impact = std::max(glm::dot(lightNormal, lightDirection), 0.0f);
+		glm::vec3 reflectDirection = glm::reflect(-lightDirection, lightNormal);
+		float specular = powf(std::max(glm::dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+
+		phong += light.ambientColor * state.material.ambientColor;
+		phong += impact * light.diffuseColor * state.material.diffuseColor;
+		phong += light.specularIntensity * specular * state.material.specularColor;
+	}
+
+	if (state.bTextured)
+	{
+		glm::vec4 texel = SceneGeometry::SampleTexture(*state.pTexture, uv * state.uvScale);
+		return(glm::vec4(phong * glm::vec3(texel), 1.0f));
+	}
+	return(glm::vec4(phong * glm::vec3(state.color), state.color.a));
+}
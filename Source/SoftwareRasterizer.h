@@ -0,0 +1,115 @@
+///////////////////////////////////////////////////////////////////////////////
+// softwarerasterizer.h
+// ============
+// multithreaded CPU rasterizer backend for the scene
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneGeometry.h"
+#include "WorkerPool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  SoftwareRasterizer
+ *
+ *  This class draws the scene on the CPU for machines with
+ *  no usable GPU driver. A frame runs in two parallel
+ *  stages: the workers transform and clip slices of the
+ *  draw list and bin the triangles into screen tiles, then
+ *  each worker takes whole tiles and rasterizes them with
+ *  SSE2 edge functions, perspective correct texturing and
+ *  the Phong lighting of the scene shaders. The tiles never
+ *  overlap, so the second stage needs no locks.
+ ***********************************************************/
+class SoftwareRasterizer
+{
+public:
+	// edge length of a screen tile, in pixels
+	static const int TILE_SIZE = 64;
+
+	// constructor; zero threads uses one less than the cores
+	SoftwareRasterizer(int threadCount = 0);
+	// destructor
+	~SoftwareRasterizer();
+
+	// set the size of the color and depth buffers
+	bool Resize(int width, int height);
+	// draw the scene into the color buffer
+	void Render(const SceneGeometry& scene, const glm::mat4& view,
+		const glm::mat4& projection, const glm::vec3& viewPosition);
+
+	// RGBA pixels, bottom row first like glReadPixels
+	const unsigned char* GetColorBuffer() const { return(m_colorBuffer.empty() ? NULL : &m_colorBuffer[0]); }
+	int GetWidth() const { return(m_width); }
+	int GetHeight() const { return(m_height); }
+	int GetThreadCount() const { return(m_workerPool.GetThreadCount()); }
+	// triangles that reached the tile bins in the last frame
+	long GetBinnedTriangles() const { return(m_binnedTriangles); }
+
+private:
+	// a vertex after the perspective divide; the attributes are
+	// divided by w for perspective correct interpolation
+	struct RASTER_VERTEX
+	{
+		float x;
+		float y;
+		float z;
+		float invW;
+		glm::vec3 positionOverW;
+		glm::vec3 normalOverW;
+		glm::vec2 uvOverW;
+	};
+
+	struct TRIANGLE
+	{
+		RASTER_VERTEX v[3];
+		int objectIndex;
+	};
+
+	// the shader state of one object, resolved once per frame
+	struct SHADE_STATE
+	{
+		bool bTextured;
+		const SceneGeometry::TEXTURE* pTexture;
+		glm::vec2 uvScale;
+		glm::vec4 color;
+		SceneManager::OBJECT_MATERIAL material;
+	};
+
+	WorkerPool m_workerPool;
+	int m_width;
+	int m_height;
+	int m_tilesX;
+	int m_tilesY;
+	std::vector<unsigned char> m_colorBuffer;
+	// padded by a few floats so the last SIMD load stays inside
+	std::vector<float> m_depthBuffer;
+
+	// per geometry job: its triangles, and per tile the indices
+	// of the triangles that touch it, in draw order
+	std::vector<std::vector<TRIANGLE> > m_triangles;
+	std::vector<std::vector<std::vector<uint32_t> > > m_bins;
+	std::vector<SHADE_STATE> m_shadeStates;
+	glm::vec3 m_viewPosition;
+	std::atomic<int> m_nextTile;
+	long m_binnedTriangles;
+
+	// transform, clip and bin a slice of the scene triangles
+	void ProcessGeometry(const SceneGeometry& scene, const glm::mat4& viewProjection,
+		int job, size_t firstTriangle, size_t lastTriangle);
+	// add a clipped triangle to the bins of the tiles it covers
+	void BinTriangle(int job, const TRIANGLE& triangle);
+	// rasterize the tiles handed out through m_nextTile
+	void RasterTiles();
+	// draw the part of a triangle that lies inside one tile
+	void DrawTriangle(const TRIANGLE& triangle, int x0, int y0, int x1, int y1);
+	// light and color one pixel
+	glm::vec4 ShadePixel(const SHADE_STATE& state, const glm::vec3& position,
+		const glm::vec3& normal, const glm::vec2& uv) const;
+};
@@ -0,0 +1,251 @@
+///////////////////////////////////////////////////////////////////////////////
+// TiledScreenshot.cpp
+// ===================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `TiledScreenshot` class, which renders stills of
+// 16k pixels and more, far beyond GL_MAX_RENDERBUFFER_SIZE. The
+// perspective projection from `ViewManager::PrepareSceneView` is split
+// into sub-frusta, one per tile, and the tiles are stitched back together
+// in the output file.
+//
+// FUNCTIONALITY:
+// - Clamp the tile size to the largest renderbuffer and viewport.
+// - Render the tiles of one row of the image into a strip buffer, reading
+//   each tile straight into place with GL_PACK_ROW_LENGTH.
+// - Compress and write the finished strip on a worker thread while the
+//   next strip renders; the PNG is written from the top down.
+// - Report progress and the throughput in megapixels per second.
+//
+// NOTES:
+// All tiles use the same camera and the same shading, so the seams are
+// invisible. Screen-space effects that sample neighbouring pixels would
+// need overlapping tiles.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "TiledScreenshot.h"
+#include "GLDebugOutput.h"
+#include "ImageWriter.h"
+#include "WorkerPool.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+
+/***********************************************************
+ *  TiledScreenshot()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TiledScreenshot::TiledScreenshot(ViewManager* pViewManager, SceneManager* pSceneManager, int tileSize)
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_tileSize = (tileSize > 0) ? tileSize : 1024;
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+}
+
+/***********************************************************
+ *  ~TiledScreenshot()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TiledScreenshot::~TiledScreenshot()
+{
+	DestroyTarget();
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  CreateTarget()
+ *
+ *  This method is used for creating the framebuffer that
+ *  every tile is rendered into.
+ ***********************************************************/
+bool TiledScreenshot::CreateTarget()
+{
+	GLint maxRenderbufferSize = 0;
+	GLint maxViewport[2] = { 0, 0 };
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, maxViewport);
+
+	if (m_tileSize > maxRenderbufferSize)
+		m_tileSize = maxRenderbufferSize;
+	if (m_tileSize > maxViewport[0])
+		m_tileSize = maxViewport[0];
+	if (m_tileSize > maxViewport[1])
+		m_tileSize = maxViewport[1];
+
+	glGenFramebuffers(1, &m_framebuffer);
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glGenRenderbuffers(1, &m_depthBuffer);
+
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, m_tileSize, m_tileSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, m_tileSize, m_tileSize);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+	GLDebugOutput::LabelObject(GL_FRAMEBUFFER, m_framebuffer, "framebuffer:screenshot-tile");
+	GLDebugOutput::LabelObject(GL_RENDERBUFFER, m_colorBuffer, "renderbuffer:screenshot-tile.color");
+	GLDebugOutput::LabelObject(GL_RENDERBUFFER, m_depthBuffer, "renderbuffer:screenshot-tile.depth");
+
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Screenshot tile framebuffer is incomplete: 0x" << std::hex << status << std::dec << std::endl;
+		DestroyTarget();
+		return(false);
+	}
+	return(true);
+}
+
+/***********************************************************
+ *  DestroyTarget()
+ *
+ *  This method is used for freeing the tile framebuffer.
+ ***********************************************************/
+void TiledScreenshot::DestroyTarget()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_framebuffer = 0;
+		m_colorBuffer = 0;
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  Render()
+ *
+ *  This method renders the image strip by strip, from the
+ *  top down, and streams every strip into the PNG file.
+ ***********************************************************/
+bool TiledScreenshot::Render(const std::string& filename, int width, int height)
+{
+	typedef std::chrono::steady_clock CLOCK;
+
+	if ((NULL == m_pViewManager) || (NULL == m_pSceneManager) || (width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+	if ((m_framebuffer == 0) && !CreateTarget())
+	{
+		return(false);
+	}
+
+	PngRowWriter writer;
+	if (!writer.Open(filename, width, height))
+	{
+		return(false);
+	}
+
+	const int tilesX = (width + m_tileSize - 1) / m_tileSize;
+	const int tilesY = (height + m_tileSize - 1) / m_tileSize;
+	std::cout << "INFO: Rendering " << width << "x" << height << " screenshot as "
+		<< tilesX << "x" << tilesY << " tiles of " << m_tileSize << " pixels" << std::endl;
+
+	// one strip is written by the worker while the next renders
+	std::vector<unsigned char> strips[2];
+	strips[0].resize((size_t)width * m_tileSize * 4);
+	strips[1].resize((size_t)width * m_tileSize * 4);
+	WorkerPool worker(1);
+	bool bWritten = true;
+
+	GLint savedViewport[4];
+	glGetIntegerv(GL_VIEWPORT, savedViewport);
+	glPixelStorei(GL_PACK_ROW_LENGTH, width);
+
+	CLOCK::time_point start = CLOCK::now();
+	for (int row = 0; row < tilesY; row++)
+	{
+		// rows of the image are counted from the top, GL from the bottom
+		int stripTop = height - row * m_tileSize;
+		int stripHeight = (stripTop < m_tileSize) ? stripTop : m_tileSize;
+		int stripBottom = stripTop - stripHeight;
+		unsigned char* pStrip = &strips[row % 2][0];
+
+		for (int column = 0; column < tilesX; column++)
+		{
+			int tileX = column * m_tileSize;
+			int tileWidth = (width - tileX < m_tileSize) ? (width - tileX) : m_tileSize;
+			RenderTile(width, height, tileX, stripBottom, tileWidth, stripHeight, pStrip);
+		}
+
+		// the previous strip must be in the file before this one
+		worker.WaitIdle();
+		worker.Submit([&writer, &bWritten, pStrip, stripHeight]()
+		{
+			if (!writer.WriteRows(pStrip, stripHeight, true))
+			{
+				bWritten = false;
+			}
+		});
+
+		double seconds = std::chrono::duration<double>(CLOCK::now() - start).count();
+		double megapixels = (double)width * (height - stripBottom) / 1.0e6;
+		std::cout << std::fixed << std::setprecision(1) << "INFO: screenshot "
+			<< 100.0 * (row + 1) / tilesY << "% (" << (row + 1) * tilesX << " of "
+			<< tilesX * tilesY << " tiles), " << megapixels / seconds << " MP/s" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+	}
+	worker.WaitIdle();
+
+	glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(savedViewport[0], savedViewport[1], savedViewport[2], savedViewport[3]);
+	m_pViewManager->ClearProjectionTile();
+
+	bWritten = writer.Close() && bWritten;
+	double seconds = std::chrono::duration<double>(CLOCK::now() - start).count();
+	double megapixels = (double)width * height / 1.0e6;
+	if (bWritten)
+	{
+		std::cout << std::fixed << std::setprecision(2) << "INFO: Wrote " << filename << ": "
+			<< megapixels << " MP in " << seconds << " s, " << megapixels / seconds << " MP/s" << std::endl;
+		std::cout.unsetf(std::ios::floatfield);
+	}
+	else
+	{
+		std::cerr << "Could not write screenshot: " << filename << std::endl;
+	}
+	return(bWritten);
+}
+
+/***********************************************************
+ *  RenderTile()
+ *
+ *  This method draws the scene for one tile and reads the
+ *  pixels into their place in the strip.
+ ***********************************************************/
+void TiledScreenshot::RenderTile(int imageWidth, int imageHeight, int x, int y, int width, int height, unsigned char* pStrip)
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glViewport(0, 0, width, height);
+	m_pViewManager->SetProjectionTile(imageWidth, imageHeight, x, y, width, height);
+
+	glEnable(GL_DEPTH_TEST);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	m_pViewManager->PrepareSceneView();
+	m_pSceneManager->RenderScene();
+
+	// the strip is imageWidth pixels wide, so each tile lands
+	// at its column offset
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pStrip + (size_t)x * 4);
+}
@@ -0,0 +1,55 @@
+///////////////////////////////////////////////////////////////////////////////
+// tiledscreenshot.h
+// ============
+// render still images larger than the maximum framebuffer size in tiles
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "SceneManager.h"
+#include "ViewManager.h"
+
+#include <string>
+
+/***********************************************************
+ *  TiledScreenshot
+ *
+ *  This class renders a print resolution still of the scene
+ *  as a grid of tiles. Each tile is drawn into one reusable
+ *  framebuffer object with the projection narrowed to its
+ *  part of the image, and each finished row of tiles is
+ *  appended to a PNG file, so only two rows of tiles are
+ *  ever held in memory.
+ ***********************************************************/
+class TiledScreenshot
+{
+public:
+	// constructor
+	TiledScreenshot(ViewManager* pViewManager, SceneManager* pSceneManager, int tileSize = 1024);
+	// destructor
+	~TiledScreenshot();
+
+	// render the current view into a PNG file of the given size
+	bool Render(const std::string& filename, int width, int height);
+
+private:
+	ViewManager* m_pViewManager;
+	SceneManager* m_pSceneManager;
+	// requested edge length of a tile, in pixels
+	int m_tileSize;
+
+	// reusable render target for the tiles
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+
+	// create the tile render target, limited by the driver
+	bool CreateTarget();
+	// free the tile render target
+	void DestroyTarget();
+	// draw one tile and read it into a row of tiles
+	void RenderTile(int imageWidth, int imageHeight, int x, int y, int width, int height, unsigned char* pStrip);
+};
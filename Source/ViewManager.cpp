@@ -35,6 +35,8 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/type_ptr.hpp>    
 
+#include <algorithm>
+
 // declaration of the global variables and defines
 namespace
 {
@@ -52,6 +54,10 @@ namespace
 	float gLastX = WINDOW_WIDTH / 2.0f;
 	float gLastY = WINDOW_HEIGHT / 2.0f;
 	bool gFirstMouse = true;
+	// cursor position of a left click not yet taken for picking
+	bool gClickPending = false;
+	double gClickX = 0.0;
+	double gClickY = 0.0;
 
 	// time between current frame and last frame
 	float gDeltaTime = 0.0f; 
@@ -73,6 +79,12 @@ ViewManager::ViewManager(
 	// initialize the member variables
 	m_pShaderManager = pShaderManager;
 	m_pWindow = NULL;
+	m_bProjectionTile = false;
+	m_tileTransform = glm::mat4(1.0f);
+	m_tileAspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_cameraCuts = 0;
 	g_pCamera = new Camera();
 	// default camera view parameters
 	g_pCamera->Position = glm::vec3(3.0f, 5.0f, 12.0f);
@@ -126,6 +138,8 @@ GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
 
 	// this callback is used to receive mouse moving events
 	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
+	// this callback is used to receive mouse clicks for picking
+	glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
 
 	// enable blending for supporting tranparent rendering
 	glEnable(GL_BLEND);
@@ -163,6 +177,23 @@ void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos,
 	// move the 3D camera according to the calculated offsets
 	g_pCamera->ProcessMouseMovement(xOffset * 20, yOffset * 20);
 }
+
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a mouse button is pressed or released; left clicks are
+ *  kept until they are taken for picking.
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	if ((button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		glfwGetCursorPos(window, &gClickX, &gClickY);
+		gClickPending = true;
+	}
+}
+
 long double baseSpeed = 0.00;
 void ViewManager::scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 
@@ -227,6 +258,7 @@ void ViewManager::ProcessKeyboardEvents()
 		g_pCamera->Front = glm::vec3(0.0f, -0.5f, -9.0f);
 		g_pCamera->Up = glm::vec3(0.0f, 10.0f, 0.0f);
 		g_pCamera->Zoom = 80;
+		m_cameraCuts++;
 	}
 	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS) {
 		bOrthographicProjection = true;  // Orthographic view
@@ -251,14 +283,26 @@ void ViewManager::PrepareSceneView()
 	gLastFrame = currentFrame;
 
 	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
+	// event queue, unless a tiled image is being rendered
+	if (!m_bProjectionTile)
+	{
+		ProcessKeyboardEvents();
+	}
 
 	// get the current view matrix from the camera
 	view = g_pCamera->GetViewMatrix();
 
 	// define the current projection matrix
-	projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	if (m_bProjectionTile)
+	{
+		projection = m_tileTransform * glm::perspective(glm::radians(g_pCamera->Zoom), m_tileAspect, 0.1f, 100.0f);
+	}
+	else
+	{
+		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
+	}
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
 
 	// if the shader manager object is valid
 	if (NULL != m_pShaderManager)
@@ -276,4 +320,117 @@ void ViewManager::PrepareSceneView()
 	else {
 		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
 	}
-}
\ No newline at end of file
+}
+
+/***********************************************************
+ *  SetProjectionTile()
+ *
+ *  This method limits the projection to one rectangle of a
+ *  larger image, given in pixels from the bottom left. The
+ *  tile's part of clip space is scaled and moved to cover
+ *  the whole viewport, so the tiles line up exactly.
+ ***********************************************************/
+void ViewManager::SetProjectionTile(int imageWidth, int imageHeight, int x, int y, int width, int height)
+{
+	float scaleX = (float)imageWidth / (float)width;
+	float scaleY = (float)imageHeight / (float)height;
+	float offsetX = (float)(imageWidth - 2 * x) / (float)width - 1.0f;
+	float offsetY = (float)(imageHeight - 2 * y) / (float)height - 1.0f;
+
+	m_tileTransform = glm::translate(glm::vec3(offsetX, offsetY, 0.0f)) *
+		glm::scale(glm::vec3(scaleX, scaleY, 1.0f));
+	m_tileAspect = (float)imageWidth / (float)imageHeight;
+	m_bProjectionTile = true;
+}
+
+/***********************************************************
+ *  ClearProjectionTile()
+ *
+ *  This method returns to the projection of the window.
+ ***********************************************************/
+void ViewManager::ClearProjectionTile()
+{
+	m_bProjectionTile = false;
+	m_tileTransform = glm::mat4(1.0f);
+	m_tileAspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method places the camera at a position, looking
+ *  along a direction, with the given field of view.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& front, float zoom)
+{
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	g_pCamera->Position = position;
+	g_pCamera->Front = glm::normalize(front);
+	g_pCamera->Zoom = zoom;
+	m_cameraCuts++;
+}
+
+/***********************************************************
+ *  GetCameraPose()
+ *
+ *  This method returns the position, viewing direction and
+ *  field of view of the camera.
+ ***********************************************************/
+void ViewManager::GetCameraPose(glm::vec3& position, glm::vec3& front, float& zoom) const
+{
+	if (NULL == g_pCamera)
+	{
+		return;
+	}
+
+	position = g_pCamera->Position;
+	front = g_pCamera->Front;
+	zoom = g_pCamera->Zoom;
+}
+
+/***********************************************************
+ *  TakeClick()
+ *
+ *  This method returns the cursor position of the last
+ *  left click and forgets it.
+ ***********************************************************/
+bool ViewManager::TakeClick(double& xCursor, double& yCursor)
+{
+	if (!gClickPending)
+	{
+		return(false);
+	}
+	xCursor = gClickX;
+	yCursor = gClickY;
+	gClickPending = false;
+	return(true);
+}
+
+/***********************************************************
+ *  ComputeCursorRay()
+ *
+ *  This method unprojects a cursor position, in window
+ *  coordinates from the top left, onto the near and far
+ *  planes and returns the ray between the two points.
+ ***********************************************************/
+void ViewManager::ComputeCursorRay(double xCursor, double yCursor, glm::vec3& origin, glm::vec3& direction) const
+{
+	int width = WINDOW_WIDTH;
+	int height = WINDOW_HEIGHT;
+	if (NULL != m_pWindow)
+	{
+		glfwGetWindowSize(m_pWindow, &width, &height);
+	}
+
+	float x = (float)(2.0 * xCursor / (double)std::max(width, 1) - 1.0);
+	float y = (float)(1.0 - 2.0 * yCursor / (double)std::max(height, 1));
+	glm::mat4 inverse = glm::inverse(m_projectionMatrix * m_viewMatrix);
+	glm::vec4 nearPoint = inverse * glm::vec4(x, y, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverse * glm::vec4(x, y, 1.0f, 1.0f);
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
@@ -27,12 +27,25 @@ public:
 	// mouse position callback for mouse interaction with the 3D scene
 	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
 	static void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+	// mouse button callback that remembers left clicks for picking
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
 
 private:
 	// pointer to shader manager object
 	ShaderManager* m_pShaderManager;
 	// active OpenGL display window
 	GLFWwindow* m_pWindow;
+	// true while the projection is limited to one tile of a larger image
+	bool m_bProjectionTile;
+	// maps the tile's part of clip space onto the whole viewport
+	glm::mat4 m_tileTransform;
+	// aspect ratio of the whole tiled image
+	float m_tileAspect;
+	// matrices uploaded by the last PrepareSceneView()
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// counts the camera jumps, such as the P key reset
+	unsigned int m_cameraCuts;
 
 	// process keyboard events for interaction with the 3D scene
 	void ProcessKeyboardEvents();
@@ -43,4 +56,30 @@ public:
 	
 	// prepare the conversion from 3D object display to 2D scene display
 	void PrepareSceneView();
+
+	// limit the projection to the pixel rectangle of one tile of a
+	// larger image, so the image can be rendered tile by tile;
+	// keyboard input is ignored until the tile is cleared
+	void SetProjectionTile(int imageWidth, int imageHeight, int x, int y, int width, int height);
+	// return to the projection of the whole window
+	void ClearProjectionTile();
+
+	// place the camera, for renders that supply their own pose
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& front, float zoom);
+	// read the current camera placement
+	void GetCameraPose(glm::vec3& position, glm::vec3& front, float& zoom) const;
+
+	// view and projection of the last prepared frame
+	const glm::mat4& GetViewMatrix() const { return(m_viewMatrix); }
+	const glm::mat4& GetProjectionMatrix() const { return(m_projectionMatrix); }
+	// changes whenever the camera is placed instead of moved, so
+	// anything kept from earlier frames can be thrown away
+	unsigned int GetCameraCuts() const { return(m_cameraCuts); }
+
+	// the cursor position of the last left click, once; false
+	// when there was no click since the last call
+	bool TakeClick(double& xCursor, double& yCursor);
+	// world space ray through a cursor position, with the matrices
+	// of the last prepared frame
+	void ComputeCursorRay(double xCursor, double yCursor, glm::vec3& origin, glm::vec3& direction) const;
 };
\ No newline at end of file
@@ -0,0 +1,315 @@
+///////////////////////////////////////////////////////////////////////////////
+// VisibilityCache.cpp
+// ===================
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `VisibilityCache` class, a frustum culler for the
+// draw list of the scene manager that reuses the results of the previous
+// frames.
+//
+// FUNCTIONALITY:
+// - Test the world bounding sphere of each object against the six planes
+//   of the view projection, and store with the result its margin: the
+//   smallest distance of the sphere to a plane it is inside of when
+//   visible, or the largest distance to a plane it is outside of when
+//   not.
+// - Add up the camera motion of every frame: the distance the camera
+//   moved and a bound on how far a plane normal turned, taken from the
+//   difference of the rotations of the view matrices.
+// - A plane moves by at most travel + turn * (distance + travel) at a
+//   point that was at the given distance from the camera, so an object
+//   is tested again only when that bound reaches its margin. Objects near
+//   a plane are tested every frame, the others only every few frames.
+// - Test everything when the view manager reports a camera jump (the P
+//   key reset or a placed camera), when the projection changes, when the
+//   draw list changes size or when one frame moves further than the jump
+//   threshold.
+// - Count the tests done and skipped and print the share at shutdown.
+//
+// NOTES:
+// The bound is conservative: the turn of the rotation matrix is measured
+// with the Frobenius norm, which overestimates the turn of a single
+// direction by up to a factor of sqrt(2). Moving objects must be marked
+// dirty, the cache only follows the camera.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "VisibilityCache.h"
+#include "SceneGeometry.h"
+
+// GLFW library
+#include "GLFW/glfw3.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+
+/***********************************************************
+ *  VisibilityCache()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+VisibilityCache::VisibilityCache()
+{
+	for (int type = 0; type < SceneManager::MESH_COUNT; type++)
+	{
+		SceneGeometry::MESH mesh;
+		SceneGeometry::BuildMesh((SceneManager::MESH_TYPE)type, mesh);
+		m_meshSpheres[type] = SceneGeometry::ComputeBoundingSphere(mesh);
+	}
+
+	m_lastView = glm::mat4(1.0f);
+	m_lastProjection = glm::mat4(1.0f);
+	m_lastCameraCuts = 0;
+	m_bValid = false;
+	m_travel = 0.0;
+	m_turn = 0.0;
+	m_jumpDistance = 2.0f;
+	m_jumpRadians = glm::radians(30.0f);
+
+	m_frames = 0;
+	m_fullUpdates = 0;
+	m_tests = 0;
+	m_skippedTests = 0;
+	m_visibleCount = 0;
+	m_cpuSeconds = 0.0;
+}
+
+/***********************************************************
+ *  ~VisibilityCache()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+VisibilityCache::~VisibilityCache()
+{
+}
+
+/***********************************************************
+ *  SetJumpThreshold()
+ *
+ *  This method sets the camera move in one frame above
+ *  which every object is tested again. The keyboard steps
+ *  of the camera stay far below the defaults.
+ ***********************************************************/
+void VisibilityCache::SetJumpThreshold(float distance, float degrees)
+{
+	m_jumpDistance = distance;
+	m_jumpRadians = glm::radians(degrees);
+}
+
+/***********************************************************
+ *  ExtractFrustumPlanes()
+ *
+ *  This method returns the planes of a view projection as
+ *  sums and differences of its rows, normalized so that
+ *  dot(plane.xyz, point) + plane.w is a distance.
+ ***********************************************************/
+void VisibilityCache::ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+{
+	glm::vec4 w(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+	for (int i = 0; i < 3; i++)
+	{
+		glm::vec4 row(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+		planes[i * 2 + 0] = w + row;
+		planes[i * 2 + 1] = w - row;
+	}
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+/***********************************************************
+ *  ComputeSphere()
+ *
+ *  This method transforms the sphere of the mesh of an
+ *  object into the world.
+ ***********************************************************/
+glm::vec4 VisibilityCache::ComputeSphere(const SceneManager::SCENE_OBJECT& object) const
+{
+	glm::mat4 model = SceneManager::ComputeModelMatrix(object.scale, object.rotation, object.position);
+	return(SceneGeometry::TransformSphere(model, m_meshSpheres[object.mesh]));
+}
+
+/***********************************************************
+ *  TestEntry()
+ *
+ *  This method tests the sphere of an entry against the
+ *  frustum and stores the result, the margin and the camera
+ *  motion it was tested at.
+ ***********************************************************/
+void VisibilityCache::TestEntry(ENTRY& entry, const glm::vec4 planes[6], const glm::vec3& cameraPosition)
+{
+	glm::vec3 center(entry.sphere);
+	float inside = 1e30f;
+	float outside = 0.0f;
+	for (int i = 0; i < 6; i++)
+	{
+		// negative when the whole sphere is behind the plane
+		float distance = glm::dot(glm::vec3(planes[i]), center) + planes[i].w + entry.sphere.w;
+		if (distance < 0.0f)
+		{
+			outside = std::max(outside, -distance);
+		}
+		else
+		{
+			inside = std::min(inside, distance);
+		}
+	}
+
+	// an object outside stays outside while any of its
+	// separating planes still separates it
+	entry.bVisible = (outside == 0.0f);
+	entry.margin = entry.bVisible ? inside : outside;
+	entry.distance = glm::length(center - cameraPosition);
+	entry.travelAtTest = m_travel;
+	entry.turnAtTest = m_turn;
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method adds the camera motion since the previous
+ *  frame and tests the objects whose margin it may have
+ *  used up, or every object after a camera jump.
+ ***********************************************************/
+void VisibilityCache::Update(const std::vector<SceneManager::SCENE_OBJECT>& objects,
+	const glm::mat4& view, const glm::mat4& projection, unsigned int cameraCuts)
+{
+	double startTime = glfwGetTime();
+	glm::vec3 cameraPosition = glm::vec3(glm::inverse(view)[3]);
+
+	bool bFullUpdate = !m_bValid || (objects.size() != m_entries.size()) ||
+		(cameraCuts != m_lastCameraCuts) || (projection != m_lastProjection);
+	if (!bFullUpdate)
+	{
+		// the difference of the rotations is zero for a camera
+		// that only moved, without the rounding of an angle
+		glm::mat3 turnMatrix = glm::mat3(view) - glm::mat3(m_lastView);
+		double turn = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			turn += glm::dot(turnMatrix[i], turnMatrix[i]);
+		}
+		turn = sqrt(turn);
+		double travel = glm::length(cameraPosition - glm::vec3(glm::inverse(m_lastView)[3]));
+
+		if ((travel > m_jumpDistance) || (turn > m_jumpRadians))
+		{
+			bFullUpdate = true;
+		}
+		else
+		{
+			m_travel += travel;
+			m_turn += turn;
+		}
+	}
+
+	if (bFullUpdate)
+	{
+		m_entries.resize(objects.size());
+		for (size_t i = 0; i < m_entries.size(); i++)
+		{
+			m_entries[i].bDirty = true;
+		}
+		m_travel = 0.0;
+		m_turn = 0.0;
+		m_fullUpdates++;
+	}
+
+	glm::vec4 planes[6];
+	ExtractFrustumPlanes(projection * view, planes);
+
+	m_visibleCount = 0;
+	for (size_t i = 0; i < m_entries.size(); i++)
+	{
+		ENTRY& entry = m_entries[i];
+		if (entry.bDirty)
+		{
+			entry.sphere = ComputeSphere(objects[i]);
+			entry.bDirty = false;
+			TestEntry(entry, planes, cameraPosition);
+			m_tests++;
+		}
+		else
+		{
+			double travel = m_travel - entry.travelAtTest;
+			double motion = travel + (m_turn - entry.turnAtTest) * (entry.distance + travel);
+			if (motion < entry.margin)
+			{
+				m_skippedTests++;
+			}
+			else
+			{
+				TestEntry(entry, planes, cameraPosition);
+				m_tests++;
+			}
+		}
+
+		if (entry.bVisible)
+		{
+			m_visibleCount++;
+		}
+	}
+
+	m_lastView = view;
+	m_lastProjection = projection;
+	m_lastCameraCuts = cameraCuts;
+	m_bValid = true;
+	m_frames++;
+	m_cpuSeconds += glfwGetTime() - startTime;
+}
+
+/***********************************************************
+ *  IsVisible()
+ *
+ *  This method returns the result of the last update for
+ *  an object; objects the cache has not seen are drawn.
+ ***********************************************************/
+bool VisibilityCache::IsVisible(size_t index) const
+{
+	if (index >= m_entries.size())
+	{
+		return(true);
+	}
+	return(m_entries[index].bVisible);
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method makes the next update recompute the sphere
+ *  of an object and test it.
+ ***********************************************************/
+void VisibilityCache::MarkDirty(size_t index)
+{
+	if (index < m_entries.size())
+	{
+		m_entries[index].bDirty = true;
+	}
+}
+
+/***********************************************************
+ *  PrintReport()
+ *
+ *  This method prints how many of the frustum tests the
+ *  cache skipped, the full updates and the CPU time.
+ ***********************************************************/
+void VisibilityCache::PrintReport() const
+{
+	long long total = m_tests + m_skippedTests;
+	if ((m_frames == 0) || (total == 0))
+	{
+		return;
+	}
+
+	std::cout << std::fixed << std::setprecision(1) << "INFO: Visibility cache: skipped " << m_skippedTests
+		<< " of " << total << " frustum tests (" << (double)m_skippedTests * 100.0 / (double)total
+		<< "%) over " << m_frames << " frames" << std::endl;
+	std::cout << std::setprecision(3) << "INFO: Visibility cache: " << m_fullUpdates << " full re-tests, "
+		<< m_visibleCount << " of " << m_entries.size() << " objects visible in the last frame, "
+		<< m_cpuSeconds * 1000.0 / (double)m_frames << " ms CPU per frame" << std::endl;
+	std::cout.unsetf(std::ios::floatfield);
+}
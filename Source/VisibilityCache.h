@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// visibilitycache.h
+// ============
+// frustum culling that keeps the results of earlier frames
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "SceneManager.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  VisibilityCache
+ *
+ *  This class culls the draw list against the view frustum
+ *  on the CPU and keeps the result of every object between
+ *  frames. With each test it stores how far the frustum
+ *  can move before the result changes, and the camera
+ *  motion of the following frames is added up against that
+ *  margin. Only objects close to a frustum plane, or marked
+ *  dirty, are tested again; a camera jump or a new
+ *  projection tests everything.
+ ***********************************************************/
+class VisibilityCache
+{
+public:
+	// constructor
+	VisibilityCache();
+	// destructor
+	~VisibilityCache();
+
+	// classify the objects with the matrices of a new frame; the
+	// cut count of the view manager changes on camera jumps
+	void Update(const std::vector<SceneManager::SCENE_OBJECT>& objects,
+		const glm::mat4& view, const glm::mat4& projection, unsigned int cameraCuts);
+	// result of the last update, true for unknown objects
+	bool IsVisible(size_t index) const;
+
+	// test an object again on the next update, e.g. after it moved
+	void MarkDirty(size_t index);
+	// test every object on the next update
+	void Invalidate() { m_bValid = false; }
+	// camera moves in one frame that count as a jump
+	void SetJumpThreshold(float distance, float degrees);
+
+	// the six planes of a view projection, normalized and facing
+	// inwards: left, right, bottom, top, near, far
+	static void ExtractFrustumPlanes(const glm::mat4& viewProjection, glm::vec4 planes[6]);
+
+	// print the share of the tests that were skipped
+	void PrintReport() const;
+
+private:
+	struct ENTRY
+	{
+		// world bounding sphere, center in xyz and radius in w
+		glm::vec4 sphere;
+		// distance a plane can move relative to the center
+		// before the result of the last test can change
+		float margin;
+		// distance of the center from the camera at the test
+		float distance;
+		// camera motion added up until the test
+		double travelAtTest;
+		double turnAtTest;
+		bool bVisible;
+		bool bDirty;
+	};
+
+	std::vector<ENTRY> m_entries;
+	// bounding spheres of the basic meshes in object space
+	glm::vec4 m_meshSpheres[SceneManager::MESH_COUNT];
+
+	// camera of the previous update
+	glm::mat4 m_lastView;
+	glm::mat4 m_lastProjection;
+	unsigned int m_lastCameraCuts;
+	bool m_bValid;
+	// camera translation and rotation (radians) added up since
+	// the last test of everything
+	double m_travel;
+	double m_turn;
+	float m_jumpDistance;
+	float m_jumpRadians;
+
+	long m_frames;
+	long m_fullUpdates;
+	long long m_tests;
+	long long m_skippedTests;
+	int m_visibleCount;
+	double m_cpuSeconds;
+
+	// world bounding sphere of a scene object
+	glm::vec4 ComputeSphere(const SceneManager::SCENE_OBJECT& object) const;
+	// test one object against the planes and store its margin
+	void TestEntry(ENTRY& entry, const glm::vec4 planes[6], const glm::vec3& cameraPosition);
+};
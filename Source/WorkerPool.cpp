@@ -0,0 +1,154 @@
+///////////////////////////////////////////////////////////////////////////////
+// WorkerPool.cpp
+// ==============
+// VERSION: 1.0
+//
+// DESCRIPTION:
+// This file defines the `WorkerPool` class, a small thread pool used for
+// CPU work that would otherwise stall the render loop, such as compressing
+// captured frames before they are written to disk.
+//
+// FUNCTIONALITY:
+// - Start a fixed number of worker threads when the pool is created.
+// - Hand out queued tasks in submission order.
+// - Let the caller wait for the queue to drain, or only until the backlog
+//   drops below a limit so memory use stays bounded.
+//
+// /////////////////////////////////////////////////////////////////////////////
+
+#include "WorkerPool.h"
+
+/***********************************************************
+ *  WorkerPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+WorkerPool::WorkerPool(int threadCount)
+{
+	m_runningTasks = 0;
+	m_bStopping = false;
+
+	if (threadCount <= 0)
+	{
+		// keep one core free for the render thread
+		threadCount = (int)std::thread::hardware_concurrency() - 1;
+		if (threadCount < 1)
+		{
+			threadCount = 1;
+		}
+	}
+
+	for (int i = 0; i < threadCount; i++)
+	{
+		m_threads.push_back(std::thread(&WorkerPool::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~WorkerPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+WorkerPool::~WorkerPool()
+{
+	WaitIdle();
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_taskReady.notify_all();
+
+	for (size_t i = 0; i < m_threads.size(); i++)
+	{
+		m_threads[i].join();
+	}
+	m_threads.clear();
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method queues a task for the next free worker.
+ ***********************************************************/
+void WorkerPool::Submit(const std::function<void()>& task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(task);
+	}
+	m_taskReady.notify_one();
+}
+
+/***********************************************************
+ *  WaitIdle()
+ *
+ *  This method blocks until every queued task has run.
+ ***********************************************************/
+void WorkerPool::WaitIdle()
+{
+	WaitForPending(0);
+}
+
+/***********************************************************
+ *  WaitForPending()
+ *
+ *  This method blocks until no more than the given number
+ *  of tasks are queued or running.
+ ***********************************************************/
+void WorkerPool::WaitForPending(int maxPending)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while ((int)m_tasks.size() + m_runningTasks > maxPending)
+	{
+		m_taskDone.wait(lock);
+	}
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method returns the number of tasks that are queued
+ *  or running.
+ ***********************************************************/
+int WorkerPool::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return((int)m_tasks.size() + m_runningTasks);
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method runs on every worker thread and executes
+ *  tasks until the pool shuts down.
+ ***********************************************************/
+void WorkerPool::WorkerLoop()
+{
+	while (true)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (m_tasks.empty() && !m_bStopping)
+			{
+				m_taskReady.wait(lock);
+			}
+			if (m_tasks.empty())
+			{
+				return;
+			}
+			task = m_tasks.front();
+			m_tasks.pop_front();
+			m_runningTasks++;
+		}
+
+		task();
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_runningTasks--;
+		}
+		m_taskDone.notify_all();
+	}
+}
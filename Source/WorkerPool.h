@@ -0,0 +1,60 @@
+///////////////////////////////////////////////////////////////////////////////
+// workerpool.h
+// ============
+// run CPU work such as image compression on background threads
+//
+//  Part of the 7-1 FinalProject and Milestones application.
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  WorkerPool
+ *
+ *  This class owns a fixed set of worker threads that take
+ *  tasks from a shared queue in submission order. Tasks
+ *  must not touch the OpenGL context, which stays on the
+ *  main thread.
+ ***********************************************************/
+class WorkerPool
+{
+public:
+	// constructor; zero threads uses one less than the cores
+	WorkerPool(int threadCount = 0);
+	// destructor; finishes the queued tasks first
+	~WorkerPool();
+
+	// queue a task for the next free worker
+	void Submit(const std::function<void()>& task);
+	// block until the queue is empty and every worker is idle
+	void WaitIdle();
+	// block until no more than the given number of tasks wait
+	void WaitForPending(int maxPending);
+
+	// number of tasks that are queued or running
+	int GetPendingCount();
+	// number of worker threads
+	int GetThreadCount() const { return((int)m_threads.size()); }
+
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()> > m_tasks;
+	std::mutex m_mutex;
+	// signalled when a task is queued or the pool shuts down
+	std::condition_variable m_taskReady;
+	// signalled when a task finishes
+	std::condition_variable m_taskDone;
+	// tasks that have been taken from the queue but not finished
+	int m_runningTasks;
+	bool m_bStopping;
+
+	// loop run by every worker thread
+	void WorkerLoop();
+};